@@ -32,6 +32,7 @@
 #include "errors.h"
 #include "fileio.h"
 #include "fileutils.h"
+#include "operationlog.h"
 
 namespace QInstaller {
 
@@ -171,7 +172,8 @@ BinaryLayout BinaryContent::binaryLayout(QFile *file, quint64 magicCookie)
     the file using binaryLayout() using \a magicCookie. Throws Error on failure.
 
     If \a operations is not 0, it is set to the performed operations from a previous run of for
-    example the maintenance tool.
+    example the maintenance tool. Operations from a binary OperationLog are not decoded yet, the
+    XML form written by earlier versions is read as well.
 
     If \a manager is not 0, it is first cleared and then set to the resource collections embedded
     into the binary.
@@ -201,16 +203,25 @@ void BinaryContent::readBinaryContent(QFile *file, QList<OperationBlob> *operati
             throw Error(QCoreApplication::translate("BinaryContent",
                 "Cannot seek to %1 to read the operation data.").arg(posOfOperationsBlock));
         }
-        // read the operations count
-        qint64 operationsCount = QInstaller::retrieveInt64(file);
-        // read the operations
-        for (int i = 0; i < operationsCount; ++i) {
-            const QString name = QInstaller::retrieveString(file);
-            const QString xml = QInstaller::retrieveString(file);
-            operations->append(OperationBlob(name, xml));
+        const QSharedPointer<const OperationLog> log = OperationLog::read(file);
+        if (log) {
+            operations->reserve(operations->count() + log->count());
+            for (int i = 0; i < log->count(); ++i)
+                operations->append(OperationBlob(log->name(i), log, i));
+        } else {
+            // written by an older maintenance tool, every operation is stored as XML
+            file->seek(posOfOperationsBlock);
+            // read the operations count
+            qint64 operationsCount = QInstaller::retrieveInt64(file);
+            // read the operations
+            for (int i = 0; i < operationsCount; ++i) {
+                const QString name = QInstaller::retrieveString(file);
+                const QString xml = QInstaller::retrieveString(file);
+                operations->append(OperationBlob(name, xml));
+            }
+            // operations count
+            Q_UNUSED(QInstaller::retrieveInt64(file)) // read it, but deliberately not used
         }
-        // operations count
-        Q_UNUSED(QInstaller::retrieveInt64(file)) // read it, but deliberately not used
     }
 
     if (manager) {    // read the collection index and data
@@ -31,12 +31,94 @@
 #include "errors.h"
 #include "fileio.h"
 
+#include <QDateTime>
 #include <QFileInfo>
 #include <QFlags>
+#include <QHash>
+#include <QMutex>
 #include <QUuid>
+#include <QWeakPointer>
+
+#include <climits>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <errno.h>
+#include <unistd.h>
+#endif
 
 namespace QInstaller {
 
+/*
+    Read only mapping of a whole file. Resources that wrap the same file share one mapping, which
+    is unmapped once the last of them is closed.
+*/
+class ResourceMapping
+{
+    Q_DISABLE_COPY(ResourceMapping)
+
+public:
+    static QSharedPointer<ResourceMapping> acquire(const QString &path);
+
+    ~ResourceMapping()
+    {
+        if (m_data)
+            m_file.unmap(m_data);
+    }
+
+    const char *data() const { return reinterpret_cast<const char *>(m_data); }
+    qint64 size() const { return m_size; }
+
+private:
+    explicit ResourceMapping(const QString &path)
+        : m_file(path)
+    {}
+
+    bool isCurrent(const QFileInfo &info) const
+    {
+        return info.size() == m_size && info.lastModified() == m_lastModified;
+    }
+
+    QFile m_file;
+    uchar *m_data = nullptr;
+    qint64 m_size = 0;
+    QDateTime m_lastModified;
+};
+
+struct ResourceMappings
+{
+    QMutex mutex;
+    QHash<QString, QWeakPointer<ResourceMapping> > mappings;
+};
+Q_GLOBAL_STATIC(ResourceMappings, resourceMappings)
+
+/*
+    Returns the shared mapping of the file \a path, or a null pointer if the file cannot be
+    mapped, for example because it is empty or the address space is too small.
+*/
+QSharedPointer<ResourceMapping> ResourceMapping::acquire(const QString &path)
+{
+    const QFileInfo info(path);
+    const QString key = info.absoluteFilePath();
+
+    QMutexLocker _(&resourceMappings->mutex);
+    QSharedPointer<ResourceMapping> mapping = resourceMappings->mappings.value(key).toStrongRef();
+    if (mapping && mapping->isCurrent(info))
+        return mapping;
+
+    mapping.reset(new ResourceMapping(path));
+    mapping->m_size = info.size();
+    mapping->m_lastModified = info.lastModified();
+    if (mapping->m_size <= 0 || !mapping->m_file.open(QIODevice::ReadOnly))
+        return QSharedPointer<ResourceMapping>();
+    mapping->m_data = mapping->m_file.map(0, mapping->m_size);
+    if (!mapping->m_data)
+        return QSharedPointer<ResourceMapping>();
+
+    resourceMappings->mappings.insert(key, mapping);
+    return mapping;
+}
+
 /*!
     \class QInstaller::OperationBlob
     \inmodule QtInstallerFramework
@@ -56,9 +138,27 @@ namespace QInstaller {
     \brief The name of the operation.
 */
 
+/*!
+    \fn OperationBlob::OperationBlob(const QString &n, const QSharedPointer<const OperationLog> &l, int i)
+
+    Constructs the operation blob for the operation named \a n, which is stored at index \a i of
+    the binary operation log \a l.
+*/
+
 /*!
     \variable QInstaller::OperationBlob::xml
-    \brief The XML representation of the operation.
+    \brief The XML representation of the operation, empty if the operation is stored in a binary
+        operation log.
+*/
+
+/*!
+    \variable QInstaller::OperationBlob::log
+    \brief The binary operation log the operation is stored in, if any.
+*/
+
+/*!
+    \variable QInstaller::OperationBlob::index
+    \brief The index of the operation in \l log.
 */
 
 /*!
@@ -72,6 +172,11 @@ namespace QInstaller {
 
     The resource name can be set at any time using setName() or during construction. The segment
     supplied during construction represents the offset and size of the resource inside the file.
+
+    When opened, the resource maps the file it wraps into memory. All resources of the same file
+    share this mapping, and the data of an open resource can be accessed without copying through
+    constData() or view(). If the file cannot be mapped, the resource falls back to positional
+    reads from the file.
 */
 
 /*!
@@ -158,12 +263,21 @@ bool Resource::open()
     if (isOpen())
         return false;
 
-    if (!m_file.open(QIODevice::ReadOnly)) {
+    m_mapping = ResourceMapping::acquire(m_file.fileName(QAbstractFileEngine::DefaultName));
+    if (m_mapping && m_segment.end() > m_mapping->size())
+        m_mapping.clear();
+
+    if (!m_mapping && !m_file.open(QIODevice::ReadOnly)) {
         setErrorString(m_file.errorString());
         return false;
     }
 
-    if (!QIODevice::open(QIODevice::ReadOnly)) {
+    // mapped data is copied straight to the caller, an additional read buffer would only cost
+    const OpenMode mode = m_mapping ? (QIODevice::ReadOnly | QIODevice::Unbuffered)
+        : QIODevice::ReadOnly;
+    if (!QIODevice::open(mode)) {
+        m_mapping.clear();
+        m_file.close();
         setErrorString(tr("Cannot open resource %1 for reading.").arg(QString::fromUtf8(m_name)));
         return false;
     }
@@ -174,10 +288,44 @@ bool Resource::open()
  */
 void Resource::close()
 {
+    m_mapping.clear();
     m_file.close();
     QIODevice::close();
 }
 
+/*!
+    Returns \c true if the resource is open and its data is read from a memory mapping of the
+    file.
+*/
+bool Resource::isMapped() const
+{
+    return !m_mapping.isNull();
+}
+
+/*!
+    Returns a pointer to the data of the resource if it is mapped into memory; otherwise returns
+    \c nullptr. The pointer stays valid until the resource is closed.
+
+    \sa isMapped()
+*/
+const char *Resource::constData() const
+{
+    return m_mapping ? m_mapping->data() + m_segment.start() : nullptr;
+}
+
+/*!
+    Returns the data of the resource without copying it if it is mapped into memory; otherwise
+    returns an empty byte array. The returned byte array must not outlive the open resource.
+
+    \sa isMapped(), constData()
+*/
+QByteArray Resource::view() const
+{
+    if (!m_mapping)
+        return QByteArray();
+    return QByteArray::fromRawData(constData(), int(qMin<qint64>(size(), INT_MAX)));
+}
+
 /*!
     \reimp
  */
@@ -196,11 +344,33 @@ qint64 Resource::readData(char* data, qint64 maxSize)
     if (maxSize <= 0)
         return 0;
 
-    const qint64 p = m_file.pos();
-    m_file.seek(m_segment.start() + pos());
-    const qint64 amountRead = m_file.read(data, maxSize);
-    m_file.seek(p);
-    return amountRead;
+    if (m_mapping) {
+        memcpy(data, constData() + pos(), maxSize);
+        return maxSize;
+    }
+    return readFile(data, maxSize, m_segment.start() + pos());
+}
+
+/*!
+    Reads at most \a maxSize bytes at \a offset of the underlying file into \a data, without
+    relying on the position of the file.
+*/
+qint64 Resource::readFile(char *data, qint64 maxSize, qint64 offset)
+{
+#ifdef Q_OS_UNIX
+    const int fd = m_file.handle();
+    if (fd >= 0) {
+        ssize_t amountRead;
+        do {
+            amountRead = ::pread(fd, data, size_t(maxSize), off_t(offset));
+        } while (amountRead < 0 && errno == EINTR);
+        return amountRead;
+    }
+#endif
+    // the file is not shared with anyone else, so there is no position to restore
+    if (!m_file.seek(offset))
+        return -1;
+    return m_file.read(data, maxSize);
 }
 
 /*!
@@ -228,9 +398,26 @@ qint64 Resource::writeData(const char* data, qint64 maxSize)
 void Resource::copyData(Resource *resource, QFileDevice *out)
 {
     qint64 left = resource->size();
-    char data[4096];
+    if (resource->isMapped()) {
+        const char *data = resource->constData() + resource->pos();
+        left -= resource->pos();
+        while (left > 0) {
+            const qint64 bytesWritten = out->write(data, qMin<qint64>(left, 1 << 24));
+            if (bytesWritten <= 0) {
+                throw QInstaller::Error(tr("Write failed after %1 bytes: %2")
+                    .arg(QString::number(resource->size() - left), out->errorString()));
+            }
+            data += bytesWritten;
+            left -= bytesWritten;
+        }
+        resource->seek(resource->size());
+        return;
+    }
+
+    QByteArray buffer(64 * 1024, Qt::Uninitialized);
+    char *data = buffer.data();
     while (left > 0) {
-        const qint64 len = qMin<qint64>(left, 4096);
+        const qint64 len = qMin<qint64>(left, buffer.size());
         const qint64 bytesRead = resource->read(data, len);
         if (bytesRead != len) {
             throw QInstaller::Error(tr("Read failed after %1 bytes: %2")
@@ -39,13 +39,20 @@
 
 namespace QInstaller {
 
+class OperationLog;
+
 struct OperationBlob {
     OperationBlob(const QString &n, const QString &x)
         : name(n), xml(x) {}
+    OperationBlob(const QString &n, const QSharedPointer<const OperationLog> &l, int i)
+        : name(n), log(l), index(i) {}
     QString name;
     QString xml;
+    QSharedPointer<const OperationLog> log;
+    int index = -1;
 };
 
+class ResourceMapping;
 
 class INSTALLER_EXPORT Resource : public QIODevice
 {
@@ -70,10 +77,15 @@ public:
     Range<qint64> segment() const { return m_segment; }
     void setSegment(const Range<qint64> &segment) { m_segment = segment; }
 
+    bool isMapped() const;
+    const char *constData() const;
+    QByteArray view() const;
+
     void copyData(QFileDevice *out) { copyData(this, out); }
     static void copyData(Resource *archive, QFileDevice *out);
 
 private:
+    qint64 readFile(char *data, qint64 maxSize, qint64 offset);
     qint64 readData(char *data, qint64 maxSize);
     qint64 writeData(const char *data, qint64 maxSize);
 
@@ -84,6 +96,7 @@ private:
     QFSFileEngine m_file;
     QByteArray m_name;
     Range<qint64> m_segment;
+    QSharedPointer<ResourceMapping> m_mapping;
 };
 
 
@@ -28,6 +28,8 @@
 
 #include "binaryformatengine.h"
 
+#include "errors.h"
+
 #include <QRegExp>
 
 namespace {
@@ -191,24 +193,14 @@ bool BinaryFormatEngine::copy(const QString &newName)
     if (!target.open(QIODevice::WriteOnly))
         return false;
 
-    qint64 bytesLeft = size();
     if (!open(QIODevice::ReadOnly))
         return false;
 
-    char data[4096];
-    while(bytesLeft > 0) {
-        const qint64 len = qMin<qint64>(bytesLeft, 4096);
-        const qint64 bytesRead = read(data, len);
-        if (bytesRead != len) {
-            close();
-            return false;
-        }
-        const qint64 bytesWritten = target.write(data, len);
-        if (bytesWritten != len) {
-            close();
-            return false;
-        }
-        bytesLeft -= len;
+    try {
+        Resource::copyData(m_resource.data(), &target);
+    } catch (const Error &) {
+        close();
+        return false;
     }
     close();
 
@@ -290,4 +282,37 @@ qint64 BinaryFormatEngine::size() const
     return m_resource.isNull() ? 0 : m_resource->size();
 }
 
+/*!
+    \internal
+
+    Maps the requested part of an open resource without copying, if the resource data is memory
+    mapped. Unmapping is a no-op, the mapping belongs to the resource.
+*/
+bool BinaryFormatEngine::extension(Extension extension, const ExtensionOption *option,
+    ExtensionReturn *output)
+{
+    if (extension == MapExtension) {
+        const MapExtensionOption *options = static_cast<const MapExtensionOption *>(option);
+        MapExtensionReturn *returnValue = static_cast<MapExtensionReturn *>(output);
+        if (m_resource.isNull() || !m_resource->isMapped() || options->offset < 0
+            || options->size < 0 || options->offset + options->size > m_resource->size()) {
+            return false;
+        }
+        returnValue->address = reinterpret_cast<uchar *>(const_cast<char *>(
+            m_resource->constData() + options->offset));
+        return true;
+    }
+    if (extension == UnMapExtension)
+        return true;
+    return false;
+}
+
+/*!
+    \internal
+*/
+bool BinaryFormatEngine::supportsExtension(Extension extension) const
+{
+    return extension == MapExtension || extension == UnMapExtension;
+}
+
 } // namespace QInstaller
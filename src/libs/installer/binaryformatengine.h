@@ -59,6 +59,10 @@ public:
     Iterator *beginEntryList(QDir::Filters filters, const QStringList &filterNames);
     QStringList entryList(QDir::Filters filters, const QStringList &filterNames) const;
 
+    bool extension(Extension extension, const ExtensionOption *option = 0,
+        ExtensionReturn *output = 0);
+    bool supportsExtension(Extension extension) const;
+
 private:
     QString m_fileNamePath;
 
@@ -388,8 +388,10 @@ void Component::setValue(const QString &key, const QString &value)
     if (d->m_vars.value(key) == normalizedValue)
         return;
 
-    if (key == scName)
+    if (key == scName) {
         d->m_componentName = normalizedValue;
+        d->m_core->componentTreeChanged();
+    }
     if (key == scCheckable)
         this->setCheckable(normalizedValue.toLower() == scTrue);
     if (key == scExpandedByDefault)
@@ -440,6 +442,7 @@ void Component::appendComponent(Component *component)
         parent->removeComponent(component);
     component->d->m_parentComponent = this;
     setTristate(d->m_childComponents.count() > 0);
+    d->m_core->componentTreeChanged();
 }
 
 /*!
@@ -452,6 +455,7 @@ void Component::removeComponent(Component *component)
         component->d->m_parentComponent = 0;
         d->m_childComponents.removeAll(component);
         d->m_allChildComponents.removeAll(component);
+        d->m_core->componentTreeChanged();
     }
 }
 
@@ -0,0 +1,175 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include "componentindex.h"
+
+#include "component.h"
+#include "constants.h"
+#include "packagemanagercore.h"
+#include "updater.h"
+
+namespace QInstaller {
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::VersionRequirement
+    \internal
+    \brief The VersionRequirement class holds a parsed version requirement, such as \c{>=4.5}.
+
+    Parsing the comparator once allows matching the requirement against many versions
+    without re-evaluating a regular expression for every comparison.
+*/
+
+/*!
+    Parses \a requirement. A requirement without comparator is treated as an exact match.
+*/
+VersionRequirement::VersionRequirement(const QString &requirement)
+{
+    int pos = 0;
+    while (pos < requirement.size()) {
+        const QChar c = requirement.at(pos);
+        if (c != QLatin1Char('<') && c != QLatin1Char('=') && c != QLatin1Char('>'))
+            break;
+        ++pos;
+    }
+
+    if (pos == 0) {
+        m_allowEqual = true;
+    } else {
+        const QStringRef comparator = requirement.leftRef(pos);
+        m_allowEqual = comparator.contains(QLatin1Char('='));
+        m_allowLess = comparator.contains(QLatin1Char('<'));
+        m_allowMore = comparator.contains(QLatin1Char('>'));
+    }
+    m_version = requirement.mid(pos);
+}
+
+/*!
+    Returns \c true if \a version fulfills the requirement.
+*/
+bool VersionRequirement::matches(const QString &version) const
+{
+    if (m_allowEqual && version == m_version)
+        return true;
+
+    if (m_allowLess && KDUpdater::compareVersion(m_version, version) > 0)
+        return true;
+
+    if (m_allowMore && KDUpdater::compareVersion(m_version, version) < 0)
+        return true;
+
+    return false;
+}
+
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::ComponentRequirement
+    \internal
+    \brief The ComponentRequirement class holds a parsed component name and optional
+    version requirement, such as \c{org.qt-project.sdk.qt:>=4.5}.
+*/
+
+ComponentRequirement::ComponentRequirement(const QString &requirement)
+{
+    QString version;
+    PackageManagerCore::parseNameAndVersion(requirement, &m_name, &version);
+    if (!version.isEmpty())
+        m_version = VersionRequirement(version);
+}
+
+/*!
+    Returns \c true if \a component has the required name and its version, either
+    remote or local, matches the version requirement.
+*/
+bool ComponentRequirement::matches(const Component *component) const
+{
+    if (m_name.isEmpty() || component->name() != m_name)
+        return false;
+
+    if (m_version.isEmpty())
+        return true;
+
+    return m_version.matches(component->value(scVersion));
+}
+
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::ComponentIndex
+    \internal
+    \brief The ComponentIndex class provides hashed lookup of components by name.
+
+    Components sharing a name are kept in insertion order, so find() returns the same
+    component as a linear scan over the list the index was built from.
+*/
+
+ComponentIndex::ComponentIndex(const QList<Component *> &components)
+{
+    m_components.reserve(components.count());
+    foreach (Component *component, components)
+        insert(component);
+}
+
+void ComponentIndex::clear()
+{
+    m_components.clear();
+}
+
+void ComponentIndex::insert(Component *component)
+{
+    m_components[component->name()].append(component);
+}
+
+/*!
+    Returns the first component matching \a requirement, or \c 0 if there is none.
+*/
+Component *ComponentIndex::find(const QString &requirement) const
+{
+    if (requirement.isEmpty())
+        return nullptr;
+    return find(ComponentRequirement(requirement));
+}
+
+/*!
+    \overload
+*/
+Component *ComponentIndex::find(const ComponentRequirement &requirement) const
+{
+    const auto it = m_components.constFind(requirement.name());
+    if (it == m_components.constEnd())
+        return nullptr;
+
+    foreach (Component *component, it.value()) {
+        if (requirement.matches(component))
+            return component;
+    }
+    return nullptr;
+}
+
+} // namespace QInstaller
@@ -0,0 +1,93 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+#ifndef COMPONENTINDEX_H
+#define COMPONENTINDEX_H
+
+#include "installer_global.h"
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+namespace QInstaller {
+
+class Component;
+
+class INSTALLER_EXPORT VersionRequirement
+{
+public:
+    VersionRequirement() = default;
+    explicit VersionRequirement(const QString &requirement);
+
+    bool isEmpty() const { return m_version.isEmpty() && !m_allowEqual; }
+    QString version() const { return m_version; }
+
+    bool matches(const QString &version) const;
+
+private:
+    QString m_version;
+    bool m_allowEqual = false;
+    bool m_allowLess = false;
+    bool m_allowMore = false;
+};
+
+class INSTALLER_EXPORT ComponentRequirement
+{
+public:
+    ComponentRequirement() = default;
+    explicit ComponentRequirement(const QString &requirement);
+
+    QString name() const { return m_name; }
+    VersionRequirement version() const { return m_version; }
+
+    bool matches(const Component *component) const;
+
+private:
+    QString m_name;
+    VersionRequirement m_version;
+};
+
+class INSTALLER_EXPORT ComponentIndex
+{
+public:
+    ComponentIndex() = default;
+    explicit ComponentIndex(const QList<Component *> &components);
+
+    void clear();
+    void insert(Component *component);
+
+    Component *find(const QString &requirement) const;
+    Component *find(const ComponentRequirement &requirement) const;
+
+private:
+    QHash<QString, QList<Component *> > m_components;
+};
+
+} // namespace QInstaller
+
+#endif // COMPONENTINDEX_H
@@ -271,24 +271,35 @@ bool CreateLocalRepositoryOperation::performOperation()
                     repo.filePath(name), nameVersionHash.value(name), &helper));
                 emit outputTextChanged(helper.m_files.first());
 
-                // copy the 7z files that are inside the component index into the target
+                // copy the 7z files that are inside the component index into the target, straight
+                // from the binary so that the copy can be done by the kernel
                 const ResourceCollection collection = manager.collectionByName(name.toUtf8());
-                foreach (const QSharedPointer<Resource> &resource, collection.resources()) {
-                    const bool isOpen = resource->isOpen();
-                    if ((!isOpen) && (!resource->open()))
-                        continue;
+                qint64 collectionSize = 0;
+                foreach (const QSharedPointer<Resource> &resource, collection.resources())
+                    collectionSize += resource->segment().length();
 
+                qint64 collectionCopied = 0;
+                foreach (const QSharedPointer<Resource> &resource, collection.resources()) {
                     QFile target(repo.filePath(name) + QDir::separator()
                         + QString::fromUtf8(resource->name()));
                     QInstaller::openForWrite(&target);
-                    resource->copyData(&target);
+                    if (!file.seek(resource->segment().start())) {
+                        throw QInstaller::Error(tr("Cannot seek to resource \"%1\" in \"%2\": %3")
+                            .arg(QString::fromUtf8(resource->name()),
+                            QDir::toNativeSeparators(file.fileName()), file.errorString()));
+                    }
+                    QInstaller::appendData(&target, &file, resource->segment().length(),
+                        [&](qint64 copied, qint64) {
+                            const double done = double(collectionCopied + copied)
+                                / double(qMax<qint64>(1, collectionSize));
+                            emit progressChanged(.65f + (((double(i) + done)
+                                / double(names.count())) * .25f));
+                        });
+                    collectionCopied += resource->segment().length();
                     helper.m_files.prepend(target.fileName());
                     emit outputTextChanged(helper.m_files.first());
-
-                    if (!isOpen) // If we reach that point, either the resource was opened already.
-                        resource->close();         // or we did open it and have to close it again.
                 }
-                emit progressChanged(.65f + ((double(i) / double(names.count())) * .25f));
+                emit progressChanged(.65f + ((double(i + 1) / double(names.count())) * .25f));
             }
         }
 
@@ -31,6 +31,7 @@
 #include "component.h"
 #include "messageboxhandler.h"
 #include "packagemanagercore.h"
+#include "settings.h"
 #include "utils.h"
 
 #include "filedownloader.h"
@@ -38,6 +39,7 @@
 
 #include <QtCore/QFile>
 #include <QtCore/QTimerEvent>
+#include <QtCore/QUrl>
 
 using namespace QInstaller;
 using namespace KDUpdater;
@@ -45,15 +47,20 @@ using namespace KDUpdater;
 
 /*!
     Creates a new DownloadArchivesJob with \a parent.
+
+    Up to maxConcurrentDownloads() archives, together with their checksum files, are downloaded
+    at the same time, but never more than maxConcurrentDownloadsPerHost() from the same host.
+    The limits are initialized from the installer settings.
 */
 DownloadArchivesJob::DownloadArchivesJob(PackageManagerCore *core)
     : Job(core)
     , m_core(core)
-    , m_downloader(nullptr)
     , m_archivesDownloaded(0)
     , m_archivesToDownloadCount(0)
+    , m_maxConcurrentDownloads(core->settings().maxConcurrentDownloads())
+    , m_maxConcurrentDownloadsPerHost(core->settings().maxConcurrentDownloadsPerHost())
     , m_canceled(false)
-    , m_lastFileProgress(0)
+    , m_waitingForUserInput(false)
     , m_progressChangedTimerId(0)
 {
     setCapabilities(Cancelable);
@@ -64,8 +71,8 @@ DownloadArchivesJob::DownloadArchivesJob(PackageManagerCore *core)
 */
 DownloadArchivesJob::~DownloadArchivesJob()
 {
-    if (m_downloader)
-        m_downloader->deleteLater();
+    foreach (FileDownloader *downloader, m_downloads.keys())
+        downloader->deleteLater();
 }
 
 /*!
@@ -78,13 +85,39 @@ void DownloadArchivesJob::setArchivesToDownload(const QList<QPair<QString, QStri
     m_archivesToDownloadCount = archives.count();
 }
 
+/*!
+    Returns \c true if \a archive has been downloaded and registered in the installer's file
+    system, or if it was skipped because it cannot be downloaded at all.
+*/
+bool DownloadArchivesJob::isArchiveProcessed(const QString &archive) const
+{
+    return m_processedArchives.contains(archive);
+}
+
+/*!
+    Sets the maximum number of simultaneous downloads to \a count. Values smaller than one are
+    treated as one, which results in strictly sequential downloads.
+*/
+void DownloadArchivesJob::setMaxConcurrentDownloads(int count)
+{
+    m_maxConcurrentDownloads = qMax(1, count);
+}
+
+/*!
+    Sets the maximum number of simultaneous downloads from a single host to \a count.
+*/
+void DownloadArchivesJob::setMaxConcurrentDownloadsPerHost(int count)
+{
+    m_maxConcurrentDownloadsPerHost = qMax(1, count);
+}
+
 /*!
     \reimp
 */
 void DownloadArchivesJob::doStart()
 {
     m_archivesDownloaded = 0;
-    fetchNextArchiveHash();
+    startPendingDownloads();
 }
 
 /*!
@@ -93,94 +126,134 @@ void DownloadArchivesJob::doStart()
 void DownloadArchivesJob::doCancel()
 {
     m_canceled = true;
-    if (m_downloader != nullptr)
-        m_downloader->cancelDownload();
+    if (!m_waitingForUserInput)
+        cancelRunningDownloads(); // otherwise done once the message box returns
 }
 
-void DownloadArchivesJob::fetchNextArchiveHash()
+/*!
+    Fills the free download slots with pending archives, respecting the per host limit. Finishes
+    the job once all archives have been downloaded and registered.
+*/
+void DownloadArchivesJob::startPendingDownloads()
 {
-    if (m_core->testChecksum()) {
-        if (m_canceled) {
-            finishWithError(tr("Canceled"));
-            return;
-        }
+    if (m_waitingForUserInput)
+        return;
 
-        if (m_archivesToDownload.isEmpty()) {
-            emitFinished();
-            return;
+    // the job was canceled or failed, and already reported as finished
+    if (m_canceled) {
+        cancelRunningDownloads();
+        return;
+    }
+
+    for (int i = 0; i < m_archivesToDownload.count()
+         && m_downloads.count() < m_maxConcurrentDownloads;) {
+        const QString host = QUrl(m_archivesToDownload.at(i).second).host();
+        if (m_downloadsPerHost.value(host) >= m_maxConcurrentDownloadsPerHost) {
+            ++i;
+            continue;
         }
+        startDownload(m_archivesToDownload.takeAt(i));
+    }
 
-        if (m_downloader)
-            m_downloader->deleteLater();
+    if (m_downloads.isEmpty() && m_archivesToDownload.isEmpty())
+        emitFinished();
+}
 
-        m_downloader = setupDownloader(QLatin1String(".sha1"));
-        if (!m_downloader) {
-            m_archivesToDownload.removeFirst();
-            QMetaObject::invokeMethod(this, "fetchNextArchiveHash", Qt::QueuedConnection);
-            return;
-        }
+/*!
+    Starts downloading \a archive. If checksums are tested and the archive's hash is not known yet,
+    the hash file is downloaded first.
+*/
+void DownloadArchivesJob::startDownload(const Archive &archive)
+{
+    const bool fetchHash = m_core->testChecksum() && !m_archiveHashes.contains(archive.first);
+
+    FileDownloader *downloader = fetchHash
+        ? setupDownloader(archive, QLatin1String(".sha1"))
+        : setupDownloader(archive, QString(), m_core->value(scUrlQueryString));
+    if (!downloader) {
+        --m_archivesToDownloadCount;
+        m_archiveHashes.remove(archive.first);
+        m_processedArchives.insert(archive.first);
+        emit archiveProcessed(archive.first);
+        return;
+    }
+
+    m_downloads.insert(downloader, archive);
+    ++m_downloadsPerHost[downloader->url().host()];
 
-        connect(m_downloader, &FileDownloader::downloadCompleted,
+    if (fetchHash) {
+        connect(downloader, &FileDownloader::downloadCompleted,
                 this, &DownloadArchivesJob::finishedHashDownload, Qt::QueuedConnection);
-        m_downloader->download();
     } else {
-        QMetaObject::invokeMethod(this, "fetchNextArchive", Qt::QueuedConnection);
+        emit progressChanged(currentProgress());
+        connect(downloader, SIGNAL(downloadProgress(double)), this, SLOT(emitDownloadProgress(double)));
+        connect(downloader, &FileDownloader::downloadCompleted,
+                this, &DownloadArchivesJob::registerFile, Qt::QueuedConnection);
     }
+    downloader->download();
 }
 
-void DownloadArchivesJob::finishedHashDownload()
+/*!
+    Removes \a downloader from the list of running downloads and returns the archive it fetched.
+    The downloader is scheduled for deletion.
+*/
+DownloadArchivesJob::Archive DownloadArchivesJob::takeDownload(FileDownloader *downloader)
 {
-    Q_ASSERT(m_downloader != nullptr);
-
-    QFile sha1HashFile(m_downloader->downloadedFileName());
-    if (sha1HashFile.open(QFile::ReadOnly)) {
-        m_currentHash = sha1HashFile.readAll();
-        fetchNextArchive();
-    } else {
-        finishWithError(tr("Downloading hash signature failed."));
-    }
+    const QString host = downloader->url().host();
+    if (--m_downloadsPerHost[host] <= 0)
+        m_downloadsPerHost.remove(host);
+    m_downloadProgress.remove(downloader);
+    m_lastUrl = downloader->url().toString();
+    downloader->deleteLater();
+    return m_downloads.take(downloader);
 }
 
 /*!
-    Fetches the next archive and registers it in the installer.
+    Aborts all running downloads without reporting their individual results.
 */
-void DownloadArchivesJob::fetchNextArchive()
+void DownloadArchivesJob::cancelRunningDownloads()
 {
-    if (m_canceled) {
-        finishWithError(tr("Canceled"));
-        return;
+    foreach (FileDownloader *downloader, m_downloads.keys()) {
+        disconnect(downloader, nullptr, this, nullptr);
+        downloader->cancelDownload();
+        takeDownload(downloader);
     }
+    m_archivesToRetry.clear();
+}
 
-    if (m_archivesToDownload.isEmpty()) {
-        emitFinished();
+void DownloadArchivesJob::finishedHashDownload()
+{
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(sender());
+    if (!m_downloads.contains(downloader))
         return;
-    }
 
-    if (m_downloader != nullptr)
-        m_downloader->deleteLater();
+    const QString fileName = downloader->downloadedFileName();
+    const Archive archive = takeDownload(downloader);
 
-    m_downloader = setupDownloader(QString(), m_core->value(scUrlQueryString));
-    if (!m_downloader) {
-        m_archivesToDownload.removeFirst();
-        QMetaObject::invokeMethod(this, "fetchNextArchiveHash", Qt::QueuedConnection);
-        return;
+    QFile sha1HashFile(fileName);
+    if (sha1HashFile.open(QFile::ReadOnly)) {
+        m_archiveHashes.insert(archive.first, sha1HashFile.readAll());
+        if (m_canceled || m_waitingForUserInput)
+            m_archivesToDownload.prepend(archive);
+        else
+            startDownload(archive);
+        startPendingDownloads();
+    } else {
+        finishWithError(tr("Downloading hash signature failed."));
     }
-
-    emit progressChanged(double(m_archivesDownloaded) / m_archivesToDownloadCount);
-    connect(m_downloader, SIGNAL(downloadProgress(double)), this, SLOT(emitDownloadProgress(double)));
-    connect(m_downloader, &FileDownloader::downloadCompleted,
-            this, &DownloadArchivesJob::registerFile, Qt::QueuedConnection);
-
-    m_downloader->download();
 }
 
 /*!
-    Emits the global download progress during a single download in a lazy way (uses a timer to reduce to
-    much processChanged).
+    Emits the global download progress during the downloads in a lazy way (uses a timer to reduce
+    to much processChanged).
 */
 void DownloadArchivesJob::emitDownloadProgress(double progress)
 {
-    m_lastFileProgress = progress;
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(sender());
+    if (!m_downloads.contains(downloader))
+        return;
+
+    m_downloadProgress.insert(downloader, progress);
     if (!m_progressChangedTimerId)
         m_progressChangedTimerId = startTimer(5);
 }
@@ -193,88 +266,169 @@ void DownloadArchivesJob::timerEvent(QTimerEvent *event)
     if (event->timerId() == m_progressChangedTimerId) {
         killTimer(m_progressChangedTimerId);
         m_progressChangedTimerId = 0;
-        emit progressChanged((double(m_archivesDownloaded) + m_lastFileProgress) / m_archivesToDownloadCount);
+        emit progressChanged(currentProgress());
     }
 }
 
+/*!
+    Returns the aggregated progress of all finished and currently running archive downloads.
+*/
+double DownloadArchivesJob::currentProgress() const
+{
+    if (m_archivesToDownloadCount <= 0)
+        return 1.0;
+
+    double progress = m_archivesDownloaded;
+    foreach (double fileProgress, m_downloadProgress)
+        progress += fileProgress;
+    return progress / m_archivesToDownloadCount;
+}
+
 /*!
     Registers the just downloaded file in the installer's file system.
 */
 void DownloadArchivesJob::registerFile()
 {
-    Q_ASSERT(m_downloader != nullptr);
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(sender());
+    if (!m_downloads.contains(downloader))
+        return;
+
+    const QString fileName = downloader->downloadedFileName();
+    const QByteArray sha1Sum = downloader->sha1Sum().toHex();
+    const Archive archive = takeDownload(downloader);
 
     if (m_canceled)
         return;
 
-    if (m_core->testChecksum() && m_currentHash != m_downloader->sha1Sum().toHex()) {
+    if (m_core->testChecksum() && m_archiveHashes.value(archive.first) != sha1Sum) {
+        m_archiveHashes.remove(archive.first);
+        if (m_waitingForUserInput) {
+            m_archivesToRetry.append(archive);
+            return;
+        }
         //TODO: Maybe we should try to download the file again automatically
-        const QMessageBox::Button res =
-            MessageBoxHandler::critical(MessageBoxHandler::currentBestSuitParent(),
-            QLatin1String("DownloadError"), tr("Download Error"), tr("Hash verification while "
-            "downloading failed. This is a temporary error, please retry."),
-            QMessageBox::Retry | QMessageBox::Cancel, QMessageBox::Cancel);
+        const QMessageBox::StandardButton res = askForRetry(archive, QLatin1String("DownloadError"),
+            tr("Hash verification while downloading failed. This is a temporary error, please retry."),
+            QMessageBox::Cancel);
 
+        if (m_canceled) {
+            cancelRunningDownloads();
+            return;
+        }
         if (res == QMessageBox::Cancel) {
             finishWithError(tr("Cannot verify Hash"));
             return;
         }
-    } else {
-        ++m_archivesDownloaded;
-        if (m_progressChangedTimerId) {
-            killTimer(m_progressChangedTimerId);
-            m_progressChangedTimerId = 0;
-            emit progressChanged(double(m_archivesDownloaded) / m_archivesToDownloadCount);
-        }
+        retryFailedDownloads();
+        return;
+    }
 
-        const QPair<QString, QString> pair = m_archivesToDownload.takeFirst();
-        BinaryFormatEngineHandler::instance()->registerResource(pair.first,
-            m_downloader->downloadedFileName());
+    ++m_archivesDownloaded;
+    m_archiveHashes.remove(archive.first);
+    if (m_progressChangedTimerId) {
+        killTimer(m_progressChangedTimerId);
+        m_progressChangedTimerId = 0;
     }
-    fetchNextArchiveHash();
+    emit progressChanged(currentProgress());
+
+    BinaryFormatEngineHandler::instance()->registerResource(archive.first, fileName);
+    m_processedArchives.insert(archive.first);
+    emit archiveProcessed(archive.first);
+    startPendingDownloads();
 }
 
 void DownloadArchivesJob::downloadCanceled()
 {
-    emitFinishedWithError(Job::Canceled, m_downloader->errorString());
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(sender());
+    if (!m_downloads.contains(downloader))
+        return;
+
+    const QString error = downloader->errorString();
+    takeDownload(downloader);
+    // a retry message box might still be open, its answer must not restart the finished job
+    m_canceled = true;
+    cancelRunningDownloads();
+    emitFinishedWithError(Job::Canceled, error);
 }
 
 void DownloadArchivesJob::downloadFailed(const QString &error)
 {
+    FileDownloader *const downloader = qobject_cast<FileDownloader *>(sender());
+    if (!m_downloads.contains(downloader))
+        return;
+
+    const Archive archive = takeDownload(downloader);
     if (m_canceled)
         return;
 
-    const QMessageBox::StandardButton b =
-        MessageBoxHandler::critical(MessageBoxHandler::currentBestSuitParent(),
-        QLatin1String("archiveDownloadError"), tr("Download Error"), tr("Cannot download archive %1: %2")
-        .arg(m_archivesToDownload.first().second, error), QMessageBox::Retry | QMessageBox::Cancel);
+    // Downloads failing while the user is asked already share the pending answer.
+    if (m_waitingForUserInput) {
+        m_archivesToRetry.append(archive);
+        return;
+    }
+
+    const QMessageBox::StandardButton b = askForRetry(archive, QLatin1String("archiveDownloadError"),
+        tr("Cannot download archive %1: %2").arg(archive.second, error), QMessageBox::NoButton);
 
-    if (b == QMessageBox::Retry)
-        QMetaObject::invokeMethod(this, "fetchNextArchiveHash", Qt::QueuedConnection);
-    else
-        downloadCanceled();
+    if (m_canceled) {
+        cancelRunningDownloads();
+    } else if (b == QMessageBox::Retry) {
+        retryFailedDownloads();
+    } else {
+        m_canceled = true;
+        cancelRunningDownloads();
+        emitFinishedWithError(Job::Canceled, error);
+    }
+}
+
+/*!
+    Shows a message box asking whether the download of \a archive should be retried. The
+    remaining downloads keep running while the message box is shown. Returns the button
+    the user clicked.
+*/
+QMessageBox::StandardButton DownloadArchivesJob::askForRetry(const Archive &archive,
+    const QString &identifier, const QString &text, QMessageBox::StandardButton defaultButton)
+{
+    m_waitingForUserInput = true;
+    const QMessageBox::StandardButton button =
+        MessageBoxHandler::critical(MessageBoxHandler::currentBestSuitParent(), identifier,
+        tr("Download Error"), text, QMessageBox::Retry | QMessageBox::Cancel, defaultButton);
+    m_waitingForUserInput = false;
+
+    m_archivesToRetry.prepend(archive);
+    return button;
+}
+
+/*!
+    Puts all archives that failed while the user was asked back in front of the download queue.
+*/
+void DownloadArchivesJob::retryFailedDownloads()
+{
+    m_archivesToDownload = m_archivesToRetry + m_archivesToDownload;
+    m_archivesToRetry.clear();
+    startPendingDownloads();
 }
 
 void DownloadArchivesJob::finishWithError(const QString &error)
 {
-    const FileDownloader *const dl = qobject_cast<const FileDownloader*> (sender());
+    const QString url = m_lastUrl;
+    m_canceled = true;
+    cancelRunningDownloads();
     const QString msg = tr("Cannot fetch archives: %1\nError while loading %2");
-    if (dl != nullptr)
-        emitFinishedWithError(QInstaller::DownloadError, msg.arg(error, dl->url().toString()));
-    else
-        emitFinishedWithError(QInstaller::DownloadError, msg.arg(error, m_downloader->url().toString()));
+    emitFinishedWithError(QInstaller::DownloadError, msg.arg(error, url));
 }
 
-KDUpdater::FileDownloader *DownloadArchivesJob::setupDownloader(const QString &suffix, const QString &queryString)
+KDUpdater::FileDownloader *DownloadArchivesJob::setupDownloader(const Archive &archive,
+    const QString &suffix, const QString &queryString)
 {
     KDUpdater::FileDownloader *downloader = nullptr;
-    const QFileInfo fi = QFileInfo(m_archivesToDownload.first().first);
+    const QFileInfo fi = QFileInfo(archive.first);
     const Component *const component = m_core->componentByName(PackageManagerCore::checkableName(QFileInfo(fi.path()).fileName()));
     if (component) {
         QString fullQueryString;
         if (!queryString.isEmpty())
             fullQueryString = QLatin1String("?") + queryString;
-        const QUrl url(m_archivesToDownload.first().second + suffix + fullQueryString);
+        const QUrl url(archive.second + suffix + fullQueryString);
         const QString &scheme = url.scheme();
         downloader = FileDownloaderFactory::instance().create(scheme, this);
 
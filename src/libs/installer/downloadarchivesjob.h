@@ -31,7 +31,11 @@
 
 #include "job.h"
 
+#include <QtCore/QHash>
 #include <QtCore/QPair>
+#include <QtCore/QSet>
+
+#include <QtWidgets/QMessageBox>
 
 QT_BEGIN_NAMESPACE
 class QTimerEvent;
@@ -56,11 +60,19 @@ public:
 
     int numberOfDownloads() const { return m_archivesDownloaded; }
     void setArchivesToDownload(const QList<QPair<QString, QString> > &archives);
+    bool isArchiveProcessed(const QString &archive) const;
+
+    int maxConcurrentDownloads() const { return m_maxConcurrentDownloads; }
+    void setMaxConcurrentDownloads(int count);
+
+    int maxConcurrentDownloadsPerHost() const { return m_maxConcurrentDownloadsPerHost; }
+    void setMaxConcurrentDownloadsPerHost(int count);
 
 Q_SIGNALS:
     void progressChanged(double progress);
     void outputTextChanged(const QString &progress);
     void downloadStatusChanged(const QString &status);
+    void archiveProcessed(const QString &archive);
 
 protected:
     void doStart();
@@ -72,25 +84,42 @@ protected Q_SLOTS:
     void downloadCanceled();
     void downloadFailed(const QString &error);
     void finishWithError(const QString &error);
-    void fetchNextArchive();
-    void fetchNextArchiveHash();
+    void startPendingDownloads();
     void finishedHashDownload();
     void emitDownloadProgress(double progress);
 
 private:
-    KDUpdater::FileDownloader *setupDownloader(const QString &suffix = QString(), const QString &queryString = QString());
+    typedef QPair<QString, QString> Archive;
+
+    void startDownload(const Archive &archive);
+    Archive takeDownload(KDUpdater::FileDownloader *downloader);
+    void cancelRunningDownloads();
+    QMessageBox::StandardButton askForRetry(const Archive &archive, const QString &identifier,
+        const QString &text, QMessageBox::StandardButton defaultButton);
+    void retryFailedDownloads();
+    double currentProgress() const;
+    KDUpdater::FileDownloader *setupDownloader(const Archive &archive, const QString &suffix = QString(),
+        const QString &queryString = QString());
 
 private:
     PackageManagerCore *m_core;
-    KDUpdater::FileDownloader *m_downloader;
+    QHash<KDUpdater::FileDownloader *, Archive> m_downloads;
+    QHash<KDUpdater::FileDownloader *, double> m_downloadProgress;
+    QHash<QString, int> m_downloadsPerHost;
+    QHash<QString, QByteArray> m_archiveHashes;
+    QSet<QString> m_processedArchives;
 
     int m_archivesDownloaded;
     int m_archivesToDownloadCount;
-    QList<QPair<QString, QString> > m_archivesToDownload;
+    QList<Archive> m_archivesToDownload;
+    QList<Archive> m_archivesToRetry;
+
+    int m_maxConcurrentDownloads;
+    int m_maxConcurrentDownloadsPerHost;
 
     bool m_canceled;
-    QByteArray m_currentHash;
-    double m_lastFileProgress;
+    bool m_waitingForUserInput;
+    QString m_lastUrl;
     int m_progressChangedTimerId;
 };
 
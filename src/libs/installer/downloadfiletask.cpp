@@ -29,15 +29,18 @@
 #include "downloadfiletask.h"
 
 #include "downloadfiletask_p.h"
+#include "networksession.h"
 
 #include <QCoreApplication>
 #include <QDir>
 #include <QEventLoop>
 #include <QFileInfo>
-#include <QNetworkProxyFactory>
+#include <QNetworkAccessManager>
 #include <QSslError>
 #include <QTemporaryFile>
 
+#include <algorithm>
+
 namespace QInstaller {
 
 AuthenticationRequiredException::AuthenticationRequiredException(Type type, const QString &message)
@@ -50,21 +53,25 @@ Downloader::Downloader()
     : m_finished(0)
 {
     connect(&m_timer, &QTimer::timeout, this, &Downloader::onTimeout);
-    connect(&m_nam, &QNetworkAccessManager::finished, this, &Downloader::onFinished);
+    // Requests to a host might have been released by another thread.
+    connect(&NetworkSession::instance(), &NetworkSession::requestReleased, this,
+        &Downloader::startPendingDownloads, Qt::QueuedConnection);
 }
 
 Downloader::~Downloader()
 {
-    m_nam.disconnect();
     for (const auto &pair : m_downloads) {
+        pair.first->manager()->disconnect(this);
         pair.first->disconnect();
         pair.first->abort();
         pair.first->deleteLater();
     }
+    foreach (const QUrl &url, m_acquiredRequests)
+        NetworkSession::instance().releaseRequest(url);
 }
 
 void Downloader::download(QFutureInterface<FileTaskResult> &fi, const QList<FileTaskItem> &items,
-    QNetworkProxyFactory *networkProxyFactory)
+    KDUpdater::FileDownloaderProxyFactory *networkProxyFactory)
 {
     m_items = items;
     m_futureInterface = &fi;
@@ -72,11 +79,7 @@ void Downloader::download(QFutureInterface<FileTaskResult> &fi, const QList<File
     fi.reportStarted();
     fi.setExpectedResultCount(items.count());
 
-    m_nam.setProxyFactory(networkProxyFactory);
-    connect(&m_nam, &QNetworkAccessManager::authenticationRequired, this,
-        &Downloader::onAuthenticationRequired);
-    connect(&m_nam, &QNetworkAccessManager::proxyAuthenticationRequired, this,
-            &Downloader::onProxyAuthenticationRequired);
+    m_proxyFactory.reset(networkProxyFactory);
     QTimer::singleShot(0, this, &Downloader::doDownload);
 }
 
@@ -85,9 +88,14 @@ void Downloader::doDownload()
     m_timer.start(1000); // Use a timer to check for canceled downloads.
 
     foreach (const FileTaskItem &item, m_items) {
-        if (!startDownload(item))
+        const QUrl source = item.source();
+        if (!source.isValid()) {
+            startDownload(item); // reports the invalid URL
             break;
+        }
+        m_pendingItems[source.scheme() + QLatin1String("://") + source.authority()].append(item);
     }
+    startPendingDownloads();
 
     if (m_items.isEmpty() || m_futureInterface->isCanceled()) {
         m_futureInterface->reportFinished();
@@ -95,6 +103,31 @@ void Downloader::doDownload()
     }
 }
 
+/*!
+    \internal
+
+    Starts the pending downloads as long as the network session allows more requests to their
+    host. The others are started once requests are released.
+*/
+void Downloader::startPendingDownloads()
+{
+    NetworkSession &session = NetworkSession::instance();
+    QMap<QString, QList<FileTaskItem>>::iterator it = m_pendingItems.begin();
+    while (it != m_pendingItems.end()) {
+        QList<FileTaskItem> &items = it.value();
+        while (!items.isEmpty() && !m_futureInterface->isCanceled()) {
+            const QUrl source = items.first().source();
+            if (!session.tryAcquireRequest(source))
+                break;
+            m_acquiredRequests.insert(startDownload(items.takeFirst()), source);
+        }
+        if (items.isEmpty())
+            it = m_pendingItems.erase(it);
+        else
+            ++it;
+    }
+}
+
 
 // -- private slots
 
@@ -186,6 +219,9 @@ void Downloader::onReadyRead()
 
 void Downloader::onFinished(QNetworkReply *reply)
 {
+    if (m_downloads.find(reply) == m_downloads.cend())
+        return;
+
     Data &data = *m_downloads[reply];
     const QString filename = data.file ? data.file->fileName() : QString();
     if (!m_futureInterface->isCanceled()) {
@@ -204,6 +240,11 @@ void Downloader::onFinished(QNetworkReply *reply)
                 foreach (const QUrl &redirect, redirects)
                     m_redirects.insertMulti(redirectReply, redirect);
                 m_redirects.insertMulti(redirectReply, url);
+                // the redirect keeps the request acquired for the original host
+                if (redirectReply)
+                    m_acquiredRequests.insert(redirectReply, m_acquiredRequests.take(reply));
+                else if (m_acquiredRequests.contains(reply))
+                    NetworkSession::instance().releaseRequest(m_acquiredRequests.take(reply));
 
                 m_downloads.erase(reply);
                 m_redirects.remove(reply);
@@ -230,15 +271,29 @@ void Downloader::onFinished(QNetworkReply *reply)
         if (expectedCheckSum != data.observer->checkSum().toHex())
             checksumMismatch = true;
     }
-    m_futureInterface->reportResult(FileTaskResult(filename, data.observer->checkSum(), data.taskItem,
-                                                  checksumMismatch));
+    FileTaskResult result(filename, data.observer->checkSum(), data.taskItem, checksumMismatch);
+    if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+        if (data.file)
+            data.file->remove();
+        result.insert(TaskRole::TargetFile, QString());
+        result.insert(TaskRole::ChecksumMismatch, false);
+        result.insert(TaskRole::NotModified, true);
+    }
+    if (reply->hasRawHeader("ETag"))
+        result.insert(TaskRole::ETag, reply->rawHeader("ETag"));
+    if (reply->hasRawHeader("Last-Modified"))
+        result.insert(TaskRole::LastModified, reply->rawHeader("Last-Modified"));
+    m_futureInterface->reportResult(result);
 
     m_downloads.erase(reply);
     m_redirects.remove(reply);
     reply->deleteLater();
+    if (m_acquiredRequests.contains(reply))
+        NetworkSession::instance().releaseRequest(m_acquiredRequests.take(reply));
 
     m_finished++;
-    if (m_downloads.empty() || m_futureInterface->isCanceled()) {
+    startPendingDownloads();
+    if ((m_downloads.empty() && m_pendingItems.isEmpty()) || m_futureInterface->isCanceled()) {
         m_futureInterface->reportFinished();
         emit finished();    // emit finished, so the event loop can shutdown
     }
@@ -258,7 +313,8 @@ void Downloader::onError(QNetworkReply::NetworkError error)
         //Do not throw error if Updates.xml not found. The repository might be removed
         //with RepositoryUpdate in Updates.xml later.
         //: %2 is a sentence describing the error
-        if (data.taskItem.source().contains(QLatin1String("Updates.xml"), Qt::CaseInsensitive)) {
+        if (data.taskItem.value(TaskRole::Optional).toBool()
+            || data.taskItem.source().contains(QLatin1String("Updates.xml"), Qt::CaseInsensitive)) {
             qDebug() << QString::fromLatin1("Network error while downloading '%1': %2.").arg(
                    data.taskItem.source(), reply->errorString());
         } else {
@@ -316,6 +372,16 @@ void Downloader::onAuthenticationRequired(QNetworkReply *reply, QAuthenticator *
 
 void Downloader::onProxyAuthenticationRequired(const QNetworkProxy &proxy, QAuthenticator *)
 {
+    // The manager is shared with other downloaders, only report if one of our replies goes
+    // through the proxy. All replies of a manager use the same proxies.
+    QNetworkAccessManager *const manager = qobject_cast<QNetworkAccessManager *>(sender());
+    const auto ownReply = std::find_if(m_downloads.cbegin(), m_downloads.cend(),
+        [manager](const std::pair<QNetworkReply *const, std::unique_ptr<Data>> &pair) {
+            return pair.first->manager() == manager;
+        });
+    if (ownReply == m_downloads.cend())
+        return;
+
     // Report to GUI thread.
     // (MetadataJob will ask for username/password, and restart the download ...)
     AuthenticationRequiredException e(AuthenticationRequiredException::Type::Proxy,
@@ -371,10 +437,24 @@ QNetworkReply *Downloader::startDownload(const FileTaskItem &item)
         return 0;
     }
 
-    QNetworkReply *reply = m_nam.get(QNetworkRequest(source));
+    QNetworkRequest request(source);
+    const QVariantHash headers = item.value(TaskRole::RequestHeaders).toHash();
+    for (QVariantHash::const_iterator it = headers.constBegin(); it != headers.constEnd(); ++it)
+        request.setRawHeader(it.key().toLatin1(), it.value().toByteArray());
+
+    QNetworkReply *reply = NetworkSession::instance().get(request,
+        m_proxyFactory ? m_proxyFactory->clone() : nullptr);
     std::unique_ptr<Data> data(new Data(item));
     m_downloads[reply] = std::move(data);
 
+    // The session picks the manager by proxies, so connect to the one of each reply.
+    QNetworkAccessManager *const manager = reply->manager();
+    connect(manager, &QNetworkAccessManager::authenticationRequired, this,
+        &Downloader::onAuthenticationRequired, Qt::UniqueConnection);
+    connect(manager, &QNetworkAccessManager::proxyAuthenticationRequired, this,
+        &Downloader::onProxyAuthenticationRequired, Qt::UniqueConnection);
+
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() { onFinished(reply); });
     connect(reply, &QIODevice::readyRead, this, &Downloader::onReadyRead);
     connect(reply, SIGNAL(error(QNetworkReply::NetworkError)), this,
         SLOT(onError(QNetworkReply::NetworkError)));
@@ -40,7 +40,12 @@ namespace QInstaller {
 namespace TaskRole {
 enum
 {
-    Authenticator = TaskRole::TargetFile + 10
+    Authenticator = TaskRole::TargetFile + 10,
+    RequestHeaders,     // QVariantHash of raw headers added to the request
+    ETag,               // validators of the reply, for conditional requests later on
+    LastModified,
+    NotModified,        // the server answered with 304, no file got written
+    Optional            // network errors are only logged, the repository might not provide the file
 };
 }
 
@@ -33,7 +33,6 @@
 #include <observer.h>
 
 #include <QFile>
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkRequest>
 #include <QTimer>
@@ -42,6 +41,7 @@
 #include <unordered_map>
 
 QT_BEGIN_NAMESPACE
+class QNetworkAccessManager;
 class QSslError;
 QT_END_NAMESPACE
 
@@ -77,13 +77,14 @@ public:
     ~Downloader();
 
     void download(QFutureInterface<FileTaskResult> &fi, const QList<FileTaskItem> &items,
-        QNetworkProxyFactory *networkProxyFactory);
+        KDUpdater::FileDownloaderProxyFactory *networkProxyFactory);
 
 signals:
     void finished();
 
 private slots:
     void doDownload();
+    void startPendingDownloads();
     void onReadyRead();
     void onFinished(QNetworkReply *reply);
     void onError(QNetworkReply::NetworkError error);
@@ -102,8 +103,10 @@ private:
 
     QTimer m_timer;
     int m_finished;
-    QNetworkAccessManager m_nam;
+    std::unique_ptr<KDUpdater::FileDownloaderProxyFactory> m_proxyFactory;
     QList<FileTaskItem> m_items;
+    QMap<QString, QList<FileTaskItem>> m_pendingItems; // by host
+    QHash<QNetworkReply*, QUrl> m_acquiredRequests;
     QMultiHash<QNetworkReply*, QUrl> m_redirects;
     std::unordered_map<QNetworkReply*, std::unique_ptr<Data>> m_downloads;
 };
@@ -28,6 +28,9 @@
 
 #include "extractarchiveoperation_p.h"
 
+#include "remoteclient.h"
+#include "remotefileoperations.h"
+
 #include <QEventLoop>
 #include <QThreadPool>
 #include <QFileInfo>
@@ -54,6 +57,14 @@ bool ExtractArchiveOperation::performOperation()
     const QString archivePath = args.at(0);
     const QString targetDir = args.at(1);
 
+    // Let the elevated server extract the archive on its own instead of writing every file
+    // through it. Archives inside the installer binary can only be read by this process.
+    if (RemoteClient::instance().isActive() && !archivePath.contains(QLatin1String("://"))) {
+        RemoteFileOperations remote;
+        if (remote.isAvailable())
+            return extractOnServer(&remote, archivePath, targetDir);
+    }
+
     Receiver receiver;
     Callback callback;
 
@@ -99,6 +110,36 @@ bool ExtractArchiveOperation::performOperation()
     return true;
 }
 
+/*!
+    Extracts \a archivePath to \a targetDir in the server process connected to by \a remote.
+*/
+bool ExtractArchiveOperation::extractOnServer(RemoteFileOperations *remote,
+    const QString &archivePath, const QString &targetDir)
+{
+    emit outputTextChanged(tr("Extracting \"%1\"").arg(QFileInfo(archivePath).fileName()));
+    const bool success = remote->extractArchive(archivePath, targetDir,
+        [this](quint64 completed, quint64 total) {
+            if (total > 0)
+                emit progressChanged(double(completed) / total);
+        });
+
+    m_files.clear();
+    foreach (const QString &file, remote->extractedFiles())
+        fileFinished(QDir::toNativeSeparators(file));
+    setValue(QLatin1String("files"), m_files);
+
+    // delete all backups we can delete right now, remember the rest
+    foreach (const RemoteFileOperations::BackupFiles::value_type &backup, remote->backupFiles())
+        deleteFileNowOrLater(backup.second);
+
+    if (!success) {
+        setError(UserDefinedError);
+        setErrorString(remote->errorString());
+        return false;
+    }
+    return true;
+}
+
 bool ExtractArchiveOperation::undoOperation()
 {
     Q_ASSERT(arguments().count() == 2);
@@ -35,6 +35,8 @@
 
 namespace QInstaller {
 
+class RemoteFileOperations;
+
 class INSTALLER_EXPORT ExtractArchiveOperation : public QObject, public Operation
 {
     Q_OBJECT
@@ -56,6 +58,9 @@ private Q_SLOTS:
     void fileFinished(const QString &progress);
 
 private:
+    bool extractOnServer(RemoteFileOperations *remote, const QString &archivePath,
+        const QString &targetDir);
+
     QStringList m_files;
     class Callback;
     class Runnable;
@@ -182,7 +182,8 @@ public:
         }
 
         try {
-            Lib7z::extractArchive(&archive, m_targetDir, m_callback);
+            Lib7z::extractArchive(&archive, m_targetDir, m_callback,
+                Lib7z::extractThreadCount());
             emit finished(true, QString());
         } catch (const Lib7z::SevenZipException& e) {
             emit finished(false, tr("Error while extracting archive \"%1\": %2").arg(m_archivePath,
@@ -30,6 +30,7 @@
 
 #include "errors.h"
 #include "range.h"
+#include "remoteclient.h"
 
 #include <QCoreApplication>
 #include <QByteArray>
@@ -37,6 +38,82 @@
 #include <QFileDevice>
 #include <QString>
 
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// amount of data handed to the kernel at once, small enough to report progress regularly
+const qint64 KernelCopyBlockSize = 16 * 1024 * 1024;
+const qint64 BufferedCopyBlockSize = 1024 * 1024;
+
+#ifdef Q_OS_LINUX
+/*
+    Lets the kernel copy \a size bytes at \a inPos of \a in to \a outPos of \a out. The data is
+    shared between the files if the file system can clone extents, otherwise it is copied by
+    copy_file_range() or sendfile() without passing through user space. Returns the number of
+    bytes copied, which is less than \a size if the kernel cannot copy between the two files.
+*/
+qint64 kernelCopy(int in, qint64 inPos, int out, qint64 outPos, qint64 size,
+    const QInstaller::CopyProgressCallback &progress)
+{
+#ifdef FICLONERANGE
+    struct file_clone_range range;
+    range.src_fd = in;
+    range.src_offset = inPos;
+    range.src_length = size;
+    range.dest_offset = outPos;
+    if (::ioctl(out, FICLONERANGE, &range) == 0) {
+        if (progress)
+            progress(size, size);
+        return size;
+    }
+#endif
+
+    qint64 copied = 0;
+#ifdef __NR_copy_file_range
+    while (copied < size) {
+        loff_t inOffset = inPos + copied;
+        loff_t outOffset = outPos + copied;
+        const ssize_t n = ::syscall(__NR_copy_file_range, in, &inOffset, out, &outOffset,
+            size_t(qMin(size - copied, KernelCopyBlockSize)), 0u);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        copied += n;
+        if (progress)
+            progress(copied, size);
+    }
+#endif
+
+    // sendfile() writes at the file offset of out, so it needs to be in place
+    if (copied < size && ::lseek(out, outPos + copied, SEEK_SET) >= 0) {
+        while (copied < size) {
+            off_t inOffset = inPos + copied;
+            const ssize_t n = ::sendfile(out, in, &inOffset,
+                size_t(qMin(size - copied, KernelCopyBlockSize)));
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            copied += n;
+            if (progress)
+                progress(copied, size);
+        }
+    }
+    return copied;
+}
+#endif
+
+} // namespace
+
 qint64 QInstaller::retrieveInt64(QFileDevice *in)
 {
     qint64 n = 0;
@@ -92,10 +169,11 @@ QByteArray QInstaller::retrieveData(QFileDevice *in, qint64 size)
     return ba;
 }
 
-void QInstaller::appendData(QFileDevice *out, QFileDevice *in, qint64 size)
+void QInstaller::appendData(QFileDevice *out, QFileDevice *in, qint64 size,
+    const CopyProgressCallback &progress)
 {
     Q_ASSERT(!in->isSequential());
-    QInstaller::blockingCopy(in, out, size);
+    QInstaller::blockingCopy(in, out, size, progress);
 }
 
 void QInstaller::openForRead(QFileDevice *dev)
@@ -146,23 +224,47 @@ qint64 QInstaller::blockingRead(QFileDevice *in, char *buffer, qint64 size)
     return size;
 }
 
-qint64 QInstaller::blockingCopy(QFileDevice *in, QFileDevice *out, qint64 size)
+/*
+    Copies \a size bytes from the current position of \a in to the current position of \a out and
+    returns the number of bytes copied. On Linux the kernel copies between plain local files
+    directly, everywhere else, for devices without a file handle and for files opened through the
+    remote file engine the data goes through a large buffer.
+    \a progress, if set, is called with the number of bytes copied so far.
+*/
+qint64 QInstaller::blockingCopy(QFileDevice *in, QFileDevice *out, qint64 size,
+    const CopyProgressCallback &progress)
 {
-    static const qint64 blockSize = 4096;
-    QByteArray ba(blockSize, '\0');
-    qint64 actual = qMin(blockSize, size);
-    while (actual > 0) {
+    qint64 copied = 0;
+#ifdef Q_OS_LINUX
+    // data appended by the kernel would ignore O_APPEND, pending writes need to go out first;
+    // remote file engines return handles of the server process, they are no use in here
+    if (size > 0 && !RemoteClient::instance().isActive() && in->handle() >= 0
+        && out->handle() >= 0 && !out->openMode().testFlag(QIODevice::Append) && out->flush()) {
+        const qint64 inPos = in->pos();
+        const qint64 outPos = out->pos();
+        copied = kernelCopy(in->handle(), inPos, out->handle(), outPos, size, progress);
+        if (copied > 0 && !(in->seek(inPos + copied) && out->seek(outPos + copied))) {
+            throw Error(QCoreApplication::translate("QInstaller", "Copy failed: %1")
+                .arg(in->errorString().isEmpty() ? out->errorString() : in->errorString()));
+        }
+    }
+#endif
+
+    QByteArray ba(int(qMin(BufferedCopyBlockSize, size - copied)), Qt::Uninitialized);
+    while (copied < size) {
+        const qint64 actual = qMin<qint64>(ba.size(), size - copied);
         try {
             QInstaller::blockingRead(in, ba.data(), actual);
             QInstaller::blockingWrite(out, ba.constData(), actual);
-            size -= actual;
-            actual = qMin(blockSize, size);
         } catch (const Error &error) {
             throw Error(QCoreApplication::translate("QInstaller", "Copy failed: %1")
                 .arg(error.message()));
         }
+        copied += actual;
+        if (progress)
+            progress(copied, size);
     }
-    return size;
+    return copied;
 }
 
 qint64 QInstaller::blockingWrite(QFileDevice *out, const QByteArray &data)
@@ -31,6 +31,8 @@
 
 #include "installer_global.h"
 
+#include <functional>
+
 QT_BEGIN_NAMESPACE
 class QByteArray;
 class QFileDevice;
@@ -42,6 +44,8 @@ class Range;
 
 namespace QInstaller {
 
+typedef std::function<void(qint64 copied, qint64 total)> CopyProgressCallback;
+
 qint64 INSTALLER_EXPORT retrieveInt64(QFileDevice *in);
 void INSTALLER_EXPORT appendInt64(QFileDevice *out, qint64 n);
 
@@ -55,14 +59,16 @@ QByteArray INSTALLER_EXPORT retrieveByteArray(QFileDevice *in);
 void INSTALLER_EXPORT appendByteArray(QFileDevice *out, const QByteArray &ba);
 
 QByteArray INSTALLER_EXPORT retrieveData(QFileDevice *in, qint64 size);
-void INSTALLER_EXPORT appendData(QFileDevice *out, QFileDevice *in, qint64 size);
+void INSTALLER_EXPORT appendData(QFileDevice *out, QFileDevice *in, qint64 size,
+    const CopyProgressCallback &progress = CopyProgressCallback());
 
 void INSTALLER_EXPORT openForRead(QFileDevice *dev);
 void INSTALLER_EXPORT openForWrite(QFileDevice *dev);
 void INSTALLER_EXPORT openForAppend(QFileDevice *dev);
 
 qint64 INSTALLER_EXPORT blockingRead(QFileDevice *in, char *buffer, qint64 size);
-qint64 INSTALLER_EXPORT blockingCopy(QFileDevice *in, QFileDevice *out, qint64 size);
+qint64 INSTALLER_EXPORT blockingCopy(QFileDevice *in, QFileDevice *out, qint64 size,
+    const CopyProgressCallback &progress = CopyProgressCallback());
 
 qint64 INSTALLER_EXPORT blockingWrite(QFileDevice *out, const QByteArray &data);
 qint64 INSTALLER_EXPORT blockingWrite(QFileDevice *out, const char *data, qint64 size);
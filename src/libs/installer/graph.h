@@ -33,26 +33,35 @@
 #include <QList>
 #include <QPair>
 #include <QSet>
+#include <QVector>
+
+#include <algorithm>
 
 namespace QInstaller {
 
+/*
+    A directed graph where an edge from node to edge means node depends on edge. Nodes are
+    stored once and referenced by index, adjacency is kept in per-node index arrays. Sorting
+    uses Kahn's algorithm and does not recurse, so deep dependency chains are fine.
+*/
 template <class T> class Graph
 {
 public:
-    inline Graph() {}
+    inline Graph() : m_hasCycle(false) {}
     explicit Graph(const QList<T> &nodes)
+        : m_hasCycle(false)
     {
         addNodes(nodes);
     }
 
     const QList<T> nodes() const
     {
-        return m_graph.keys();
+        return m_nodes.toList();
     }
 
     void addNode(const T &node)
     {
-        m_graph.insert(node, QSet<T>());
+        indexOf(node);
     }
 
     void addNodes(const QList<T> &nodes)
@@ -63,12 +72,22 @@ public:
 
     QList<T> edges(const T &node) const
     {
-        return m_graph.value(node).toList();
+        QList<T> result;
+        const int index = m_index.value(node, -1);
+        if (index < 0)
+            return result;
+        foreach (int edge, m_edges.at(index))
+            result.append(m_nodes.at(edge));
+        return result;
     }
 
     void addEdge(const T &node, const T &edge)
     {
-        m_graph[node].insert(edge);
+        const int from = indexOf(node);
+        const int to = indexOf(edge);
+        QVector<int> &edges = m_edges[from];
+        if (!edges.contains(to))
+            edges.append(to);
     }
 
     void addEdges(const T &node, const QList<T> &edges)
@@ -82,20 +101,33 @@ public:
         return m_hasCycle;
     }
 
+    /*
+        Returns a pair of nodes on the last detected cycle: the first one depends on the second,
+        which in turn depends indirectly on the first.
+    */
     QPair<T, T> cycle() const
     {
         return m_cycle;
     }
 
+    /*
+        Returns the nodes of the last detected cycle. Every node depends on the next one, the
+        last node depends on the first one.
+    */
+    QList<T> cyclePath() const
+    {
+        return m_cyclePath;
+    }
+
+    /*
+        Returns all nodes ordered so that every node comes after the nodes it depends on. If the
+        graph has a cycle, the nodes on and depending on the cycle are left out.
+    */
     QList<T> sort() const
     {
-        QSet<T> visitedNodes;
         QList<T> resolvedNodes;
-
-        m_hasCycle = false;
-        m_cycle = qMakePair(T(), T());
-        foreach (const T &node, nodes())
-            visit(node, &resolvedNodes, &visitedNodes);
+        foreach (const QList<T> &level, levels())
+            resolvedNodes.append(level);
         return resolvedNodes;
     }
 
@@ -106,39 +138,119 @@ public:
         return result;
     }
 
-private:
-    void visit(const T &node, QList<T> *const resolvedNodes, QSet<T> *const visitedNodes) const
+    /*
+        Returns the nodes grouped in levels. The first level contains the nodes without
+        dependencies, every following level the nodes whose dependencies are all in previous
+        levels. Nodes of one level do not depend on each other. If the graph has a cycle, the
+        nodes on and depending on the cycle are left out.
+    */
+    QList<QList<T> > levels() const
     {
-        if (m_hasCycle)
-            return;
+        const int count = m_nodes.count();
 
-        // if we visited this node already
-        if (visitedNodes->contains(node)) {
-            // and if the node is already in the ordered list
-            if (resolvedNodes->contains(node))
-                return;
+        // reverse adjacency in compressed form: the dependees of node i are
+        // dependees[offsets[i]] up to dependees[offsets[i + 1]]
+        QVector<int> offsets(count + 1, 0);
+        QVector<int> pending(count, 0);
+        for (int i = 0; i < count; ++i) {
+            pending[i] = m_edges.at(i).count();
+            foreach (int edge, m_edges.at(i))
+                ++offsets[edge + 1];
+        }
+        for (int i = 0; i < count; ++i)
+            offsets[i + 1] += offsets[i];
+        QVector<int> dependees(offsets.at(count));
+        QVector<int> fill(offsets.mid(0, count));
+        for (int i = 0; i < count; ++i) {
+            foreach (int edge, m_edges.at(i))
+                dependees[fill[edge]++] = i;
+        }
 
-            m_hasCycle = true;
-            m_cycle.second = node;
-            return; // if not yet in the ordered list, we detected a cycle
+        QVector<int> current;
+        for (int i = 0; i < count; ++i) {
+            if (pending.at(i) == 0)
+                current.append(i);
         }
 
-        // mark this node as visited
-        visitedNodes->insert(node);
+        QList<QList<T> > result;
+        int resolvedCount = 0;
+        QVector<int> next;
+        while (!current.isEmpty()) {
+            QList<T> level;
+            level.reserve(current.count());
+            foreach (int node, current) {
+                level.append(m_nodes.at(node));
+                for (int i = offsets.at(node); i < offsets.at(node + 1); ++i) {
+                    const int dependee = dependees.at(i);
+                    if (--pending[dependee] == 0)
+                        next.append(dependee);
+                }
+            }
+            resolvedCount += current.count();
+            result.append(level);
+            std::sort(next.begin(), next.end());
+            current.swap(next);
+            next.clear();
+        }
 
-        m_cycle.first = node;
-        // recursively visit all adjacency
-        foreach (const T &adjacency, edges(node))
-            visit(adjacency, resolvedNodes, visitedNodes);
+        m_hasCycle = resolvedCount < count;
+        m_cycle = qMakePair(T(), T());
+        m_cyclePath.clear();
+        if (m_hasCycle)
+            findCycle(pending);
+        return result;
+    }
 
-        // append this node to the ordered list
-        resolvedNodes->append(node);
+private:
+    int indexOf(const T &node)
+    {
+        const typename QHash<T, int>::const_iterator it = m_index.constFind(node);
+        if (it != m_index.constEnd())
+            return it.value();
+
+        const int index = m_nodes.count();
+        m_index.insert(node, index);
+        m_nodes.append(node);
+        m_edges.append(QVector<int>());
+        return index;
+    }
+
+    // Every unresolved node has an unresolved dependency, so following those from any unresolved
+    // node has to end up in a cycle.
+    void findCycle(const QVector<int> &pending) const
+    {
+        const int count = m_nodes.count();
+        QVector<int> position(count, -1);
+        QVector<int> path;
+
+        int node = 0;
+        while (node < count && pending.at(node) == 0)
+            ++node;
+
+        while (position.at(node) < 0) {
+            position[node] = path.count();
+            path.append(node);
+            foreach (int edge, m_edges.at(node)) {
+                if (pending.at(edge) > 0) {
+                    node = edge;
+                    break;
+                }
+            }
+        }
+
+        for (int i = position.at(node); i < path.count(); ++i)
+            m_cyclePath.append(m_nodes.at(path.at(i)));
+        m_cycle = qMakePair(m_cyclePath.last(), m_cyclePath.first());
     }
 
 private:
+    QHash<T, int> m_index;
+    QVector<T> m_nodes;
+    QVector<QVector<int> > m_edges;
+
     mutable bool m_hasCycle;
-    QHash<T, QSet<T> > m_graph;
-    mutable QPair<T,T> m_cycle;
+    mutable QPair<T, T> m_cycle;
+    mutable QList<T> m_cyclePath;
 };
 
 }
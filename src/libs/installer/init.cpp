@@ -49,6 +49,7 @@
 #include "consumeoutputoperation.h"
 
 #include "lib7z_facade.h"
+#include "networksession.h"
 #include "utils.h"
 
 #include "updateoperationfactory.h"
@@ -167,6 +168,10 @@ void QInstaller::init()
     factory.registerUpdateOperation<SettingsOperation>(QLatin1String("Settings"));
 
     FileDownloaderFactory::setFollowRedirects(true);
+    FileDownloaderFactory::setRequestFunction([](const QNetworkRequest &request,
+                                                 QNetworkProxyFactory *proxyFactory) {
+        return NetworkSession::instance().get(request, proxyFactory);
+    });
 
    qInstallMessageHandler(messageHandler);
 }
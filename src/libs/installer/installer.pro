@@ -121,6 +121,12 @@ HEADERS += packagemanagercore.h \
     binarycontent.h \
     binarylayout.h \
     installercalculator.h \
+    componentindex.h \
+    operationlog.h \
+    updatesindex.h \
+    metadatacache.h \
+    remotefileoperations.h \
+    networksession.h \
     uninstallercalculator.h \
     componentchecker.h \
     proxycredentialsdialog.h \
@@ -202,6 +208,12 @@ SOURCES += packagemanagercore.cpp \
     binarycontent.cpp \
     binarylayout.cpp \
     installercalculator.cpp \
+    componentindex.cpp \
+    operationlog.cpp \
+    updatesindex.cpp \
+    metadatacache.cpp \
+    remotefileoperations.cpp \
+    networksession.cpp \
     uninstallercalculator.cpp \
     componentchecker.cpp \
     proxycredentialsdialog.cpp \
@@ -34,10 +34,14 @@
 
 #include <QDebug>
 
+#include <algorithm>
+
 namespace QInstaller {
 
 InstallerCalculator::InstallerCalculator(const QList<Component *> &allComponents)
     : m_allComponents(allComponents)
+    , m_componentIndex(allComponents)
+    , m_autoDependOnIndexed(false)
 {
 }
 
@@ -98,6 +102,51 @@ void InstallerCalculator::realAppendToInstallComponents(Component *component, co
     if (!component->isInstalled(version) || component->updateRequested()) {
         m_orderedComponentsToInstall.append(component);
         m_toInstallComponentIds.insert(component->name());
+        satisfyAutoDependency(component->name());
+    }
+}
+
+void InstallerCalculator::initAutoDependOnIndex()
+{
+    m_autoDependOnIndexed = true;
+
+    for (int i = 0; i < m_allComponents.count(); ++i) {
+        Component *component = m_allComponents.at(i);
+        const QSet<QString> autoDependencies = component->autoDependencies().toSet();
+        if (autoDependencies.isEmpty())
+            continue;
+
+        m_autoDependOnRemaining.insert(component, autoDependencies.count());
+        m_autoDependOnPosition.insert(component, i);
+        foreach (const QString &name, autoDependencies)
+            m_autoDependOnDependents[name].append(component);
+    }
+
+    if (m_autoDependOnRemaining.isEmpty())
+        return;
+
+    // installed packages satisfy auto depend on values as well as the scheduled ones
+    PackageManagerCore *core = m_allComponents.first()->packageManagerCore();
+    m_installedPackageNames = core->localInstalledPackages().keys().toSet();
+    foreach (const QString &name, m_installedPackageNames)
+        satisfyAutoDependency(name);
+    foreach (const QString &name, m_toInstallComponentIds)
+        satisfyAutoDependency(name);
+}
+
+void InstallerCalculator::satisfyAutoDependency(const QString &name)
+{
+    if (!m_autoDependOnIndexed || m_autoDependOnSatisfied.contains(name))
+        return;
+    m_autoDependOnSatisfied.insert(name);
+
+    const auto it = m_autoDependOnDependents.constFind(name);
+    if (it == m_autoDependOnDependents.constEnd())
+        return;
+
+    foreach (Component *component, it.value()) {
+        if (--m_autoDependOnRemaining[component] == 0)
+            m_autoDependOnResolved.append(component);
     }
 }
 
@@ -112,6 +161,9 @@ bool InstallerCalculator::appendComponentsToInstall(const QList<Component *> &co
     if (components.isEmpty())
         return true;
 
+    if (!m_autoDependOnIndexed)
+        initAutoDependOnIndex();
+
     QList<Component*> notAppendedComponents; // for example components with unresolved dependencies
     foreach (Component *component, components){
         if (m_toInstallComponentIds.contains(component->name())) {
@@ -134,19 +186,26 @@ bool InstallerCalculator::appendComponentsToInstall(const QList<Component *> &co
             return false;
     }
 
+    // All regular dependencies are resolved. Now we are looking for auto depend on components,
+    // the ones whose auto depend on values all got installed or scheduled for installation
+    // since the last round. Keep the order of all components for a stable install order.
+    QList<Component *> resolvedAutoDependOnList;
+    resolvedAutoDependOnList.swap(m_autoDependOnResolved);
+    std::sort(resolvedAutoDependOnList.begin(), resolvedAutoDependOnList.end(),
+        [this](Component *lhs, Component *rhs) {
+            return m_autoDependOnPosition.value(lhs) < m_autoDependOnPosition.value(rhs);
+        });
+
     QList<Component *> foundAutoDependOnList;
-    // All regular dependencies are resolved. Now we are looking for auto depend on components.
-    foreach (Component *component, m_allComponents) {
+    foreach (Component *component, resolvedAutoDependOnList) {
         // If a components is already installed or is scheduled for installation, no need to check
         // for auto depend installation.
         if ((!component->isInstalled() || component->updateRequested())
             && !m_toInstallComponentIds.contains(component->name())) {
-                // If we figure out a component requests auto installation, keep it to resolve
+                // The component requests auto installation, keep it to resolve
                 // their dependencies as well.
-                if (component->isAutoDependOn(m_toInstallComponentIds)) {
-                    foundAutoDependOnList.append(component);
-                    insertInstallReason(component, InstallerCalculator::Automatic);
-                }
+                foundAutoDependOnList.append(component);
+                insertInstallReason(component, InstallerCalculator::Automatic);
         }
     }
 
@@ -155,15 +214,83 @@ bool InstallerCalculator::appendComponentsToInstall(const QList<Component *> &co
     return true;
 }
 
+// Applies a selection change to the already calculated components to install. Returns false if
+// that is not possible incrementally, e.g. a removed component is still needed by others or pulled
+// in dependencies; the calculator is in an undefined state then and needs a full recalculation.
+bool InstallerCalculator::updateComponentsToInstall(const QList<Component *> &addedComponents,
+    const QList<Component *> &removedComponents)
+{
+    foreach (Component *component, removedComponents) {
+        if (!removeComponentToInstall(component))
+            return false;
+    }
+
+    QList<Component *> components;
+    foreach (Component *component, addedComponents) {
+        // already scheduled components have their dependencies resolved
+        if (!m_toInstallComponentIds.contains(component->name()))
+            components.append(component);
+    }
+    return appendComponentsToInstall(components);
+}
+
+bool InstallerCalculator::removeComponentToInstall(Component *component)
+{
+    // a full calculation would add dependencies and auto dependencies again
+    const InstallReasonType reason = installReasonType(component);
+    if (reason == Dependent || reason == Automatic)
+        return false;
+
+    foreach (Component *dependee, m_resolvedDependees.value(component)) {
+        if (dependee != component)
+            return false;
+    }
+
+    const QString name = component->name();
+    foreach (Component *dependency, m_resolvedDependencies.value(component)) {
+        if (m_toInstallComponentIds.contains(dependency->name())
+                && installReasonType(dependency) == Dependent
+                && installReasonReferencedComponent(dependency) == name) {
+            return false;
+        }
+    }
+
+    const bool scheduled = m_toInstallComponentIds.contains(name);
+    const bool unsatisfiesAutoDependOn = scheduled && m_autoDependOnSatisfied.contains(name)
+        && !m_installedPackageNames.contains(name);
+    if (unsatisfiesAutoDependOn) {
+        foreach (Component *dependent, m_autoDependOnDependents.value(name)) {
+            if (m_toInstallComponentIds.contains(dependent->name()))
+                return false;
+        }
+    }
+
+    foreach (Component *dependency, m_resolvedDependencies.take(component))
+        m_resolvedDependees[dependency].remove(component);
+    m_visitedComponents.remove(component);
+    m_toInstallComponentIdReasonHash.remove(name);
+    if (!scheduled)
+        return true;
+
+    m_orderedComponentsToInstall.removeOne(component);
+    m_toInstallComponentIds.remove(name);
+    if (unsatisfiesAutoDependOn) {
+        m_autoDependOnSatisfied.remove(name);
+        foreach (Component *dependent, m_autoDependOnDependents.value(name))
+            ++m_autoDependOnRemaining[dependent];
+    }
+    return true;
+}
+
 bool InstallerCalculator::appendComponentToInstall(Component *component, const QString &version)
 {
     QSet<QString> allDependencies = component->dependencies().toSet();
     QString requiredDependencyVersion = version;
     foreach (const QString &dependencyComponentName, allDependencies) {
-        // PackageManagerCore::componentByName returns 0 if dependencyComponentName contains a
+        // ComponentIndex::find returns 0 if dependencyComponentName contains a
         // version which is not available
-        Component *dependencyComponent =
-            PackageManagerCore::componentByName(dependencyComponentName, m_allComponents);
+        const ComponentRequirement requirement(dependencyComponentName);
+        Component *dependencyComponent = m_componentIndex.find(requirement);
         if (!dependencyComponent) {
             const QString errorMessage = QCoreApplication::translate("InstallerCalculator",
                 "Cannot find missing dependency \"%1\" for \"%2\".").arg(dependencyComponentName,
@@ -177,18 +304,16 @@ bool InstallerCalculator::appendComponentToInstall(Component *component, const Q
                 return false;
             }
         }
+        m_resolvedDependencies[component].insert(dependencyComponent);
+        m_resolvedDependees[dependencyComponent].insert(component);
+
         //Check if component requires higher version than what might be already installed
         bool isUpdateRequired = false;
-        QString requiredName;
-        QString requiredVersion;
-        PackageManagerCore::parseNameAndVersion(dependencyComponentName, &requiredName, &requiredVersion);
-        if (!requiredVersion.isEmpty() &&
+        if (!requirement.version().isEmpty() &&
                 !dependencyComponent->value(scInstalledVersion).isEmpty()) {
-            QRegExp compEx(QLatin1String("([<=>]+)(.*)"));
-            const QString installedVersion = compEx.exactMatch(dependencyComponent->value(scInstalledVersion)) ?
-                compEx.cap(2) : dependencyComponent->value(scInstalledVersion);
-
-            requiredVersion = compEx.exactMatch(requiredVersion) ? compEx.cap(2) : requiredVersion;
+            const QString installedVersion =
+                VersionRequirement(dependencyComponent->value(scInstalledVersion)).version();
+            const QString requiredVersion = requirement.version().version();
 
             if (KDUpdater::compareVersion(requiredVersion, installedVersion) >= 1 ) {
                 isUpdateRequired = true;
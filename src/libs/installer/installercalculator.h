@@ -28,6 +28,7 @@
 #ifndef INSTALLERCALCULATOR_H
 #define INSTALLERCALCULATOR_H
 
+#include "componentindex.h"
 #include "installer_global.h"
 
 #include <QHash>
@@ -59,6 +60,8 @@ public:
     QString componentsToInstallError() const;
 
     bool appendComponentsToInstall(const QList<Component*> &components);
+    bool updateComponentsToInstall(const QList<Component*> &addedComponents,
+                                   const QList<Component*> &removedComponents);
 
 private:
     void insertInstallReason(Component *component,
@@ -66,10 +69,17 @@ private:
                              const QString &referencedComponentName = QString());
     void realAppendToInstallComponents(Component *component, const QString &version = QString());
     bool appendComponentToInstall(Component *components, const QString &version = QString());
+    bool removeComponentToInstall(Component *component);
     QString recursionError(Component *component);
+    void initAutoDependOnIndex();
+    void satisfyAutoDependency(const QString &name);
 
     QList<Component*> m_allComponents;
+    ComponentIndex m_componentIndex;
     QHash<Component*, QSet<Component*> > m_visitedComponents;
+    //resolved dependencies in both directions, used to tell if a component can be dropped
+    QHash<Component*, QSet<Component*> > m_resolvedDependencies;
+    QHash<Component*, QSet<Component*> > m_resolvedDependees;
     QSet<QString> m_toInstallComponentIds; //for faster lookups
     QString m_componentsToInstallError;
     //calculate installation order variables
@@ -77,6 +87,16 @@ private:
     //we can't use this reason hash as component id hash, because some reasons are ready before
     //the component is added
     QHash<QString, QPair<InstallReasonType, QString> > m_toInstallComponentIdReasonHash;
+
+    //auto depend on resolution: auto depend on name -> components listing it, and the number of
+    //names per component that are neither installed nor scheduled for installation yet
+    bool m_autoDependOnIndexed;
+    QHash<QString, QList<Component*> > m_autoDependOnDependents;
+    QHash<Component*, int> m_autoDependOnRemaining;
+    QHash<Component*, int> m_autoDependOnPosition;
+    QSet<QString> m_autoDependOnSatisfied;
+    QSet<QString> m_installedPackageNames;
+    QList<Component*> m_autoDependOnResolved;
 };
 
 }
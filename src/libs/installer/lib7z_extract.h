@@ -69,16 +69,20 @@ namespace Lib7z
         virtual HRESULT setCompleted(quint64 /*completed*/, quint64 /*total*/) { return S_OK; }
 
     private:
+        friend class ExtractWorkerCallback;
+
         CArc *arc = 0;
 
         QString targetDir;
         quint64 total = 0;
         quint64 completed = 0;
         quint32 currentIndex = 0;
+        CMyComPtr<ISequentialOutStream> currentStream;
     };
 
     void INSTALLER_EXPORT extractArchive(QFileDevice *archive, const QString &targetDirectory,
-        ExtractCallback *callback = 0);
+        ExtractCallback *callback = 0, int maxThreadCount = 1);
+    int INSTALLER_EXPORT extractThreadCount();
 
 } // namespace Lib7z
 
@@ -30,6 +30,7 @@
 
 #include "errors.h"
 #include "fileio.h"
+#include "remoteclient.h"
 
 #include "lib7z_create.h"
 #include "lib7z_extract.h"
@@ -55,11 +56,18 @@
 #include <QCoreApplication>
 #include <QDir>
 #include <QFileInfo>
+#include <QFuture>
 #include <QIODevice>
+#include <QMap>
+#include <QMutex>
 #include <QPointer>
 #include <QReadWriteLock>
 #include <QTemporaryFile>
+#include <QThreadPool>
+#include <QtConcurrentRun>
 
+#include <algorithm>
+#include <cstring>
 #include <mutex>
 #include <memory>
 
@@ -77,7 +85,9 @@ HINSTANCE g_hInstance = nullptr;
 extern "C" int global_use_utf16_conversion;
 
 #include <myWindows/config.h>
+#include <errno.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 namespace NArchive {
@@ -156,6 +166,44 @@ void initSevenZ()
 }
 
 
+// -- 7z codecs, loaded once and shared by all calls
+
+class CodecRegistry
+{
+    Q_DISABLE_COPY(CodecRegistry)
+
+public:
+    CodecRegistry()
+    {
+        initSevenZ(); // the codecs and archive handlers need to be registered before loading
+        m_loaded = (m_codecs.Load() == S_OK);
+        if (m_loaded && !ParseOpenTypes(m_codecs, L"7z", m_sevenZTypes))
+            m_sevenZTypes.Clear();
+    }
+
+    // The loaded codecs are only read after construction, so sharing them between threads is
+    // safe. Handlers are created per archive by the open and update functions.
+    CCodecs *codecs()
+    {
+        if (!m_loaded)
+            throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot load codecs."));
+        return &m_codecs;
+    }
+
+    // Returns the open types restricting the open call to the 7z handler, or an empty list if
+    // there is no 7z handler.
+    const CObjectVector<COpenType> &sevenZTypes() const
+    {
+        return m_sevenZTypes;
+    }
+
+private:
+    CCodecs m_codecs;
+    bool m_loaded = false;
+    CObjectVector<COpenType> m_sevenZTypes;
+};
+Q_GLOBAL_STATIC(CodecRegistry, codecRegistry)
+
 // -- error handling
 
 Q_GLOBAL_STATIC(QString, getLastErrorString)
@@ -392,6 +440,24 @@ public:
         return m_errorString;
     }
 
+    /*
+        Closes the device and returns whether all data got written. Writes through the installer
+        server are only confirmed once the file is flushed, so a failure might show up here.
+    */
+    bool close()
+    {
+        if (!m_device->isOpen())
+            return m_errorString.isEmpty();
+
+        m_device->close();
+        QFileDevice *const file = qobject_cast<QFileDevice *>(m_device.get());
+        if (file && file->error() != QFileDevice::NoError) {
+            m_errorString = file->errorString();
+            return false;
+        }
+        return m_errorString.isEmpty();
+    }
+
     STDMETHOD(Write)(const void *data, UInt32 size, UInt32 *processedSize)
     {
         if (processedSize)
@@ -429,15 +495,86 @@ public:
         LIB7Z_ASSERTS(m_device, Readable)
     }
 
+    /*
+        Creates a view of the \a length bytes at \a offset inside \a file. The view keeps its own
+        position and reads from a memory mapping of the file, or positionally from the file
+        handle if the file cannot be mapped. Neither touches the position of \a file. Files
+        opened through the remote file engine hand out the handle of the server process, so they
+        are read by seeking \a file instead.
+    */
+    QIODeviceInStream(QFileDevice *file, qint64 offset, qint64 length)
+        : IInStream()
+        , CMyUnknownImp()
+        , m_device(file)
+        , m_file(file)
+        , m_isSegment(true)
+        , m_offset(offset)
+        , m_length(length)
+    {
+        LIB7Z_ASSERTS(m_device, Readable)
+        if (m_length > 0)
+            m_data = m_file->map(m_offset, m_length);
+        m_ownsMapping = (m_data != nullptr);
+#ifdef Q_OS_UNIX
+        if (!m_data && !RemoteClient::instance().isActive())
+            m_handle = m_file->handle();
+#endif
+    }
+
+    ~QIODeviceInStream()
+    {
+        if (m_ownsMapping && m_file)
+            m_file->unmap(m_data);
+    }
+
+    /*
+        Returns \c true if reading from this stream does not depend on the position of the
+        underlying device, so that views of the same file can be read in parallel.
+    */
+    bool isPositional() const
+    {
+        return m_isSegment && (m_data || m_handle >= 0);
+    }
+
+    /*
+        Returns a new view of the same segment that shares the mapping or handle of this stream,
+        but has a position of its own. This stream must outlive the returned one.
+    */
+    QIODeviceInStream *view() const
+    {
+        Q_ASSERT(m_isSegment);
+        QIODeviceInStream *view = new QIODeviceInStream(m_device.data());
+        view->m_file = m_file;
+        view->m_isSegment = true;
+        view->m_offset = m_offset;
+        view->m_length = m_length;
+        view->m_data = m_data;
+        view->m_handle = m_handle;
+        return view;
+    }
+
     STDMETHOD(Read)(void *data, UInt32 size, UInt32 *processedSize)
     {
         if (m_device.isNull())
             return E_FAIL;
 
-        const qint64 actual = m_device->read(reinterpret_cast<char*>(data), size);
-        Q_ASSERT(actual != 0 || m_device->atEnd());
+        qint64 actual = 0;
+        if (m_isSegment) {
+            const qint64 maxSize = qMin<qint64>(size, qMax<qint64>(0, m_length - m_pos));
+            if (m_data) {
+                memcpy(data, m_data + m_pos, maxSize);
+                actual = maxSize;
+            } else {
+                actual = readAt(reinterpret_cast<char*>(data), maxSize, m_offset + m_pos);
+            }
+            if (actual > 0)
+                m_pos += actual;
+        } else {
+            actual = m_device->read(reinterpret_cast<char*>(data), size);
+            Q_ASSERT(actual != 0 || m_device->atEnd());
+        }
         if (processedSize)
-            *processedSize = actual;
+            *processedSize = qMax<qint64>(0, actual);
         return actual >= 0 ? S_OK : E_FAIL;
     }
 
@@ -447,32 +584,116 @@ public:
             return E_FAIL;
         if (seekOrigin > STREAM_SEEK_END)
             return STG_E_INVALIDFUNCTION;
+        const qint64 size = m_isSegment ? m_length : m_device->size();
+        const qint64 pos = m_isSegment ? m_pos : m_device->pos();
         UInt64 np = 0;
         switch (seekOrigin) {
             case STREAM_SEEK_SET:
                 np = offset;
                 break;
             case STREAM_SEEK_CUR:
-                np = m_device->pos() + offset;
+                np = pos + offset;
                 break;
             case STREAM_SEEK_END:
-                np = m_device->size() + offset;
+                np = size + offset;
                 break;
             default:
                 return STG_E_INVALIDFUNCTION;
         }
 
-        np = qBound(static_cast<UInt64>(0), np, static_cast<UInt64>(m_device->size()));
-        const bool ok = m_device->seek(np);
+        np = qBound(static_cast<UInt64>(0), np, static_cast<UInt64>(size));
+        bool ok = true;
+        if (m_isSegment)
+            m_pos = np;
+        else
+            ok = m_device->seek(np);
         if (newPosition)
             *newPosition = np;
         return ok ? S_OK : E_FAIL;
     }
 
+private:
+    qint64 readAt(char *data, qint64 maxSize, qint64 offset)
+    {
+#ifdef Q_OS_UNIX
+        if (m_handle >= 0) {
+            ssize_t amountRead;
+            do {
+                amountRead = ::pread(m_handle, data, size_t(maxSize), off_t(offset));
+            } while (amountRead < 0 && errno == EINTR);
+            return amountRead;
+        }
+#endif
+        // neither mapped nor a plain file, share the device position with everybody else
+        if (!m_device->seek(offset))
+            return -1;
+        return m_device->read(data, maxSize);
+    }
+
 private:
     QPointer<QIODevice> m_device;
+    QPointer<QFileDevice> m_file;
+    bool m_isSegment = false;
+    qint64 m_offset = 0;
+    qint64 m_length = 0;
+    qint64 m_pos = 0;
+    uchar *m_data = nullptr;
+    bool m_ownsMapping = false;
+    int m_handle = -1;
 };
 
+static bool hasSevenZSignature(IInStream *stream)
+{
+    static const char signature[] = { '7', 'z', '\xBC', '\xAF', '\x27', '\x1C' };
+    if (stream->Seek(0, STREAM_SEEK_SET, nullptr) != S_OK)
+        return false;
+
+    char buffer[sizeof(signature)];
+    UInt32 processedSize = 0;
+    return stream->Read(buffer, sizeof(buffer), &processedSize) == S_OK
+        && processedSize == sizeof(buffer) && memcmp(buffer, signature, sizeof(signature)) == 0;
+}
+
+/*
+    Opens the archive in \a stream with the shared codecs. Archives starting with the 7z
+    signature are opened with the 7z handler directly, the signature probing across all formats
+    is only done if that fails or for other archive types.
+*/
+static HRESULT openArchive(IInStream *stream, CArchiveLink *archiveLink)
+{
+    COpenOptions op;
+    op.codecs = codecRegistry->codecs();
+
+    CIntVector excluded;
+    op.excludedFormats = &excluded;
+    op.stream = stream;
+
+    CObjectVector<CProperty> properties;
+    op.props = &properties;
+
+    const CObjectVector<COpenType> &sevenZTypes = codecRegistry->sevenZTypes();
+    if (sevenZTypes.Size() > 0 && hasSevenZSignature(stream)) {
+        CObjectVector<COpenType> types = sevenZTypes;
+        op.types = &types;
+        if (archiveLink->Open2(op, nullptr) == S_OK)
+            return S_OK;
+        archiveLink->Close();
+        archiveLink->Release();
+    }
+
+    CObjectVector<COpenType> types;
+    op.types = &types;  // Empty, because we use a stream.
+    return archiveLink->Open2(op, nullptr);
+}
+
+/*
+    Returns a stream over the whole of \a archive that leaves the position of \a archive alone.
+*/
+static QIODeviceInStream *segmentInStream(QFileDevice *archive)
+{
+    return new QIODeviceInStream(archive, 0, archive->size());
+}
+
 bool operator==(const File &lhs, const File &rhs)
 {
     return lhs.path == rhs.path
@@ -491,27 +712,11 @@ QVector<File> listArchive(QFileDevice *archive)
 
     const qint64 initialPos = archive->pos();
     try {
-        CCodecs codecs;
-        if (codecs.Load() != S_OK)
-            throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot load codecs."));
-
-        COpenOptions op;
-        op.codecs = &codecs;
-
-        CObjectVector<COpenType> types;
-        op.types = &types;  // Empty, because we use a stream.
-
-        CIntVector excluded;
-        op.excludedFormats = &excluded;
-
-        const CMyComPtr<IInStream> stream = new QIODeviceInStream(archive);
-        op.stream = stream; // CMyComPtr is needed, otherwise it crashes in OpenStream().
-
-        CObjectVector<CProperty> properties;
-        op.props = &properties;
+        // CMyComPtr is needed, otherwise it crashes in OpenStream().
+        const CMyComPtr<IInStream> stream = segmentInStream(archive);
 
         CArchiveLink archiveLink;
-        if (archiveLink.Open2(op, nullptr) != S_OK) {
+        if (openArchive(stream, &archiveLink) != S_OK) {
             throw SevenZipException(QCoreApplication::translate("Lib7z",
                 "Cannot open archive \"%1\".").arg(archive->fileName()));
         }
@@ -575,11 +780,14 @@ STDMETHODIMP ExtractCallback::SetCompleted(const UInt64 *c)
     return S_OK;
 }
 
+Q_GLOBAL_STATIC(QMutex, directoryMutex)
+
 // this method will be called by CFolderOutStream::OpenFile to stream via
 // CDecoder::CodeSpec extracted content to an output stream.
 STDMETHODIMP ExtractCallback::GetStream(UInt32 index, ISequentialOutStream **outStream, Int32 /*askExtractMode*/)
 {
     *outStream = nullptr;
+    currentStream.Release();
     if (targetDir.isEmpty())
         return E_FAIL;
 
@@ -596,7 +804,13 @@ STDMETHODIMP ExtractCallback::GetStream(UInt32 index, ISequentialOutStream **out
     const QFileInfo fi(QString::fromLatin1("%1/%2").arg(targetDir, UString2QString(s)));
 
     DirectoryGuard guard(fi.absolutePath());
-    const QStringList directories = guard.tryCreate();
+    QStringList directories;
+    {
+        // workers extracting folders in parallel share the directories, so only one of them may
+        // create and report a directory
+        QMutexLocker _(directoryMutex());
+        directories = guard.tryCreate();
+    }
 
     bool isDir = false;
     Archive_IsItem_Folder(arc->Archive, index, isDir);
@@ -630,6 +844,7 @@ STDMETHODIMP ExtractCallback::GetStream(UInt32 index, ISequentialOutStream **out
         }
         CMyComPtr<ISequentialOutStream> stream =
             new QIODeviceSequentialOutStream(std::move(file));
+        currentStream = stream; // kept to close the file and check the result once it is written
         *outStream = stream.Detach(); // CMyComPtr is needed, otherwise it crashes in Write().
     }
 
@@ -647,6 +862,22 @@ STDMETHODIMP ExtractCallback::SetOperationResult(Int32 /*resultEOperationResult*
     if (targetDir.isEmpty())
         return S_OK;
 
+    if (currentStream) {
+        QIODeviceSequentialOutStream *const stream = static_cast<QIODeviceSequentialOutStream *>(
+            static_cast<ISequentialOutStream *>(currentStream));
+        const bool closed = stream->close();
+        const QString error = stream->errorString();
+        currentStream.Release();
+        if (!closed) {
+            UString s;
+            arc->GetItemPath(currentIndex, s);
+            const QString path = QString::fromLatin1("%1/%2").arg(targetDir, UString2QString(s));
+            setLastError(QCoreApplication::translate("ExtractCallbackImpl",
+                "Cannot write file \"%1\": %2").arg(QDir::toNativeSeparators(path), error));
+            return E_FAIL;
+        }
+    }
+
     UString s;
     if (arc->GetItemPath(currentIndex, s) != S_OK) {
         setLastError(QCoreApplication::translate("ExtractCallbackImpl",
@@ -865,19 +1096,20 @@ static QString createTmp7z()
     more files, one or more directories or a combination of files and folders. The \c * wildcard
     is supported also. The value of \a level specifies the compression ratio, the default is set
     to \c 5 (Normal compression). The \a callback can be used to get information about the archive
-    creation process. If no \a callback is given, an empty implementation is used.
+    creation process. If no \a callback is given, an empty implementation is used. The archive is
+    compressed with \a threadCount threads, or as many as 7z considers useful if it is \c 0.
 
     \note Throws SevenZipException on error.
     \note Filenames are stored case-sensitive with UTF-8 encoding.
     \note The ownership of \a callback is transferred to the function and gets delete on exit.
 */
 void INSTALLER_EXPORT createArchive(QFileDevice *archive, const QStringList &sources,
-    Compression level, UpdateCallback *callback)
+    Compression level, UpdateCallback *callback, int threadCount)
 {
     LIB7Z_ASSERTS(archive, Writable)
 
     const QString tmpArchive = createTmp7z();
-    Lib7z::createArchive(tmpArchive, sources, QTmpFile::No, level, callback);
+    Lib7z::createArchive(tmpArchive, sources, QTmpFile::No, level, callback, threadCount);
 
     try {
         QFile source(tmpArchive);
@@ -894,7 +1126,10 @@ void INSTALLER_EXPORT createArchive(QFileDevice *archive, const QStringList &sou
     is supported. To be able to use the function during an elevated installation, set \a mode to
     \c QTmpFile::Yes. The value of \a level specifies the compression ratio, the default is set
     to \c 5 (Normal compression). The \a callback can be used to get information about the archive
-    creation process. If no \a callback is given, an empty implementation is used.
+    creation process. If no \a callback is given, an empty implementation is used. The archive is
+    compressed with \a threadCount threads, or as many as 7z considers useful if it is \c 0.
+    Callers creating several archives at the same time should limit it, as every compression
+    thread allocates its own dictionary.
 
     \note Throws SevenZipException on error.
     \note If \a archive exists, it will be overwritten.
@@ -902,7 +1137,7 @@ void INSTALLER_EXPORT createArchive(QFileDevice *archive, const QStringList &sou
     \note The ownership of \a callback is transferred to the function and gets delete on exit.
 */
 void createArchive(const QString &archive, const QStringList &sources, QTmpFile mode,
-    Compression level, UpdateCallback *callback)
+    Compression level, UpdateCallback *callback, int threadCount)
 {
     try {
         QString target = archive;
@@ -917,7 +1152,10 @@ void createArchive(const QString &archive, const QStringList &sources, QTmpFile
             commandStrings.Add(L"-mtm=on"); // time: modeifier|creation|access
             commandStrings.Add(L"-mtc=on");
             commandStrings.Add(L"-mta=on");
-            commandStrings.Add(L"-mmt=on"); // threads: multi-threaded
+            if (threadCount > 0) // threads: limited or multi-threaded
+                commandStrings.Add(QString2UString(QString::fromLatin1("-mmt=%1").arg(threadCount)));
+            else
+                commandStrings.Add(L"-mmt=on");
 #ifdef Q_OS_WIN
             commandStrings.Add(L"-sccUTF-8"); // files: case-sensitive|UTF8
 #endif
@@ -933,17 +1171,15 @@ void createArchive(const QString &archive, const QStringList &sources, QTmpFile
             throw SevenZipException(UString2QString(e));
         }
 
-        CCodecs codecs;
-        if (codecs.Load() != S_OK)
-            throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot load codecs."));
+        CCodecs *codecs = codecRegistry->codecs();
 
         CObjectVector<COpenType> types;
-        if (!ParseOpenTypes(codecs, options.ArcType, types))
+        if (!ParseOpenTypes(*codecs, options.ArcType, types))
             throw SevenZipException(QCoreApplication::translate("Lib7z", "Unsupported archive type."));
 
         CUpdateErrorInfo errorInfo;
         CMyComPtr<UpdateCallback> comCallback = callback == 0 ? new UpdateCallback : callback;
-        const HRESULT res = UpdateArchive(&codecs, types, options.ArchiveName, options.Censor,
+        const HRESULT res = UpdateArchive(codecs, types, options.ArchiveName, options.Censor,
             options.UpdateOptions, errorInfo, nullptr, comCallback, true);
 
         const QFile tempFile(UString2QString(options.ArchiveName));
@@ -988,14 +1224,249 @@ void createArchive(const QString &archive, const QStringList &sources, QTmpFile
     }
 }
 
+// -- parallel extraction of 7z folders
+
+// shared by all extractions, so that concurrent ones do not multiply the number of threads
+Q_GLOBAL_STATIC(QThreadPool, extractThreadPool)
+
+/*!
+    Returns the number of threads the folders (solid blocks) of 7z archives are decoded with.
+    The threads are shared between all extractions running at the same time.
+*/
+int extractThreadCount()
+{
+    return extractThreadPool()->maxThreadCount();
+}
+
+struct ParallelExtractState
+{
+    QMutex mutex;
+    ExtractCallback *callback = nullptr;
+    QVector<quint64> completed;
+    quint64 total = 0;
+    QAtomicInt failed;
+};
+
+/*
+    Extracts a subset of the archive items in a worker thread. Everything that reaches the user
+    supplied callback is serialized, the progress of all workers is reported as one.
+*/
+class ExtractWorkerCallback : public ExtractCallback
+{
+    Q_DISABLE_COPY(ExtractWorkerCallback)
+
+public:
+    ExtractWorkerCallback(ParallelExtractState *state, int worker)
+        : m_state(state)
+        , m_worker(worker)
+    {}
+
+private:
+    bool prepareForFile(const QString &filename) Q_DECL_OVERRIDE
+    {
+        QMutexLocker _(&m_state->mutex);
+        return m_state->callback->prepareForFile(filename);
+    }
+
+    void setCurrentFile(const QString &filename) Q_DECL_OVERRIDE
+    {
+        QMutexLocker _(&m_state->mutex);
+        m_state->callback->setCurrentFile(filename);
+    }
+
+    HRESULT setCompleted(quint64 completed, quint64 /*total*/) Q_DECL_OVERRIDE
+    {
+        if (m_state->failed.load())
+            return E_ABORT;
+
+        QMutexLocker _(&m_state->mutex);
+        m_state->completed[m_worker] = completed;
+        quint64 allCompleted = 0;
+        foreach (quint64 value, m_state->completed)
+            allCompleted += value;
+        if (m_state->total == 0)
+            return S_OK;
+        return m_state->callback->setCompleted(qMin(allCompleted, m_state->total), m_state->total);
+    }
+
+private:
+    ParallelExtractState *m_state;
+    int m_worker;
+};
+
+/*
+    Opens the archive in \a stream once more and extracts the items listed in \a indices. If
+    \a stream is \c null, \a archive is opened by name instead. Returns an empty string on
+    success, the error message otherwise.
+*/
+static QString extractItems(IInStream *stream, const QString &archive, const QString &directory,
+    const QVector<UInt32> &indices, ParallelExtractState *state, int worker)
+{
+    try {
+        QFile file(archive);
+        CMyComPtr<IInStream> fileStream;
+        if (!stream) {
+            if (!file.open(QIODevice::ReadOnly)) {
+                return QCoreApplication::translate("Lib7z", "Cannot open archive \"%1\".")
+                    .arg(archive);
+            }
+            fileStream = segmentInStream(&file);
+            stream = fileStream;
+        }
+
+        CArchiveLink archiveLink;
+        if (openArchive(stream, &archiveLink) != S_OK || archiveLink.Arcs.Size() != 1) {
+            return QCoreApplication::translate("Lib7z", "Cannot open archive \"%1\".")
+                .arg(archive);
+        }
+
+        CMyComPtr<ExtractWorkerCallback> callback = new ExtractWorkerCallback(state, worker);
+        callback->setTarget(directory);
+        callback->setArchive(&archiveLink.Arcs[0]);
+        const HRESULT result = archiveLink.Arcs[0].Archive->Extract(indices.constData(),
+            indices.count(), false, callback);
+        if (result != S_OK)
+            return errorMessageFrom7zResult(result);
+        return QString();
+    } catch (const SevenZipException &e) {
+        return e.message();
+    } catch (...) {
+        return QCoreApplication::translate("Lib7z", "Unknown exception caught (%1).")
+            .arg(QString::fromLatin1(Q_FUNC_INFO));
+    }
+}
+
+/*
+    Spreads the folders (solid blocks) of the single 7z archive in \a archiveLink over up to
+    \a maxThreadCount workers, each decoding its folders from its own view of \a stream. If
+    \a stream cannot be read positionally, every worker opens \a archive again instead. Items
+    without data, like directories, are extracted at the end. Returns \c false without
+    extracting anything if the archive cannot be split up.
+*/
+static bool extractFoldersInParallel(QFileDevice *archive, QIODeviceInStream *stream,
+    const QString &directory, const CArchiveLink &archiveLink, ExtractCallback *callback,
+    int maxThreadCount)
+{
+    const CObjectVector<COpenType> &sevenZTypes = codecRegistry->sevenZTypes();
+    if (archiveLink.Arcs.Size() != 1 || sevenZTypes.Size() == 0
+        || archiveLink.Arcs[0].FormatIndex != sevenZTypes[0].FormatIndex) {
+        return false;
+    }
+    if (!stream->isPositional()) {
+        QFile probe(archive->fileName());
+        if (archive->fileName().isEmpty() || !probe.open(QIODevice::ReadOnly))
+            return false;
+    }
+
+    IInArchive *const arch = archiveLink.Arcs[0].Archive;
+    UInt32 numItems = 0;
+    if (arch->GetNumberOfItems(&numItems) != S_OK)
+        return false;
+
+    // items of one folder are stored consecutively, so collecting them keeps the order
+    QMap<quint32, QVector<UInt32> > folderItems;
+    QHash<quint32, quint64> folderSizes;
+    QVector<UInt32> itemsWithoutFolder;
+    quint64 total = 0;
+    for (UInt32 item = 0; item < numItems; ++item) {
+        const NCOM::CPropVariant prop = readProperty(arch, item, kpidBlock);
+        const quint64 size = getUInt64Property(arch, item, kpidSize, 0);
+        total += size;
+        if (prop.vt == VT_UI4) {
+            folderItems[prop.ulVal].append(item);
+            folderSizes[prop.ulVal] += size;
+        } else {
+            itemsWithoutFolder.append(item);
+        }
+    }
+
+    const int workerCount = qMin(qMin(maxThreadCount, extractThreadCount()),
+        folderItems.count());
+    if (workerCount < 2)
+        return false;
+
+    // hand the biggest folders out first, always to the worker with the least data
+    QList<quint32> folders = folderItems.keys();
+    std::stable_sort(folders.begin(), folders.end(), [&folderSizes](quint32 lhs, quint32 rhs) {
+        return folderSizes.value(lhs) > folderSizes.value(rhs);
+    });
+    QVector<QVector<UInt32> > workerItems(workerCount);
+    QVector<quint64> workerSizes(workerCount, 0);
+    foreach (quint32 folder, folders) {
+        const int worker = int(std::min_element(workerSizes.constBegin(), workerSizes.constEnd())
+            - workerSizes.constBegin());
+        workerItems[worker] += folderItems.value(folder);
+        workerSizes[worker] += folderSizes.value(folder);
+    }
+
+    ParallelExtractState state;
+    state.callback = callback;
+    state.completed.resize(workerCount + 1);
+    state.total = total;
+
+    // views are created and released here, the workers only ever read through them
+    QVector<CMyComPtr<IInStream> > views(workerCount);
+    if (stream->isPositional()) {
+        for (int worker = 0; worker < workerCount; ++worker)
+            views[worker] = stream->view();
+    }
+
+    const QString fileName = archive->fileName();
+    QVector<QFuture<QString> > futures;
+    for (int worker = 0; worker < workerCount; ++worker) {
+        QVector<UInt32> &items = workerItems[worker];
+        std::sort(items.begin(), items.end());
+        IInStream *const view = views.at(worker);
+        futures.append(QtConcurrent::run(extractThreadPool(), [&, view, items, worker]() {
+            const QString error = extractItems(view, fileName, directory, items, &state,
+                worker);
+            if (!error.isEmpty())
+                state.failed.store(1);
+            return error;
+        }));
+    }
+
+    QString error;
+    foreach (const QFuture<QString> &future, futures) {
+        if (error.isEmpty())
+            error = future.result(); // waits for the worker
+        else
+            future.waitForFinished();
+    }
+    if (!error.isEmpty())
+        throw SevenZipException(error);
+
+    if (!itemsWithoutFolder.isEmpty()) {
+        CMyComPtr<ExtractWorkerCallback> folderlessCallback
+            = new ExtractWorkerCallback(&state, workerCount);
+        folderlessCallback->setTarget(directory);
+        folderlessCallback->setArchive(const_cast<CArc *>(&archiveLink.Arcs[0]));
+        const HRESULT result = arch->Extract(itemsWithoutFolder.constData(),
+            itemsWithoutFolder.count(), false, folderlessCallback);
+        if (result != S_OK)
+            throw SevenZipException(errorMessageFrom7zResult(result));
+    }
+    return true;
+}
+
 /*!
     Extracts the given \a archive content into target directory \a directory using the provided
     extract callback \a callback. The output filenames are deduced from the \a archive content.
 
+    If \a maxThreadCount is greater than one and \a archive is a 7z file with several folders
+    (solid blocks), the folders are decoded by up to \a maxThreadCount threads, each reading
+    through its own view of the file. The threads are taken from a pool shared by all
+    extractions, see extractThreadCount(). The calls to \a callback are serialized in that case,
+    but do not come from the calling thread.
+
+    The archive is read from a memory mapping of \a archive, or positionally from its handle,
+    where possible, without changing the position of \a archive.
+
     \note Throws SevenZipException on error.
     \note The ownership of \a callback is not transferred to the function.
 */
-void extractArchive(QFileDevice *archive, const QString &directory, ExtractCallback *callback)
+void extractArchive(QFileDevice *archive, const QString &directory, ExtractCallback *callback,
+    int maxThreadCount)
 {
     LIB7Z_ASSERTS(archive, Readable)
 
@@ -1012,33 +1483,20 @@ void extractArchive(QFileDevice *archive, const QString &directory, ExtractCallb
     try {
         outDir.tryCreate();
 
-        CCodecs codecs;
-        if (codecs.Load() != S_OK)
-            throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot load codecs."));
-
-        COpenOptions op;
-        op.codecs = &codecs;
-
-        CObjectVector<COpenType> types;
-        op.types = &types;  // Empty, because we use a stream.
-
-        CIntVector excluded;
-        op.excludedFormats = &excluded;
-
-        const CMyComPtr<IInStream> stream = new QIODeviceInStream(archive);
-        op.stream = stream; // CMyComPtr is needed, otherwise it crashes in OpenStream().
-
-        CObjectVector<CProperty> properties;
-        op.props = &properties;
+        // CMyComPtr is needed, otherwise it crashes in OpenStream().
+        const CMyComPtr<QIODeviceInStream> stream = segmentInStream(archive);
 
         CArchiveLink archiveLink;
-        if (archiveLink.Open2(op, nullptr) != S_OK) {
+        if (openArchive(stream, &archiveLink) != S_OK) {
             throw SevenZipException(QCoreApplication::translate("Lib7z",
                 "Cannot open archive \"%1\".").arg(archive->fileName()));
         }
 
+        const bool extracted = maxThreadCount > 1 && extractFoldersInParallel(archive, stream,
+            directory, archiveLink, callback, maxThreadCount);
+
         callback->setTarget(directory);
-        for (unsigned a = 0; a < archiveLink.Arcs.Size(); ++a) {
+        for (unsigned a = 0; !extracted && a < archiveLink.Arcs.Size(); ++a) {
             callback->setArchive(&archiveLink.Arcs[a]);
             IInArchive *const arch = archiveLink.Arcs[a].Archive;
 
@@ -1069,27 +1527,11 @@ bool isSupportedArchive(QFileDevice *archive)
 
     const qint64 initialPos = archive->pos();
     try {
-        CCodecs codecs;
-        if (codecs.Load() != S_OK)
-            throw SevenZipException(QCoreApplication::translate("Lib7z", "Cannot load codecs."));
-
-        COpenOptions op;
-        op.codecs = &codecs;
-
-        CObjectVector<COpenType> types;
-        op.types = &types;  // Empty, because we use a stream.
-
-        CIntVector excluded;
-        op.excludedFormats = &excluded;
-
+        // CMyComPtr is needed, otherwise it crashes in OpenStream().
         const CMyComPtr<IInStream> stream = new QIODeviceInStream(archive);
-        op.stream = stream; // CMyComPtr is needed, otherwise it crashes in OpenStream().
-
-        CObjectVector<CProperty> properties;
-        op.props = &properties;
 
         CArchiveLink archiveLink;
-        const HRESULT result = archiveLink.Open2(op, nullptr);
+        const HRESULT result = openArchive(stream, &archiveLink);
 
         archive->seek(initialPos);
         return result == S_OK;
@@ -0,0 +1,374 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include "metadatacache.h"
+
+#include "fileutils.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace QInstaller {
+
+namespace {
+
+const quint32 IndexMagic = 0x49464d43; // "IFMC"
+const qint32 IndexVersion = 2; // version 1 lacks whether the repository has an Updates.index
+
+// package names come from the repository, they must not point outside the cache directory
+bool isPackageDirectoryName(const QString &package)
+{
+    return !package.isEmpty() && !package.contains(QLatin1Char('/'))
+        && !package.contains(QLatin1Char('\\')) && !package.contains(QLatin1String(".."));
+}
+
+}
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::MetadataCache
+    \brief The MetadataCache class keeps the unpacked metadata of a repository across runs.
+
+    Every repository gets a directory of its own below the cache directory, named after a hash
+    of the repository URL. It holds the last downloaded Updates.xml together with its HTTP
+    validators, and one directory per package unpacked from the meta.7z archive of that
+    package. An index remembers the version and SHA-1 checksum each package directory was
+    unpacked from, so that only packages whose version or checksum changed have to be fetched
+    again.
+
+    The repository directory is locked while the cache is open, so that installers running at
+    the same time do not modify it under each other's feet.
+*/
+
+/*!
+    Creates a cache for the repository at \a repositoryUrl below \a cacheDirectory. Call open()
+    before using it.
+*/
+MetadataCache::MetadataCache(const QString &cacheDirectory, const QUrl &repositoryUrl)
+    : m_updatesIndexMissing(false)
+{
+    const QByteArray key = repositoryUrl.toString(QUrl::RemovePassword | QUrl::StripTrailingSlash)
+        .toUtf8();
+    m_directory = cacheDirectory + QLatin1Char('/')
+        + QString::fromLatin1(QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex());
+}
+
+MetadataCache::~MetadataCache()
+{
+}
+
+/*!
+    Returns the directory used for caching metadata unless another one is set.
+*/
+QString MetadataCache::defaultCacheDirectory()
+{
+    const QString location = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (location.isEmpty())
+        return QString();
+    return location + QLatin1String("/qt-installer-framework/metadata");
+}
+
+/*!
+    Creates and locks the repository directory and reads its index. Returns \c false and sets
+    errorString() if the directory cannot be created or is in use by another process.
+*/
+bool MetadataCache::open()
+{
+    if (isOpen())
+        return true;
+
+    if (!QDir().mkpath(m_directory)) {
+        m_errorString = QString::fromLatin1("Cannot create directory \"%1\".")
+            .arg(QDir::toNativeSeparators(m_directory));
+        return false;
+    }
+
+    QScopedPointer<QLockFile> lock(new QLockFile(m_directory + QLatin1String(".lock")));
+    lock->setStaleLockTime(0); // only a crashed owner makes the lock stale
+    if (!lock->tryLock()) {
+        m_errorString = QString::fromLatin1("Directory \"%1\" is in use.")
+            .arg(QDir::toNativeSeparators(m_directory));
+        return false;
+    }
+    m_lock.swap(lock);
+    load();
+    return true;
+}
+
+/*!
+    Returns whether the cache was opened successfully.
+*/
+bool MetadataCache::isOpen() const
+{
+    return !m_lock.isNull();
+}
+
+/*!
+    Returns a description of the last error that occurred.
+*/
+QString MetadataCache::errorString() const
+{
+    return m_errorString;
+}
+
+/*!
+    Returns the directory holding Updates.xml and the unpacked package metadata.
+*/
+QString MetadataCache::directory() const
+{
+    return m_directory;
+}
+
+/*!
+    Returns the path of the cached Updates.xml.
+*/
+QString MetadataCache::updatesXml() const
+{
+    return m_directory + QLatin1String("/Updates.xml");
+}
+
+/*!
+    Returns the entity tag the server sent along with the cached Updates.xml.
+*/
+QByteArray MetadataCache::eTag() const
+{
+    return m_eTag;
+}
+
+/*!
+    Returns the modification date the server sent along with the cached Updates.xml.
+*/
+QByteArray MetadataCache::lastModified() const
+{
+    return m_lastModified;
+}
+
+/*!
+    Remembers \a eTag and \a lastModified of the cached Updates.xml, to revalidate it with the
+    next request. Pass empty values to force a full download next time.
+*/
+void MetadataCache::setValidators(const QByteArray &eTag, const QByteArray &lastModified)
+{
+    m_eTag = eTag;
+    m_lastModified = lastModified;
+}
+
+/*!
+    Returns whether the repository had no Updates.index when it was last asked for one.
+*/
+bool MetadataCache::isUpdatesIndexMissing() const
+{
+    return m_updatesIndexMissing;
+}
+
+/*!
+    Remembers whether the repository has no Updates.index, as given by \a missing, so that it
+    is not asked for one on every run.
+*/
+void MetadataCache::setUpdatesIndexMissing(bool missing)
+{
+    m_updatesIndexMissing = missing;
+}
+
+/*!
+    Returns whether the metadata of \a package was unpacked from an archive with \a version and
+    \a sha1, and the unpacked metadata is still there. Packages without a checksum are never
+    considered cached.
+*/
+bool MetadataCache::contains(const QString &package, const QString &version,
+    const QByteArray &sha1) const
+{
+    if (sha1.isEmpty())
+        return false;
+    const QHash<QString, Entry>::const_iterator it = m_entries.constFind(package);
+    return it != m_entries.constEnd() && it->version == version && it->sha1 == sha1
+        && QFileInfo(m_directory + QLatin1Char('/') + package).isDir();
+}
+
+/*!
+    Returns the names of all packages in the index.
+*/
+QStringList MetadataCache::packages() const
+{
+    return m_entries.keys();
+}
+
+/*!
+    Removes \a package from the index and deletes its unpacked metadata. The metadata is kept if
+    \a package is no plain directory name, like one containing a path separator or \c{..}.
+*/
+void MetadataCache::remove(const QString &package)
+{
+    m_entries.remove(package);
+    m_pending.remove(package);
+    if (!isPackageDirectoryName(package)) {
+        qDebug() << "Refusing to delete metadata of package with invalid name" << package;
+        return;
+    }
+    const QString path = m_directory + QLatin1Char('/') + package;
+    if (QFileInfo::exists(path))
+        removeDirectory(path, true);
+}
+
+/*!
+    Removes all packages from the index that are not listed in \a packages.
+*/
+void MetadataCache::retain(const QSet<QString> &packages)
+{
+    foreach (const QString &package, m_entries.keys()) {
+        if (!packages.contains(package))
+            remove(package);
+    }
+}
+
+/*!
+    Marks \a package as being fetched again for \a version and \a sha1. The package is
+    removed from the index until commitUpdates() is called after it got unpacked.
+*/
+void MetadataCache::beginUpdate(const QString &package, const QString &version,
+    const QByteArray &sha1)
+{
+    remove(package);
+    const Entry entry = { version, sha1 };
+    m_pending.insert(package, entry);
+}
+
+/*!
+    Drops the pending update of \a package, it stays out of the index.
+*/
+void MetadataCache::cancelUpdate(const QString &package)
+{
+    m_pending.remove(package);
+}
+
+/*!
+    Adds all packages passed to beginUpdate() to the index and saves it.
+*/
+bool MetadataCache::commitUpdates()
+{
+    for (QHash<QString, Entry>::const_iterator it = m_pending.constBegin();
+            it != m_pending.constEnd(); ++it) {
+        m_entries.insert(it.key(), it.value());
+    }
+    m_pending.clear();
+    return save();
+}
+
+/*!
+    Writes the index to disk. Returns \c false and sets errorString() on failure.
+*/
+bool MetadataCache::save()
+{
+    QSaveFile file(m_directory + QLatin1String("/index"));
+    if (!file.open(QIODevice::WriteOnly)) {
+        m_errorString = file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << IndexMagic << IndexVersion << m_eTag << m_lastModified << m_updatesIndexMissing
+        << qint32(m_entries.count());
+    for (QHash<QString, Entry>::const_iterator it = m_entries.constBegin();
+            it != m_entries.constEnd(); ++it) {
+        stream << it.key() << it->version << it->sha1;
+    }
+
+    if (!file.commit()) {
+        m_errorString = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+/*
+    Reads the index. A missing or broken index leaves the cache empty, everything is fetched
+    again then.
+*/
+void MetadataCache::load()
+{
+    m_eTag.clear();
+    m_lastModified.clear();
+    m_updatesIndexMissing = false;
+    m_entries.clear();
+
+    QFile file(m_directory + QLatin1String("/index"));
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic;
+    qint32 version;
+    qint32 count;
+    QByteArray eTag;
+    QByteArray lastModified;
+    bool updatesIndexMissing = false;
+    stream >> magic >> version;
+    if (stream.status() != QDataStream::Ok || magic != IndexMagic || version < 1
+        || version > IndexVersion) {
+        qDebug() << "Ignoring metadata cache index of unknown format in"
+            << m_directory;
+        return;
+    }
+
+    stream >> eTag >> lastModified;
+    if (version >= 2)
+        stream >> updatesIndexMissing;
+    stream >> count;
+    QHash<QString, Entry> entries;
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString package;
+        Entry entry;
+        stream >> package >> entry.version >> entry.sha1;
+        if (isPackageDirectoryName(package))
+            entries.insert(package, entry);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        qDebug() << "Ignoring truncated metadata cache index in"
+            << m_directory;
+        return;
+    }
+
+    m_entries = entries;
+    m_updatesIndexMissing = updatesIndexMissing;
+    // without the file the validators would make the server answer with an empty reply
+    if (QFileInfo::exists(updatesXml())) {
+        m_eTag = eTag;
+        m_lastModified = lastModified;
+    }
+}
+
+} // namespace QInstaller
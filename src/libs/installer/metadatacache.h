@@ -0,0 +1,103 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#ifndef METADATACACHE_H
+#define METADATACACHE_H
+
+#include "installer_global.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QScopedPointer>
+#include <QSet>
+#include <QString>
+#include <QUrl>
+
+QT_BEGIN_NAMESPACE
+class QLockFile;
+QT_END_NAMESPACE
+
+namespace QInstaller {
+
+class INSTALLER_EXPORT MetadataCache
+{
+    Q_DISABLE_COPY(MetadataCache)
+
+public:
+    MetadataCache(const QString &cacheDirectory, const QUrl &repositoryUrl);
+    ~MetadataCache();
+
+    static QString defaultCacheDirectory();
+
+    bool open();
+    bool isOpen() const;
+    QString errorString() const;
+
+    QString directory() const;
+    QString updatesXml() const;
+
+    QByteArray eTag() const;
+    QByteArray lastModified() const;
+    void setValidators(const QByteArray &eTag, const QByteArray &lastModified);
+
+    bool isUpdatesIndexMissing() const;
+    void setUpdatesIndexMissing(bool missing);
+
+    bool contains(const QString &package, const QString &version, const QByteArray &sha1) const;
+    QStringList packages() const;
+    void remove(const QString &package);
+    void retain(const QSet<QString> &packages);
+
+    void beginUpdate(const QString &package, const QString &version, const QByteArray &sha1);
+    void cancelUpdate(const QString &package);
+    bool commitUpdates();
+
+    bool save();
+
+private:
+    void load();
+
+private:
+    struct Entry {
+        QString version;
+        QByteArray sha1;
+    };
+
+    QString m_directory;
+    QScopedPointer<QLockFile> m_lock;
+    QString m_errorString;
+    QByteArray m_eTag;
+    QByteArray m_lastModified;
+    bool m_updatesIndexMissing;
+    QHash<QString, Entry> m_entries;
+    QHash<QString, Entry> m_pending;
+};
+
+} // namespace QInstaller
+
+#endif // METADATACACHE_H
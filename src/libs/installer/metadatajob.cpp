@@ -28,6 +28,7 @@
 #include "metadatajob.h"
 
 #include "metadatajob_p.h"
+#include "metadatacache.h"
 #include "packagemanagercore.h"
 #include "packagemanagerproxyfactory.h"
 #include "productkeycheck.h"
@@ -36,6 +37,8 @@
 #include "settings.h"
 #include "testrepository.h"
 
+#include <QFileInfo>
+#include <QSaveFile>
 #include <QTemporaryDir>
 #include <QtMath>
 
@@ -51,12 +54,39 @@ static QUrl resolveUrl(const FileTaskResult &result, const QString &url)
     return u;
 }
 
+static QString cacheKey(const Repository &repository)
+{
+    return repository.url().toString(QUrl::RemovePassword | QUrl::StripTrailingSlash);
+}
+
+namespace {
+
+enum ItemRole {
+    UpdatesIndexRole = TaskRole::UserRole + 1,  // the item fetches the Updates.index of a repository
+    PackageUpdateRole,                          // name of the package whose PackageUpdate.xml is fetched
+    CachedUpdatesXmlRole,                       // the cached Updates.xml, already matched to the index
+    UpdatesIndexSkippedRole                     // the repository had no Updates.index last time
+};
+
+}
+
+static bool readDocument(const QString &fileName, QDomDocument *document, QString *errorString)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *errorString = file.errorString();
+        return false;
+    }
+    return document->setContent(&file, errorString);
+}
+
 MetadataJob::MetadataJob(QObject *parent)
     : Job(parent)
     , m_core(nullptr)
     , m_addCompressedPackages(false)
     , m_downloadableChunkSize(1000)
     , m_taskNumber(0)
+    , m_cacheDirectory(MetadataCache::defaultCacheDirectory())
 {
     setCapabilities(Cancelable);
     connect(&m_xmlTask, &QFutureWatcherBase::finished, this, &MetadataJob::xmlTaskFinished);
@@ -111,6 +141,8 @@ void MetadataJob::doStart()
     const ProductKeyCheck *const productKeyCheck = ProductKeyCheck::instance();
     if (!m_addCompressedPackages) {
         emit infoMessage(this, tr("Preparing meta information download..."));
+        m_updatesIndexes.clear();
+        m_updatesXmlResults.clear();
         const bool onlineInstaller = m_core->isInstaller() && !m_core->isOfflineOnly();
         if (onlineInstaller || m_core->isMaintainer()) {
             QList<FileTaskItem> items;
@@ -118,20 +150,22 @@ void MetadataJob::doStart()
             foreach (const Repository &repo, repositories) {
                 if (repo.isEnabled() &&
                         productKeyCheck->isValidRepository(repo)) {
-                    QAuthenticator authenticator;
-                    authenticator.setUser(repo.username());
-                    authenticator.setPassword(repo.password());
-
                     if (!repo.isCompressed()) {
-                        QString url = repo.url().toString() + QLatin1String("/Updates.xml?");
-                        if (!m_core->value(scUrlQueryString).isEmpty())
-                            url += m_core->value(scUrlQueryString) + QLatin1Char('&');
-
-                        // also append a random string to avoid proxy caches
-                        FileTaskItem item(url.append(QString::number(qrand() * qrand())));
-                        item.insert(TaskRole::UserRole, QVariant::fromValue(repo));
-                        item.insert(TaskRole::Authenticator, QVariant::fromValue(authenticator));
-                        items.append(item);
+                        const MetadataCache *const cache = openCache(repo);
+                        if (cache && !cache->isUpdatesIndexMissing()) {
+                            // the small index comes first, it tells whether the cached
+                            // Updates.xml can be reused or brought up to date package by package
+                            FileTaskItem item = repositoryFileItem(repo, UpdatesIndex::fileName());
+                            item.insert(UpdatesIndexRole, true);
+                            item.insert(TaskRole::Optional, true);
+                            items.append(item);
+                        } else {
+                            // repositories without an index do not pay a failed request each run
+                            FileTaskItem item = updatesXmlItem(repo);
+                            if (cache)
+                                item.insert(UpdatesIndexSkippedRole, true);
+                            items.append(item);
+                        }
                     }
                     else {
                         qDebug() << "Trying to parse compressed repo as normal repository."\
@@ -287,7 +321,14 @@ void MetadataJob::xmlTaskFinished()
     Status status = XmlDownloadFailure;
     try {
         m_xmlTask.waitForFinished();
-        status = parseUpdatesXml(m_xmlTask.future().results());
+        const QList<FileTaskItem> items = resolveUpdatesIndexes(m_xmlTask.future().results());
+        if (!items.isEmpty()) {
+            startXMLTask(items); // changed packages or complete Updates.xml files still missing
+            return;
+        }
+        status = parseUpdatesXml(m_updatesXmlResults);
+        m_updatesXmlResults.clear();
+        m_updatesIndexes.clear();
     } catch (const AuthenticationRequiredException &e) {
         if (e.type() == AuthenticationRequiredException::Type::Proxy) {
             const QNetworkProxy proxy = e.proxy();
@@ -380,11 +421,18 @@ void MetadataJob::unzipTaskFinished()
     if (error() != Job::NoError)
         return;
 
-    delete m_unzipTasks.value(watcher);
+    UnzipArchiveTask *const task = qobject_cast<UnzipArchiveTask *>(m_unzipTasks.value(watcher));
+    if (cacheForDirectory(task->target()))
+        QFile::remove(task->archive()); // the cache only keeps the unpacked metadata
+    delete task;
     m_unzipTasks.remove(watcher);
     delete watcher;
 
     if (m_unzipTasks.isEmpty()) {
+        foreach (const QSharedPointer<MetadataCache> &cache, m_caches) {
+            if (cache && !cache->commitUpdates())
+                qDebug() << "Cannot update metadata cache:" << cache->errorString();
+        }
         setProcessedAmount(100);
         emitFinished();
     }
@@ -415,6 +463,11 @@ void MetadataJob::metadataTaskFinished()
                                 .arg(item.value(TaskRole::SourceFile).toString());
                         if (m_core->settings().allowUnstableComponents()) {
                             m_shaMissmatchPackages.append(item.value(TaskRole::Name).toString());
+                            // keep it out of the cache, so that it is checked again next time
+                            MetadataCache *const cache = cacheForDirectory(item
+                                .value(TaskRole::UserRole).toString());
+                            if (cache)
+                                cache->cancelUpdate(item.value(TaskRole::Name).toString());
                             qWarning() << mismatchMessage;
                         } else {
                             throw QInstaller::TaskException(mismatchMessage);
@@ -487,6 +540,9 @@ void MetadataJob::reset()
         m_metadataTask.cancel();
     } catch (...) {}
     m_tempDirDeleter.releaseAndDeleteAll();
+    m_caches.clear(); // drops pending cache updates and releases the locks
+    m_updatesIndexes.clear();
+    m_updatesXmlResults.clear();
     m_metadataResult.clear();
     m_taskNumber = 0;
 }
@@ -516,106 +572,336 @@ void MetadataJob::resetCompressedFetch()
     } catch (...) {}
 }
 
+FileTaskItem MetadataJob::repositoryFileItem(const Repository &repository,
+    const QString &fileName) const
+{
+    QString url = repository.url().toString() + QLatin1Char('/') + fileName;
+    if (!m_core->value(scUrlQueryString).isEmpty())
+        url += QLatin1Char('?') + m_core->value(scUrlQueryString);
+
+    QAuthenticator authenticator;
+    authenticator.setUser(repository.username());
+    authenticator.setPassword(repository.password());
+
+    // make proxies revalidate what they might have cached
+    QVariantHash headers;
+    headers.insert(QLatin1String("Cache-Control"), QByteArray("no-cache"));
+
+    FileTaskItem item(url);
+    item.insert(TaskRole::UserRole, QVariant::fromValue(repository));
+    item.insert(TaskRole::Authenticator, QVariant::fromValue(authenticator));
+    item.insert(TaskRole::RequestHeaders, headers);
+    return item;
+}
+
+FileTaskItem MetadataJob::updatesXmlItem(const Repository &repository) const
+{
+    FileTaskItem item = repositoryFileItem(repository, QLatin1String("Updates.xml"));
+    if (const MetadataCache *const cache = cacheForRepository(repository)) {
+        // let the server tell whether the cached copy is still current
+        QVariantHash headers = item.value(TaskRole::RequestHeaders).toHash();
+        if (!cache->eTag().isEmpty())
+            headers.insert(QLatin1String("If-None-Match"), cache->eTag());
+        if (!cache->lastModified().isEmpty())
+            headers.insert(QLatin1String("If-Modified-Since"), cache->lastModified());
+        item.insert(TaskRole::RequestHeaders, headers);
+    }
+    return item;
+}
+
+/*
+ * Sorts the results of an Updates.xml download round. Results of Updates.xml files are kept for
+ * parsing. Fetched indexes and PackageUpdate.xml files are used to bring the cached Updates.xml
+ * of their repository up to date. Returns the items that need another round, that is the
+ * PackageUpdate.xml files of changed packages and the Updates.xml files of repositories that
+ * cannot be updated from their index.
+ */
+QList<FileTaskItem> MetadataJob::resolveUpdatesIndexes(const QList<FileTaskResult> &results)
+{
+    QList<FileTaskItem> items;
+    QHash<QString, Repository> repositories;
+    QHash<QString, QList<FileTaskResult> > packageUpdates;
+    foreach (const FileTaskResult &result, results) {
+        const FileTaskItem item = result.taskItem();
+        if (item.value(UpdatesIndexRole).toBool()) {
+            items.append(resolveUpdatesIndex(result));
+        } else if (item.value(PackageUpdateRole).isValid()) {
+            const Repository repository = item.value(TaskRole::UserRole).value<Repository>();
+            repositories.insert(cacheKey(repository), repository);
+            packageUpdates[cacheKey(repository)].append(result);
+        } else {
+            m_updatesXmlResults.append(result);
+        }
+    }
+
+    foreach (const Repository &repository, repositories) {
+        if (applyPackageUpdates(repository, packageUpdates.value(cacheKey(repository))))
+            continue;
+        m_updatesIndexes.remove(cacheKey(repository));
+        items.append(updatesXmlItem(repository));
+    }
+    return items;
+}
+
+QList<FileTaskItem> MetadataJob::resolveUpdatesIndex(const FileTaskResult &result)
+{
+    const Repository repository = result.taskItem().value(TaskRole::UserRole).value<Repository>();
+    MetadataCache *const cache = cacheForRepository(repository);
+
+    QString error;
+    UpdatesIndex index;
+    const bool valid = !result.target().isEmpty() && index.read(result.target(), &error);
+    if (!result.target().isEmpty())
+        QFile::remove(result.target());
+    if (cache && result.target().isEmpty()) {
+        // asked for again once the Updates.xml of the repository changes
+        qDebug() << "No Updates.index in" << repository.displayname();
+        cache->setUpdatesIndexMissing(true);
+    }
+    if (!cache || !valid) {
+        qDebug() << "Cannot use Updates.index of" << repository.displayname() << error;
+        return QList<FileTaskItem>() << updatesXmlItem(repository);
+    }
+    cache->setUpdatesIndexMissing(false);
+    m_updatesIndexes.insert(cacheKey(repository), index);
+
+    UpdatesIndex cachedIndex;
+    if (QFileInfo::exists(cache->updatesXml())
+        && cachedIndex.read(cache->directory() + QLatin1Char('/') + UpdatesIndex::fileName())
+        && cachedIndex.hasSameContent(index)) {
+        FileTaskItem item = updatesXmlItem(repository);
+        item.insert(CachedUpdatesXmlRole, true);
+        FileTaskResult cached(QString(), QByteArray(), item, false);
+        cached.insert(TaskRole::NotModified, true);
+        m_updatesXmlResults.append(cached);
+        return QList<FileTaskItem>();
+    }
+
+    QDomDocument doc;
+    if (!readDocument(cache->updatesXml(), &doc, &error)
+        || UpdatesIndex::hashHeader(doc) != index.headerSha1()) {
+        return QList<FileTaskItem>() << updatesXmlItem(repository);
+    }
+
+    const QStringList changed = index.changedPackages(doc);
+    if (changed.count() > index.packages().count() / 2)
+        return QList<FileTaskItem>() << updatesXmlItem(repository); // cheaper in one go
+    if (changed.isEmpty()) {
+        if (applyPackageUpdates(repository, QList<FileTaskResult>()))
+            return QList<FileTaskItem>();
+        m_updatesIndexes.remove(cacheKey(repository));
+        return QList<FileTaskItem>() << updatesXmlItem(repository);
+    }
+
+    qDebug() << "Fetching" << changed.count() << "changed package updates of"
+        << repository.displayname();
+    QList<FileTaskItem> items;
+    foreach (const QString &package, changed) {
+        FileTaskItem item = repositoryFileItem(repository,
+            UpdatesIndex::packageUpdateFileName(package));
+        item.insert(PackageUpdateRole, package);
+        item.insert(TaskRole::Optional, true);
+        items.append(item);
+    }
+    return items;
+}
+
+/*
+ * Replaces the PackageUpdate elements of the cached Updates.xml of \a repository with the ones
+ * fetched in \a results. On success a result for the cached Updates.xml is queued for parsing.
+ */
+bool MetadataJob::applyPackageUpdates(const Repository &repository,
+    const QList<FileTaskResult> &results)
+{
+    MetadataCache *const cache = cacheForRepository(repository);
+    const UpdatesIndex index = m_updatesIndexes.value(cacheKey(repository));
+
+    QString error;
+    bool ok = cache && index.isValid();
+    QHash<QString, QDomElement> packageUpdates;
+    foreach (const FileTaskResult &result, results) {
+        QDomDocument fragment;
+        if (ok) {
+            ok = !result.target().isEmpty() && readDocument(result.target(), &fragment, &error);
+            packageUpdates.insert(result.taskItem().value(PackageUpdateRole).toString(),
+                fragment.documentElement());
+        }
+        if (!result.target().isEmpty())
+            QFile::remove(result.target());
+    }
+
+    QDomDocument doc;
+    if (ok) {
+        ok = readDocument(cache->updatesXml(), &doc, &error)
+            && index.apply(&doc, packageUpdates, &error);
+    }
+    if (ok) {
+        QSaveFile file(cache->updatesXml());
+        ok = file.open(QIODevice::WriteOnly) && file.write(doc.toByteArray()) != -1
+            && file.commit();
+        if (!ok)
+            error = file.errorString();
+    }
+    if (!ok) {
+        qDebug() << "Cannot update the cached Updates.xml of" << repository.displayname()
+            << "from its index:" << error;
+        return false;
+    }
+
+    // the merged file is no longer byte by byte what the server has
+    cache->setValidators(QByteArray(), QByteArray());
+    const QString indexFile = cache->directory() + QLatin1Char('/') + UpdatesIndex::fileName();
+    if (!index.write(indexFile, &error)) {
+        qDebug() << "Cannot store Updates.index:" << error;
+        QFile::remove(indexFile);
+    }
+    qDebug() << "Updated" << packageUpdates.count() << "packages in the cached Updates.xml of"
+        << repository.displayname();
+
+    FileTaskItem item = updatesXmlItem(repository);
+    item.insert(CachedUpdatesXmlRole, true);
+    FileTaskResult cached(QString(), QByteArray(), item, false);
+    cached.insert(TaskRole::NotModified, true);
+    m_updatesXmlResults.append(cached);
+    return true;
+}
+
 MetadataJob::Status MetadataJob::parseUpdatesXml(const QList<FileTaskResult> &results)
 {
     foreach (const FileTaskResult &result, results) {
         if (error() != Job::NoError)
             return XmlDownloadFailure;
 
+        const FileTaskItem item = result.value(TaskRole::TaskItem).value<FileTaskItem>();
+        Metadata metadata;
+        metadata.repository = item.value(TaskRole::UserRole).value<Repository>();
+        MetadataCache *const cache = cacheForRepository(metadata.repository);
+        const bool notModified = cache && result.value(TaskRole::NotModified).toBool();
+
         //If repository is not found, target might be empty. Do not continue parsing the
         //repository and do not prevent further repositories usage.
-        if (result.target().isEmpty()) {
+        if (result.target().isEmpty() && !notModified) {
             continue;
         }
-        Metadata metadata;
-        QTemporaryDir tmp(QDir::tempPath() + QLatin1String("/remoterepo-XXXXXX"));
-        if (!tmp.isValid()) {
-            qDebug() << "Cannot create unique temporary directory.";
-            return XmlDownloadFailure;
-        }
 
-        tmp.setAutoRemove(false);
-        metadata.directory = tmp.path();
-        m_tempDirDeleter.add(metadata.directory);
+        if (cache) {
+            // the unpacked metadata of unchanged packages is reused from earlier runs
+            metadata.directory = cache->directory();
+        } else {
+            QTemporaryDir tmp(QDir::tempPath() + QLatin1String("/remoterepo-XXXXXX"));
+            if (!tmp.isValid()) {
+                qDebug() << "Cannot create unique temporary directory.";
+                return XmlDownloadFailure;
+            }
+
+            tmp.setAutoRemove(false);
+            metadata.directory = tmp.path();
+            m_tempDirDeleter.add(metadata.directory);
+        }
 
         QFile file(result.target());
-        if (!file.rename(metadata.directory + QLatin1String("/Updates.xml"))) {
-            qDebug() << "Cannot rename target to Updates.xml:" << file.errorString();
-            return XmlDownloadFailure;
+        const QString updatesXml = metadata.directory + QLatin1String("/Updates.xml");
+        if (notModified) {
+            qDebug() << "Using cached Updates.xml of" << metadata.repository.displayname();
+            file.setFileName(updatesXml);
+        } else {
+            if (cache) {
+                QFile::remove(updatesXml);
+                cache->setValidators(result.value(TaskRole::ETag).toByteArray(),
+                    result.value(TaskRole::LastModified).toByteArray());
+                // the repository was republished, it might come with an index now
+                if (item.value(UpdatesIndexSkippedRole).toBool())
+                    cache->setUpdatesIndexMissing(false);
+            }
+            if (!file.rename(updatesXml)) {
+                qDebug() << "Cannot rename target to Updates.xml:" << file.errorString();
+                return XmlDownloadFailure;
+            }
         }
 
-        if (!file.open(QIODevice::ReadOnly)) {
-            qDebug() << "Cannot open Updates.xml for reading:" << file.errorString();
+        // parsed once, the package records are handed on to the update finder with the metadata
+        metadata.updatesInfo.setFileName(updatesXml);
+        if (metadata.updatesInfo.error() == KDUpdater::UpdatesInfo::CouldNotReadUpdateInfoFileError) {
+            qDebug() << "Cannot open Updates.xml for reading:" << metadata.updatesInfo.errorString();
             return XmlDownloadFailure;
         }
-
-        QString error;
-        QDomDocument doc;
-        if (!doc.setContent(&file, &error)) {
+        if (metadata.updatesInfo.error() == KDUpdater::UpdatesInfo::InvalidXmlError) {
             qDebug().nospace() << "Cannot fetch a valid version of Updates.xml from repository "
-                               << metadata.repository.displayname() << ": " << error;
+                               << metadata.repository.displayname() << ": "
+                               << metadata.updatesInfo.errorString();
+            if (cache) {
+                cache->setValidators(QByteArray(), QByteArray()); // download it again next time
+                cache->save();
+                QFile::remove(metadata.directory + QLatin1Char('/') + UpdatesIndex::fileName());
+            }
             //If there are other repositories, try to use those
             continue;
         }
-        file.close();
+        // invalid content is reported by the update finder, like it always was
+
+        if (cache && !item.value(CachedUpdatesXmlRole).toBool()) {
+            // keep the index only next to the Updates.xml it describes
+            const QString indexFile = metadata.directory + QLatin1Char('/') + UpdatesIndex::fileName();
+            const UpdatesIndex index = m_updatesIndexes.value(cacheKey(metadata.repository));
+            QDomDocument doc;
+            QString error;
+            if (!index.isValid() || !readDocument(updatesXml, &doc, &error)
+                || !index.describes(doc) || !index.write(indexFile)) {
+                QFile::remove(indexFile);
+            }
+        }
 
-        const FileTaskItem item = result.value(TaskRole::TaskItem).value<FileTaskItem>();
-        metadata.repository = item.value(TaskRole::UserRole).value<Repository>();
         const bool online = !(metadata.repository.url().scheme()).isEmpty();
 
         bool testCheckSum = true;
-        const QDomElement root = doc.documentElement();
-        const QDomNode checksum = root.firstChildElement(QLatin1String("Checksum"));
-        if (!checksum.isNull())
-            testCheckSum = (checksum.toElement().text().toLower() == scTrue);
-
-        QDomNodeList children = root.childNodes();
-        for (int i = 0; i < children.count(); ++i) {
-            const QDomElement el = children.at(i).toElement();
-            if (!el.isNull() && el.tagName() == QLatin1String("PackageUpdate")) {
-                const QDomNodeList c2 = el.childNodes();
-                QString packageName, packageVersion, packageHash;
-                bool metaFound = false;
-                for (int j = 0; j < c2.count(); ++j) {
-                    if (c2.at(j).toElement().tagName() == scName)
-                        packageName = c2.at(j).toElement().text();
-                    else if (c2.at(j).toElement().tagName() == scVersion)
-                        packageVersion = (online ? c2.at(j).toElement().text() : QString());
-                    else if ((c2.at(j).toElement().tagName() == QLatin1String("SHA1")) && testCheckSum)
-                        packageHash = c2.at(j).toElement().text();
-                    else {
-                        foreach (QString meta, metaElements) {
-                            if (c2.at(j).toElement().tagName() == meta) {
-                                metaFound = true;
-                                break;
-                            }
-                        }
-                    }
+        if (metadata.updatesInfo.hasChecksum())
+            testCheckSum = (metadata.updatesInfo.checksum().toLower() == scTrue);
+
+        QSet<QString> packageNames;
+        foreach (const KDUpdater::UpdateInfo &info, metadata.updatesInfo.updatesInfo()) {
+            const QString packageName = info.data.value(scName).toString();
+            const QString packageVersion = online ? info.data.value(scVersion).toString() : QString();
+            const QString packageHash = testCheckSum
+                ? info.data.value(QLatin1String("SHA1")).toString() : QString();
+            bool metaFound = false;
+            foreach (const QString &meta, metaElements) {
+                if (info.data.contains(meta)) {
+                    metaFound = true;
+                    break;
                 }
+            }
 
-                const QString repoUrl = metadata.repository.url().toString();
-                //If script element is not found, no need to fetch metadata
-                if (metaFound) {
-                    FileTaskItem item(QString::fromLatin1("%1/%2/%3meta.7z").arg(repoUrl, packageName,
-                        packageVersion), metadata.directory + QString::fromLatin1("/%1-%2-meta.7z")
-                        .arg(packageName, packageVersion));
-
-                    QAuthenticator authenticator;
-                    authenticator.setUser(metadata.repository.username());
-                    authenticator.setPassword(metadata.repository.password());
-
-                    item.insert(TaskRole::UserRole, metadata.directory);
-                    item.insert(TaskRole::Checksum, packageHash.toLatin1());
-                    item.insert(TaskRole::Authenticator, QVariant::fromValue(authenticator));
-                    item.insert(TaskRole::Name, packageName);
-
-                    m_packages.append(item);
-                } else {
-                    QString fileName = metadata.directory + QLatin1Char('/') + packageName;
-                    QDir directory(fileName);
-                    if (!directory.exists()) {
-                        directory.mkdir(fileName);
-                    }
+            packageNames.insert(packageName);
+            const QString repoUrl = metadata.repository.url().toString();
+            //If script element is not found, no need to fetch metadata
+            if (metaFound && cache
+                && cache->contains(packageName, packageVersion, packageHash.toLatin1())) {
+                qDebug() << "Using cached meta information of" << packageName;
+            } else if (metaFound) {
+                if (cache)
+                    cache->beginUpdate(packageName, packageVersion, packageHash.toLatin1());
+
+                FileTaskItem item(QString::fromLatin1("%1/%2/%3meta.7z").arg(repoUrl, packageName,
+                    packageVersion), metadata.directory + QString::fromLatin1("/%1-%2-meta.7z")
+                    .arg(packageName, packageVersion));
+
+                QAuthenticator authenticator;
+                authenticator.setUser(metadata.repository.username());
+                authenticator.setPassword(metadata.repository.password());
+
+                item.insert(TaskRole::UserRole, metadata.directory);
+                item.insert(TaskRole::Checksum, packageHash.toLatin1());
+                item.insert(TaskRole::Authenticator, QVariant::fromValue(authenticator));
+                item.insert(TaskRole::Name, packageName);
+
+                m_packages.append(item);
+            } else {
+                if (cache)
+                    cache->remove(packageName); // drop what an older version shipped
+                QString fileName = metadata.directory + QLatin1Char('/') + packageName;
+                QDir directory(fileName);
+                if (!directory.exists()) {
+                    directory.mkdir(fileName);
                 }
             }
         }
@@ -630,53 +916,57 @@ MetadataJob::Status MetadataJob::parseUpdatesXml(const QList<FileTaskResult> &re
             m_metaFromArchive.insert(metadata.directory, metadata);
         }
 
+        if (cache) {
+            cache->retain(packageNames);
+            if (!cache->save())
+                qDebug() << "Cannot update metadata cache:" << cache->errorString();
+        }
+
 
         // search for additional repositories that we might need to check
-        const QDomNode repositoryUpdate = root.firstChildElement(QLatin1String("RepositoryUpdate"));
-        if (repositoryUpdate.isNull())
+        const QList<KDUpdater::RepositoryUpdateInfo> updates
+            = metadata.updatesInfo.repositoryUpdates();
+        if (updates.isEmpty())
             continue;
 
         QHash<QString, QPair<Repository, Repository> > repositoryUpdates;
-        children = repositoryUpdate.toElement().childNodes();
-        for (int i = 0; i < children.count(); ++i) {
-            const QDomElement el = children.at(i).toElement();
-            if (!el.isNull() && el.tagName() == QLatin1String("Repository")) {
-                const QString action = el.attribute(QLatin1String("action"));
-                if (action == QLatin1String("add")) {
-                    // add a new repository to the defaults list
-                    Repository repository(resolveUrl(result, el.attribute(QLatin1String("url"))), true);
-                    repository.setUsername(el.attribute(QLatin1String("username")));
-                    repository.setPassword(el.attribute(QLatin1String("password")));
-                    repository.setDisplayName(el.attribute(QLatin1String("displayname")));
-                    if (ProductKeyCheck::instance()->isValidRepository(repository)) {
-                        repositoryUpdates.insertMulti(action, qMakePair(repository, Repository()));
-                        qDebug() << "Repository to add:" << repository.displayname();
-                    }
-                } else if (action == QLatin1String("remove")) {
-                    // remove possible default repositories using the given server url
-                    Repository repository(resolveUrl(result, el.attribute(QLatin1String("url"))), true);
-                    repository.setDisplayName(el.attribute(QLatin1String("displayname")));
+        foreach (const KDUpdater::RepositoryUpdateInfo &update, updates) {
+            const QHash<QString, QString> &el = update.attributes;
+            const QString action = el.value(QLatin1String("action"));
+            if (action == QLatin1String("add")) {
+                // add a new repository to the defaults list
+                Repository repository(resolveUrl(result, el.value(QLatin1String("url"))), true);
+                repository.setUsername(el.value(QLatin1String("username")));
+                repository.setPassword(el.value(QLatin1String("password")));
+                repository.setDisplayName(el.value(QLatin1String("displayname")));
+                if (ProductKeyCheck::instance()->isValidRepository(repository)) {
                     repositoryUpdates.insertMulti(action, qMakePair(repository, Repository()));
-
-                    qDebug() << "Repository to remove:" << repository.displayname();
-                } else if (action == QLatin1String("replace")) {
-                    // replace possible default repositories using the given server url
-                    Repository oldRepository(resolveUrl(result, el.attribute(QLatin1String("oldUrl"))), true);
-                    Repository newRepository(resolveUrl(result, el.attribute(QLatin1String("newUrl"))), true);
-                    newRepository.setUsername(el.attribute(QLatin1String("username")));
-                    newRepository.setPassword(el.attribute(QLatin1String("password")));
-                    newRepository.setDisplayName(el.attribute(QLatin1String("displayname")));
-
-                    if (ProductKeyCheck::instance()->isValidRepository(newRepository)) {
-                        // store the new repository and the one old it replaces
-                        repositoryUpdates.insertMulti(action, qMakePair(newRepository, oldRepository));
-                        qDebug() << "Replace repository" << oldRepository.displayname() << "with"
-                            << newRepository.displayname();
-                    }
-                } else {
-                    qDebug() << "Invalid additional repositories action set in Updates.xml fetched "
-                        "from" << metadata.repository.displayname() << "line:" << el.lineNumber();
+                    qDebug() << "Repository to add:" << repository.displayname();
+                }
+            } else if (action == QLatin1String("remove")) {
+                // remove possible default repositories using the given server url
+                Repository repository(resolveUrl(result, el.value(QLatin1String("url"))), true);
+                repository.setDisplayName(el.value(QLatin1String("displayname")));
+                repositoryUpdates.insertMulti(action, qMakePair(repository, Repository()));
+
+                qDebug() << "Repository to remove:" << repository.displayname();
+            } else if (action == QLatin1String("replace")) {
+                // replace possible default repositories using the given server url
+                Repository oldRepository(resolveUrl(result, el.value(QLatin1String("oldUrl"))), true);
+                Repository newRepository(resolveUrl(result, el.value(QLatin1String("newUrl"))), true);
+                newRepository.setUsername(el.value(QLatin1String("username")));
+                newRepository.setPassword(el.value(QLatin1String("password")));
+                newRepository.setDisplayName(el.value(QLatin1String("displayname")));
+
+                if (ProductKeyCheck::instance()->isValidRepository(newRepository)) {
+                    // store the new repository and the one old it replaces
+                    repositoryUpdates.insertMulti(action, qMakePair(newRepository, oldRepository));
+                    qDebug() << "Replace repository" << oldRepository.displayname() << "with"
+                        << newRepository.displayname();
                 }
+            } else {
+                qDebug() << "Invalid additional repositories action set in Updates.xml fetched "
+                    "from" << metadata.repository.displayname() << "line:" << update.lineNumber;
             }
         }
 
@@ -719,6 +1009,42 @@ MetadataJob::Status MetadataJob::parseUpdatesXml(const QList<FileTaskResult> &re
     return XmlDownloadSuccess;
 }
 
+/*
+    Opens the metadata cache for \a repository, unless caching is disabled or the repository
+    is a local archive. Returns \c nullptr if no cache can be used.
+*/
+MetadataCache *MetadataJob::openCache(const Repository &repository)
+{
+    if (m_cacheDirectory.isEmpty() || repository.isCompressed())
+        return nullptr;
+
+    const QString key = cacheKey(repository);
+    if (!m_caches.contains(key)) {
+        QSharedPointer<MetadataCache> cache(new MetadataCache(m_cacheDirectory, repository.url()));
+        if (!cache->open()) {
+            qDebug() << "Not caching meta information of" << repository.displayname() << ":"
+                << cache->errorString();
+            cache.clear();
+        }
+        m_caches.insert(key, cache); // a failure is remembered as well, to not try again
+    }
+    return m_caches.value(key).data();
+}
+
+MetadataCache *MetadataJob::cacheForRepository(const Repository &repository) const
+{
+    return m_caches.value(cacheKey(repository)).data();
+}
+
+MetadataCache *MetadataJob::cacheForDirectory(const QString &directory) const
+{
+    foreach (const QSharedPointer<MetadataCache> &cache, m_caches) {
+        if (cache && cache->directory() == directory)
+            return cache.data();
+    }
+    return nullptr;
+}
+
 QSet<Repository> MetadataJob::getRepositories()
 {
     QSet<Repository> repositories;
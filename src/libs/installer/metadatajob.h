@@ -33,17 +33,22 @@
 #include "fileutils.h"
 #include "job.h"
 #include "repository.h"
+#include "updatesindex.h"
+#include "updatesinfo_p.h"
 
 #include <QFutureWatcher>
+#include <QSharedPointer>
 
 namespace QInstaller {
 
+class MetadataCache;
 class PackageManagerCore;
 
 struct Metadata
 {
     QString directory;
     Repository repository;
+    KDUpdater::UpdatesInfo updatesInfo;
 };
 
 struct ArchiveMetadata
@@ -73,6 +78,9 @@ public:
     void addCompressedPackages(bool addCompressPackage) { m_addCompressedPackages = addCompressPackage;}
     QStringList shaMismatchPackages() const { return m_shaMissmatchPackages; }
 
+    QString cacheDirectory() const { return m_cacheDirectory; }
+    void setCacheDirectory(const QString &directory) { m_cacheDirectory = directory; }
+
 private slots:
     void doStart();
     void doCancel();
@@ -91,7 +99,15 @@ private:
     void reset();
     void resetCompressedFetch();
     Status parseUpdatesXml(const QList<FileTaskResult> &results);
+    FileTaskItem repositoryFileItem(const Repository &repository, const QString &fileName) const;
+    FileTaskItem updatesXmlItem(const Repository &repository) const;
+    QList<FileTaskItem> resolveUpdatesIndexes(const QList<FileTaskResult> &results);
+    QList<FileTaskItem> resolveUpdatesIndex(const FileTaskResult &result);
+    bool applyPackageUpdates(const Repository &repository, const QList<FileTaskResult> &results);
     QSet<Repository> getRepositories();
+    MetadataCache *openCache(const Repository &repository);
+    MetadataCache *cacheForRepository(const Repository &repository) const;
+    MetadataCache *cacheForDirectory(const QString &directory) const;
 
 private:
     PackageManagerCore *m_core;
@@ -112,6 +128,10 @@ private:
     QHash<QString, ArchiveMetadata> m_fetchedArchive;
     QHash<QString, Metadata> m_metaFromDefaultRepositories;
     QHash<QString, Metadata> m_metaFromArchive; //for faster lookups.
+    QString m_cacheDirectory;
+    QHash<QString, QSharedPointer<MetadataCache> > m_caches;
+    QHash<QString, UpdatesIndex> m_updatesIndexes;
+    QList<FileTaskResult> m_updatesXmlResults;
 };
 
 }   // namespace QInstaller
@@ -0,0 +1,299 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include "networksession.h"
+
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QNetworkAccessManager>
+#include <QNetworkProxyFactory>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QStringList>
+#include <QThread>
+#include <QUrl>
+
+#ifndef QT_NO_SSL
+#include <QSslConfiguration>
+#endif
+
+#include <memory>
+
+namespace QInstaller {
+
+namespace {
+
+// Requests in flight to one host, over all threads. HTTP/1.1 connections are limited to six per
+// host by QNetworkAccessManager anyway, an HTTP/2 connection multiplexes all of them.
+const int DefaultMaxRequestsPerHost = 16;
+
+class FixedProxyFactory : public QNetworkProxyFactory
+{
+public:
+    explicit FixedProxyFactory(const QList<QNetworkProxy> &proxies)
+        : m_proxies(proxies)
+    {}
+
+    QList<QNetworkProxy> queryProxy(const QNetworkProxyQuery &query) Q_DECL_OVERRIDE
+    {
+        Q_UNUSED(query)
+        return m_proxies;
+    }
+
+private:
+    const QList<QNetworkProxy> m_proxies;
+};
+
+}
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::NetworkSession
+    \brief The NetworkSession class shares network connections between all downloads.
+
+    A QNetworkAccessManager keeps a pool of connections per host, but it can only be used from
+    the thread it was created in. The session therefore creates one manager per thread and hands
+    it to every downloader of that thread, so that consecutive downloads reuse open connections
+    instead of connecting again. Requests going through different proxies get a manager per
+    proxy configuration, as the proxies of a manager in use can not be changed. Encrypted requests allow HTTP/2, which multiplexes all requests
+    to a host over a single connection if the server supports it.
+
+    TLS session tickets are shared over all threads, so that a connection opened by another
+    thread resumes the TLS session instead of doing a full handshake.
+
+    The number of requests in flight to a host is limited over all threads. Downloaders call
+    tryAcquireRequest() before they start a request and releaseRequest() once it is done, and
+    retry waiting requests when requestReleased() is emitted.
+*/
+
+/*!
+    \fn QInstaller::NetworkSession::requestReleased()
+
+    This signal is emitted, from the thread calling releaseRequest(), after a request to any
+    host was released.
+*/
+
+/*!
+    Returns the network session of the application.
+*/
+NetworkSession &NetworkSession::instance()
+{
+    static NetworkSession theSession;
+    return theSession;
+}
+
+NetworkSession::NetworkSession()
+    : m_maxRequestsPerHost(DefaultMaxRequestsPerHost)
+{
+}
+
+/*!
+    Returns the network access manager of the calling thread, creating it if necessary. The
+    manager uses the proxies of the application.
+
+    The managers of the application thread are deleted together with the application object,
+    the managers of other threads once their thread finishes.
+*/
+QNetworkAccessManager *NetworkSession::networkAccessManager()
+{
+    return networkAccessManager(QList<QNetworkProxy>());
+}
+
+/*!
+    \internal
+
+    Returns the network access manager of the calling thread that sends all requests through
+    \a proxies, creating it if necessary. An empty list selects the manager using the proxies
+    of the application. The proxies of a manager are set once when it is created.
+*/
+QNetworkAccessManager *NetworkSession::networkAccessManager(const QList<QNetworkProxy> &proxies)
+{
+    QPointer<QNetworkAccessManager> &manager = m_managers.localData()[proxyKey(proxies)];
+    if (manager)
+        return manager;
+
+    QThread *const thread = QThread::currentThread();
+    QCoreApplication *const app = QCoreApplication::instance();
+    if (app && app->thread() == thread) {
+        manager = new QNetworkAccessManager(app);
+    } else {
+        manager = new QNetworkAccessManager;
+        connect(thread, &QThread::finished, manager.data(), &QObject::deleteLater);
+    }
+    if (!proxies.isEmpty())
+        manager->setProxyFactory(new FixedProxyFactory(proxies));
+    return manager;
+}
+
+/*!
+    Sends a GET \a request with a network access manager of the calling thread and returns
+    the reply. The request is prepared with prepareRequest() before. If \a proxyFactory is set,
+    the session takes ownership of it and sends the request with the manager of the proxies it
+    returns for the request URL, otherwise with networkAccessManager().
+*/
+QNetworkReply *NetworkSession::get(const QNetworkRequest &request, QNetworkProxyFactory *proxyFactory)
+{
+    QNetworkRequest prepared(request);
+    prepareRequest(&prepared);
+
+    QList<QNetworkProxy> proxies;
+    if (proxyFactory) {
+        const std::unique_ptr<QNetworkProxyFactory> factory(proxyFactory);
+        proxies = factory->queryProxy(QNetworkProxyQuery(prepared.url()));
+    }
+
+    QNetworkAccessManager *const manager = networkAccessManager(proxies);
+    QNetworkReply *const reply = manager->get(prepared);
+#ifndef QT_NO_SSL
+    if (prepared.url().scheme() == QLatin1String("https")) {
+        connect(reply, &QNetworkReply::finished, reply, [this, reply]() {
+            storeSessionTicket(reply);
+        });
+    }
+#endif
+    return reply;
+}
+
+/*!
+    Allows HTTP/2 for \a request and sets the TLS session ticket known for its host, if any.
+*/
+void NetworkSession::prepareRequest(QNetworkRequest *request) const
+{
+    if (request->url().scheme() != QLatin1String("https"))
+        return;
+
+#if QT_VERSION >= 0x050800
+    request->setAttribute(QNetworkRequest::HTTP2AllowedAttribute, true);
+#endif
+#ifndef QT_NO_SSL
+    QSslConfiguration configuration = request->sslConfiguration();
+    configuration.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+
+    QMutexLocker _(&m_mutex);
+    const QByteArray ticket = m_sessionTickets.value(hostKey(request->url()));
+    if (!ticket.isEmpty())
+        configuration.setSessionTicket(ticket);
+    request->setSslConfiguration(configuration);
+#endif
+}
+
+/*!
+    Returns the maximum number of requests in flight to the same host.
+*/
+int NetworkSession::maxRequestsPerHost() const
+{
+    QMutexLocker _(&m_mutex);
+    return m_maxRequestsPerHost;
+}
+
+/*!
+    Sets the maximum number of requests in flight to the same host to \a count.
+*/
+void NetworkSession::setMaxRequestsPerHost(int count)
+{
+    {
+        QMutexLocker _(&m_mutex);
+        m_maxRequestsPerHost = qMax(1, count);
+    }
+    emit requestReleased();
+}
+
+/*!
+    Reserves a request to the host of \a url. Returns \c false if maxRequestsPerHost() requests
+    to the host are in flight already. Each successful call needs a matching releaseRequest().
+*/
+bool NetworkSession::tryAcquireRequest(const QUrl &url)
+{
+    QMutexLocker _(&m_mutex);
+    int &active = m_activeRequests[hostKey(url)];
+    if (active >= m_maxRequestsPerHost)
+        return false;
+    ++active;
+    return true;
+}
+
+/*!
+    Releases a request to the host of \a url reserved with tryAcquireRequest().
+*/
+void NetworkSession::releaseRequest(const QUrl &url)
+{
+    {
+        QMutexLocker _(&m_mutex);
+        const QString key = hostKey(url);
+        if (--m_activeRequests[key] <= 0)
+            m_activeRequests.remove(key);
+    }
+    emit requestReleased();
+}
+
+/*!
+    \internal
+
+    Remembers the TLS session ticket \a reply got from its host.
+*/
+void NetworkSession::storeSessionTicket(QNetworkReply *reply)
+{
+#ifndef QT_NO_SSL
+    if (reply->error() != QNetworkReply::NoError)
+        return;
+
+    const QByteArray ticket = reply->sslConfiguration().sessionTicket();
+    if (ticket.isEmpty())
+        return;
+
+    QMutexLocker _(&m_mutex);
+    m_sessionTickets.insert(hostKey(reply->url()), ticket);
+#else
+    Q_UNUSED(reply)
+#endif
+}
+
+/*!
+    \internal
+*/
+QString NetworkSession::hostKey(const QUrl &url)
+{
+    return url.scheme() + QLatin1String("://") + url.host().toLower() + QLatin1Char(':')
+        + QString::number(url.port(url.scheme() == QLatin1String("https") ? 443 : 80));
+}
+
+/*!
+    \internal
+*/
+QString NetworkSession::proxyKey(const QList<QNetworkProxy> &proxies)
+{
+    QStringList keys;
+    foreach (const QNetworkProxy &proxy, proxies) {
+        keys.append(QString::number(proxy.type()) + QLatin1Char(';') + proxy.hostName()
+            + QLatin1Char(';') + QString::number(proxy.port()) + QLatin1Char(';') + proxy.user()
+            + QLatin1Char(';') + proxy.password());
+    }
+    return keys.join(QLatin1Char('\n'));
+}
+
+} // namespace QInstaller
@@ -0,0 +1,89 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#ifndef NETWORKSESSION_H
+#define NETWORKSESSION_H
+
+#include "installer_global.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QThreadStorage>
+
+QT_BEGIN_NAMESPACE
+class QNetworkAccessManager;
+class QNetworkProxy;
+class QNetworkProxyFactory;
+class QNetworkReply;
+class QNetworkRequest;
+class QUrl;
+QT_END_NAMESPACE
+
+namespace QInstaller {
+
+class INSTALLER_EXPORT NetworkSession : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(NetworkSession)
+
+public:
+    static NetworkSession &instance();
+
+    QNetworkAccessManager *networkAccessManager();
+    QNetworkReply *get(const QNetworkRequest &request, QNetworkProxyFactory *proxyFactory = nullptr);
+    void prepareRequest(QNetworkRequest *request) const;
+
+    int maxRequestsPerHost() const;
+    void setMaxRequestsPerHost(int count);
+
+    bool tryAcquireRequest(const QUrl &url);
+    void releaseRequest(const QUrl &url);
+
+signals:
+    void requestReleased();
+
+private:
+    NetworkSession();
+    QNetworkAccessManager *networkAccessManager(const QList<QNetworkProxy> &proxies);
+    void storeSessionTicket(QNetworkReply *reply);
+    static QString hostKey(const QUrl &url);
+    static QString proxyKey(const QList<QNetworkProxy> &proxies);
+
+private:
+    mutable QMutex m_mutex;
+    int m_maxRequestsPerHost;
+    QHash<QString, int> m_activeRequests;
+    QHash<QString, QByteArray> m_sessionTickets;
+    QThreadStorage<QHash<QString, QPointer<QNetworkAccessManager> > > m_managers; // by proxies
+};
+
+} // namespace QInstaller
+
+#endif // NETWORKSESSION_H
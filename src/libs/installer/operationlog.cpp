@@ -0,0 +1,516 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+#include "operationlog.h"
+
+#include "constants.h"
+#include "errors.h"
+#include "fileio.h"
+#include "fileutils.h"
+#include "packagemanagercore.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QHash>
+#include <QtEndian>
+
+namespace QInstaller {
+
+namespace {
+
+const quint32 NoComponent = 0xffffffff;
+
+enum ValueKind : quint8 {
+    StringValue = 0,        // values that survive a round trip through QString
+    StringListValue = 1,
+    VariantValue = 2        // everything else, serialized with QDataStream
+};
+
+void appendUInt32(QByteArray *data, quint32 value)
+{
+    const quint32 littleEndian = qToLittleEndian(value);
+    data->append(reinterpret_cast<const char *>(&littleEndian), sizeof(littleEndian));
+}
+
+quint32 uint32At(const QByteArray &data, int offset)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(data.constData() + offset));
+}
+
+void prepareStream(QDataStream *stream)
+{
+    stream->setVersion(QDataStream::Qt_5_0);
+    stream->setByteOrder(QDataStream::LittleEndian);
+}
+
+class StringTable
+{
+public:
+    quint32 insert(const QString &string)
+    {
+        const QHash<QString, quint32>::const_iterator it = m_index.constFind(string);
+        if (it != m_index.constEnd())
+            return it.value();
+
+        const quint32 index = quint32(m_index.count());
+        const QByteArray utf8 = string.toUtf8();
+        appendUInt32(&m_data, quint32(utf8.size()));
+        m_data.append(utf8);
+        m_index.insert(string, index);
+        return index;
+    }
+
+    QByteArray data() const { return m_data; }
+
+private:
+    QByteArray m_data;
+    QHash<QString, quint32> m_index;
+};
+
+} // namespace
+
+/*!
+    \class QInstaller::OperationLog
+    \inmodule QtInstallerFramework
+    \brief The OperationLog class reads and writes the binary log of performed operations that
+        the maintenance tool carries.
+
+    Every string of the log, like operation names, arguments and value names, is stored only
+    once in a string table and referenced by index from the operation records. Reading a log
+    only loads the tables, the strings and records are decoded when an operation is restored.
+
+    The log also stores the component every operation belongs to next to the record offsets, so
+    that component() does not need to decode the record.
+
+    Maintenance tools written by earlier versions store every operation as XML. Those logs start
+    with the operation count instead of \l Marker and are still read by BinaryContent.
+*/
+
+/*!
+    \variable QInstaller::OperationLog::Marker
+    \brief Identifies the binary log, in place of the non-negative operation count that starts
+        the XML based log.
+*/
+const qint64 OperationLog::Marker = Q_INT64_C(-0x474f4c504f); // "OPLOG"
+
+/*!
+    \variable QInstaller::OperationLog::Version
+    \brief The version of the log format written by write().
+*/
+const qint64 OperationLog::Version = 2;
+
+struct OperationLog::Writer::Private
+{
+    Private()
+        : stream(&records, QIODevice::WriteOnly)
+        , core(nullptr)
+        , count(0)
+    {
+        prepareStream(&stream);
+    }
+
+    StringTable strings;
+    QByteArray records;
+    QDataStream stream;
+    QByteArray offsets;
+    QByteArray components;
+
+    PackageManagerCore *core;
+    QString target;
+    qint64 count;
+};
+
+/*!
+    \class QInstaller::OperationLog::Writer
+    \inmodule QtInstallerFramework
+    \brief The Writer class collects operations for a new binary operation log.
+
+    Operations are either serialized from Operation objects or copied from the record of an
+    existing log, without creating an Operation for them.
+*/
+
+/*!
+    Creates a writer for an empty log.
+*/
+OperationLog::Writer::Writer()
+    : d(new Private)
+{
+}
+
+/*!
+    Destroys the writer.
+*/
+OperationLog::Writer::~Writer()
+{
+}
+
+/*!
+    Appends \a operation, with its arguments and persistent values. Paths inside the target
+    directory are stored relative to it, the same way KDUpdater::UpdateOperation::toXml() does.
+*/
+void OperationLog::Writer::append(const Operation *operation)
+{
+    if (operation->packageManager() != d->core || !d->core) {
+        d->core = operation->packageManager();
+        d->target = d->core ? d->core->value(scTargetDir) : QString();
+    }
+    const QString relocatable = QLatin1String(scRelocatable);
+
+    appendUInt32(&d->offsets, quint32(d->stream.device()->pos()));
+    d->stream << d->strings.insert(operation->name());
+
+    const QStringList arguments = operation->arguments();
+    d->stream << quint32(arguments.count());
+    foreach (const QString &argument, arguments)
+        d->stream << d->strings.insert(replacePath(argument, d->target, relocatable));
+
+    const QVariantMap values = operation->persistentValues();
+    const QString component = values.value(QLatin1String("component")).toString();
+    appendUInt32(&d->components, component.isEmpty() ? NoComponent : d->strings.insert(component));
+
+    d->stream << quint32(values.count());
+    for (QVariantMap::const_iterator it = values.constBegin(); it != values.constEnd(); ++it) {
+        d->stream << d->strings.insert(it.key());
+
+        const QVariant &value = it.value();
+        if (value.type() == QVariant::StringList) {
+            const QStringList list = value.toStringList();
+            d->stream << quint8(StringListValue) << quint32(list.count());
+            foreach (const QString &entry, list)
+                d->stream << d->strings.insert(replacePath(entry, d->target, relocatable));
+        } else if (value.type() != QVariant::List && value.canConvert(QVariant::String)) {
+            d->stream << quint8(StringValue) << qint32(value.userType())
+                << d->strings.insert(replacePath(value.toString(), d->target, relocatable));
+        } else {
+            d->stream << quint8(VariantValue) << value;
+        }
+    }
+    ++d->count;
+}
+
+/*!
+    Appends the operation at \a index of \a log unchanged. Only the string indexes of the
+    record are mapped to the new string table, the strings themselves are neither decoded nor
+    relocated. Returns \c true on success, otherwise \c false and nothing is appended.
+*/
+bool OperationLog::Writer::append(const OperationLog &log, int index)
+{
+    const int offset = int(log.m_recordOffsets.at(index));
+    QDataStream in(QByteArray::fromRawData(log.m_records.constData() + offset,
+        log.m_records.size() - offset));
+    prepareStream(&in);
+
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    prepareStream(&out);
+
+    auto copyString = [&]() {
+        quint32 string;
+        in >> string;
+        out << d->strings.insert(log.string(string));
+    };
+    auto copyCount = [&]() {
+        quint32 count;
+        in >> count;
+        out << count;
+        return in.status() == QDataStream::Ok ? count : 0;
+    };
+
+    copyString(); // name
+    for (quint32 i = copyCount(); i > 0 && in.status() == QDataStream::Ok; --i)
+        copyString(); // arguments
+
+    for (quint32 i = copyCount(); i > 0 && in.status() == QDataStream::Ok; --i) {
+        copyString(); // key
+        quint8 kind;
+        in >> kind;
+        out << kind;
+        if (kind == StringListValue) {
+            for (quint32 j = copyCount(); j > 0 && in.status() == QDataStream::Ok; --j)
+                copyString();
+        } else if (kind == StringValue) {
+            qint32 type;
+            in >> type;
+            out << type;
+            copyString();
+        } else if (kind == VariantValue) {
+            QVariant value;
+            in >> value;
+            out << value;
+        } else {
+            return false;
+        }
+    }
+    if (in.status() != QDataStream::Ok || out.status() != QDataStream::Ok)
+        return false;
+
+    const QString component = log.component(index);
+    appendUInt32(&d->offsets, quint32(d->stream.device()->pos()));
+    appendUInt32(&d->components, component.isEmpty() ? NoComponent : d->strings.insert(component));
+    d->stream.writeRawData(record.constData(), record.size());
+    ++d->count;
+    return true;
+}
+
+/*!
+    Writes the log of all appended operations to \a out. Throws Error on failure.
+*/
+void OperationLog::Writer::write(QFileDevice *out) const
+{
+    if (d->stream.status() != QDataStream::Ok) {
+        throw Error(QCoreApplication::translate("OperationLog",
+            "Cannot serialize the performed operations."));
+    }
+
+    QInstaller::appendInt64(out, Marker);
+    QInstaller::appendInt64(out, Version);
+    QInstaller::appendInt64(out, d->count);
+    QInstaller::appendByteArray(out, d->strings.data());
+    QInstaller::appendByteArray(out, d->records);
+    QInstaller::appendByteArray(out, d->offsets);
+    QInstaller::appendByteArray(out, d->components);
+    QInstaller::appendInt64(out, d->count);
+}
+
+/*!
+    Writes \a operations to \a out, with the arguments and persistent values of each operation.
+    Throws Error on failure.
+
+    \sa Writer
+*/
+void OperationLog::write(QFileDevice *out, const OperationList &operations)
+{
+    Writer writer;
+    foreach (const Operation *operation, operations)
+        writer.append(operation);
+    writer.write(out);
+}
+
+/*!
+    Reads the binary operation log at the current position of \a in. Returns a null pointer and
+    leaves the position of \a in undefined if the log at that position is not a binary one.
+    Throws Error if the log cannot be read.
+*/
+QSharedPointer<OperationLog> OperationLog::read(QFileDevice *in)
+{
+    if (QInstaller::retrieveInt64(in) != Marker)
+        return QSharedPointer<OperationLog>();
+
+    const qint64 version = QInstaller::retrieveInt64(in);
+    if (version < 1 || version > Version) {
+        throw Error(QCoreApplication::translate("OperationLog",
+            "Unsupported operation log version %1.").arg(version));
+    }
+
+    QSharedPointer<OperationLog> log(new OperationLog);
+    const qint64 count = QInstaller::retrieveInt64(in);
+    log->m_strings = QInstaller::retrieveByteArray(in);
+    log->m_records = QInstaller::retrieveByteArray(in);
+    const QByteArray offsets = QInstaller::retrieveByteArray(in);
+    const QByteArray components = version >= 2 ? QInstaller::retrieveByteArray(in) : QByteArray();
+    Q_UNUSED(QInstaller::retrieveInt64(in)) // read it, but deliberately not used
+
+    if (count < 0 || offsets.size() != count * qint64(sizeof(quint32))) {
+        throw Error(QCoreApplication::translate("OperationLog",
+            "Invalid operation log, the record index does not match %1 operations.").arg(count));
+    }
+
+    log->m_recordOffsets.resize(int(count));
+    for (int i = 0; i < count; ++i) {
+        const quint32 offset = uint32At(offsets, i * int(sizeof(quint32)));
+        if (offset + sizeof(quint32) > quint32(log->m_records.size())) {
+            throw Error(QCoreApplication::translate("OperationLog",
+                "Invalid operation log, record %1 is out of range.").arg(i));
+        }
+        log->m_recordOffsets[i] = offset;
+    }
+
+    // only the positions of the strings are needed up front, decoding happens on access
+    int pos = 0;
+    while (pos < log->m_strings.size()) {
+        if (pos + int(sizeof(quint32)) > log->m_strings.size())
+            break;
+        const quint32 length = uint32At(log->m_strings, pos);
+        pos += int(sizeof(quint32));
+        if (length > quint32(log->m_strings.size() - pos))
+            break;
+        log->m_stringOffsets.append(quint32(pos));
+        pos += int(length);
+    }
+    if (pos != log->m_strings.size()) {
+        throw Error(QCoreApplication::translate("OperationLog",
+            "Invalid operation log, the string table is truncated."));
+    }
+    log->m_decodedStrings.resize(log->m_stringOffsets.count());
+    log->m_isDecoded.resize(log->m_stringOffsets.count());
+
+    if (version >= 2) {
+        if (components.size() != offsets.size()) {
+            throw Error(QCoreApplication::translate("OperationLog",
+                "Invalid operation log, the component index does not match %1 operations.")
+                .arg(count));
+        }
+        log->m_components.resize(int(count));
+        for (int i = 0; i < count; ++i)
+            log->m_components[i] = uint32At(components, i * int(sizeof(quint32)));
+    }
+    return log;
+}
+
+/*!
+    Returns the number of operations in the log.
+*/
+int OperationLog::count() const
+{
+    return m_recordOffsets.count();
+}
+
+/*!
+    Returns the name of the operation at \a index.
+*/
+QString OperationLog::name(int index) const
+{
+    return string(uint32At(m_records, int(m_recordOffsets.at(index))));
+}
+
+/*!
+    Returns the name of the component the operation at \a index belongs to, or an empty string
+    if it does not belong to any component.
+*/
+QString OperationLog::component(int index) const
+{
+    if (!m_components.isEmpty()) {
+        const quint32 component = m_components.at(index);
+        return component == NoComponent ? QString() : string(component);
+    }
+
+    // logs without component index
+    QVariantMap values;
+    decode(index, nullptr, &values);
+    return values.value(QLatin1String("component")).toString();
+}
+
+/*!
+    Sets the arguments and values of \a operation to the ones stored for the operation at
+    \a index. Returns \c true on success, otherwise \c false.
+*/
+bool OperationLog::restore(int index, Operation *operation) const
+{
+    QStringList arguments;
+    QVariantMap values;
+    if (!decode(index, &arguments, &values))
+        return false;
+
+    operation->setArguments(arguments);
+    for (QVariantMap::const_iterator it = values.constBegin(); it != values.constEnd(); ++it)
+        operation->setValue(it.key(), it.value());
+    return true;
+}
+
+/*!
+    Decodes the record at \a index into \a arguments and \a values. Arguments are skipped if
+    \a arguments is \c nullptr. Returns \c true on success, otherwise \c false.
+*/
+bool OperationLog::decode(int index, QStringList *arguments, QVariantMap *values) const
+{
+    if (m_target.isNull()) {
+        m_target = QCoreApplication::applicationDirPath();
+        // Does not change target on non OSX platforms.
+        if (QInstaller::isInBundle(m_target, &m_target))
+            m_target = QDir::cleanPath(m_target + QLatin1String("/.."));
+    }
+    const QString relocatable = QLatin1String(scRelocatable);
+
+    const int offset = int(m_recordOffsets.at(index));
+    QDataStream stream(QByteArray::fromRawData(m_records.constData() + offset,
+        m_records.size() - offset));
+    prepareStream(&stream);
+
+    quint32 name;
+    quint32 count;
+    stream >> name >> count;
+    if (arguments)
+        arguments->reserve(int(count));
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        quint32 argument;
+        stream >> argument;
+        if (arguments)
+            arguments->append(replacePath(string(argument), relocatable, m_target));
+    }
+
+    stream >> count;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        quint32 key;
+        quint8 kind;
+        stream >> key >> kind;
+
+        QVariant value;
+        if (kind == StringListValue) {
+            quint32 entries;
+            stream >> entries;
+            QStringList list;
+            for (quint32 j = 0; j < entries && stream.status() == QDataStream::Ok; ++j) {
+                quint32 entry;
+                stream >> entry;
+                list.append(replacePath(string(entry), relocatable, m_target));
+            }
+            value = list;
+        } else if (kind == StringValue) {
+            qint32 type;
+            quint32 text;
+            stream >> type >> text;
+            value = string(text); // not relocated, the same as in fromXml()
+            value.convert(type);
+        } else if (kind == VariantValue) {
+            stream >> value;
+        } else {
+            return false;
+        }
+        values->insert(string(key), value);
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+/*!
+    Returns the string at \a index of the string table, decoding it on first access.
+*/
+QString OperationLog::string(quint32 index) const
+{
+    if (index >= quint32(m_stringOffsets.count()))
+        return QString();
+
+    if (!m_isDecoded.testBit(int(index))) {
+        const int offset = int(m_stringOffsets.at(int(index)));
+        const int length = int(uint32At(m_strings, offset - int(sizeof(quint32))));
+        m_decodedStrings[int(index)] = QString::fromUtf8(m_strings.constData() + offset, length);
+        m_isDecoded.setBit(int(index));
+    }
+    return m_decodedStrings.at(int(index));
+}
+
+} // namespace QInstaller
@@ -0,0 +1,104 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+#ifndef OPERATIONLOG_H
+#define OPERATIONLOG_H
+
+#include "installer_global.h"
+#include "qinstallerglobal.h"
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QFileDevice;
+QT_END_NAMESPACE
+
+namespace QInstaller {
+
+class INSTALLER_EXPORT OperationLog
+{
+    Q_DISABLE_COPY(OperationLog)
+
+public:
+    static const qint64 Marker;
+    static const qint64 Version;
+
+    class INSTALLER_EXPORT Writer
+    {
+        Q_DISABLE_COPY(Writer)
+
+    public:
+        Writer();
+        ~Writer();
+
+        void append(const Operation *operation);
+        bool append(const OperationLog &log, int index);
+
+        void write(QFileDevice *out) const;
+
+    private:
+        struct Private;
+        QScopedPointer<Private> d;
+    };
+
+    static void write(QFileDevice *out, const OperationList &operations);
+    static QSharedPointer<OperationLog> read(QFileDevice *in);
+
+    int count() const;
+    QString name(int index) const;
+    QString component(int index) const;
+
+    bool restore(int index, Operation *operation) const;
+
+private:
+    OperationLog() = default;
+    QString string(quint32 index) const;
+    bool decode(int index, QStringList *arguments, QVariantMap *values) const;
+
+private:
+    QByteArray m_strings;
+    QVector<quint32> m_stringOffsets;
+    mutable QVector<QString> m_decodedStrings;
+    mutable QBitArray m_isDecoded;
+
+    QByteArray m_records;
+    QVector<quint32> m_recordOffsets;
+
+    QVector<quint32> m_components;
+
+    mutable QString m_target;
+};
+
+} // namespace QInstaller
+
+#endif // OPERATIONLOG_H
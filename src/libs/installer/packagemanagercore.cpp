@@ -31,6 +31,7 @@
 #include "adminauthorization.h"
 #include "binarycontent.h"
 #include "component.h"
+#include "componentindex.h"
 #include "componentmodel.h"
 #include "downloadarchivesjob.h"
 #include "errors.h"
@@ -399,19 +400,6 @@ static bool sNoForceInstallation = false;
 static bool sVirtualComponentsVisible = false;
 static bool sCreateLocalRepositoryFromBinary = false;
 
-static bool componentMatches(const Component *component, const QString &name,
-    const QString &version = QString())
-{
-    if (name.isEmpty() || component->name() != name)
-        return false;
-
-    if (version.isEmpty())
-        return true;
-
-    // can be remote or local version
-    return PackageManagerCore::versionMatches(component->value(scVersion), version);
-}
-
 /*!
     Creates the maintenance tool in the installation directory.
 */
@@ -419,7 +407,7 @@ void PackageManagerCore::writeMaintenanceTool()
 {
     if (d->m_needToWriteMaintenanceTool) {
         try {
-            d->writeMaintenanceTool(d->m_performedOperationsOld + d->m_performedOperationsCurrentSession);
+            d->writeMaintenanceTool();
 
             bool gainedAdminRights = false;
             QTemporaryFile tempAdminFile(d->targetDir()
@@ -460,6 +448,7 @@ void PackageManagerCore::reset()
     d->m_installerBaseBinaryUnreplaced.clear();
     d->m_coreCheckedHash.clear();
     d->m_componentsToInstallCalculated = false;
+    d->invalidateComponentIndex();
 }
 
 /*!
@@ -505,12 +494,11 @@ void PackageManagerCore::cancelMetaInfoJob()
  */
 void PackageManagerCore::componentsToInstallNeedsRecalculation()
 {
-    d->clearInstallerCalculator();
     d->clearUninstallerCalculator();
     QList<Component*> selectedComponentsToInstall = componentsMarkedForInstallation();
 
     d->m_componentsToInstallCalculated =
-            d->installerCalculator()->appendComponentsToInstall(selectedComponentsToInstall);
+            d->calculateComponentsToInstall(selectedComponentsToInstall);
 
     QList<Component *> componentsToInstall = d->installerCalculator()->orderedComponentsToInstall();
 
@@ -619,49 +607,16 @@ int PackageManagerCore::downloadNeededArchives(double partProgressSize)
 {
     Q_ASSERT(partProgressSize >= 0 && partProgressSize <= 1);
 
-    QList<QPair<QString, QString> > archivesToDownload;
-    QList<Component*> neededComponents = orderedComponentsToInstall();
-    foreach (Component *component, neededComponents) {
-        // collect all archives to be downloaded
-        const QStringList toDownload = component->downloadableArchives();
-        foreach (const QString &versionFreeString, toDownload) {
-            archivesToDownload.push_back(qMakePair(QString::fromLatin1("installer://%1/%2")
-                .arg(component->name(), versionFreeString), QString::fromLatin1("%1/%2/%3")
-                .arg(component->repositoryUrl().toString(), component->name(), versionFreeString)));
-        }
-    }
-
+    const QList<QPair<QString, QString> > archivesToDownload =
+        d->archivesToDownload(orderedComponentsToInstall());
     if (archivesToDownload.isEmpty())
         return 0;
 
-    ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("\nDownloading packages..."));
-
-    DownloadArchivesJob archivesJob(this);
-    archivesJob.setAutoDelete(false);
-    archivesJob.setArchivesToDownload(archivesToDownload);
-    connect(this, &PackageManagerCore::installationInterrupted, &archivesJob, &Job::cancel);
-    connect(&archivesJob, &DownloadArchivesJob::outputTextChanged,
-            ProgressCoordinator::instance(), &ProgressCoordinator::emitLabelAndDetailTextChanged);
-    connect(&archivesJob, &DownloadArchivesJob::downloadStatusChanged,
-            ProgressCoordinator::instance(), &ProgressCoordinator::downloadStatusChanged);
-
-    ProgressCoordinator::instance()->registerPartProgress(&archivesJob,
-        SIGNAL(progressChanged(double)), partProgressSize);
+    QScopedPointer<DownloadArchivesJob> archivesJob(d->startArchivesDownload(archivesToDownload,
+        partProgressSize));
+    d->waitForArchivesDownload(archivesJob.data());
 
-    archivesJob.start();
-    archivesJob.waitForFinished();
-
-    if (archivesJob.error() == Job::Canceled)
-        interrupt();
-    else if (archivesJob.error() != Job::NoError)
-        throw Error(archivesJob.errorString());
-
-    if (d->statusCanceledOrFailed())
-        throw Error(tr("Installation canceled by user."));
-
-    ProgressCoordinator::instance()->emitDownloadStatus(tr("All downloads finished."));
-
-    return archivesJob.numberOfDownloads();
+    return archivesJob->numberOfDownloads();
 }
 
 /*!
@@ -736,13 +691,7 @@ void PackageManagerCore::rollBackInstallation()
                 }
             }
 
-            d->m_localPackageHub->writeToDisk();
-            if (isInstaller()) {
-                if (d->m_localPackageHub->packageInfoCount() == 0) {
-                    QFile file(d->m_localPackageHub->fileName());
-                    file.remove();
-                }
-            }
+            d->m_localPackageHub->writeJournal();
 
             if (becameAdmin)
                 dropAdminRights();
@@ -757,6 +706,14 @@ void PackageManagerCore::rollBackInstallation()
                 "error happened."));
         }
     }
+
+    d->m_localPackageHub->writeToDisk();
+    if (isInstaller()) {
+        if (d->m_localPackageHub->packageInfoCount() == 0) {
+            QFile file(d->m_localPackageHub->fileName());
+            file.remove();
+        }
+    }
 }
 
 /*!
@@ -857,11 +814,7 @@ PackageManagerCore::PackageManagerCore(qint64 magicmaker, const QList<OperationB
     // Every installed package should have at least one MinimalProgress operation.
     //
     QSet<QString> installedPackages = d->m_core->localInstalledPackages().keys().toSet();
-    QSet<QString> operationPackages;
-    foreach (QInstaller::Operation *operation, d->m_performedOperationsOld) {
-        if (operation->hasValue(QLatin1String("component")))
-            operationPackages.insert(operation->value(QLatin1String("component")).toString());
-    }
+    const QSet<QString> operationPackages = d->performedOperationComponents();
 
     QSet<QString> packagesWithoutOperation = installedPackages - operationPackages;
     QSet<QString> orphanedOperations = operationPackages - installedPackages;
@@ -1455,6 +1408,7 @@ ScriptEngine *PackageManagerCore::controlScriptEngine() const
 void PackageManagerCore::appendRootComponent(Component *component)
 {
     d->m_rootComponents.append(component);
+    d->invalidateComponentIndex();
     emit componentAdded(component);
 }
 
@@ -1525,6 +1479,7 @@ void PackageManagerCore::appendUpdaterComponent(Component *component)
 {
     component->setUpdateAvailable(true);
     d->m_updaterComponents.append(component);
+    d->invalidateComponentIndex();
     emit componentAdded(component);
 }
 
@@ -1536,7 +1491,18 @@ void PackageManagerCore::appendUpdaterComponent(Component *component)
 */
 Component *PackageManagerCore::componentByName(const QString &name) const
 {
-    return componentByName(name, components(ComponentType::AllNoReplacements));
+    return d->componentByName(name);
+}
+
+/*!
+    \internal
+
+    Called by components when their name or their child components changed, so that
+    componentByName() does not return outdated results.
+*/
+void PackageManagerCore::componentTreeChanged()
+{
+    d->invalidateComponentIndex();
 }
 
 /*!
@@ -1551,13 +1517,9 @@ Component *PackageManagerCore::componentByName(const QString &name, const QList<
     if (name.isEmpty())
         return nullptr;
 
-    QString fixedVersion;
-    QString fixedName;
-
-    parseNameAndVersion(name, &fixedName, &fixedVersion);
-
+    const ComponentRequirement requirement(name);
     foreach (Component *component, components) {
-        if (componentMatches(component, fixedName, fixedVersion))
+        if (requirement.matches(component))
             return component;
     }
 
@@ -1606,12 +1568,11 @@ bool PackageManagerCore::calculateComponentsToInstall() const
 {
     emit aboutCalculateComponentsToInstall();
     if (!d->m_componentsToInstallCalculated) {
-        d->clearInstallerCalculator();
         QList<Component*> selectedComponentsToInstall = componentsMarkedForInstallation();
 
         d->storeCheckState();
         d->m_componentsToInstallCalculated =
-            d->installerCalculator()->appendComponentsToInstall(selectedComponentsToInstall);
+            d->calculateComponentsToInstall(selectedComponentsToInstall);
     }
     emit finishedCalculateComponentsToInstall();
     return d->m_componentsToInstallCalculated;
@@ -1750,13 +1711,10 @@ QList<Component*> PackageManagerCore::dependees(const Component *_component) con
         return QList<Component *>();
 
     QList<Component *> dependees;
-    QString name;
-    QString version;
     foreach (Component *component, availableComponents) {
         const QStringList &dependencies = component->dependencies();
         foreach (const QString &dependency, dependencies) {
-            parseNameAndVersion(dependency, &name, &version);
-            if (componentMatches(_component, name, version))
+            if (ComponentRequirement(dependency).matches(_component))
                 dependees.append(component);
         }
     }
@@ -2134,24 +2092,7 @@ bool PackageManagerCore::performOperation(const QString &name, const QStringList
 */
 bool PackageManagerCore::versionMatches(const QString &version, const QString &requirement)
 {
-    QRegExp compEx(QLatin1String("([<=>]+)(.*)"));
-    const QString comparator = compEx.exactMatch(requirement) ? compEx.cap(1) : QLatin1String("=");
-    const QString ver = compEx.exactMatch(requirement) ? compEx.cap(2) : requirement;
-
-    const bool allowEqual = comparator.contains(QLatin1Char('='));
-    const bool allowLess = comparator.contains(QLatin1Char('<'));
-    const bool allowMore = comparator.contains(QLatin1Char('>'));
-
-    if (allowEqual && version == ver)
-        return true;
-
-    if (allowLess && KDUpdater::compareVersion(ver, version) > 0)
-        return true;
-
-    if (allowMore && KDUpdater::compareVersion(ver, version) < 0)
-        return true;
-
-    return false;
+    return VersionRequirement(requirement).matches(version);
 }
 
 /*!
@@ -2435,6 +2376,7 @@ bool PackageManagerCore::isOfflineOnly() const
 void PackageManagerCore::setUninstaller()
 {
     d->m_magicBinaryMarker = BinaryContent::MagicUninstallerMarker;
+    d->m_componentsToInstallCalculated = false;
 }
 
 /*!
@@ -2455,6 +2397,7 @@ bool PackageManagerCore::isUninstaller() const
 void PackageManagerCore::setUpdater()
 {
     d->m_magicBinaryMarker = BinaryContent::MagicUpdaterMarker;
+    d->m_componentsToInstallCalculated = false;
 }
 
 /*!
@@ -2474,6 +2417,7 @@ bool PackageManagerCore::isUpdater() const
 void PackageManagerCore::setPackageManager()
 {
     d->m_magicBinaryMarker = BinaryContent::MagicPackageManagerMarker;
+    d->m_componentsToInstallCalculated = false;
 }
 
 
@@ -2805,6 +2749,7 @@ bool PackageManagerCore::fetchUpdaterPackages(const PackagesList &remotes, const
         if (replaceMes.contains(component->name()))
             localReplaceMes.insert(component->name(), component);
     }
+    d->invalidateComponentIndex();
 
     // store all components that got a replacement, but do not modify the components list
     storeReplacedComponents(localReplaceMes.unite(components), data);
@@ -362,6 +362,11 @@ private:
     // remove once we deprecate isSelected, setSelected etc...
     friend class ComponentSelectionPage;
     void restoreCheckState();
+
+private:
+    // components report changes of their name or children to keep the name index current
+    friend class Component;
+    void componentTreeChanged();
 };
 Q_DECLARE_OPERATORS_FOR_FLAGS(PackageManagerCore::ComponentTypes)
 
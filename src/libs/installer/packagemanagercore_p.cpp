@@ -34,16 +34,20 @@
 #include "component.h"
 #include "scriptengine.h"
 #include "componentmodel.h"
+#include "downloadarchivesjob.h"
 #include "errors.h"
 #include "fileio.h"
+#include "remoteclient.h"
 #include "remotefileengine.h"
 #include "graph.h"
 #include "messageboxhandler.h"
+#include "operationlog.h"
 #include "packagemanagercore.h"
 #include "progresscoordinator.h"
 #include "qprocesswrapper.h"
 #include "protocol.h"
 #include "qsettingswrapper.h"
+#include "settings.h"
 #include "installercalculator.h"
 #include "uninstallercalculator.h"
 #include "componentchecker.h"
@@ -60,9 +64,11 @@
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
 #include <QtCore/QDirIterator>
+#include <QtCore/QEventLoop>
 #include <QtCore/QUuid>
 #include <QtCore/QFuture>
 #include <QtCore/QFutureWatcher>
+#include <QtCore/QThreadPool>
 #include <QtCore/QTemporaryFile>
 
 #include <QXmlStreamReader>
@@ -126,6 +132,14 @@ static bool runOperation(Operation *operation, PackageManagerCorePrivate::Operat
     return false;
 }
 
+static bool syncJournal(QFileDevice *journal)
+{
+    // written through the installer server, the handle is not one of this process
+    if (RemoteClient::instance().isActive())
+        return true;
+    return LocalPackageHub::syncToDisk(journal);
+}
+
 static QStringList checkRunningProcessesFromList(const QStringList &processList)
 {
     const QList<ProcessInfo> allProcesses = runningProcesses();
@@ -209,13 +223,18 @@ PackageManagerCorePrivate::PackageManagerCorePrivate(PackageManagerCore *core)
     , m_componentScriptEngine(nullptr)
     , m_controlScriptEngine(nullptr)
     , m_installerCalculator(nullptr)
+    , m_installerCalculatorUpdater(false)
+    , m_installerCalculatorOutdated(false)
     , m_uninstallerCalculator(nullptr)
+    , m_componentIndexValid(false)
+    , m_componentIndexUpdater(false)
     , m_proxyFactory(nullptr)
     , m_defaultModel(nullptr)
     , m_updaterModel(nullptr)
     , m_guiObject(nullptr)
     , m_remoteFileEngineHandler(nullptr)
 {
+    m_localPackageHub->setJournalSyncFunction(&syncJournal);
 }
 
 PackageManagerCorePrivate::PackageManagerCorePrivate(PackageManagerCore *core, qint64 magicInstallerMaker,
@@ -239,28 +258,19 @@ PackageManagerCorePrivate::PackageManagerCorePrivate(PackageManagerCore *core, q
     , m_componentScriptEngine(nullptr)
     , m_controlScriptEngine(nullptr)
     , m_installerCalculator(nullptr)
+    , m_installerCalculatorUpdater(false)
+    , m_installerCalculatorOutdated(false)
     , m_uninstallerCalculator(nullptr)
+    , m_componentIndexValid(false)
+    , m_componentIndexUpdater(false)
     , m_proxyFactory(nullptr)
     , m_defaultModel(nullptr)
     , m_updaterModel(nullptr)
     , m_guiObject(nullptr)
     , m_remoteFileEngineHandler(new RemoteFileEngineHandler)
+    , m_pendingOperationsOld(performedOperations)
 {
-    foreach (const OperationBlob &operation, performedOperations) {
-        QScopedPointer<QInstaller::Operation> op(KDUpdater::UpdateOperationFactory::instance()
-            .create(operation.name, core));
-        if (op.isNull()) {
-            qWarning() << "Failed to load unknown operation" << operation.name;
-            continue;
-        }
-
-        if (!op->fromXml(operation.xml)) {
-            qWarning() << "Failed to load XML for operation" << operation.name;
-            continue;
-        }
-        m_performedOperationsOld.append(op.take());
-    }
-
+    m_localPackageHub->setJournalSyncFunction(&syncJournal);
     connect(this, &PackageManagerCorePrivate::installationStarted,
             m_core, &PackageManagerCore::installationStarted);
     connect(this, &PackageManagerCorePrivate::installationFinished,
@@ -465,6 +475,8 @@ ScriptEngine *PackageManagerCorePrivate::controlScriptEngine() const
 
 void PackageManagerCorePrivate::clearAllComponentLists()
 {
+    invalidateComponentIndex();
+
     QList<QInstaller::Component*> toDelete;
 
     toDelete << m_rootComponents;
@@ -484,6 +496,8 @@ void PackageManagerCorePrivate::clearAllComponentLists()
 
 void PackageManagerCorePrivate::clearUpdaterComponentLists()
 {
+    invalidateComponentIndex();
+
     QSet<Component*> usedComponents =
         QSet<Component*>::fromList(m_updaterComponents + m_updaterComponentsDeps);
 
@@ -507,6 +521,32 @@ void PackageManagerCorePrivate::clearUpdaterComponentLists()
     cleanUpComponentEnvironment();
 }
 
+Component *PackageManagerCorePrivate::componentByName(const QString &name) const
+{
+    if (name.isEmpty())
+        return nullptr;
+
+    QMutexLocker _(&m_componentIndexMutex);
+    const bool updater = isUpdater();
+    if (!m_componentIndexValid || m_componentIndexUpdater != updater) {
+        m_componentIndex = ComponentIndex(m_core->components(PackageManagerCore::ComponentType::AllNoReplacements));
+        m_componentIndexUpdater = updater;
+        m_componentIndexValid = true;
+    }
+    return m_componentIndex.find(name);
+}
+
+// Drops the name lookup index, it is rebuilt on the next componentByName() call. Needs to be
+// called whenever components are added to or removed from the component lists or tree. The
+// installer calculator knows the old components as well, it is rebuilt on the next calculation.
+void PackageManagerCorePrivate::invalidateComponentIndex()
+{
+    QMutexLocker _(&m_componentIndexMutex);
+    m_componentIndexValid = false;
+    m_componentIndex.clear();
+    m_installerCalculatorOutdated = true;
+}
+
 QList<Component *> &PackageManagerCorePrivate::replacementDependencyComponents()
 {
     return (!isUpdater()) ? m_rootDependencyReplacements : m_updaterDependencyReplacements;
@@ -521,6 +561,49 @@ void PackageManagerCorePrivate::clearInstallerCalculator()
 {
     delete m_installerCalculator;
     m_installerCalculator = nullptr;
+    m_installerCalculatorSelection.clear();
+}
+
+/*!
+    Calculates the components to install for \a selectedComponents. If the previous calculation
+    succeeded, only the difference to its selection is applied to the existing calculator. A full
+    calculation is done if there is no previous result, the change cannot be applied
+    incrementally, or the components or the run mode changed since the calculator was created.
+*/
+bool PackageManagerCorePrivate::calculateComponentsToInstall(const QList<Component *> &selectedComponents)
+{
+    bool outdated = false;
+    {
+        QMutexLocker _(&m_componentIndexMutex);
+        outdated = m_installerCalculatorOutdated;
+    }
+    if (m_installerCalculator && (outdated || m_installerCalculatorUpdater != isUpdater()))
+        clearInstallerCalculator();
+
+    if (m_installerCalculator && m_componentsToInstallCalculated) {
+        const QSet<Component *> selection = selectedComponents.toSet();
+
+        QList<Component *> addedComponents;
+        foreach (Component *component, selectedComponents) {
+            if (!m_installerCalculatorSelection.contains(component))
+                addedComponents.append(component);
+        }
+        QList<Component *> removedComponents;
+        foreach (Component *component, m_installerCalculatorSelection) {
+            if (!selection.contains(component))
+                removedComponents.append(component);
+        }
+
+        if (m_installerCalculator->updateComponentsToInstall(addedComponents, removedComponents)) {
+            m_installerCalculatorSelection = selection;
+            return true;
+        }
+        qDebug() << "Cannot apply the selection change incrementally, recalculating all components.";
+    }
+
+    clearInstallerCalculator();
+    m_installerCalculatorSelection = selectedComponents.toSet();
+    return installerCalculator()->appendComponentsToInstall(selectedComponents);
 }
 
 InstallerCalculator *PackageManagerCorePrivate::installerCalculator() const
@@ -529,6 +612,9 @@ InstallerCalculator *PackageManagerCorePrivate::installerCalculator() const
         PackageManagerCorePrivate *const pmcp = const_cast<PackageManagerCorePrivate *> (this);
         pmcp->m_installerCalculator = new InstallerCalculator(
             m_core->components(PackageManagerCore::ComponentType::AllNoReplacements));
+        pmcp->m_installerCalculatorUpdater = isUpdater();
+        QMutexLocker _(&m_componentIndexMutex);
+        pmcp->m_installerCalculatorOutdated = false;
     }
     return m_installerCalculator;
 }
@@ -1080,7 +1166,7 @@ void PackageManagerCorePrivate::writeMaintenanceToolBinary(QFile *const input, q
 }
 
 void PackageManagerCorePrivate::writeMaintenanceToolBinaryData(QFileDevice *output, QFile *const input,
-    const OperationList &performedOperations, const BinaryLayout &layout)
+    const OperationLog::Writer &operationLog, const BinaryLayout &layout)
 {
     const qint64 dataBlockStart = output->pos();
 
@@ -1109,15 +1195,7 @@ void PackageManagerCorePrivate::writeMaintenanceToolBinaryData(QFileDevice *outp
     }
 
     const qint64 operationsStart = output->pos();
-    QInstaller::appendInt64(output, performedOperations.count());
-    foreach (Operation *operation, performedOperations) {
-        QInstaller::appendString(output, operation->name());
-        QInstaller::appendString(output, operation->toXml().toString());
-
-        // for the ui not to get blocked
-        qApp->processEvents();
-    }
-    QInstaller::appendInt64(output, performedOperations.count());
+    operationLog.write(output);
     const qint64 operationsEnd = output->pos();
 
     // we don't save any component-indexes.
@@ -1141,8 +1219,14 @@ void PackageManagerCorePrivate::writeMaintenanceToolBinaryData(QFileDevice *outp
     QInstaller::appendInt64(output, BinaryContent::MagicUninstallerMarker);
 }
 
-void PackageManagerCorePrivate::writeMaintenanceTool(OperationList performedOperations)
+void PackageManagerCorePrivate::writeMaintenanceTool()
 {
+    // operations logged as XML by older versions cannot be copied, create them
+    if (!pendingOperationsLogged())
+        performedOperationsOld();
+    OperationList performedOperations = m_performedOperationsOld
+        + m_performedOperationsCurrentSession;
+
     bool gainedAdminRights = false;
     QTemporaryFile tempAdminFile(targetDir() + QLatin1String("/testjsfdjlkdsjflkdsjfldsjlfds")
         + QString::number(qrand() % 1000));
@@ -1340,13 +1424,14 @@ void PackageManagerCorePrivate::writeMaintenanceTool(OperationList performedOper
             }
         }
 
-        performedOperations = sortOperationsBasedOnComponentDependencies(performedOperations);
+        OperationLog::Writer operationLog;
+        appendOperationsInDependencyOrder(&operationLog, performedOperations);
         m_core->setValue(QLatin1String("installedOperationAreSorted"), QLatin1String("true"));
 
         try {
             QTemporaryFile file;
             QInstaller::openForWrite(&file);
-            writeMaintenanceToolBinaryData(&file, &input, performedOperations, layout);
+            writeMaintenanceToolBinaryData(&file, &input, operationLog, layout);
             QInstaller::appendInt64(&file, BinaryContent::MagicCookieDat);
 
             QFile dummy(dataFile + QLatin1String(".new"));
@@ -1375,7 +1460,7 @@ void PackageManagerCorePrivate::writeMaintenanceTool(OperationList performedOper
             QFile file(maintenanceToolName() + QLatin1String(".new"));
             QInstaller::openForAppend(&file);
             file.seek(file.size());
-            writeMaintenanceToolBinaryData(&file, &input, performedOperations, layout);
+            writeMaintenanceToolBinaryData(&file, &input, operationLog, layout);
             QInstaller::appendInt64(&file, BinaryContent::MagicCookie);
         }
         input.close();
@@ -1501,7 +1586,18 @@ bool PackageManagerCorePrivate::runInstaller()
 
         const double downloadPartProgressSize = double(1) / double(3);
         double componentsInstallPartProgressSize = double(2) / double(3);
-        const int downloadedArchivesCount = m_core->downloadNeededArchives(downloadPartProgressSize);
+
+        // In pipelined mode the archives are downloaded while the components get installed.
+        QScopedPointer<DownloadArchivesJob> archivesJob;
+        int downloadedArchivesCount = 0;
+        if (m_data.settings().pipelinedInstallation()) {
+            const QList<QPair<QString, QString> > archives = archivesToDownload(componentsToInstall);
+            downloadedArchivesCount = archives.count();
+            if (!archives.isEmpty())
+                archivesJob.reset(startArchivesDownload(archives, downloadPartProgressSize));
+        } else {
+            downloadedArchivesCount = m_core->downloadNeededArchives(downloadPartProgressSize);
+        }
 
         // if there was no download we have the whole progress for installing components
         if (!downloadedArchivesCount)
@@ -1521,8 +1617,8 @@ bool PackageManagerCorePrivate::runInstaller()
             + (PackageManagerCore::createLocalRepositoryFromBinary() ? 1 : 0);
         double progressOperationSize = componentsInstallPartProgressSize / progressOperationCount;
 
-        foreach (Component *component, componentsToInstall)
-            installComponent(component, progressOperationSize, adminRightsGained);
+        installComponents(componentsToInstall, progressOperationSize, adminRightsGained,
+            archivesJob.data());
 
         if (m_core->isOfflineOnly() && PackageManagerCore::createLocalRepositoryFromBinary()) {
             emit m_core->titleMessageChanged(tr("Creating local repository"));
@@ -1573,7 +1669,7 @@ bool PackageManagerCorePrivate::runInstaller()
 
         emit m_core->titleMessageChanged(tr("Creating Maintenance Tool"));
 
-        writeMaintenanceTool(m_performedOperationsOld + m_performedOperationsCurrentSession);
+        writeMaintenanceTool();
 
         // fake a possible wrong value to show a full progress bar
         const int progress = ProgressCoordinator::instance()->progressInPercentage();
@@ -1645,17 +1741,11 @@ bool PackageManagerCorePrivate::runPackageUpdater()
 
         OperationList undoOperations;
         OperationList nonRevertedOperations;
+        QList<OperationBlob> nonRevertedPendingOperations;
         QHash<QString, Component *> componentsByName;
 
-        // order the operations in the right component dependency order
-        // next loop will save the needed operations in reverse order for uninstallation
-        OperationList performedOperationsOld = m_performedOperationsOld;
-        if (m_core->value(QLatin1String("installedOperationAreSorted")) != QLatin1String("true"))
-            performedOperationsOld = sortOperationsBasedOnComponentDependencies(m_performedOperationsOld);
-
-        // build a list of undo operations based on the checked state of the component
-        foreach (Operation *operation, performedOperationsOld) {
-            const QString &name = operation->value(QLatin1String("component")).toString();
+        // returns whether the operations of the component called name are kept
+        auto keepOperations = [&](const QString &name) {
             Component *component = componentsByName.value(name, nullptr);
             if (!component)
                 component = m_core->componentByName(PackageManagerCore::checkableName(name));
@@ -1667,15 +1757,13 @@ bool PackageManagerCorePrivate::runPackageUpdater()
                 // did not add the component as install dependency and there is no replacement, keep it.
                 if ((component && !component->updateRequested() && !componentsToInstall.contains(component)
                     && !m_componentsToReplaceUpdaterMode.contains(name))) {
-                        nonRevertedOperations.append(operation);
-                        continue;
+                        return true;
                 }
 
                 // There is a replacement, but the replacement is not scheduled for update, keep it as well.
                 if (m_componentsToReplaceUpdaterMode.contains(name)
                     && !m_componentsToReplaceUpdaterMode.value(name).first->updateRequested()) {
-                        nonRevertedOperations.append(operation);
-                        continue;
+                        return true;
                 }
             } else if (isPackageManager()) {
                 // We found the component, the component is still checked and the dependency solver did not
@@ -1683,19 +1771,60 @@ bool PackageManagerCorePrivate::runPackageUpdater()
                 if (component
                         && component->installAction() == ComponentModelHelper::KeepInstalled
                         && !componentsToInstall.contains(component)) {
-                    nonRevertedOperations.append(operation);
-                    continue;
+                    return true;
                 }
 
                 // There is a replacement, but the replacement is not scheduled for update, keep it as well.
                 if (m_componentsToReplaceAllMode.contains(name)
                     && !m_componentsToReplaceAllMode.value(name).first->isSelectedForInstallation()) {
-                        nonRevertedOperations.append(operation);
-                        continue;
+                        return true;
                 }
             } else {
                 Q_ASSERT_X(false, Q_FUNC_INFO, "Invalid package manager mode!");
             }
+            return false;
+        };
+
+        // order the operations in the right component dependency order, older maintenance tools
+        // did not write them sorted
+        OperationList oldOperations;
+        if (m_core->value(QLatin1String("installedOperationAreSorted")) != QLatin1String("true")) {
+            oldOperations = sortOperationsBasedOnComponentDependencies(performedOperationsOld());
+        } else {
+            if (!pendingOperationsLogged())
+                performedOperationsOld();
+            oldOperations = m_performedOperationsOld;
+        }
+
+        // Operations not created yet are only created if their component gets reverted, the
+        // others are copied unchanged from the log when writing the maintenance tool. The next
+        // loops save the needed operations in reverse order for uninstallation.
+        foreach (const OperationBlob &pendingOperation, m_pendingOperationsOld) {
+            const QString name = pendingOperation.log->component(pendingOperation.index);
+            if (name.isEmpty() || keepOperations(name)) {
+                nonRevertedPendingOperations.append(pendingOperation);
+                continue;
+            }
+
+            Operation *operation = createOperation(pendingOperation);
+            if (!operation)
+                continue;
+            if (operation->value(QLatin1String("uninstall-only")).toBool()) {
+                delete operation;
+                nonRevertedPendingOperations.append(pendingOperation);
+                continue;
+            }
+
+            undoOperations.prepend(operation);
+            updateAdminRights |= operation->value(QLatin1String("admin")).toBool();
+        }
+
+        // build a list of undo operations based on the checked state of the component
+        foreach (Operation *operation, oldOperations) {
+            if (keepOperations(operation->value(QLatin1String("component")).toString())) {
+                nonRevertedOperations.append(operation);
+                continue;
+            }
 
             // Filter out the create target dir undo operation, it's only needed for full uninstall.
             // Note: We filter for unnamed operations as well, since old installations had the remove target
@@ -1729,20 +1858,30 @@ bool PackageManagerCorePrivate::runPackageUpdater()
 
         ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("Preparing the installation..."));
 
-        // following, we download the needed archives
-        m_core->downloadNeededArchives(downloadPartProgressSize);
+        // following, we download the needed archives, in pipelined mode while the deselected
+        // components are removed and the selected ones are installed
+        QScopedPointer<DownloadArchivesJob> archivesJob;
+        if (m_data.settings().pipelinedInstallation()) {
+            const QList<QPair<QString, QString> > archives = archivesToDownload(componentsToInstall);
+            if (!archives.isEmpty())
+                archivesJob.reset(startArchivesDownload(archives, downloadPartProgressSize));
+        } else {
+            m_core->downloadNeededArchives(downloadPartProgressSize);
+        }
 
         if (undoOperations.count() > 0) {
             ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("Removing deselected components..."));
             runUndoOperations(undoOperations, undoOperationProgressSize, adminRightsGained, true);
         }
-        m_performedOperationsOld = nonRevertedOperations; // these are all operations left: those not reverted
+        // these are all operations left: those not reverted
+        m_pendingOperationsOld = nonRevertedPendingOperations;
+        m_performedOperationsOld = nonRevertedOperations;
 
         const double progressOperationCount = countProgressOperations(componentsToInstall);
         const double progressOperationSize = componentsInstallPartProgressSize / progressOperationCount;
 
-        foreach (Component *component, componentsToInstall)
-            installComponent(component, progressOperationSize, adminRightsGained);
+        installComponents(componentsToInstall, progressOperationSize, adminRightsGained,
+            archivesJob.data());
 
         emit m_core->titleMessageChanged(tr("Creating Maintenance Tool"));
 
@@ -1792,12 +1931,12 @@ bool PackageManagerCorePrivate::runUninstaller()
         if (!tempAdminFile.open() || !tempAdminFile.isWritable())
             adminRightsGained = m_core->gainAdminRights();
 
-        OperationList undoOperations = m_performedOperationsOld;
+        OperationList undoOperations = performedOperationsOld();
         std::reverse(undoOperations.begin(), undoOperations.end());
 
         bool updateAdminRights = false;
         if (!adminRightsGained) {
-            foreach (Operation *op, m_performedOperationsOld) {
+            foreach (Operation *op, undoOperations) {
                 updateAdminRights |= op->value(QLatin1String("admin")).toBool();
                 if (updateAdminRights)
                     break;  // an operation needs elevation to be able to perform their undo
@@ -1850,6 +1989,19 @@ bool PackageManagerCorePrivate::runUninstaller()
 
 void PackageManagerCorePrivate::installComponent(Component *component, double progressOperationSize,
     bool adminRightsGained)
+{
+    const bool showDetailsLog = prepareComponentInstallation(component, progressOperationSize);
+    foreach (Operation *operation, component->operations())
+        performInstallationOperation(component, operation, adminRightsGained);
+    finishComponentInstallation(component, showDetailsLog);
+}
+
+/*!
+    Announces the installation of \a component and connects its operations to the installer.
+    Returns \c true if the component does some real work and a details log should be shown.
+*/
+bool PackageManagerCorePrivate::prepareComponentInstallation(Component *component,
+    double progressOperationSize)
 {
     const OperationList operations = component->operations();
     if (!component->operationsCreatedSuccessfully())
@@ -1865,59 +2017,80 @@ void PackageManagerCorePrivate::installComponent(Component *component, double pr
     }
 
     foreach (Operation *operation, operations) {
-        if (statusCanceledOrFailed())
-            throw Error(tr("Installation canceled by user"));
-
-        // maybe this operations wants us to be admin...
-        bool becameAdmin = false;
-        if (!adminRightsGained && operation->value(QLatin1String("admin")).toBool()) {
-            becameAdmin = m_core->gainAdminRights();
-            qDebug() << operation->name() << "as admin:" << becameAdmin;
-        }
-
         connectOperationToInstaller(operation, progressOperationSize);
         connectOperationCallMethodRequest(operation);
+    }
+    return showDetailsLog;
+}
+
+/*!
+    Performs \a operation of \a component and asks the user how to continue if it fails. If
+    \a performed is \c true, the operation has already been run with \a ok as result.
+*/
+void PackageManagerCorePrivate::performInstallationOperation(Component *component,
+    Operation *operation, bool adminRightsGained, bool performed, bool ok)
+{
+    if (statusCanceledOrFailed()) {
+        // an operation that already ran might still need an undo call to cleanup
+        if (performed && (ok || operation->error() > Operation::InvalidArguments))
+            addPerformed(operation);
+        throw Error(tr("Installation canceled by user"));
+    }
+
+    // maybe this operations wants us to be admin...
+    bool becameAdmin = false;
+    if (!performed && !adminRightsGained && operation->value(QLatin1String("admin")).toBool()) {
+        becameAdmin = m_core->gainAdminRights();
+        qDebug() << operation->name() << "as admin:" << becameAdmin;
+    }
 
+    if (!performed) {
         // allow the operation to backup stuff before performing the operation
         performOperationThreaded(operation, PackageManagerCorePrivate::Backup);
+        ok = performOperationThreaded(operation);
+    }
 
-        bool ignoreError = false;
-        bool ok = performOperationThreaded(operation);
-        while (!ok && !ignoreError && m_core->status() != PackageManagerCore::Canceled) {
-            qDebug() << QString::fromLatin1("Operation \"%1\" with arguments \"%2\" failed: %3")
-                .arg(operation->name(), operation->arguments().join(QLatin1String("; ")),
-                operation->errorString());
-            const QMessageBox::StandardButton button =
-                MessageBoxHandler::warning(MessageBoxHandler::currentBestSuitParent(),
-                QLatin1String("installationErrorWithRetry"), tr("Installer Error"),
-                tr("Error during installation process (%1):\n%2").arg(component->name(),
-                operation->errorString()),
-                QMessageBox::Retry | QMessageBox::Ignore | QMessageBox::Cancel, QMessageBox::Retry);
-
-            if (button == QMessageBox::Retry)
-                ok = performOperationThreaded(operation);
-            else if (button == QMessageBox::Ignore)
-                ignoreError = true;
-            else if (button == QMessageBox::Cancel)
-                m_core->interrupt();
-        }
-
-        if (ok || operation->error() > Operation::InvalidArguments) {
-            // Remember that the operation was performed, that allows us to undo it if a following operation
-            // fails or if this operation failed but still needs an undo call to cleanup.
-            addPerformed(operation);
-        }
-
-        if (becameAdmin)
-            m_core->dropAdminRights();
+    bool ignoreError = false;
+    while (!ok && !ignoreError && m_core->status() != PackageManagerCore::Canceled) {
+        qDebug() << QString::fromLatin1("Operation \"%1\" with arguments \"%2\" failed: %3")
+            .arg(operation->name(), operation->arguments().join(QLatin1String("; ")),
+            operation->errorString());
+        const QMessageBox::StandardButton button =
+            MessageBoxHandler::warning(MessageBoxHandler::currentBestSuitParent(),
+            QLatin1String("installationErrorWithRetry"), tr("Installer Error"),
+            tr("Error during installation process (%1):\n%2").arg(component->name(),
+            operation->errorString()),
+            QMessageBox::Retry | QMessageBox::Ignore | QMessageBox::Cancel, QMessageBox::Retry);
 
-        if (!ok && !ignoreError)
-            throw Error(operation->errorString());
+        if (button == QMessageBox::Retry)
+            ok = performOperationThreaded(operation);
+        else if (button == QMessageBox::Ignore)
+            ignoreError = true;
+        else if (button == QMessageBox::Cancel)
+            m_core->interrupt();
+    }
 
-        if (component->value(scEssential, scFalse) == scTrue)
-            m_needsHardRestart = true;
+    if (ok || operation->error() > Operation::InvalidArguments) {
+        // Remember that the operation was performed, that allows us to undo it if a following operation
+        // fails or if this operation failed but still needs an undo call to cleanup.
+        addPerformed(operation);
     }
 
+    if (becameAdmin)
+        m_core->dropAdminRights();
+
+    if (!ok && !ignoreError)
+        throw Error(operation->errorString());
+
+    if (component->value(scEssential, scFalse) == scTrue)
+        m_needsHardRestart = true;
+}
+
+/*!
+    Registers \a component as installed once all of its operations have been performed.
+*/
+void PackageManagerCorePrivate::finishComponentInstallation(Component *component, bool showDetailsLog)
+{
     registerPathsForUninstallation(component->pathsForUninstallation(), component->name());
 
     if (!component->stopProcessForUpdateRequests().isEmpty()) {
@@ -1942,7 +2115,8 @@ void PackageManagerCorePrivate::installComponent(Component *component, double pr
                                   component->value(scInheritVersion),
                                   component->isCheckable(),
                                   component->isExpandedByDefault());
-    m_localPackageHub->writeToDisk();
+    // only journal the change, the complete file is written once all components are installed
+    m_localPackageHub->writeJournal();
 
     component->setInstalled();
     component->markAsPerformedInstallation();
@@ -1951,6 +2125,416 @@ void PackageManagerCorePrivate::installComponent(Component *component, double pr
         ProgressCoordinator::instance()->emitDetailTextChanged(tr("Done"));
 }
 
+static QStringList archiveNames(const QList<QPair<QString, QString> > &archives)
+{
+    QStringList names;
+    typedef QPair<QString, QString> Archive;
+    foreach (const Archive &archive, archives)
+        names.append(archive.first);
+    return names;
+}
+
+/*!
+    Installs \a components in the given order. If \a archivesJob is set, the archives are still
+    being downloaded and the installation of each component waits until its own archives are
+    available. As \a components is ordered by dependencies, the archives of a component's
+    dependencies are always available by then, since those components got installed before.
+
+    If more than one concurrent installation is configured, independent components are installed
+    concurrently, see installComponentsConcurrently(). Installations running with \a adminRightsGained
+    are not concurrent, as every operation then goes through the single elevated server.
+*/
+void PackageManagerCorePrivate::installComponents(const QList<Component *> &components,
+    double progressOperationSize, bool adminRightsGained, DownloadArchivesJob *archivesJob)
+{
+    const int maxConcurrentInstallations = m_data.settings().maxConcurrentInstallations();
+    if (maxConcurrentInstallations > 1 && components.count() > 1 && !adminRightsGained) {
+        installComponentsConcurrently(components, progressOperationSize, adminRightsGained,
+            archivesJob, maxConcurrentInstallations);
+    } else {
+        foreach (Component *component, components) {
+            if (archivesJob) {
+                const QStringList archives = archiveNames(archivesToDownload(QList<Component *>()
+                    << component));
+                if (!archives.isEmpty())
+                    waitForArchivesDownload(archivesJob, archives);
+            }
+            installComponent(component, progressOperationSize, adminRightsGained);
+        }
+    }
+
+    if (archivesJob)
+        waitForArchivesDownload(archivesJob);
+
+    m_localPackageHub->writeToDisk();
+}
+
+namespace {
+
+struct ComponentOperationsResult
+{
+    ComponentOperationsResult() : processed(0), ok(true) {}
+    int processed; // the number of operations that have been run
+    bool ok;       // the result of the last operation that has been run
+};
+
+class ConcurrentInstallation
+{
+public:
+    explicit ConcurrentInstallation(Component *c)
+        : component(c)
+        , next(0)
+        , showDetailsLog(false)
+    {}
+
+    Component *component;
+    OperationList operations;
+    int next; // the first operation that has not been run yet
+    QFutureWatcher<ComponentOperationsResult> watcher;
+    bool showDetailsLog;
+};
+
+} // namespace
+
+/*!
+    Returns whether \a operation only unpacks or copies files and can run on a worker thread,
+    without touching any state of the installer.
+*/
+static bool runsOnWorkerThread(const Operation *operation)
+{
+    if (operation->value(QLatin1String("admin")).toBool())
+        return false;
+    return operation->name() == QLatin1String("Extract")
+        || operation->name() == QLatin1String("Copy");
+}
+
+/*!
+    Runs backup and perform of \a operations one after the other, stopping at the first failing
+    operation or as soon as \a abort is set. Called from a worker thread.
+*/
+static ComponentOperationsResult runComponentOperations(const OperationList &operations,
+    const QAtomicInt *abort)
+{
+    ComponentOperationsResult result;
+    foreach (Operation *operation, operations) {
+        if (abort->load())
+            break;
+        runOperation(operation, PackageManagerCorePrivate::Backup);
+        result.ok = runOperation(operation, PackageManagerCorePrivate::Perform);
+        ++result.processed;
+        if (!result.ok)
+            break;
+    }
+    return result;
+}
+
+/*!
+    Installs \a components using up to \a maxConcurrentInstallations worker threads. A component
+    is started as soon as all of its dependencies and automatic dependencies among \a components
+    have been installed, and, if \a archivesJob is set, its own archives have been downloaded.
+
+    Only the operations that unpack or copy files run on the worker threads. All other operations,
+    the handling of failed operations and registering a component as installed happen on the main
+    thread, one component at a time, the same way as installComponent() does.
+
+    Components with operations that require admin rights to be gained, are installed on their own
+    once all running installations have finished, so that the admin rights transitions never
+    overlap and admin operations never run concurrently.
+
+    The operations of a component are recorded in their order once they have been run. As a
+    component is never started before its dependencies have been finished, the recorded order
+    stays a valid dependency order for undo and rollback.
+*/
+void PackageManagerCorePrivate::installComponentsConcurrently(const QList<Component *> &components,
+    double progressOperationSize, bool adminRightsGained, DownloadArchivesJob *archivesJob,
+    int maxConcurrentInstallations)
+{
+    // dependency edges restricted to the components to install
+    QHash<Component *, int> remainingDependencies;
+    QHash<Component *, QList<Component *> > dependents;
+    foreach (Component *component, components) {
+        QSet<Component *> dependencies;
+        foreach (const QString &name, component->dependencies() + component->autoDependencies()) {
+            Component *dependency = PackageManagerCore::componentByName(name, components);
+            if (dependency && dependency != component)
+                dependencies.insert(dependency);
+        }
+        remainingDependencies.insert(component, dependencies.count());
+        foreach (Component *dependency, dependencies)
+            dependents[dependency].append(component);
+    }
+
+    QList<Component *> ready;
+    foreach (Component *component, components) {
+        if (remainingDependencies.value(component) == 0)
+            ready.append(component);
+    }
+
+    auto needsExclusiveInstallation = [](Component *component) {
+        foreach (Operation *operation, component->operations()) {
+            if (operation->value(QLatin1String("admin")).toBool())
+                return true;
+        }
+        return false;
+    };
+    auto archivesAvailable = [this, archivesJob](Component *component) {
+        if (!archivesJob)
+            return true;
+        foreach (const QString &archive, archiveNames(archivesToDownload(QList<Component *>()
+            << component))) {
+            if (!archivesJob->isArchiveProcessed(archive))
+                return false;
+        }
+        return true;
+    };
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(maxConcurrentInstallations);
+
+    QAtomicInt abort(0);
+    QEventLoop loop;
+    connect(m_core, &PackageManagerCore::installationInterrupted, &loop, [&abort]() {
+        abort.store(1);
+    });
+    if (archivesJob) {
+        connect(archivesJob, &DownloadArchivesJob::archiveProcessed, &loop, &QEventLoop::quit);
+        connect(archivesJob, &Job::finished, &loop, &QEventLoop::quit);
+    }
+
+    QList<ConcurrentInstallation *> running;
+    int installedCount = 0;
+
+    auto componentInstalled = [&](Component *component) {
+        ++installedCount;
+        foreach (Component *dependent, dependents.value(component)) {
+            if (--remainingDependencies[dependent] == 0)
+                ready.append(dependent);
+        }
+    };
+
+    // Runs the operations of a component on this thread until the next ones can be handed to a
+    // worker. Returns true once the component has been installed.
+    auto continueInstallation = [&](ConcurrentInstallation *installation) {
+        Component *const component = installation->component;
+        const OperationList &operations = installation->operations;
+        while (installation->next < operations.count()) {
+            if (!runsOnWorkerThread(operations.at(installation->next))) {
+                performInstallationOperation(component, operations.at(installation->next++),
+                    adminRightsGained);
+                continue;
+            }
+            if (statusCanceledOrFailed())
+                throw Error(tr("Installation canceled by user"));
+
+            int end = installation->next + 1;
+            while (end < operations.count() && runsOnWorkerThread(operations.at(end)))
+                ++end;
+            installation->watcher.setFuture(QtConcurrent::run(&threadPool, runComponentOperations,
+                operations.mid(installation->next, end - installation->next), &abort));
+            return false;
+        }
+
+        finishComponentInstallation(component, installation->showDetailsLog);
+        componentInstalled(component);
+        return true;
+    };
+
+    // Records the operations run by a worker and continues a failed operation on this thread.
+    auto finishWorkerOperations = [&](ConcurrentInstallation *installation) {
+        const ComponentOperationsResult result = installation->watcher.result();
+        Component *const component = installation->component;
+        for (int i = 0; i < result.processed; ++i) {
+            Operation *const operation = installation->operations.at(installation->next++);
+            if (i == result.processed - 1 && !result.ok) {
+                performInstallationOperation(component, operation, adminRightsGained, true, false);
+                continue;
+            }
+            addPerformed(operation);
+            if (component->value(scEssential, scFalse) == scTrue)
+                m_needsHardRestart = true;
+        }
+    };
+
+    // Waits for all running workers and records what they did, used to keep rollback complete.
+    auto drainRunningInstallations = [&]() {
+        abort.store(1);
+        while (!running.isEmpty()) {
+            ConcurrentInstallation *installation = running.takeFirst();
+            if (!installation->watcher.isFinished()) {
+                QEventLoop drainLoop;
+                connect(&installation->watcher, &QFutureWatcherBase::finished, &drainLoop,
+                    &QEventLoop::quit, Qt::QueuedConnection);
+                if (!installation->watcher.isFinished())
+                    drainLoop.exec();
+            }
+            const ComponentOperationsResult result = installation->watcher.result();
+            for (int i = 0; i < result.processed; ++i) {
+                Operation *const operation = installation->operations.at(installation->next + i);
+                if (result.ok || i < result.processed - 1
+                    || operation->error() > Operation::InvalidArguments) {
+                        addPerformed(operation);
+                }
+            }
+            delete installation;
+        }
+    };
+
+    try {
+        while (installedCount < components.count()) {
+            if (statusCanceledOrFailed())
+                throw Error(tr("Installation canceled by user"));
+
+            bool started = false;
+            for (int i = 0; i < ready.count(); ++i) {
+                Component *const component = ready.at(i);
+                if (!archivesAvailable(component))
+                    continue;
+
+                if (needsExclusiveInstallation(component)) {
+                    if (!running.isEmpty())
+                        break; // keep the order, wait until the running installations are done
+                    ready.removeAt(i);
+                    installComponent(component, progressOperationSize, adminRightsGained);
+                    componentInstalled(component);
+                    started = true;
+                    break;
+                }
+
+                if (running.count() >= maxConcurrentInstallations)
+                    break;
+
+                ready.removeAt(i--);
+                QScopedPointer<ConcurrentInstallation> installation(
+                    new ConcurrentInstallation(component));
+                installation->showDetailsLog = prepareComponentInstallation(component,
+                    progressOperationSize);
+                installation->operations = component->operations();
+                connect(&installation->watcher, &QFutureWatcherBase::finished, &loop,
+                    &QEventLoop::quit, Qt::QueuedConnection);
+                if (!continueInstallation(installation.data()))
+                    running.append(installation.take());
+                started = true;
+            }
+
+            // continue all components whose workers are done, in the order they have been started
+            for (int i = 0; i < running.count(); ++i) {
+                ConcurrentInstallation *installation = running.at(i);
+                if (!installation->watcher.isFinished())
+                    continue;
+                running.removeAt(i--);
+                QScopedPointer<ConcurrentInstallation> finished(installation);
+                finishWorkerOperations(installation);
+                if (!continueInstallation(installation))
+                    running.insert(++i, finished.take());
+                started = true;
+            }
+
+            if (started)
+                continue;
+
+            if (running.isEmpty()) {
+                if (!archivesJob || ready.isEmpty()) {
+                    throw Error(tr("Cannot resolve the installation order of the remaining %1 "
+                        "components.").arg(components.count() - installedCount));
+                }
+                waitForArchivesDownload(archivesJob, archiveNames(archivesToDownload(
+                    QList<Component *>() << ready.first())));
+                continue;
+            }
+            loop.exec();
+        }
+    } catch (const Error &) {
+        drainRunningInstallations();
+        throw;
+    }
+}
+
+/*!
+    Returns the archives that need to be downloaded for \a components. The first value of each
+    pair contains the file name inside the installer's file system, the second one the source url.
+*/
+QList<QPair<QString, QString> > PackageManagerCorePrivate::archivesToDownload(
+    const QList<Component *> &components) const
+{
+    QList<QPair<QString, QString> > archives;
+    foreach (Component *component, components) {
+        const QStringList toDownload = component->downloadableArchives();
+        foreach (const QString &versionFreeString, toDownload) {
+            archives.push_back(qMakePair(QString::fromLatin1("installer://%1/%2")
+                .arg(component->name(), versionFreeString), QString::fromLatin1("%1/%2/%3")
+                .arg(component->repositoryUrl().toString(), component->name(), versionFreeString)));
+        }
+    }
+    return archives;
+}
+
+/*!
+    Creates and starts a job downloading \a archives. Its progress is reported as a part of
+    \a partProgressSize of the overall progress. The caller takes ownership of the job.
+*/
+DownloadArchivesJob *PackageManagerCorePrivate::startArchivesDownload(
+    const QList<QPair<QString, QString> > &archives, double partProgressSize)
+{
+    ProgressCoordinator::instance()->emitLabelAndDetailTextChanged(tr("\nDownloading packages..."));
+
+    DownloadArchivesJob *archivesJob = new DownloadArchivesJob(m_core);
+    archivesJob->setAutoDelete(false);
+    archivesJob->setArchivesToDownload(archives);
+    connect(m_core, &PackageManagerCore::installationInterrupted, archivesJob, &Job::cancel);
+    connect(archivesJob, &DownloadArchivesJob::outputTextChanged,
+            ProgressCoordinator::instance(), &ProgressCoordinator::emitLabelAndDetailTextChanged);
+    connect(archivesJob, &DownloadArchivesJob::downloadStatusChanged,
+            ProgressCoordinator::instance(), &ProgressCoordinator::downloadStatusChanged);
+
+    ProgressCoordinator::instance()->registerPartProgress(archivesJob,
+        SIGNAL(progressChanged(double)), partProgressSize);
+
+    archivesJob->start();
+    return archivesJob;
+}
+
+/*!
+    Waits until all of \a archives have been processed by \a archivesJob, or until the job has
+    finished if \a archives is empty. Throws an Error if the download failed or the installation
+    got canceled meanwhile.
+*/
+void PackageManagerCorePrivate::waitForArchivesDownload(DownloadArchivesJob *archivesJob,
+    const QStringList &archives)
+{
+    auto archivesProcessed = [archivesJob, archives]() {
+        if (archives.isEmpty())
+            return false;
+        foreach (const QString &archive, archives) {
+            if (!archivesJob->isArchiveProcessed(archive))
+                return false;
+        }
+        return true;
+    };
+
+    if (!archivesJob->isFinished() && !archivesProcessed()) {
+        QEventLoop loop;
+        connect(archivesJob, &Job::finished, &loop, &QEventLoop::quit);
+        connect(archivesJob, &DownloadArchivesJob::archiveProcessed, &loop, [&loop, archivesProcessed]() {
+            if (archivesProcessed())
+                loop.quit();
+        });
+        loop.exec();
+    }
+
+    if (archivesJob->isFinished()) {
+        if (archivesJob->error() == Job::Canceled)
+            m_core->interrupt();
+        else if (archivesJob->error() != Job::NoError)
+            throw Error(archivesJob->errorString());
+    }
+
+    if (statusCanceledOrFailed())
+        throw Error(tr("Installation canceled by user."));
+
+    if (archivesJob->isFinished() && archives.isEmpty())
+        ProgressCoordinator::instance()->emitDownloadStatus(tr("All downloads finished."));
+}
+
 // -- private
 
 void PackageManagerCorePrivate::deleteMaintenanceTool()
@@ -1989,8 +2573,8 @@ void PackageManagerCorePrivate::deleteMaintenanceTool()
     QStringList arguments;
     arguments << QLatin1String("//Nologo") << batchfile; // execute the batchfile
     arguments << QDir::toNativeSeparators(QFileInfo(installerBinaryPath()).absoluteFilePath());
-    if (!m_performedOperationsOld.isEmpty()) {
-        const Operation *const op = m_performedOperationsOld.first();
+    if (!performedOperationsOld().isEmpty()) {
+        const Operation *const op = performedOperationsOld().first();
         if (op->name() == QLatin1String("Mkdir")) // the target directory name
             arguments << QDir::toNativeSeparators(QFileInfo(op->arguments().first()).absoluteFilePath());
     }
@@ -2107,7 +2691,8 @@ void PackageManagerCorePrivate::runUndoOperations(const OperationList &undoOpera
                     component = componentsToReplace().value(componentName).second;
                 if (component) {
                     component->setUninstalled();
-                    m_localPackageHub->removePackage(component->name());
+                    if (m_localPackageHub->removePackage(component->name()))
+                        m_localPackageHub->writeJournal();
                 }
             }
 
@@ -2127,6 +2712,14 @@ void PackageManagerCorePrivate::runUndoOperations(const OperationList &undoOpera
     m_localPackageHub->writeToDisk();
 }
 
+static QList<KDUpdater::UpdatesInfo> parsedUpdatesInfo(const QList<Metadata> &metadata)
+{
+    QList<KDUpdater::UpdatesInfo> updatesInfo;
+    foreach (const Metadata &data, metadata)
+        updatesInfo.append(data.updatesInfo);
+    return updatesInfo;
+}
+
 PackagesList PackageManagerCorePrivate::remotePackages()
 {
     if (m_updates && m_updateFinder)
@@ -2138,6 +2731,7 @@ PackagesList PackageManagerCorePrivate::remotePackages()
     m_updateFinder = new KDUpdater::UpdateFinder;
     m_updateFinder->setAutoDelete(false);
     m_updateFinder->setPackageSources(m_packageSources);
+    m_updateFinder->setParsedUpdatesInfo(parsedUpdatesInfo(m_metadataJob.metadata()));
     m_updateFinder->setLocalPackageHub(m_localPackageHub);
     m_updateFinder->run();
 
@@ -2162,6 +2756,7 @@ PackagesList PackageManagerCorePrivate::compressedPackages()
     m_compressedFinder->setAutoDelete(false);
     m_compressedFinder->addCompressedPackage(true);
     m_compressedFinder->setPackageSources(m_compressedPackageSources);
+    m_compressedFinder->setParsedUpdatesInfo(parsedUpdatesInfo(m_metadataJob.metadata()));
 
     m_compressedFinder->setLocalPackageHub(m_localPackageHub);
     m_compressedFinder->run();
@@ -2310,30 +2905,17 @@ bool PackageManagerCorePrivate::addUpdateResourcesFromRepositories(bool parseChe
             continue;
 
         if (parseChecksum) {
-            const QString updatesXmlPath = data.directory + QLatin1String("/Updates.xml");
-            QFile updatesFile(updatesXmlPath);
-            try {
-                QInstaller::openForRead(&updatesFile);
-            } catch(const Error &e) {
-                qDebug() << "Error opening Updates.xml:" << e.message();
-                setStatus(PackageManagerCore::Failure, tr("Cannot add temporary update source information."));
-                return false;
-            }
-
-            int line = 0;
-            int column = 0;
-            QString error;
-            QDomDocument doc;
-            if (!doc.setContent(&updatesFile, &error, &line, &column)) {
-                qDebug().nospace() << "Parse error in file" << updatesFile.fileName()
-                                   << ": " << error << " at line " << line << " col " << column;
+            // the metadata job parsed Updates.xml already
+            const KDUpdater::UpdatesInfo &updatesInfo = data.updatesInfo;
+            if (updatesInfo.error() == KDUpdater::UpdatesInfo::CouldNotReadUpdateInfoFileError
+                || updatesInfo.error() == KDUpdater::UpdatesInfo::InvalidXmlError) {
+                qDebug() << "Error reading Updates.xml:" << updatesInfo.errorString();
                 setStatus(PackageManagerCore::Failure, tr("Cannot add temporary update source information."));
                 return false;
             }
 
-            const QDomNode checksum = doc.documentElement().firstChildElement(QLatin1String("Checksum"));
-            if (!checksum.isNull())
-                m_core->setTestChecksum(checksum.toElement().text().toLower() == scTrue);
+            if (updatesInfo.hasChecksum())
+                m_core->setTestChecksum(updatesInfo.checksum().toLower() == scTrue);
         }
         if (compressedRepository)
             m_compressedPackageSources.insert(PackageSource(QUrl::fromLocalFile(data.directory), 1));
@@ -2391,20 +2973,89 @@ void PackageManagerCorePrivate::connectOperationCallMethodRequest(Operation *con
     }
 }
 
-OperationList PackageManagerCorePrivate::sortOperationsBasedOnComponentDependencies(const OperationList &operationList)
+/*!
+    Creates the operation stored in \a operation. Returns \c nullptr if the operation is unknown
+    or its data cannot be loaded.
+*/
+Operation *PackageManagerCorePrivate::createOperation(const OperationBlob &operation)
 {
-    OperationList sortedOperations;
-    QHash<QString, OperationList> componentOperationHash;
+    QScopedPointer<QInstaller::Operation> op(KDUpdater::UpdateOperationFactory::instance()
+        .create(operation.name, m_core));
+    if (op.isNull()) {
+        qWarning() << "Failed to load unknown operation" << operation.name;
+        return nullptr;
+    }
 
-    // sort component unrelated operations to the beginning
-    foreach (Operation *operation, operationList) {
-        const QString componentName = operation->value(QLatin1String("component")).toString();
-        if (componentName.isEmpty())
-            sortedOperations.append(operation);
-        else
-            componentOperationHash[componentName].append(operation);
+    if (operation.log) {
+        if (!operation.log->restore(operation.index, op.data())) {
+            qWarning() << "Failed to load data for operation" << operation.name;
+            return nullptr;
+        }
+    } else if (!op->fromXml(operation.xml)) {
+        qWarning() << "Failed to load XML for operation" << operation.name;
+        return nullptr;
+    }
+    return op.take();
+}
+
+/*!
+    Returns \c true if all operations of previous runs that were not created yet are stored in a
+    binary operation log, which can be copied without creating them.
+*/
+bool PackageManagerCorePrivate::pendingOperationsLogged() const
+{
+    foreach (const OperationBlob &operation, m_pendingOperationsOld) {
+        if (!operation.log)
+            return false;
+    }
+    return true;
+}
+
+/*!
+    Returns the operations performed by previous runs of the installer. The operations stored
+    in the binary are created on first access, not when the installer is started.
+*/
+OperationList &PackageManagerCorePrivate::performedOperationsOld()
+{
+    if (m_pendingOperationsOld.isEmpty())
+        return m_performedOperationsOld;
+
+    OperationList operations;
+    operations.reserve(m_pendingOperationsOld.count() + m_performedOperationsOld.count());
+    foreach (const OperationBlob &operation, m_pendingOperationsOld) {
+        if (Operation *op = createOperation(operation))
+            operations.append(op);
+    }
+    m_pendingOperationsOld.clear();
+    m_performedOperationsOld = operations + m_performedOperationsOld;
+    return m_performedOperationsOld;
+}
+
+/*!
+    Returns the names of the components that have operations performed by previous runs of
+    the installer. Uses the component index of the binary operation log if the operations have
+    not been created yet.
+*/
+QSet<QString> PackageManagerCorePrivate::performedOperationComponents()
+{
+    if (!pendingOperationsLogged())
+        performedOperationsOld();
+
+    QSet<QString> components;
+    foreach (const OperationBlob &operation, m_pendingOperationsOld) {
+        const QString component = operation.log->component(operation.index);
+        if (!component.isEmpty())
+            components.insert(component);
     }
+    foreach (QInstaller::Operation *operation, m_performedOperationsOld) {
+        if (operation->hasValue(QLatin1String("component")))
+            components.insert(operation->value(QLatin1String("component")).toString());
+    }
+    return components;
+}
 
+QStringList PackageManagerCorePrivate::componentsInDependencyOrder()
+{
     Graph<QString> componentGraph;  // create the complete component graph
     foreach (const Component* node, m_core->components(PackageManagerCore::ComponentType::All)) {
         componentGraph.addNode(node->name());
@@ -2413,15 +3064,74 @@ OperationList PackageManagerCorePrivate::sortOperationsBasedOnComponentDependenc
 
     const QStringList resolvedComponents = componentGraph.sort();
     if (componentGraph.hasCycle()) {
+        qWarning().noquote() << "Dependency cycle:"
+            << QStringList(componentGraph.cyclePath()).join(QLatin1String(" -> "));
         throw Error(tr("Dependency cycle between components \"%1\" and \"%2\" detected.")
             .arg(componentGraph.cycle().first, componentGraph.cycle().second));
     }
-    foreach (const QString &componentName, resolvedComponents)
+    return resolvedComponents;
+}
+
+OperationList PackageManagerCorePrivate::sortOperationsBasedOnComponentDependencies(const OperationList &operationList)
+{
+    OperationList sortedOperations;
+    QHash<QString, OperationList> componentOperationHash;
+
+    // sort component unrelated operations to the beginning
+    foreach (Operation *operation, operationList) {
+        const QString componentName = operation->value(QLatin1String("component")).toString();
+        if (componentName.isEmpty())
+            sortedOperations.append(operation);
+        else
+            componentOperationHash[componentName].append(operation);
+    }
+
+    foreach (const QString &componentName, componentsInDependencyOrder())
         sortedOperations.append(componentOperationHash.value(componentName));
 
     return sortedOperations;
 }
 
+/*!
+    Appends the pending operations of previous runs followed by \a operationList to \a writer,
+    sorted the same way as sortOperationsBasedOnComponentDependencies() does. Pending operations
+    are copied from their log without creating them.
+*/
+void PackageManagerCorePrivate::appendOperationsInDependencyOrder(OperationLog::Writer *writer,
+    const OperationList &operationList)
+{
+    QHash<QString, QList<OperationBlob> > componentLoggedOperationHash;
+    QHash<QString, OperationList> componentOperationHash;
+
+    auto appendLogged = [writer](const OperationBlob &operation) {
+        if (!writer->append(*operation.log, operation.index))
+            qWarning() << "Failed to copy data for operation" << operation.name;
+    };
+
+    // sort component unrelated operations to the beginning
+    foreach (const OperationBlob &operation, m_pendingOperationsOld) {
+        const QString componentName = operation.log->component(operation.index);
+        if (componentName.isEmpty())
+            appendLogged(operation);
+        else
+            componentLoggedOperationHash[componentName].append(operation);
+    }
+    foreach (Operation *operation, operationList) {
+        const QString componentName = operation->value(QLatin1String("component")).toString();
+        if (componentName.isEmpty())
+            writer->append(operation);
+        else
+            componentOperationHash[componentName].append(operation);
+    }
+
+    foreach (const QString &componentName, componentsInDependencyOrder()) {
+        foreach (const OperationBlob &operation, componentLoggedOperationHash.value(componentName))
+            appendLogged(operation);
+        foreach (Operation *operation, componentOperationHash.value(componentName))
+            writer->append(operation);
+    }
+}
+
 void PackageManagerCorePrivate::handleMethodInvocationRequest(const QString &invokableMethodName)
 {
     QObject *obj = QObject::sender();
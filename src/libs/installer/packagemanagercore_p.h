@@ -29,7 +29,9 @@
 #ifndef PACKAGEMANAGERCORE_P_H
 #define PACKAGEMANAGERCORE_P_H
 
+#include "componentindex.h"
 #include "metadatajob.h"
+#include "operationlog.h"
 #include "packagemanagercore.h"
 #include "packagemanagercoredata.h"
 #include "packagemanagerproxyfactory.h"
@@ -39,6 +41,7 @@
 #include "sysinfo.h"
 #include "updatefinder.h"
 
+#include <QMutex>
 #include <QObject>
 
 class Job;
@@ -53,6 +56,7 @@ namespace QInstaller {
 
 struct BinaryLayout;
 class Component;
+class DownloadArchivesJob;
 class ScriptEngine;
 class ComponentModel;
 class TempDirDeleter;
@@ -98,7 +102,7 @@ public:
     void writeMaintenanceConfigFiles();
     void readMaintenanceConfigFiles(const QString &targetDir);
 
-    void writeMaintenanceTool(OperationList performedOperations);
+    void writeMaintenanceTool();
 
     QString componentsXmlPath() const;
     QString configurationFileName() const;
@@ -111,11 +115,14 @@ public:
 
     void clearAllComponentLists();
     void clearUpdaterComponentLists();
+    Component *componentByName(const QString &name) const;
+    void invalidateComponentIndex();
     QList<Component*> &replacementDependencyComponents();
     QHash<QString, QPair<Component*, Component*> > &componentsToReplace();
 
     void clearInstallerCalculator();
     InstallerCalculator *installerCalculator() const;
+    bool calculateComponentsToInstall(const QList<Component *> &selectedComponents);
 
     void clearUninstallerCalculator();
     UninstallerCalculator *uninstallerCalculator() const;
@@ -141,7 +148,10 @@ public:
     int countProgressOperations(const OperationList &operations);
     void connectOperationToInstaller(Operation *const operation, double progressOperationPartSize);
     void connectOperationCallMethodRequest(Operation *const operation);
+    QStringList componentsInDependencyOrder();
     OperationList sortOperationsBasedOnComponentDependencies(const OperationList &operationList);
+    void appendOperationsInDependencyOrder(OperationLog::Writer *writer,
+        const OperationList &operationList);
 
     Operation *createOwnedOperation(const QString &type);
     Operation *takeOwnedOperation(Operation *operation);
@@ -150,6 +160,11 @@ public:
     void registerPathsForUninstallation(const QList<QPair<QString, bool> > &pathsForUninstallation,
         const QString &componentName);
 
+    Operation *createOperation(const OperationBlob &operation);
+    bool pendingOperationsLogged() const;
+    OperationList &performedOperationsOld();
+    QSet<QString> performedOperationComponents();
+
     void addPerformed(Operation *op) {
         m_performedOperationsCurrentSession.append(op);
     }
@@ -161,6 +176,21 @@ public:
 
     void installComponent(Component *component, double progressOperationSize,
         bool adminRightsGained = false);
+    void installComponents(const QList<Component *> &components, double progressOperationSize,
+        bool adminRightsGained, DownloadArchivesJob *archivesJob = nullptr);
+    void installComponentsConcurrently(const QList<Component *> &components,
+        double progressOperationSize, bool adminRightsGained, DownloadArchivesJob *archivesJob,
+        int maxConcurrentInstallations);
+    bool prepareComponentInstallation(Component *component, double progressOperationSize);
+    void performInstallationOperation(Component *component, Operation *operation,
+        bool adminRightsGained, bool performed = false, bool ok = false);
+    void finishComponentInstallation(Component *component, bool showDetailsLog);
+
+    QList<QPair<QString, QString> > archivesToDownload(const QList<Component *> &components) const;
+    DownloadArchivesJob *startArchivesDownload(const QList<QPair<QString, QString> > &archives,
+        double partProgressSize);
+    void waitForArchivesDownload(DownloadArchivesJob *archivesJob,
+        const QStringList &archives = QStringList());
 
 signals:
     void installationStarted();
@@ -196,7 +226,6 @@ public:
     QList<QInstaller::Component*> m_updaterDependencyReplacements;
 
     OperationList m_ownedOperations;
-    OperationList m_performedOperationsOld;
     OperationList m_performedOperationsCurrentSession;
 
     bool m_dependsOnLocalInstallerBinary;
@@ -222,7 +251,7 @@ private:
 
     void writeMaintenanceToolBinary(QFile *const input, qint64 size, bool writeBinaryLayout);
     void writeMaintenanceToolBinaryData(QFileDevice *output, QFile *const input,
-        const OperationList &performed, const BinaryLayout &layout);
+        const OperationLog::Writer &operationLog, const BinaryLayout &layout);
 
     void runUndoOperations(const OperationList &undoOperations, double undoOperationProgressSize,
         bool adminRightsGained, bool deleteOperation);
@@ -255,8 +284,17 @@ private:
     QHash<QString, QPair<Component*, Component*> > m_componentsToReplaceUpdaterMode;
 
     InstallerCalculator *m_installerCalculator;
+    QSet<Component *> m_installerCalculatorSelection;
+    bool m_installerCalculatorUpdater;
+    bool m_installerCalculatorOutdated; // guarded by m_componentIndexMutex
     UninstallerCalculator *m_uninstallerCalculator;
 
+    // name -> component lookup for the components of the current run mode, built on demand
+    mutable QMutex m_componentIndexMutex;
+    mutable ComponentIndex m_componentIndex;
+    mutable bool m_componentIndexValid;
+    mutable bool m_componentIndexUpdater;
+
     PackageManagerProxyFactory *m_proxyFactory;
 
     ComponentModel *m_defaultModel;
@@ -266,6 +304,11 @@ private:
     QScopedPointer<RemoteFileEngineHandler> m_remoteFileEngineHandler;
 
 private:
+    // operations read from the binary, turned into Operation objects on first use; pending
+    // operations always precede the created ones
+    QList<OperationBlob> m_pendingOperationsOld;
+    OperationList m_performedOperationsOld;
+
     // remove once we deprecate isSelected, setSelected etc...
     void restoreCheckState();
     void storeCheckState();
@@ -27,12 +27,166 @@
 **************************************************************************/
 
 #include "protocol.h"
+
+#include <QHash>
 #include <QIODevice>
 
+#include <cstring>
+
 namespace QInstaller {
 
 typedef qint32 PackageSize;
 
+namespace Protocol {
+
+// same order as CommandId
+static const char *const CommandNames[] = {
+    "",
+    Create,
+    Destroy,
+    Shutdown,
+    Authorize,
+    Reply,
+    Batch,
+    QProcessCloseWriteChannel,
+    QProcessExitCode,
+    QProcessExitStatus,
+    QProcessKill,
+    QProcessReadAll,
+    QProcessReadAllStandardOutput,
+    QProcessReadAllStandardError,
+    QProcessStartDetached,
+    QProcessSetWorkingDirectory,
+    QProcessSetEnvironment,
+    QProcessEnvironment,
+    QProcessStart3Arg,
+    QProcessStart2Arg,
+    QProcessState,
+    QProcessTerminate,
+    QProcessWaitForFinished,
+    QProcessWaitForStarted,
+    QProcessWorkingDirectory,
+    QProcessErrorString,
+    QProcessReadChannel,
+    QProcessSetReadChannel,
+    QProcessWrite,
+    QProcessProcessChannelMode,
+    QProcessSetProcessChannelMode,
+    QProcessSetNativeArguments,
+    GetQProcessSignals,
+    QSettingsAllKeys,
+    QSettingsBeginGroup,
+    QSettingsBeginWriteArray,
+    QSettingsBeginReadArray,
+    QSettingsChildGroups,
+    QSettingsChildKeys,
+    QSettingsClear,
+    QSettingsContains,
+    QSettingsEndArray,
+    QSettingsEndGroup,
+    QSettingsFallbacksEnabled,
+    QSettingsFileName,
+    QSettingsGroup,
+    QSettingsIsWritable,
+    QSettingsRemove,
+    QSettingsSetArrayIndex,
+    QSettingsSetFallbacksEnabled,
+    QSettingsStatus,
+    QSettingsSync,
+    QSettingsSetValue,
+    QSettingsValue,
+    QSettingsOrganizationName,
+    QSettingsApplicationName,
+    QAbstractFileEngineAtEnd,
+    QAbstractFileEngineCaseSensitive,
+    QAbstractFileEngineClose,
+    QAbstractFileEngineCopy,
+    QAbstractFileEngineEntryList,
+    QAbstractFileEngineError,
+    QAbstractFileEngineErrorString,
+    QAbstractFileEngineFileFlags,
+    QAbstractFileEngineFileName,
+    QAbstractFileEngineFlush,
+    QAbstractFileEngineHandle,
+    QAbstractFileEngineIsRelativePath,
+    QAbstractFileEngineIsSequential,
+    QAbstractFileEngineLink,
+    QAbstractFileEngineMkdir,
+    QAbstractFileEngineOpen,
+    QAbstractFileEngineOwner,
+    QAbstractFileEngineOwnerId,
+    QAbstractFileEnginePos,
+    QAbstractFileEngineRead,
+    QAbstractFileEngineReadLine,
+    QAbstractFileEngineRemove,
+    QAbstractFileEngineRename,
+    QAbstractFileEngineRmdir,
+    QAbstractFileEngineSeek,
+    QAbstractFileEngineSetFileName,
+    QAbstractFileEngineSetPermissions,
+    QAbstractFileEngineSetSize,
+    QAbstractFileEngineSize,
+    QAbstractFileEngineSupportsExtension,
+    QAbstractFileEngineExtension,
+    QAbstractFileEngineWrite,
+    QAbstractFileEngineSyncToDisk,
+    QAbstractFileEngineRenameOverwrite,
+    QAbstractFileEngineFileTime,
+    Progress,
+    RemoteFileOperationsExtractArchive,
+    RemoteFileOperationsCopyTree,
+    RemoteFileOperationsRemoveTree,
+    RemoteFileOperationsSetPermissions,
+    QAbstractFileEngineAttachSharedMemory,
+    QAbstractFileEngineReadShared,
+    QAbstractFileEngineWriteShared,
+};
+Q_STATIC_ASSERT(sizeof(CommandNames) / sizeof(CommandNames[0]) == size_t(CommandId::Count));
+
+/*!
+    Returns the textual name of \a command, as used by version 1 of the protocol.
+*/
+const char *commandName(CommandId command)
+{
+    if (command >= CommandId::Count)
+        return CommandNames[0];
+    return CommandNames[int(command)];
+}
+
+/*!
+    Returns the id of the command called \a name, or CommandId::Invalid for unknown names.
+*/
+CommandId commandId(const QByteArray &name)
+{
+    static const QHash<QByteArray, CommandId> ids = [] {
+        QHash<QByteArray, CommandId> ids;
+        for (int i = 1; i < int(CommandId::Count); ++i)
+            ids.insert(QByteArray(CommandNames[i]), CommandId(i));
+        return ids;
+    }();
+    return ids.value(name, CommandId::Invalid);
+}
+
+} // namespace Protocol
+
+/*
+    The header of a version 2 packet: payload size, request id, command id and reserved flags.
+*/
+static const int HeaderSize = sizeof(quint32) + sizeof(quint32) + sizeof(quint16)
+    + sizeof(quint16);
+
+static void writeAll(QIODevice *device, const char *data, qint64 size)
+{
+    while (size > 0) {
+        const qint64 bytesWritten = device->write(data, size);
+        Q_ASSERT(bytesWritten >= 0);
+        if (bytesWritten < 0)
+            return;
+        data += bytesWritten;
+        size -= bytesWritten;
+    }
+}
+
 /*!
     Write a packet containing \a command and \a data to \a device.
 
@@ -93,4 +247,76 @@ bool receivePacket(QIODevice *device, QByteArray *command, QByteArray *data)
     return true;
 }
 
+/*!
+    Writes a packet with \a command, \a requestId and \a data to \a device, using the framing of
+    protocol \a version. The header and the payload are written separately, so the payload is
+    not copied into an intermediate packet.
+
+    \note Both client and server need to have the same endianness.
+*/
+void sendPacket(QIODevice *device, qint32 version, Protocol::CommandId command, quint32 requestId,
+    const QByteArray &data)
+{
+    if (version < Protocol::Version) {
+        const char *name = Protocol::commandName(command);
+        sendPacket(device, QByteArray::fromRawData(name, int(strlen(name))), data);
+        return;
+    }
+
+    const quint32 size = quint32(data.size());
+    const quint16 id = quint16(command);
+    const quint16 flags = 0;
+
+    char header[HeaderSize];
+    char *pos = header;
+    memcpy(pos, &size, sizeof(size));
+    pos += sizeof(size);
+    memcpy(pos, &requestId, sizeof(requestId));
+    pos += sizeof(requestId);
+    memcpy(pos, &id, sizeof(id));
+    pos += sizeof(id);
+    memcpy(pos, &flags, sizeof(flags));
+
+    writeAll(device, header, HeaderSize);
+    writeAll(device, data.constData(), data.size());
+}
+
+/*!
+    Reads a packet in the framing of protocol \a version from \a device into \a packet. The
+    payload is read in one piece and handed over as is.
+
+    Returns \c false if the packet in the device buffer is yet incomplete, \c true otherwise.
+
+    \note Both client and server need to have the same endianness.
+*/
+bool receivePacket(QIODevice *device, qint32 version, Packet *packet)
+{
+    if (version < Protocol::Version) {
+        QByteArray command;
+        if (!receivePacket(device, &command, &packet->data))
+            return false;
+        packet->command = Protocol::commandId(command);
+        packet->requestId = 0;
+        return true;
+    }
+
+    char header[HeaderSize];
+    if (device->peek(header, HeaderSize) < HeaderSize)
+        return false;
+
+    quint32 size;
+    quint16 id;
+    memcpy(&size, header, sizeof(size));
+    if (device->bytesAvailable() < qint64(HeaderSize) + size)
+        return false;
+
+    device->read(header, HeaderSize);
+    memcpy(&packet->requestId, header + sizeof(size), sizeof(packet->requestId));
+    memcpy(&id, header + sizeof(size) + sizeof(packet->requestId), sizeof(id));
+    packet->command = id < quint16(Protocol::CommandId::Count) ? Protocol::CommandId(id)
+        : Protocol::CommandId::Invalid;
+    packet->data = device->read(size);
+    return true;
+}
+
 } // namespace QInstaller
@@ -31,6 +31,8 @@
 
 #include "installer_global.h"
 
+#include <QByteArray>
+
 QT_FORWARD_DECLARE_CLASS(QIODevice)
 
 namespace QInstaller {
@@ -56,6 +58,10 @@ const char Destroy[] = "Destroy";
 const char Shutdown[] = "Shutdown";
 const char Authorize[] = "Authorize";
 const char Reply[] = "Reply";
+// Several method calls in one packet, answered with one reply holding all results.
+const char Batch[] = "Batch";
+// Sent by long running commands before their reply.
+const char Progress[] = "Progress";
 
 // QProcessWrapper
 const char QProcess[] = "QProcess";
@@ -162,12 +168,153 @@ const char QAbstractFileEngineWrite[] = "QAbstractFileEngine::write";
 const char QAbstractFileEngineSyncToDisk[] = "QAbstractFileEngine::syncToDisk";
 const char QAbstractFileEngineRenameOverwrite[] = "QAbstractFileEngine::renameOverwrite";
 const char QAbstractFileEngineFileTime[] = "QAbstractFileEngine::fileTime";
+const char QAbstractFileEngineAttachSharedMemory[] = "QAbstractFileEngine::attachSharedMemory";
+const char QAbstractFileEngineReadShared[] = "QAbstractFileEngine::readShared";
+const char QAbstractFileEngineWriteShared[] = "QAbstractFileEngine::writeShared";
+
+// Reads and writes of at least this many bytes go through a shared memory segment of
+// SharedMemorySize bytes, the socket then only carries offset and length.
+const qint64 DefaultSharedMemoryThreshold = 256 * 1024;
+const qint64 SharedMemorySize = 8 * 1024 * 1024;
+
+
+// RemoteFileOperations, bulk operations that the server runs on its own
+const char RemoteFileOperations[] = "RemoteFileOperations";
+const char RemoteFileOperationsExtractArchive[] = "RemoteFileOperations::extractArchive";
+const char RemoteFileOperationsCopyTree[] = "RemoteFileOperations::copyTree";
+const char RemoteFileOperationsRemoveTree[] = "RemoteFileOperations::removeTree";
+const char RemoteFileOperationsSetPermissions[] = "RemoteFileOperations::setPermissions";
+
+// Version 1 packets carry the command as text. Version 2 packets start with a fixed size header
+// holding the payload size, the request id and the command id. Connections start with version 1
+// and switch to the version agreed on while authorizing.
+const qint32 LegacyVersion = 1;
+const qint32 Version = 2;
+
+// Keep in sync with the command names in protocol.cpp. The values are part of the wire format,
+// reordering them needs a new protocol version.
+enum struct CommandId : quint16 {
+    Invalid,
+    Create,
+    Destroy,
+    Shutdown,
+    Authorize,
+    Reply,
+    Batch,
+    QProcessCloseWriteChannel,
+    QProcessExitCode,
+    QProcessExitStatus,
+    QProcessKill,
+    QProcessReadAll,
+    QProcessReadAllStandardOutput,
+    QProcessReadAllStandardError,
+    QProcessStartDetached,
+    QProcessSetWorkingDirectory,
+    QProcessSetEnvironment,
+    QProcessEnvironment,
+    QProcessStart3Arg,
+    QProcessStart2Arg,
+    QProcessState,
+    QProcessTerminate,
+    QProcessWaitForFinished,
+    QProcessWaitForStarted,
+    QProcessWorkingDirectory,
+    QProcessErrorString,
+    QProcessReadChannel,
+    QProcessSetReadChannel,
+    QProcessWrite,
+    QProcessProcessChannelMode,
+    QProcessSetProcessChannelMode,
+    QProcessSetNativeArguments,
+    GetQProcessSignals,
+    QSettingsAllKeys,
+    QSettingsBeginGroup,
+    QSettingsBeginWriteArray,
+    QSettingsBeginReadArray,
+    QSettingsChildGroups,
+    QSettingsChildKeys,
+    QSettingsClear,
+    QSettingsContains,
+    QSettingsEndArray,
+    QSettingsEndGroup,
+    QSettingsFallbacksEnabled,
+    QSettingsFileName,
+    QSettingsGroup,
+    QSettingsIsWritable,
+    QSettingsRemove,
+    QSettingsSetArrayIndex,
+    QSettingsSetFallbacksEnabled,
+    QSettingsStatus,
+    QSettingsSync,
+    QSettingsSetValue,
+    QSettingsValue,
+    QSettingsOrganizationName,
+    QSettingsApplicationName,
+    QAbstractFileEngineAtEnd,
+    QAbstractFileEngineCaseSensitive,
+    QAbstractFileEngineClose,
+    QAbstractFileEngineCopy,
+    QAbstractFileEngineEntryList,
+    QAbstractFileEngineError,
+    QAbstractFileEngineErrorString,
+    QAbstractFileEngineFileFlags,
+    QAbstractFileEngineFileName,
+    QAbstractFileEngineFlush,
+    QAbstractFileEngineHandle,
+    QAbstractFileEngineIsRelativePath,
+    QAbstractFileEngineIsSequential,
+    QAbstractFileEngineLink,
+    QAbstractFileEngineMkdir,
+    QAbstractFileEngineOpen,
+    QAbstractFileEngineOwner,
+    QAbstractFileEngineOwnerId,
+    QAbstractFileEnginePos,
+    QAbstractFileEngineRead,
+    QAbstractFileEngineReadLine,
+    QAbstractFileEngineRemove,
+    QAbstractFileEngineRename,
+    QAbstractFileEngineRmdir,
+    QAbstractFileEngineSeek,
+    QAbstractFileEngineSetFileName,
+    QAbstractFileEngineSetPermissions,
+    QAbstractFileEngineSetSize,
+    QAbstractFileEngineSize,
+    QAbstractFileEngineSupportsExtension,
+    QAbstractFileEngineExtension,
+    QAbstractFileEngineWrite,
+    QAbstractFileEngineSyncToDisk,
+    QAbstractFileEngineRenameOverwrite,
+    QAbstractFileEngineFileTime,
+    Progress,
+    RemoteFileOperationsExtractArchive,
+    RemoteFileOperationsCopyTree,
+    RemoteFileOperationsRemoveTree,
+    RemoteFileOperationsSetPermissions,
+    QAbstractFileEngineAttachSharedMemory,
+    QAbstractFileEngineReadShared,
+    QAbstractFileEngineWriteShared,
+    Count
+};
+
+INSTALLER_EXPORT const char *commandName(CommandId command);
+INSTALLER_EXPORT CommandId commandId(const QByteArray &name);
 
 } // namespace Protocol
 
+struct Packet
+{
+    Protocol::CommandId command = Protocol::CommandId::Invalid;
+    quint32 requestId = 0;
+    QByteArray data;
+};
+
 void INSTALLER_EXPORT sendPacket(QIODevice *device, const QByteArray &command, const QByteArray &data);
 bool INSTALLER_EXPORT receivePacket(QIODevice *device, QByteArray *command, QByteArray *data);
 
+void INSTALLER_EXPORT sendPacket(QIODevice *device, qint32 version, Protocol::CommandId command,
+    quint32 requestId, const QByteArray &data);
+bool INSTALLER_EXPORT receivePacket(QIODevice *device, qint32 version, Packet *packet);
+
 } // namespace QInstaller
 
 #endif // PROTOCOL_H
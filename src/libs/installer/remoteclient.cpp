@@ -78,6 +78,25 @@ void RemoteClient::setAuthorizationFallbackDisabled(bool disabled)
     d->setAuthorizationFallbackDisabled(disabled);
 }
 
+/*!
+    Returns the size from which file engine reads and writes are transferred through shared
+    memory instead of the socket. The default is Protocol::DefaultSharedMemoryThreshold.
+*/
+qint64 RemoteClient::sharedMemoryThreshold() const
+{
+    Q_D(const RemoteClient);
+    return d->m_sharedMemoryThreshold;
+}
+
+/*!
+    Sets the shared memory  threshold. A value of \c 0 disables the shared memory channel.
+*/
+void RemoteClient::setSharedMemoryThreshold(qint64 threshold)
+{
+    Q_D(RemoteClient);
+    d->m_sharedMemoryThreshold = threshold;
+}
+
 void RemoteClient::shutdown()
 {
     Q_D(RemoteClient);
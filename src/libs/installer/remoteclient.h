@@ -49,6 +49,9 @@ public:
               Protocol::StartAs startAs);
     void setAuthorizationFallbackDisabled(bool disabled);
 
+    qint64 sharedMemoryThreshold() const;
+    void setSharedMemoryThreshold(qint64 threshold);
+
     void shutdown();
     void destroy();
 
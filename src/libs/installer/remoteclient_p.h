@@ -60,6 +60,7 @@ public:
         , m_key(QLatin1String(Protocol::DefaultAuthorizationKey))
         , m_mode(Protocol::Mode::Debug)
         , m_authorizationFallbackDisabled(false)
+        , m_sharedMemoryThreshold(Protocol::DefaultSharedMemoryThreshold)
     {
         m_thread.setObjectName(QLatin1String("KeepAlive"));
     }
@@ -202,6 +203,7 @@ private:
     QThread m_thread;
     Protocol::Mode m_mode;
     bool m_authorizationFallbackDisabled;
+    qint64 m_sharedMemoryThreshold;
 };
 
 } // namespace QInstaller
@@ -31,7 +31,10 @@
 #include "protocol.h"
 #include "remoteclient.h"
 
+#include <QCoreApplication>
+#include <QDebug>
 #include <QRegExp>
+#include <QUuid>
 
 namespace QInstaller {
 
@@ -114,6 +117,8 @@ QString RemoteFileEngineIterator::currentFileName() const
 
 RemoteFileEngine::RemoteFileEngine()
     : RemoteObject(QLatin1String(Protocol::QAbstractFileEngine))
+    , m_sharedMemoryFailed(false)
+    , m_sharedMemoryPos(0)
 {
 }
 
@@ -168,8 +173,11 @@ bool RemoteFileEngine::caseSensitive() const
 */
 bool RemoteFileEngine::close()
 {
-    if (connectToServer())
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineClose));
+    if (connectToServer()) {
+        const bool closed = callRemoteMethod<bool>
+            (QString::fromLatin1(Protocol::QAbstractFileEngineClose));
+        return takeWriteErrors() && closed;
+    }
     return m_fileEngine.close();
 }
 
@@ -258,8 +266,11 @@ QString RemoteFileEngine::fileName(FileName file) const
 */
 bool RemoteFileEngine::flush()
 {
-    if (connectToServer())
-        return callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineFlush));
+    if (connectToServer()) {
+        const bool flushed = callRemoteMethod<bool>
+            (QString::fromLatin1(Protocol::QAbstractFileEngineFlush));
+        return takeWriteErrors() && flushed;
+    }
     return m_fileEngine.flush();
 }
 
@@ -469,6 +480,17 @@ bool RemoteFileEngine::supportsExtension(Extension extension) const
 qint64 RemoteFileEngine::read(char *data, qint64 maxlen)
 {
     if (connectToServer()) {
+        if (attachSharedMemory(maxlen)) {
+            // the call waits for all queued writes, so the whole segment is free afterwards
+            m_sharedMemoryPos = 0;
+            const qint64 result = callRemoteMethod<qint64>
+                (QString::fromLatin1(Protocol::QAbstractFileEngineReadShared),
+                qMin(maxlen, qint64(m_sharedMemory->size())));
+            if (result > 0)
+                memcpy(data, m_sharedMemory->constData(), result);
+            return result;
+        }
+
         QPair<qint64, QByteArray> result = callRemoteMethod<QPair<qint64, QByteArray> >
             (QString::fromLatin1(Protocol::QAbstractFileEngineRead), maxlen);
 
@@ -503,16 +525,107 @@ qint64 RemoteFileEngine::readLine(char *data, qint64 maxlen)
 
 /*!
     \reimp
+
+    Writes are sent to the server without waiting for the result. A failed write is reported
+    by the next call to flush() or close(), and makes subsequent writes fail.
 */
 qint64 RemoteFileEngine::write(const char *data, qint64 len)
 {
     if (connectToServer()) {
-        QByteArray ba(data, len);
-        return callRemoteMethod<qint64>(QString::fromLatin1(Protocol::QAbstractFileEngineWrite), ba);
+        if (hasDeferredErrors())
+            return -1;
+        if (attachSharedMemory(len))
+            return writeShared(data, len);
+        callRemoteMethodDeferred(QString::fromLatin1(Protocol::QAbstractFileEngineWrite), len,
+            QByteArray(data, len));
+        return len;
     }
     return m_fileEngine.write(data, len);
 }
 
+/*
+    Creates the shared memory segment used for reads and writes of \a size bytes and lets the
+    server attach to it. Returns \c false if \a size is below the threshold set on the remote
+    client, or if the segment cannot be used, in which case the data is sent through the socket.
+*/
+bool RemoteFileEngine::attachSharedMemory(qint64 size)
+{
+    const qint64 threshold = RemoteClient::instance().sharedMemoryThreshold();
+    if (m_sharedMemoryFailed || threshold <= 0 || size < threshold)
+        return false;
+    if (m_sharedMemory)
+        return true;
+
+    // only try once per engine, most files never get here at all
+    m_sharedMemoryFailed = true;
+    if (protocolVersion() < Protocol::Version)
+        return false;
+
+    QScopedPointer<QSharedMemory> memory(new QSharedMemory(QUuid::createUuid().toString()));
+    if (!memory->create(Protocol::SharedMemorySize)) {
+        qDebug() << "Cannot create shared memory:" << memory->errorString();
+        return false;
+    }
+    if (!callRemoteMethod<bool>(QString::fromLatin1(Protocol::QAbstractFileEngineAttachSharedMemory),
+        memory->key())) {
+        return false;
+    }
+
+    m_sharedMemory.swap(memory);
+    m_sharedMemoryFailed = false;
+    m_sharedMemoryPos = 0;
+    return true;
+}
+
+/*
+    Copies \a data into the shared memory segment and queues a write of \a len bytes from
+    there. The segment is filled front to back, once it is full all queued writes have to be
+    answered before it can be reused.
+*/
+qint64 RemoteFileEngine::writeShared(const char *data, qint64 len)
+{
+    const qint64 capacity = m_sharedMemory->size();
+    qint64 written = 0;
+    while (written < len) {
+        const qint64 chunk = qMin(len - written, capacity);
+        if (m_sharedMemoryPos + chunk > capacity) {
+            waitForDeferredCalls();
+            if (hasDeferredErrors())
+                return -1;
+            m_sharedMemoryPos = 0;
+        }
+
+        memcpy(static_cast<char *>(m_sharedMemory->data()) + m_sharedMemoryPos, data + written,
+            chunk);
+        callRemoteMethodDeferred(QString::fromLatin1(Protocol::QAbstractFileEngineWriteShared),
+            chunk, m_sharedMemoryPos, chunk);
+        m_sharedMemoryPos += chunk;
+        written += chunk;
+    }
+    return len;
+}
+
+/*
+    Returns \c true if all queued writes succeeded. Otherwise sets the error of the engine to the
+    one of the file on the server, so that QFile reports the failed writes on flush or close.
+*/
+bool RemoteFileEngine::takeWriteErrors()
+{
+    if (takeDeferredErrors().isEmpty())
+        return true;
+
+    QFile::FileError fileError = error();
+    QString message = errorString();
+    if (fileError == QFile::NoError)
+        fileError = QFile::WriteError;
+    if (message.isEmpty()) {
+        message = QCoreApplication::translate("RemoteFileEngine",
+            "Cannot write to file through the installer server.");
+    }
+    setError(fileError, message);
+    return false;
+}
+
 bool RemoteFileEngine::syncToDisk()
 {
     if (connectToServer())
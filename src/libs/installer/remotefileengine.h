@@ -31,6 +31,9 @@
 
 #include "remoteobject.h"
 
+#include <QScopedPointer>
+#include <QSharedMemory>
+
 #include <QtCore/private/qabstractfileengine_p.h>
 #include <QtCore/private/qfsfileengine_p.h>
 
@@ -98,8 +101,16 @@ public:
         ExtensionReturn *output = 0) Q_DECL_OVERRIDE;
     bool supportsExtension(Extension extension) const Q_DECL_OVERRIDE;
 
+private:
+    bool attachSharedMemory(qint64 size);
+    qint64 writeShared(const char *data, qint64 len);
+    bool takeWriteErrors();
+
 private:
     QFSFileEngine m_fileEngine;
+    QScopedPointer<QSharedMemory> m_sharedMemory;
+    bool m_sharedMemoryFailed;
+    qint64 m_sharedMemoryPos;
 };
 
 } // namespace QInstaller
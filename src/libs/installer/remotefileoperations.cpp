@@ -0,0 +1,211 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include "remotefileoperations.h"
+
+#include "protocol.h"
+
+namespace QInstaller {
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::RemoteFileOperations
+    \brief The RemoteFileOperations class runs file operations on whole archives and
+        directory trees in the privileged server process.
+
+    Going through RemoteFileEngine costs at least one round trip to the server per file.
+    The operations of this class send one command instead, the server does the file I/O
+    itself and only sends progress and the result back.
+*/
+
+RemoteFileOperations::RemoteFileOperations()
+    : RemoteObject(QLatin1String(Protocol::RemoteFileOperations))
+{
+}
+
+RemoteFileOperations::~RemoteFileOperations()
+{
+}
+
+/*!
+    Returns \c true if the operations can be run by the server, otherwise returns \c false.
+    Servers speaking the legacy protocol do not know the operations, the files need to be
+    handled one by one through RemoteFileEngine then.
+*/
+bool RemoteFileOperations::isAvailable()
+{
+    return connectToServer() && protocolVersion() >= Protocol::Version;
+}
+
+/*!
+    Extracts \a archive to \a targetDirectory. Existing files are renamed before they are
+    overwritten, see backupFiles(). The \a progress callback is called with the number of bytes
+    extracted so far and the total size. Returns \c true on success, otherwise \c false.
+
+    \note The extraction cannot be canceled once it started.
+*/
+bool RemoteFileOperations::extractArchive(const QString &archive, const QString &targetDirectory,
+    const ProgressCallback &progress)
+{
+    m_extractedFiles.clear();
+    m_backupFiles.clear();
+    if (!isAvailable()) {
+        m_errorString = tr("Not connected to an installer server supporting bulk operations.");
+        return false;
+    }
+
+    if (progress) {
+        setProgressHandler([&progress](const QByteArray &data) {
+            QDataStream stream(data);
+            quint64 completed;
+            quint64 total;
+            stream >> completed >> total;
+            progress(completed, total);
+        });
+    }
+
+    QVariantMap reply;
+    try {
+        reply = callRemoteMethod<QVariantMap>(
+            QString::fromLatin1(Protocol::RemoteFileOperationsExtractArchive), archive,
+            targetDirectory);
+    } catch (const Error &error) {
+        reply.insert(QLatin1String("error"), error.message());
+    }
+    setProgressHandler(ProgressHandler());
+
+    m_extractedFiles = reply.value(QLatin1String("files")).toStringList();
+    const QStringList backups = reply.value(QLatin1String("backups")).toStringList();
+    for (int i = 0; i + 1 < backups.count(); i += 2)
+        m_backupFiles.append(qMakePair(backups.at(i), backups.at(i + 1)));
+    return checkReply(reply);
+}
+
+/*!
+    Returns the files written by the last call to extractArchive(), in extraction order.
+*/
+QStringList RemoteFileOperations::extractedFiles() const
+{
+    return m_extractedFiles;
+}
+
+/*!
+    Returns pairs of existing file names and the names they were renamed to by the last call
+    to extractArchive().
+*/
+RemoteFileOperations::BackupFiles RemoteFileOperations::backupFiles() const
+{
+    return m_backupFiles;
+}
+
+/*!
+    Copies the contents of \a sourceDirectory recursively to \a targetDirectory. Returns \c true
+    on success, otherwise \c false.
+*/
+bool RemoteFileOperations::copyTree(const QString &sourceDirectory, const QString &targetDirectory)
+{
+    if (!isAvailable()) {
+        m_errorString = tr("Not connected to an installer server supporting bulk operations.");
+        return false;
+    }
+
+    QVariantMap reply;
+    try {
+        reply = callRemoteMethod<QVariantMap>(
+            QString::fromLatin1(Protocol::RemoteFileOperationsCopyTree), sourceDirectory,
+            targetDirectory);
+    } catch (const Error &error) {
+        reply.insert(QLatin1String("error"), error.message());
+    }
+    return checkReply(reply);
+}
+
+/*!
+    Removes \a path and everything below it. Returns \c true on success, otherwise \c false.
+*/
+bool RemoteFileOperations::removeTree(const QString &path)
+{
+    if (!isAvailable()) {
+        m_errorString = tr("Not connected to an installer server supporting bulk operations.");
+        return false;
+    }
+
+    QVariantMap reply;
+    try {
+        reply = callRemoteMethod<QVariantMap>(
+            QString::fromLatin1(Protocol::RemoteFileOperationsRemoveTree), path);
+    } catch (const Error &error) {
+        reply.insert(QLatin1String("error"), error.message());
+    }
+    return checkReply(reply);
+}
+
+/*!
+    Sets the permissions of all \a files in one go. Returns \c true if the permissions of all
+    files could be set, otherwise \c false.
+*/
+bool RemoteFileOperations::setPermissions(
+    const QList<QPair<QString, QFileDevice::Permissions> > &files)
+{
+    if (!isAvailable()) {
+        m_errorString = tr("Not connected to an installer server supporting bulk operations.");
+        return false;
+    }
+
+    QStringList paths;
+    QList<qint32> permissions;
+    for (int i = 0; i < files.count(); ++i) {
+        paths.append(files.at(i).first);
+        permissions.append(qint32(files.at(i).second));
+    }
+
+    QVariantMap reply;
+    try {
+        reply = callRemoteMethod<QVariantMap>(
+            QString::fromLatin1(Protocol::RemoteFileOperationsSetPermissions), paths, permissions);
+    } catch (const Error &error) {
+        reply.insert(QLatin1String("error"), error.message());
+    }
+    return checkReply(reply);
+}
+
+/*!
+    Returns a human readable description of the last error that occurred.
+*/
+QString RemoteFileOperations::errorString() const
+{
+    return m_errorString;
+}
+
+bool RemoteFileOperations::checkReply(const QVariantMap &reply)
+{
+    m_errorString = reply.value(QLatin1String("error")).toString();
+    return m_errorString.isEmpty();
+}
+
+} // namespace QInstaller
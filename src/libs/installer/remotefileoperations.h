@@ -0,0 +1,77 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#ifndef REMOTEFILEOPERATIONS_H
+#define REMOTEFILEOPERATIONS_H
+
+#include "remoteobject.h"
+
+#include <QFileDevice>
+#include <QPair>
+
+#include <functional>
+
+namespace QInstaller {
+
+class INSTALLER_EXPORT RemoteFileOperations : public RemoteObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(RemoteFileOperations)
+
+public:
+    typedef std::function<void(quint64 completed, quint64 total)> ProgressCallback;
+    typedef QList<QPair<QString, QString> > BackupFiles;
+
+    RemoteFileOperations();
+    ~RemoteFileOperations();
+
+    bool isAvailable();
+
+    bool extractArchive(const QString &archive, const QString &targetDirectory,
+        const ProgressCallback &progress = ProgressCallback());
+    QStringList extractedFiles() const;
+    BackupFiles backupFiles() const;
+
+    bool copyTree(const QString &sourceDirectory, const QString &targetDirectory);
+    bool removeTree(const QString &path);
+    bool setPermissions(const QList<QPair<QString, QFileDevice::Permissions> > &files);
+
+    QString errorString() const;
+
+private:
+    bool checkReply(const QVariantMap &reply);
+
+private:
+    QString m_errorString;
+    QStringList m_extractedFiles;
+    BackupFiles m_backupFiles;
+};
+
+} // namespace QInstaller
+
+#endif // REMOTEFILEOPERATIONS_H
@@ -32,16 +32,27 @@
 #include "remoteclient.h"
 
 #include <QCoreApplication>
+#include <QDebug>
 #include <QElapsedTimer>
 #include <QThread>
 
 namespace QInstaller {
 
+// queued calls are sent as one batch once either limit is reached
+static const int MaxQueuedCalls = 256;
+static const qint64 MaxQueuedBytes = 1024 * 1024;
+// batches sent without waiting for their reply
+static const int MaxPendingBatches = 4;
+
 RemoteObject::RemoteObject(const QString &wrappedType, QObject *parent)
     : QObject(parent)
     , dummy(nullptr)
     , m_type(wrappedType)
     , m_socket(nullptr)
+    , m_protocolVersion(Protocol::LegacyVersion)
+    , m_requestId(0)
+    , m_queuedBytes(0)
+    , m_nextBatchId(0)
 {
     Q_ASSERT_X(!m_type.isEmpty(), Q_FUNC_INFO, "The wrapped Qt type needs to be passed as "
         "argument and cannot be empty.");
@@ -51,6 +62,14 @@ RemoteObject::~RemoteObject()
 {
     if (m_socket) {
         if (QThread::currentThread() == m_socket->thread()) {
+            try {
+                waitForDeferredCalls();
+            } catch (const Error &error) {
+                qWarning() << "Cannot finish deferred calls:" << error.message();
+            }
+            foreach (const QString &command, m_deferredErrors)
+                qWarning() << "Deferred call failed:" << command;
+
             if (m_type != QLatin1String("RemoteClientPrivate"))
                 writeData(QLatin1String(Protocol::Destroy), m_type, dummy, dummy);
         } else {
@@ -68,12 +87,34 @@ bool RemoteObject::authorize()
     if (m_socket)
         delete m_socket;
 
+    m_queuedCalls.clear();
+    m_queuedBytes = 0;
+    m_pendingBatches.clear();
+
     m_socket = new QLocalSocket;
     m_socket->connectToServer(RemoteClient::instance().socketName());
+    m_protocolVersion = Protocol::LegacyVersion;
 
     if (m_socket->waitForConnected()) {
-        bool authorized = callRemoteMethod<bool>(QString::fromLatin1(Protocol::Authorize),
-                                                 RemoteClient::instance().authorizationKey());
+        // Announce the protocol version next to the key. The reply holds the version to use
+        // from now on, servers that only know the legacy protocol send back just the result.
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << RemoteClient::instance().authorizationKey() << Protocol::Version;
+        sendPacket(m_socket, m_protocolVersion, Protocol::CommandId::Authorize, ++m_requestId,
+            data);
+        m_socket->flush();
+        while (m_socket->bytesToWrite())
+            m_socket->waitForBytesWritten();
+
+        QByteArray reply;
+        receiveReply(QLatin1String(Protocol::Authorize), m_requestId, &reply);
+        QDataStream in(&reply, QIODevice::ReadOnly);
+        bool authorized;
+        in >> authorized;
+        if (!in.atEnd())
+            in >> m_protocolVersion;
+
         if (authorized)
             return true;
     }
@@ -99,7 +140,7 @@ bool RemoteObject::connectToServer(const QVariantList &arguments)
     foreach (const QVariant &arg, arguments)
         out << arg;
 
-    sendPacket(m_socket, Protocol::Create, data);
+    sendPacket(m_socket, m_protocolVersion, Protocol::CommandId::Create, ++m_requestId, data);
     m_socket->flush();
 
     return true;
@@ -119,4 +160,160 @@ void RemoteObject::callRemoteMethod(const QString &name)
     writeData(name, dummy, dummy, dummy);
 }
 
+/*!
+    Sets the \a handler that receives the data of progress packets sent by the server before
+    the reply of a long running command. Pass an empty handler to ignore them again.
+*/
+void RemoteObject::setProgressHandler(const ProgressHandler &handler)
+{
+    m_progressHandler = handler;
+}
+
+/*!
+    Sends all calls queued with callRemoteMethodDeferred() and waits for their replies.
+    Failed calls can be retrieved with takeDeferredErrors() afterwards.
+*/
+void RemoteObject::waitForDeferredCalls()
+{
+    if (!m_socket)
+        return;
+
+    sendQueuedCalls();
+    while (m_socket->bytesToWrite())
+        m_socket->waitForBytesWritten();
+    while (!m_pendingBatches.isEmpty())
+        receiveBatchReply();
+}
+
+/*!
+    Returns the names of the deferred calls whose reply did not match the expected one, and
+    clears the list.
+*/
+QStringList RemoteObject::takeDeferredErrors()
+{
+    QStringList errors;
+    errors.swap(m_deferredErrors);
+    return errors;
+}
+
+/*
+    Queues the call to \a command with \a data instead of sending it immediately. The reply of
+    the server is compared to \a expectedReply once it arrives.
+*/
+void RemoteObject::queueCall(const QByteArray &command, const QByteArray &data,
+    const QByteArray &expectedReply)
+{
+    QueuedCall call;
+    call.command = command;
+    call.data = data;
+    call.expectedReply = expectedReply;
+    m_queuedCalls.append(call);
+    m_queuedBytes += data.size();
+
+    if (m_queuedCalls.count() >= MaxQueuedCalls || m_queuedBytes >= MaxQueuedBytes)
+        sendQueuedCalls();
+}
+
+/*
+    Sends the queued calls as one batch. The reply is read before the next synchronous call
+    returns, or as soon as too many batches wait for their reply. Servers speaking the legacy
+    protocol do not know batches, the calls are sent one by one and waited for then.
+*/
+void RemoteObject::sendQueuedCalls() const
+{
+    if (m_queuedCalls.isEmpty())
+        return;
+
+    if (m_protocolVersion < Protocol::Version) {
+        QList<QueuedCall> calls;
+        calls.swap(m_queuedCalls);
+        m_queuedBytes = 0;
+        foreach (const QueuedCall &call, calls) {
+            sendPacket(m_socket, m_protocolVersion, Protocol::commandId(call.command),
+                ++m_requestId, call.data);
+            m_socket->flush();
+            while (m_socket->bytesToWrite())
+                m_socket->waitForBytesWritten();
+
+            QByteArray reply;
+            receiveReply(QString::fromLatin1(call.command), m_requestId, &reply);
+            if (reply != call.expectedReply)
+                m_deferredErrors.append(QString::fromLatin1(call.command));
+        }
+        return;
+    }
+
+    PendingBatch batch;
+    batch.id = m_nextBatchId++;
+    batch.requestId = ++m_requestId;
+    batch.calls.swap(m_queuedCalls);
+    m_queuedBytes = 0;
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out << batch.id << qint32(batch.calls.count());
+    foreach (const QueuedCall &call, batch.calls) {
+        out << quint16(Protocol::commandId(call.command)) << quint32(call.data.size());
+        out.writeRawData(call.data.constData(), call.data.size());
+    }
+
+    sendPacket(m_socket, m_protocolVersion, Protocol::CommandId::Batch, batch.requestId, data);
+    m_socket->flush();
+    m_pendingBatches.enqueue(batch);
+
+    while (m_pendingBatches.count() > MaxPendingBatches)
+        receiveBatchReply();
+}
+
+/*
+    Reads the reply of the oldest batch sent and records the calls that did not return the
+    expected result.
+*/
+void RemoteObject::receiveBatchReply() const
+{
+    const PendingBatch batch = m_pendingBatches.dequeue();
+
+    QByteArray data;
+    receiveReply(QLatin1String(Protocol::Batch), batch.requestId, &data);
+
+    QDataStream stream(&data, QIODevice::ReadOnly);
+    QPair<qint32, QList<QByteArray> > replies;
+    stream >> replies;
+    Q_ASSERT(stream.status() == QDataStream::Ok);
+    Q_ASSERT(replies.first == batch.id);
+    Q_ASSERT(replies.second.count() == batch.calls.count());
+
+    for (int i = 0; i < batch.calls.count(); ++i) {
+        const QueuedCall &call = batch.calls.at(i);
+        if (replies.second.value(i) != call.expectedReply)
+            m_deferredErrors.append(QString::fromLatin1(call.command));
+    }
+}
+
+/*
+    Reads the next reply packet into \a data. Throws Error if the socket fails before the
+    reply for the call to \a name, sent with \a requestId, is complete.
+*/
+void RemoteObject::receiveReply(const QString &name, quint32 requestId, QByteArray *data) const
+{
+    Packet packet;
+    forever {
+        while (!receivePacket(m_socket, m_protocolVersion, &packet)) {
+            if (!m_socket->waitForReadyRead(-1)) {
+                throw Error(tr("Cannot read all data after sending command: %1. "
+                    "Bytes expected: %2, Bytes received: %3. Error: %4").arg(name).arg(0)
+                    .arg(m_socket->bytesAvailable()).arg(m_socket->errorString()));
+            }
+        }
+        if (packet.command != Protocol::CommandId::Progress)
+            break;
+        if (m_progressHandler)
+            m_progressHandler(packet.data);
+    }
+    Q_ASSERT(packet.command == Protocol::CommandId::Reply);
+    Q_ASSERT(m_protocolVersion < Protocol::Version || packet.requestId == requestId);
+    Q_UNUSED(requestId)
+    *data = packet.data;
+}
+
 } // namespace QInstaller
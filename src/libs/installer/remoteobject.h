@@ -37,6 +37,10 @@
 #include <QDataStream>
 #include <QObject>
 #include <QLocalSocket>
+#include <QQueue>
+#include <QStringList>
+
+#include <functional>
 
 namespace QInstaller {
 
@@ -89,17 +93,12 @@ public:
         while (m_socket->bytesToWrite())
             m_socket->waitForBytesWritten();
 
-        QByteArray command;
-        QByteArray data;
-        while (!receivePacket(m_socket, &command, &data)) {
-            if (!m_socket->waitForReadyRead(-1)) {
-                throw Error(tr("Cannot read all data after sending command: %1. "
-                    "Bytes expected: %2, Bytes received: %3. Error: %4").arg(name).arg(0)
-                    .arg(m_socket->bytesAvailable()).arg(m_socket->errorString()));
-            }
-        }
+        // replies arrive in request order, the ones of queued calls come first
+        while (!m_pendingBatches.isEmpty())
+            receiveBatchReply();
 
-        Q_ASSERT(command == Protocol::Reply);
+        QByteArray data;
+        receiveReply(name, m_requestId, &data);
 
         QDataStream stream(&data, QIODevice::ReadOnly);
 
@@ -110,10 +109,43 @@ public:
         return result;
     }
 
+    template<typename R, typename T1>
+    void callRemoteMethodDeferred(const QString &name, const R &expected, const T1 &arg)
+    {
+        callRemoteMethodDeferred(name, expected, arg, dummy);
+    }
+
+    template<typename R, typename T1, typename T2>
+    void callRemoteMethodDeferred(const QString &name, const R &expected, const T1 &arg,
+        const T2 &arg2)
+    {
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        if (isValueType(arg))
+            out << arg;
+        if (isValueType(arg2))
+            out << arg2;
+
+        QByteArray reply;
+        QDataStream replyStream(&reply, QIODevice::WriteOnly);
+        replyStream << expected;
+
+        queueCall(name.toLatin1(), data, reply);
+    }
+
+    void waitForDeferredCalls();
+    bool hasDeferredErrors() const { return !m_deferredErrors.isEmpty(); }
+    QStringList takeDeferredErrors();
+
 protected:
     bool authorize();
     bool connectToServer(const QVariantList &arguments = QVariantList());
 
+    qint32 protocolVersion() const { return m_protocolVersion; }
+
+    typedef std::function<void(const QByteArray &data)> ProgressHandler;
+    void setProgressHandler(const ProgressHandler &handler);
+
     // Use this structure to allow derived classes to manipulate the template
     // function signature of the callRemoteMethod templates, since most of the
     // generated functions will differ in return type rather given arguments.
@@ -136,6 +168,8 @@ private:
     template<typename T1, typename T2, typename T3>
     void writeData(const QString &name, const T1 &arg, const T2 &arg2, const T3 &arg3) const
     {
+        sendQueuedCalls();
+
         QByteArray data;
         QDataStream out(&data, QIODevice::WriteOnly);
 
@@ -146,13 +180,41 @@ private:
         if (isValueType(arg3))
             out << arg3;
 
-        sendPacket(m_socket, name.toLatin1(), data);
+        const Protocol::CommandId command = Protocol::commandId(name.toLatin1());
+        Q_ASSERT_X(command != Protocol::CommandId::Invalid, Q_FUNC_INFO, "Unknown command.");
+        sendPacket(m_socket, m_protocolVersion, command, ++m_requestId, data);
         m_socket->flush();
     }
 
+    struct QueuedCall {
+        QByteArray command;
+        QByteArray data;
+        QByteArray expectedReply;
+    };
+    struct PendingBatch {
+        qint32 id;
+        quint32 requestId;
+        QList<QueuedCall> calls;
+    };
+
+    void queueCall(const QByteArray &command, const QByteArray &data,
+        const QByteArray &expectedReply);
+    void sendQueuedCalls() const;
+    void receiveBatchReply() const;
+    void receiveReply(const QString &name, quint32 requestId, QByteArray *data) const;
+
 private:
     QString m_type;
     QLocalSocket *m_socket;
+    mutable qint32 m_protocolVersion;
+    mutable quint32 m_requestId;
+
+    mutable QList<QueuedCall> m_queuedCalls;
+    mutable qint64 m_queuedBytes;
+    mutable QQueue<PendingBatch> m_pendingBatches;
+    mutable qint32 m_nextBatchId;
+    mutable QStringList m_deferredErrors;
+    ProgressHandler m_progressHandler;
 };
 
 } // namespace QInstaller
@@ -29,6 +29,8 @@
 #include "remoteserverconnection.h"
 
 #include "errors.h"
+#include "fileutils.h"
+#include "lib7z_facade.h"
 #include "protocol.h"
 #include "remoteserverconnection_p.h"
 #include "utils.h"
@@ -36,7 +38,12 @@
 
 #include <QCoreApplication>
 #include <QDataStream>
+#include <QEventLoop>
+#include <QFutureWatcher>
 #include <QLocalSocket>
+#include <QSharedMemory>
+#include <QTimer>
+#include <QtConcurrent>
 
 namespace QInstaller {
 
@@ -46,8 +53,11 @@ RemoteServerConnection::RemoteServerConnection(qintptr socketDescriptor, const Q
     , m_socketDescriptor(socketDescriptor)
     , m_process(nullptr)
     , m_engine(nullptr)
+    , m_sharedMemory(nullptr)
     , m_authorizationKey(key)
     , m_signalReceiver(nullptr)
+    , m_protocolVersion(Protocol::LegacyVersion)
+    , m_requestId(0)
 {
     setObjectName(QString::fromLatin1("RemoteServerConnection(%1)").arg(socketDescriptor));
 }
@@ -71,43 +81,52 @@ void RemoteServerConnection::run()
 
     bool authorized = false;
     while (socket.state() == QLocalSocket::ConnectedState) {
-        QByteArray cmd;
-        QByteArray data;
-
-        if (!receivePacket(&socket, &cmd, &data)) {
+        Packet packet;
+        if (!receivePacket(&socket, m_protocolVersion, &packet)) {
             socket.waitForReadyRead(250);
             continue;
         }
 
-        const QString command = QString::fromLatin1(cmd);
+        const Protocol::CommandId command = packet.command;
+        m_requestId = packet.requestId;
         QBuffer buf;
-        buf.setBuffer(&data);
+        buf.setBuffer(&packet.data);
         buf.open(QIODevice::ReadOnly);
         QDataStream stream;
         stream.setDevice(&buf);
         StreamChecker streamChecker(&stream);
 
-        if (authorized && command == QLatin1String(Protocol::Shutdown)) {
+        if (authorized && command == Protocol::CommandId::Shutdown) {
             authorized = false;
             sendData(&socket, true);
             socket.flush();
             socket.close();
             emit shutdownRequested();
             return;
-        } else if (command == QLatin1String(Protocol::Authorize)) {
+        } else if (command == Protocol::CommandId::Authorize) {
             QString key;
             stream >> key;
-            sendData(&socket, (authorized = (key == m_authorizationKey)));
+            authorized = (key == m_authorizationKey);
+            if (stream.atEnd()) {
+                sendData(&socket, authorized);
+            } else {
+                // the client announced the highest protocol version it supports
+                qint32 version;
+                stream >> version;
+                version = qBound(Protocol::LegacyVersion, version, Protocol::Version);
+                sendData(&socket, qMakePair(authorized, version));
+                m_protocolVersion = version;
+            }
             socket.flush();
             if (!authorized) {
                 socket.close();
                 return;
             }
         } else if (authorized) {
-            if (command.isEmpty())
+            if (command == Protocol::CommandId::Invalid)
                 continue;
 
-            if (command == QLatin1String(Protocol::Create)) {
+            if (command == Protocol::CommandId::Create) {
                 QString type;
                 stream >> type;
                 if (type == QLatin1String(Protocol::QSettings)) {
@@ -134,11 +153,13 @@ void RemoteServerConnection::run()
                     if (m_engine)
                         delete m_engine;
                     m_engine = new QFSFileEngine;
+                    delete m_sharedMemory;
+                    m_sharedMemory = nullptr;
                 }
                 continue;
             }
 
-            if (command == QLatin1String(Protocol::Destroy)) {
+            if (command == Protocol::CommandId::Destroy) {
                 QString type;
                 stream >> type;
                 if (type == QLatin1String(Protocol::QSettings)) {
@@ -150,11 +171,13 @@ void RemoteServerConnection::run()
                 } else if (type == QLatin1String(Protocol::QAbstractFileEngine)) {
                     delete m_engine;
                     m_engine = nullptr;
+                    delete m_sharedMemory;
+                    m_sharedMemory = nullptr;
                 }
                 return;
             }
 
-            if (command == QLatin1String(Protocol::GetQProcessSignals)) {
+            if (command == Protocol::CommandId::GetQProcessSignals) {
                 if (m_signalReceiver) {
                     QMutexLocker _(&m_signalReceiver->m_lock);
                     sendData(&socket, m_signalReceiver->m_receivedSignals);
@@ -164,25 +187,97 @@ void RemoteServerConnection::run()
                 continue;
             }
 
-            if (command.startsWith(QLatin1String(Protocol::QProcess))) {
-                handleQProcess(&socket, command, stream);
-            } else if (command.startsWith(QLatin1String(Protocol::QSettings))) {
-                handleQSettings(&socket, command, stream, settings.data());
-            } else if (command.startsWith(QLatin1String(Protocol::QAbstractFileEngine))) {
-                handleQFSFileEngine(&socket, command, stream);
-            } else {
-                qDebug() << "Unknown command:" << command;
-            }
+            if (command == Protocol::CommandId::Batch)
+                handleBatch(&socket, packet.data, stream, settings.data());
+            else
+                handleCommand(&socket, command, stream, settings.data());
             socket.flush();
         } else {
             // authorization failed, connection not wanted
             socket.close();
-            qDebug() << "Unknown command:" << command;
+            qDebug() << "Unknown command:" << Protocol::commandName(command);
             return;
         }
     }
 }
 
+void RemoteServerConnection::handleCommand(QIODevice *device, Protocol::CommandId command,
+    QDataStream &data, PermissionSettings *settings)
+{
+    if (command >= Protocol::CommandId::QProcessCloseWriteChannel
+        && command <= Protocol::CommandId::QProcessSetNativeArguments) {
+        handleQProcess(device, command, data);
+    } else if (command >= Protocol::CommandId::QSettingsAllKeys
+        && command <= Protocol::CommandId::QSettingsApplicationName) {
+        handleQSettings(device, command, data, settings);
+    } else if (command >= Protocol::CommandId::QAbstractFileEngineAtEnd
+        && command <= Protocol::CommandId::QAbstractFileEngineFileTime) {
+        handleQFSFileEngine(device, command, data);
+    } else if (command >= Protocol::CommandId::RemoteFileOperationsExtractArchive
+        && command <= Protocol::CommandId::RemoteFileOperationsSetPermissions) {
+        handleRemoteFileOperations(device, command, data);
+    } else if (command >= Protocol::CommandId::QAbstractFileEngineAttachSharedMemory
+        && command <= Protocol::CommandId::QAbstractFileEngineWriteShared) {
+        handleQFSFileEngine(device, command, data);
+    } else {
+        qDebug() << "Unknown command:" << Protocol::commandName(command);
+    }
+}
+
+void RemoteServerConnection::handleBatch(QIODevice *socket, const QByteArray &packet,
+    QDataStream &data, PermissionSettings *settings)
+{
+    qint32 id;
+    qint32 count;
+    data >> id >> count;
+
+    // run every call against a buffer and send all replies back at once
+    QList<QByteArray> replies;
+    for (qint32 i = 0; i < count && data.status() == QDataStream::Ok; ++i) {
+        // the arguments are used in place, without copying them out of the packet
+        quint16 cmd;
+        quint32 size;
+        data >> cmd >> size;
+        const qint64 pos = data.device()->pos();
+        if (pos + size > packet.size()) {
+            data.setStatus(QDataStream::ReadPastEnd);
+            break;
+        }
+        const Protocol::CommandId command = Protocol::CommandId(cmd);
+        const QByteArray arguments = QByteArray::fromRawData(packet.constData() + pos, int(size));
+        data.skipRawData(int(size));
+
+        QBuffer reply;
+        reply.open(QIODevice::ReadWrite);
+        {
+            QDataStream stream(arguments);
+            StreamChecker streamChecker(&stream);
+            handleCommand(&reply, command, stream, settings);
+        }
+
+        // long running commands send progress first, only the reply is of interest here
+        Packet replyPacket;
+        reply.seek(0);
+        while (receivePacket(&reply, m_protocolVersion, &replyPacket)
+            && replyPacket.command == Protocol::CommandId::Progress) {
+        }
+        replies.append(replyPacket.command == Protocol::CommandId::Reply ? replyPacket.data
+            : QByteArray());
+    }
+    sendData(socket, qMakePair(id, replies));
+}
+
+void RemoteServerConnection::sendProgress(QIODevice *device, quint64 completed, quint64 total)
+{
+    QByteArray progress;
+    QDataStream stream(&progress, QIODevice::WriteOnly);
+    stream << completed << total;
+
+    sendPacket(device, m_protocolVersion, Protocol::CommandId::Progress, m_requestId, progress);
+    if (QLocalSocket *socket = qobject_cast<QLocalSocket *>(device))
+        socket->flush();
+}
+
 template <typename T>
 void RemoteServerConnection::sendData(QIODevice *device, const T &data)
 {
@@ -190,26 +285,27 @@ void RemoteServerConnection::sendData(QIODevice *device, const T &data)
     QDataStream returnStream(&result, QIODevice::WriteOnly);
     returnStream << data;
 
-    sendPacket(device, Protocol::Reply, result);
+    sendPacket(device, m_protocolVersion, Protocol::CommandId::Reply, m_requestId, result);
 }
 
-void RemoteServerConnection::handleQProcess(QIODevice *socket, const QString &command, QDataStream &data)
+void RemoteServerConnection::handleQProcess(QIODevice *socket, Protocol::CommandId command,
+    QDataStream &data)
 {
-    if (command == QLatin1String(Protocol::QProcessCloseWriteChannel)) {
+    if (command == Protocol::CommandId::QProcessCloseWriteChannel) {
         m_process->closeWriteChannel();
-    } else if (command == QLatin1String(Protocol::QProcessExitCode)) {
+    } else if (command == Protocol::CommandId::QProcessExitCode) {
         sendData(socket, m_process->exitCode());
-    } else if (command == QLatin1String(Protocol::QProcessExitStatus)) {
+    } else if (command == Protocol::CommandId::QProcessExitStatus) {
         sendData(socket, static_cast<qint32> (m_process->exitStatus()));
-    } else if (command == QLatin1String(Protocol::QProcessKill)) {
+    } else if (command == Protocol::CommandId::QProcessKill) {
         m_process->kill();
-    } else if (command == QLatin1String(Protocol::QProcessReadAll)) {
+    } else if (command == Protocol::CommandId::QProcessReadAll) {
         sendData(socket, m_process->readAll());
-    } else if (command == QLatin1String(Protocol::QProcessReadAllStandardOutput)) {
+    } else if (command == Protocol::CommandId::QProcessReadAllStandardOutput) {
         sendData(socket, m_process->readAllStandardOutput());
-    } else if (command == QLatin1String(Protocol::QProcessReadAllStandardError)) {
+    } else if (command == Protocol::CommandId::QProcessReadAllStandardError) {
         sendData(socket, m_process->readAllStandardError());
-    } else if (command == QLatin1String(Protocol::QProcessStartDetached)) {
+    } else if (command == Protocol::CommandId::QProcessStartDetached) {
         QString program;
         QStringList arguments;
         QString workingDirectory;
@@ -220,17 +316,17 @@ void RemoteServerConnection::handleQProcess(QIODevice *socket, const QString &co
         qint64 pid = -1;
         bool success = QInstaller::startDetached(program, arguments, workingDirectory, &pid);
         sendData(socket, qMakePair< bool, qint64>(success, pid));
-    } else if (command == QLatin1String(Protocol::QProcessSetWorkingDirectory)) {
+    } else if (command == Protocol::CommandId::QProcessSetWorkingDirectory) {
         QString dir;
         data >> dir;
         m_process->setWorkingDirectory(dir);
-    } else if (command == QLatin1String(Protocol::QProcessSetEnvironment)) {
+    } else if (command == Protocol::CommandId::QProcessSetEnvironment) {
         QStringList env;
         data >> env;
         m_process->setEnvironment(env);
-    } else if (command == QLatin1String(Protocol::QProcessEnvironment)) {
+    } else if (command == Protocol::CommandId::QProcessEnvironment) {
         sendData(socket, m_process->environment());
-    } else if (command == QLatin1String(Protocol::QProcessStart3Arg)) {
+    } else if (command == Protocol::CommandId::QProcessStart3Arg) {
         QString program;
         QStringList arguments;
         qint32 mode;
@@ -238,265 +334,395 @@ void RemoteServerConnection::handleQProcess(QIODevice *socket, const QString &co
         data >> arguments;
         data >> mode;
         m_process->start(program, arguments, static_cast<QIODevice::OpenMode> (mode));
-    } else if (command == QLatin1String(Protocol::QProcessStart2Arg)) {
+    } else if (command == Protocol::CommandId::QProcessStart2Arg) {
         QString program;
         qint32 mode;
         data >> program;
         data >> mode;
         m_process->start(program, static_cast<QIODevice::OpenMode> (mode));
-    } else if (command == QLatin1String(Protocol::QProcessState)) {
+    } else if (command == Protocol::CommandId::QProcessState) {
         sendData(socket, static_cast<qint32> (m_process->state()));
-    } else if (command == QLatin1String(Protocol::QProcessTerminate)) {
+    } else if (command == Protocol::CommandId::QProcessTerminate) {
         m_process->terminate();
-    } else if (command == QLatin1String(Protocol::QProcessWaitForFinished)) {
+    } else if (command == Protocol::CommandId::QProcessWaitForFinished) {
         qint32 msecs;
         data >> msecs;
         sendData(socket, m_process->waitForFinished(msecs));
-    } else if (command == QLatin1String(Protocol::QProcessWaitForStarted)) {
+    } else if (command == Protocol::CommandId::QProcessWaitForStarted) {
         qint32 msecs;
         data >> msecs;
         sendData(socket, m_process->waitForStarted(msecs));
-    } else if (command == QLatin1String(Protocol::QProcessWorkingDirectory)) {
+    } else if (command == Protocol::CommandId::QProcessWorkingDirectory) {
         sendData(socket, m_process->workingDirectory());
-    } else if (command == QLatin1String(Protocol::QProcessErrorString)) {
+    } else if (command == Protocol::CommandId::QProcessErrorString) {
         sendData(socket, m_process->errorString());
-    } else if (command == QLatin1String(Protocol::QProcessReadChannel)) {
+    } else if (command == Protocol::CommandId::QProcessReadChannel) {
         sendData(socket, static_cast<qint32> (m_process->readChannel()));
-    } else if (command == QLatin1String(Protocol::QProcessSetReadChannel)) {
+    } else if (command == Protocol::CommandId::QProcessSetReadChannel) {
         qint32 processChannel;
         data >> processChannel;
         m_process->setReadChannel(static_cast<QProcess::ProcessChannel>(processChannel));
-    } else if (command == QLatin1String(Protocol::QProcessWrite)) {
+    } else if (command == Protocol::CommandId::QProcessWrite) {
         QByteArray byteArray;
         data >> byteArray;
         sendData(socket, m_process->write(byteArray));
-    } else if (command == QLatin1String(Protocol::QProcessProcessChannelMode)) {
+    } else if (command == Protocol::CommandId::QProcessProcessChannelMode) {
         sendData(socket, static_cast<qint32> (m_process->processChannelMode()));
-    } else if (command == QLatin1String(Protocol::QProcessSetProcessChannelMode)) {
+    } else if (command == Protocol::CommandId::QProcessSetProcessChannelMode) {
         qint32 processChannel;
         data >> processChannel;
         m_process->setProcessChannelMode(static_cast<QProcess::ProcessChannelMode>(processChannel));
     }
 #ifdef Q_OS_WIN
-    else if (command == QLatin1String(Protocol::QProcessSetNativeArguments)) {
+    else if (command == Protocol::CommandId::QProcessSetNativeArguments) {
         QString arguments;
         data >> arguments;
         m_process->setNativeArguments(arguments);
     }
 #endif
-    else if (!command.isEmpty()) {
-        qDebug() << "Unknown QProcess command:" << command;
+    else if (command != Protocol::CommandId::Invalid) {
+        qDebug() << "Unknown QProcess command:" << Protocol::commandName(command);
     }
 }
 
-void RemoteServerConnection::handleQSettings(QIODevice *socket, const QString &command,
+void RemoteServerConnection::handleQSettings(QIODevice *socket, Protocol::CommandId command,
                                              QDataStream &data, PermissionSettings *settings)
 {
     if (!settings)
         return;
 
-    if (command == QLatin1String(Protocol::QSettingsAllKeys)) {
+    if (command == Protocol::CommandId::QSettingsAllKeys) {
         sendData(socket, settings->allKeys());
-    } else if (command == QLatin1String(Protocol::QSettingsBeginGroup)) {
+    } else if (command == Protocol::CommandId::QSettingsBeginGroup) {
         QString prefix;
         data >> prefix;
         settings->beginGroup(prefix);
-    } else if (command == QLatin1String(Protocol::QSettingsBeginWriteArray)) {
+    } else if (command == Protocol::CommandId::QSettingsBeginWriteArray) {
         QString prefix;
         data >> prefix;
         qint32 size;
         data >> size;
         settings->beginWriteArray(prefix, size);
-    } else if (command == QLatin1String(Protocol::QSettingsBeginReadArray)) {
+    } else if (command == Protocol::CommandId::QSettingsBeginReadArray) {
         QString prefix;
         data >> prefix;
         sendData(socket, settings->beginReadArray(prefix));
-    } else if (command == QLatin1String(Protocol::QSettingsChildGroups)) {
+    } else if (command == Protocol::CommandId::QSettingsChildGroups) {
         sendData(socket, settings->childGroups());
-    } else if (command == QLatin1String(Protocol::QSettingsChildKeys)) {
+    } else if (command == Protocol::CommandId::QSettingsChildKeys) {
         sendData(socket, settings->childKeys());
-    } else if (command == QLatin1String(Protocol::QSettingsClear)) {
+    } else if (command == Protocol::CommandId::QSettingsClear) {
         settings->clear();
-    } else if (command == QLatin1String(Protocol::QSettingsContains)) {
+    } else if (command == Protocol::CommandId::QSettingsContains) {
         QString key;
         data >> key;
         sendData(socket, settings->contains(key));
-    } else if (command == QLatin1String(Protocol::QSettingsEndArray)) {
+    } else if (command == Protocol::CommandId::QSettingsEndArray) {
         settings->endArray();
-    } else if (command == QLatin1String(Protocol::QSettingsEndGroup)) {
+    } else if (command == Protocol::CommandId::QSettingsEndGroup) {
         settings->endGroup();
-    } else if (command == QLatin1String(Protocol::QSettingsFallbacksEnabled)) {
+    } else if (command == Protocol::CommandId::QSettingsFallbacksEnabled) {
         sendData(socket, settings->fallbacksEnabled());
-    } else if (command == QLatin1String(Protocol::QSettingsFileName)) {
+    } else if (command == Protocol::CommandId::QSettingsFileName) {
         sendData(socket, settings->fileName());
-    } else if (command == QLatin1String(Protocol::QSettingsGroup)) {
+    } else if (command == Protocol::CommandId::QSettingsGroup) {
         sendData(socket, settings->group());
-    } else if (command == QLatin1String(Protocol::QSettingsIsWritable)) {
+    } else if (command == Protocol::CommandId::QSettingsIsWritable) {
         sendData(socket, settings->isWritable());
-    } else if (command == QLatin1String(Protocol::QSettingsRemove)) {
+    } else if (command == Protocol::CommandId::QSettingsRemove) {
         QString key;
         data >> key;
         settings->remove(key);
-    } else if (command == QLatin1String(Protocol::QSettingsSetArrayIndex)) {
+    } else if (command == Protocol::CommandId::QSettingsSetArrayIndex) {
         qint32 i;
         data >> i;
         settings->setArrayIndex(i);
-    } else if (command == QLatin1String(Protocol::QSettingsSetFallbacksEnabled)) {
+    } else if (command == Protocol::CommandId::QSettingsSetFallbacksEnabled) {
         bool b;
         data >> b;
         settings->setFallbacksEnabled(b);
-    } else if (command == QLatin1String(Protocol::QSettingsStatus)) {
+    } else if (command == Protocol::CommandId::QSettingsStatus) {
         sendData(socket, settings->status());
-    } else if (command == QLatin1String(Protocol::QSettingsSync)) {
+    } else if (command == Protocol::CommandId::QSettingsSync) {
         settings->sync();
-    } else if (command == QLatin1String(Protocol::QSettingsSetValue)) {
+    } else if (command == Protocol::CommandId::QSettingsSetValue) {
         QString key;
         QVariant value;
         data >> key;
         data >> value;
         settings->setValue(key, value);
-    } else if (command == QLatin1String(Protocol::QSettingsValue)) {
+    } else if (command == Protocol::CommandId::QSettingsValue) {
         QString key;
         QVariant defaultValue;
         data >> key;
         data >> defaultValue;
         sendData(socket, settings->value(key, defaultValue));
-    } else if (command == QLatin1String(Protocol::QSettingsOrganizationName)) {
+    } else if (command == Protocol::CommandId::QSettingsOrganizationName) {
         sendData(socket, settings->organizationName());
-    } else if (command == QLatin1String(Protocol::QSettingsApplicationName)) {
+    } else if (command == Protocol::CommandId::QSettingsApplicationName) {
         sendData(socket, settings->applicationName());
-    } else if (!command.isEmpty()) {
-        qDebug() << "Unknown QSettings command:" << command;
+    } else if (command != Protocol::CommandId::Invalid) {
+        qDebug() << "Unknown QSettings command:" << Protocol::commandName(command);
     }
 }
 
-void RemoteServerConnection::handleQFSFileEngine(QIODevice *socket, const QString &command,
+void RemoteServerConnection::handleQFSFileEngine(QIODevice *socket, Protocol::CommandId command,
                                                  QDataStream &data)
 {
-    if (command == QLatin1String(Protocol::QAbstractFileEngineAtEnd)) {
+    if (command == Protocol::CommandId::QAbstractFileEngineAtEnd) {
         sendData(socket, m_engine->atEnd());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineCaseSensitive)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineCaseSensitive) {
         sendData(socket, m_engine->caseSensitive());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineClose)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineClose) {
         sendData(socket, m_engine->close());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineCopy)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineCopy) {
         QString newName;
         data >>newName;
         sendData(socket, m_engine->copy(newName));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineEntryList)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineEntryList) {
         qint32 filters;
         QStringList filterNames;
         data >>filters;
         data >>filterNames;
         sendData(socket, m_engine->entryList(static_cast<QDir::Filters> (filters), filterNames));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineError)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineError) {
         sendData(socket, static_cast<qint32> (m_engine->error()));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineErrorString)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineErrorString) {
         sendData(socket, m_engine->errorString());
     }
-    else if (command == QLatin1String(Protocol::QAbstractFileEngineFileFlags)) {
+    else if (command == Protocol::CommandId::QAbstractFileEngineFileFlags) {
         qint32 flags;
         data >>flags;
         flags = m_engine->fileFlags(static_cast<QAbstractFileEngine::FileFlags>(flags));
         sendData(socket, static_cast<qint32>(flags));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineFileName)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineFileName) {
         qint32 file;
         data >>file;
         sendData(socket, m_engine->fileName(static_cast<QAbstractFileEngine::FileName> (file)));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineFlush)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineFlush) {
         sendData(socket, m_engine->flush());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineHandle)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineHandle) {
         sendData(socket, m_engine->handle());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineIsRelativePath)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineIsRelativePath) {
         sendData(socket, m_engine->isRelativePath());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineIsSequential)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineIsSequential) {
         sendData(socket, m_engine->isSequential());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineLink)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineLink) {
         QString newName;
         data >>newName;
         sendData(socket, m_engine->link(newName));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineMkdir)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineMkdir) {
         QString dirName;
         bool createParentDirectories;
         data >>dirName;
         data >>createParentDirectories;
         sendData(socket, m_engine->mkdir(dirName, createParentDirectories));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineOpen)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineOpen) {
         qint32 openMode;
         data >>openMode;
         sendData(socket, m_engine->open(static_cast<QIODevice::OpenMode> (openMode)));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineOwner)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineOwner) {
         qint32 owner;
         data >>owner;
         sendData(socket, m_engine->owner(static_cast<QAbstractFileEngine::FileOwner> (owner)));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineOwnerId)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineOwnerId) {
         qint32 owner;
         data >>owner;
         sendData(socket, m_engine->ownerId(static_cast<QAbstractFileEngine::FileOwner> (owner)));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEnginePos)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEnginePos) {
         sendData(socket, m_engine->pos());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineRead)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineRead) {
         qint64 maxlen;
         data >> maxlen;
         QByteArray byteArray(maxlen, '\0');
         const qint64 r = m_engine->read(byteArray.data(), maxlen);
         sendData(socket, qMakePair<qint64, QByteArray>(r, byteArray));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineReadLine)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineReadLine) {
         qint64 maxlen;
         data >> maxlen;
         QByteArray byteArray(maxlen, '\0');
         const qint64 r = m_engine->readLine(byteArray.data(), maxlen);
         sendData(socket, qMakePair<qint64, QByteArray>(r, byteArray));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineRemove)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineRemove) {
         sendData(socket, m_engine->remove());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineRename)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineRename) {
         QString newName;
         data >>newName;
         sendData(socket, m_engine->rename(newName));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineRmdir)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineRmdir) {
         QString dirName;
         bool recurseParentDirectories;
         data >>dirName;
         data >>recurseParentDirectories;
         sendData(socket, m_engine->rmdir(dirName, recurseParentDirectories));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSeek)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineSeek) {
         quint64 offset;
         data >>offset;
         sendData(socket, m_engine->seek(offset));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSetFileName)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineSetFileName) {
         QString fileName;
         data >>fileName;
         m_engine->setFileName(fileName);
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSetPermissions)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineSetPermissions) {
         uint perms;
         data >>perms;
         sendData(socket, m_engine->setPermissions(perms));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSetSize)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineSetSize) {
         qint64 size;
         data >>size;
         sendData(socket, m_engine->setSize(size));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSize)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineSize) {
         sendData(socket, m_engine->size());
-    } else if ((command == QLatin1String(Protocol::QAbstractFileEngineSupportsExtension))
-        || (command == QLatin1String(Protocol::QAbstractFileEngineExtension))) {
+    } else if ((command == Protocol::CommandId::QAbstractFileEngineSupportsExtension)
+        || (command == Protocol::CommandId::QAbstractFileEngineExtension)) {
             // Implemented client side.
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineWrite)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineWrite) {
         QByteArray content;
         data >> content;
         sendData(socket, m_engine->write(content.data(), content.size()));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineSyncToDisk)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineAttachSharedMemory) {
+        QString key;
+        data >> key;
+        delete m_sharedMemory;
+        m_sharedMemory = new QSharedMemory(key);
+        const bool attached = m_sharedMemory->attach();
+        if (!attached) {
+            qDebug() << "Cannot attach shared memory:" << m_sharedMemory->errorString();
+            delete m_sharedMemory;
+            m_sharedMemory = nullptr;
+        }
+        sendData(socket, attached);
+    } else if (command == Protocol::CommandId::QAbstractFileEngineReadShared) {
+        qint64 maxlen;
+        data >> maxlen;
+        // the client does not touch the segment until this reply arrives
+        qint64 r = -1;
+        if (m_sharedMemory && maxlen >= 0 && maxlen <= m_sharedMemory->size())
+            r = m_engine->read(static_cast<char *>(m_sharedMemory->data()), maxlen);
+        sendData(socket, r);
+    } else if (command == Protocol::CommandId::QAbstractFileEngineWriteShared) {
+        qint64 offset;
+        qint64 len;
+        data >> offset;
+        data >> len;
+        qint64 r = -1;
+        if (m_sharedMemory && offset >= 0 && len >= 0 && offset <= m_sharedMemory->size() - len) {
+            r = m_engine->write(static_cast<const char *>(m_sharedMemory->constData()) + offset,
+                len);
+        }
+        sendData(socket, r);
+    } else if (command == Protocol::CommandId::QAbstractFileEngineSyncToDisk) {
         sendData(socket, m_engine->syncToDisk());
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineRenameOverwrite)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineRenameOverwrite) {
         QString newFilename;
         data >> newFilename;
         sendData(socket, m_engine->renameOverwrite(newFilename));
-    } else if (command == QLatin1String(Protocol::QAbstractFileEngineFileTime)) {
+    } else if (command == Protocol::CommandId::QAbstractFileEngineFileTime) {
         qint32 filetime;
         data >> filetime;
         sendData(socket, m_engine->fileTime(static_cast<QAbstractFileEngine::FileTime> (filetime)));
-    } else if (!command.isEmpty()) {
-        qDebug() << "Unknown QAbstractFileEngine command:" << command;
+    } else if (command != Protocol::CommandId::Invalid) {
+        qDebug() << "Unknown QAbstractFileEngine command:" << Protocol::commandName(command);
+    }
+}
+
+void RemoteServerConnection::handleRemoteFileOperations(QIODevice *socket,
+    Protocol::CommandId command, QDataStream &data)
+{
+    QVariantMap reply;
+    if (command == Protocol::CommandId::RemoteFileOperationsExtractArchive) {
+        QString archivePath;
+        QString targetDirectory;
+        data >> archivePath;
+        data >> targetDirectory;
+
+        // extract in the background, this thread owns the socket and sends the progress
+        RemoteExtractCallback callback;
+        QString error;
+        QFuture<void> future = QtConcurrent::run([&]() {
+            QFile archive(archivePath);
+            if (!archive.open(QIODevice::ReadOnly)) {
+                error = tr("Cannot open archive \"%1\" for reading: %2").arg(archivePath,
+                    archive.errorString());
+                return;
+            }
+            try {
+                Lib7z::extractArchive(&archive, targetDirectory, &callback,
+                    Lib7z::extractThreadCount());
+            } catch (const Lib7z::SevenZipException &e) {
+                error = tr("Error while extracting archive \"%1\": %2").arg(archivePath,
+                    e.message());
+            } catch (...) {
+                error = tr("Unknown exception caught while extracting \"%1\".").arg(archivePath);
+            }
+        });
+
+        QPair<quint64, quint64> sent;
+        auto sendChangedProgress = [&]() {
+            const QPair<quint64, quint64> progress = callback.progress();
+            if (progress != sent) {
+                sendProgress(socket, progress.first, progress.second);
+                sent = progress;
+            }
+        };
+
+        // the watcher quits the loop as soon as the extraction is done, the progress is sent
+        // in intervals meanwhile
+        QEventLoop loop;
+        QTimer progressTimer;
+        QFutureWatcher<void> watcher;
+        connect(&progressTimer, &QTimer::timeout, &loop, sendChangedProgress);
+        connect(&watcher, &QFutureWatcherBase::finished, &loop, &QEventLoop::quit);
+        watcher.setFuture(future);
+        if (!future.isFinished()) {
+            progressTimer.start(100);
+            loop.exec();
+            progressTimer.stop();
+        }
+        future.waitForFinished();
+        sendChangedProgress();
+
+        reply.insert(QLatin1String("error"), error);
+        reply.insert(QLatin1String("files"), callback.m_files);
+        reply.insert(QLatin1String("backups"), callback.m_backups);
+    } else if (command == Protocol::CommandId::RemoteFileOperationsCopyTree) {
+        QString sourceDirectory;
+        QString targetDirectory;
+        data >> sourceDirectory;
+        data >> targetDirectory;
+        try {
+            copyDirectoryContents(sourceDirectory, targetDirectory);
+        } catch (const Error &e) {
+            reply.insert(QLatin1String("error"), e.message());
+        }
+    } else if (command == Protocol::CommandId::RemoteFileOperationsRemoveTree) {
+        QString path;
+        data >> path;
+        try {
+            removeDirectory(path, false);
+        } catch (const Error &e) {
+            reply.insert(QLatin1String("error"), e.message());
+        }
+    } else if (command == Protocol::CommandId::RemoteFileOperationsSetPermissions) {
+        QStringList paths;
+        QList<qint32> permissions;
+        data >> paths;
+        data >> permissions;
+
+        QStringList failed;
+        for (int i = 0; i < paths.count() && i < permissions.count(); ++i) {
+            if (!QFile::setPermissions(paths.at(i), QFileDevice::Permissions(permissions.at(i))))
+                failed.append(QDir::toNativeSeparators(paths.at(i)));
+        }
+        if (!failed.isEmpty()) {
+            reply.insert(QLatin1String("error"), tr("Cannot set permissions of %n file(s): %1", "",
+                failed.count()).arg(failed.join(QLatin1String(", "))));
+        }
+    } else if (command != Protocol::CommandId::Invalid) {
+        qDebug() << "Unknown RemoteFileOperations command:" << Protocol::commandName(command);
+        return;
     }
+    sendData(socket, reply);
 }
 
 } // namespace QInstaller
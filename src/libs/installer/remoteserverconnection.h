@@ -29,6 +29,8 @@
 #ifndef REMOTESERVERCONNECTION_H
 #define REMOTESERVERCONNECTION_H
 
+#include "protocol.h"
+
 #include <QPointer>
 #include <QThread>
 
@@ -37,6 +39,7 @@
 QT_BEGIN_NAMESPACE
 class QProcess;
 class QIODevice;
+class QSharedMemory;
 QT_END_NAMESPACE
 
 namespace QInstaller {
@@ -62,18 +65,29 @@ signals:
 private:
     template <typename T>
     void sendData(QIODevice *device, const T &arg);
-    void handleQProcess(QIODevice *device, const QString &command, QDataStream &data);
-    void handleQSettings(QIODevice *device, const QString &command, QDataStream &data,
+    void handleCommand(QIODevice *device, Protocol::CommandId command, QDataStream &data,
+                       PermissionSettings *settings);
+    void handleBatch(QIODevice *device, const QByteArray &packet, QDataStream &data,
+                     PermissionSettings *settings);
+    void handleQProcess(QIODevice *device, Protocol::CommandId command, QDataStream &data);
+    void handleQSettings(QIODevice *device, Protocol::CommandId command, QDataStream &data,
                          PermissionSettings *settings);
-    void handleQFSFileEngine(QIODevice *device, const QString &command, QDataStream &data);
+    void handleQFSFileEngine(QIODevice *device, Protocol::CommandId command, QDataStream &data);
+    void handleRemoteFileOperations(QIODevice *device, Protocol::CommandId command,
+                                    QDataStream &data);
+    void sendProgress(QIODevice *device, quint64 completed, quint64 total);
 
 private:
     qintptr m_socketDescriptor;
 
     QProcess *m_process;
     QFSFileEngine *m_engine;
+    QSharedMemory *m_sharedMemory;
     QString m_authorizationKey;
     QProcessSignalReceiver *m_signalReceiver;
+
+    qint32 m_protocolVersion;
+    quint32 m_requestId;
 };
 
 } // namespace QInstaller
@@ -29,10 +29,13 @@
 #ifndef REMOTESERVERCONNECTION_P_H
 #define REMOTESERVERCONNECTION_P_H
 
+#include "lib7z_extract.h"
 #include "protocol.h"
 
+#include <QFile>
 #include <QMutex>
 #include <QProcess>
+#include <QStringList>
 #include <QVariant>
 
 namespace QInstaller {
@@ -124,6 +127,66 @@ private:
     QVariantList m_receivedSignals;
 };
 
+class RemoteExtractCallback : public Lib7z::ExtractCallback
+{
+    Q_DISABLE_COPY(RemoteExtractCallback)
+    friend class RemoteServerConnection;
+
+private:
+    RemoteExtractCallback() = default;
+
+    // Same backup handling as the callback of ExtractArchiveOperation.
+    bool prepareForFile(const QString &filename) Q_DECL_OVERRIDE
+    {
+        if (!QFile::exists(filename))
+            return true;
+
+        const QString bfn = filename + QLatin1String(".tmpUpdate");
+        QString backup = bfn;
+        int i = 0;
+        while (QFile::exists(backup))
+            backup = bfn + QString::fromLatin1(".%1").arg(i++);
+
+        QFile f(filename);
+        const bool renamed = f.rename(backup);
+        if (f.exists() && !renamed) {
+            qCritical("Cannot rename %s to %s: %s", qPrintable(filename), qPrintable(backup),
+                qPrintable(f.errorString()));
+            return false;
+        }
+        QMutexLocker _(&m_lock);
+        m_backups << filename << backup;
+        return true;
+    }
+
+    void setCurrentFile(const QString &filename) Q_DECL_OVERRIDE
+    {
+        QMutexLocker _(&m_lock);
+        m_files.append(filename);
+    }
+
+    HRESULT setCompleted(quint64 completed, quint64 total) Q_DECL_OVERRIDE
+    {
+        QMutexLocker _(&m_lock);
+        m_completed = completed;
+        m_total = total;
+        return S_OK;
+    }
+
+    QPair<quint64, quint64> progress()
+    {
+        QMutexLocker _(&m_lock);
+        return qMakePair(m_completed, m_total);
+    }
+
+private:
+    QMutex m_lock;
+    QStringList m_files;
+    QStringList m_backups;
+    quint64 m_completed = 0;
+    quint64 m_total = 0;
+};
+
 } // namespace QInstaller
 
 #endif // REMOTESERVERCONNECTION_P_H
@@ -61,6 +61,10 @@ static const QLatin1String scDependsOnLocalInstallerBinary("DependsOnLocalInstal
 static const QLatin1String scTranslations("Translations");
 static const QLatin1String scCreateLocalRepository("CreateLocalRepository");
 static const QLatin1String scInstallActionColumnVisible("InstallActionColumnVisible");
+static const QLatin1String scMaxConcurrentDownloads("MaxConcurrentDownloads");
+static const QLatin1String scMaxConcurrentDownloadsPerHost("MaxConcurrentDownloadsPerHost");
+static const QLatin1String scPipelinedInstallation("PipelinedInstallation");
+static const QLatin1String scMaxConcurrentInstallations("MaxConcurrentInstallations");
 
 static const QLatin1String scFtpProxy("FtpProxy");
 static const QLatin1String scHttpProxy("HttpProxy");
@@ -292,7 +296,9 @@ Settings Settings::fromFileAndPrefix(const QString &path, const QString &prefix,
                 << scRepositorySettingsPageVisible << scTargetConfigurationFile
                 << scRemoteRepositories << scTranslations << scUrlQueryString << QLatin1String(scControlScript)
                 << scCreateLocalRepository << scInstallActionColumnVisible << scSupportsModify << scAllowUnstableComponents
-                << scSaveDefaultRepositories << scRepositoryCategories;
+                << scSaveDefaultRepositories << scRepositoryCategories
+                << scMaxConcurrentDownloads << scMaxConcurrentDownloadsPerHost << scPipelinedInstallation
+                << scMaxConcurrentInstallations;
 
     Settings s;
     s.d->m_data.insert(scPrefix, prefix);
@@ -829,6 +835,46 @@ void Settings::setSaveDefaultRepositories(bool save)
     d->m_data.insert(scSaveDefaultRepositories, save);
 }
 
+int Settings::maxConcurrentDownloads() const
+{
+    return qMax(1, d->m_data.value(scMaxConcurrentDownloads, 4).toInt());
+}
+
+void Settings::setMaxConcurrentDownloads(int count)
+{
+    d->m_data.insert(scMaxConcurrentDownloads, count);
+}
+
+int Settings::maxConcurrentDownloadsPerHost() const
+{
+    return qMax(1, d->m_data.value(scMaxConcurrentDownloadsPerHost, 4).toInt());
+}
+
+void Settings::setMaxConcurrentDownloadsPerHost(int count)
+{
+    d->m_data.insert(scMaxConcurrentDownloadsPerHost, count);
+}
+
+bool Settings::pipelinedInstallation() const
+{
+    return d->m_data.value(scPipelinedInstallation, false).toBool();
+}
+
+void Settings::setPipelinedInstallation(bool pipelined)
+{
+    d->m_data.insert(scPipelinedInstallation, pipelined);
+}
+
+int Settings::maxConcurrentInstallations() const
+{
+    return qMax(1, d->m_data.value(scMaxConcurrentInstallations, 1).toInt());
+}
+
+void Settings::setMaxConcurrentInstallations(int count)
+{
+    d->m_data.insert(scMaxConcurrentInstallations, count);
+}
+
 QString Settings::repositoryCategoryDisplayName() const
 {
     QString displayName = d->m_data.value(QLatin1String(scRepositoryCategoryDisplayName)).toString();
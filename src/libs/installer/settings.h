@@ -164,6 +164,18 @@ public:
     bool saveDefaultRepositories() const;
     void setSaveDefaultRepositories(bool save);
 
+    int maxConcurrentDownloads() const;
+    void setMaxConcurrentDownloads(int count);
+
+    int maxConcurrentDownloadsPerHost() const;
+    void setMaxConcurrentDownloadsPerHost(int count);
+
+    bool pipelinedInstallation() const;
+    void setPipelinedInstallation(bool pipelined);
+
+    int maxConcurrentInstallations() const;
+    void setMaxConcurrentInstallations(int count);
+
     QString repositoryCategoryDisplayName() const;
     void setRepositoryCategoryDisplayName(const QString &displayName);
 
@@ -38,6 +38,7 @@ namespace QInstaller {
 
 UninstallerCalculator::UninstallerCalculator(const QList<Component *> &installedComponents)
     : m_installedComponents(installedComponents)
+    , m_installedComponentIndex(installedComponents)
 {
 }
 
@@ -101,7 +102,7 @@ void UninstallerCalculator::appendComponentsToUninstall(const QList<Component*>
                                                                  QString::SkipEmptyParts) << c->name();
                 foreach (const QString &possibleName, possibleNames) {
 
-                    Component *cc = PackageManagerCore::componentByName(possibleName, m_installedComponents);
+                    Component *cc = m_installedComponentIndex.find(possibleName);
                     if (cc && (cc->installAction() != ComponentModelHelper::AutodependUninstallation)) {
                         autoDependencies.removeAll(possibleName);
 
@@ -28,6 +28,7 @@
 #ifndef UNINSTALLERCALCULATOR_H
 #define UNINSTALLERCALCULATOR_H
 
+#include "componentindex.h"
 #include "installer_global.h"
 
 #include <QHash>
@@ -53,6 +54,7 @@ private:
     void appendComponentToUninstall(Component *component);
 
     QList<Component *> m_installedComponents;
+    ComponentIndex m_installedComponentIndex;
     QSet<Component *> m_componentsToUninstall;
 };
 
@@ -0,0 +1,406 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+#include "updatesindex.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDomDocument>
+#include <QFile>
+#include <QSaveFile>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+namespace QInstaller {
+
+namespace {
+
+const char IndexVersion[] = "1";
+
+}
+
+/*
+    Feeds \a text with a length prefix, so that neighbouring strings cannot be confused.
+*/
+static void addString(QCryptographicHash *hash, const QString &text)
+{
+    const QByteArray utf8 = text.toUtf8();
+    hash->addData(QByteArray::number(utf8.size()) + ':' + utf8);
+}
+
+/*
+    Feeds the content of \a node in a form that does not depend on how the document was
+    serialized: attributes are sorted by name, comments and processing instructions are ignored.
+*/
+static void addNode(QCryptographicHash *hash, const QDomNode &node)
+{
+    if (node.isElement()) {
+        const QDomElement element = node.toElement();
+        hash->addData('<' + element.tagName().toUtf8());
+
+        QStringList names;
+        const QDomNamedNodeMap attributes = element.attributes();
+        for (int i = 0; i < attributes.count(); ++i)
+            names.append(attributes.item(i).nodeName());
+        names.sort();
+        foreach (const QString &name, names) {
+            hash->addData(' ' + name.toUtf8() + '=');
+            addString(hash, element.attribute(name));
+        }
+        hash->addData(">");
+
+        for (QDomNode child = element.firstChild(); !child.isNull(); child = child.nextSibling())
+            addNode(hash, child);
+        hash->addData("</>");
+    } else if (node.isText() || node.isCDATASection()) {
+        addString(hash, node.nodeValue());
+    }
+}
+
+static bool isPackageUpdate(const QDomElement &element)
+{
+    return element.tagName() == QLatin1String("PackageUpdate");
+}
+
+/*!
+    \inmodule QtInstallerFramework
+    \class QInstaller::UpdatesIndex
+    \brief The UpdatesIndex class describes the content of an Updates.xml file in compact form.
+
+    An index holds a generation counter, a SHA-1 checksum of the repository wide elements of
+    Updates.xml, and a SHA-1 checksum for each PackageUpdate element. The checksums are calculated
+    over the parsed content, so they do not depend on attribute order or indentation.
+
+    The repository generator can write the index next to Updates.xml, together with a
+    PackageUpdate.xml file per package that holds the PackageUpdate element of that package
+    only. A client that kept an earlier Updates.xml then fetches the index, and only the
+    PackageUpdate.xml files of packages whose checksum changed, to bring its copy up to date.
+*/
+
+/*!
+    \class QInstaller::UpdatesIndex::Package
+    \brief The Package struct holds the name of a package and the checksum of its PackageUpdate
+    element.
+*/
+
+/*!
+    Creates an invalid index.
+*/
+UpdatesIndex::UpdatesIndex()
+    : m_generation(0)
+{
+}
+
+/*!
+    Returns the name of the index file inside a repository.
+*/
+QString UpdatesIndex::fileName()
+{
+    return QLatin1String("Updates.index");
+}
+
+/*!
+    Returns the path of the file holding the PackageUpdate element of \a package, relative to
+    the repository.
+*/
+QString UpdatesIndex::packageUpdateFileName(const QString &package)
+{
+    return package + QLatin1String("/PackageUpdate.xml");
+}
+
+/*!
+    Creates an index describing \a updates. The generation of the returned index is \c 0; set it
+    with setGeneration() before writing the index.
+*/
+UpdatesIndex UpdatesIndex::fromUpdates(const QDomDocument &updates)
+{
+    UpdatesIndex index;
+    index.m_headerSha1 = hashHeader(updates);
+
+    const QDomElement root = updates.documentElement();
+    for (QDomElement element = root.firstChildElement(); !element.isNull();
+        element = element.nextSiblingElement()) {
+        if (!isPackageUpdate(element))
+            continue;
+        Package package;
+        package.name = packageName(element);
+        package.sha1 = hashPackageUpdate(element);
+        index.m_packages.append(package);
+    }
+    return index;
+}
+
+/*!
+    Returns the checksum of all elements of \a updates that are not a PackageUpdate element.
+*/
+QByteArray UpdatesIndex::hashHeader(const QDomDocument &updates)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    const QDomElement root = updates.documentElement();
+    hash.addData(root.tagName().toUtf8());
+    for (QDomElement element = root.firstChildElement(); !element.isNull();
+        element = element.nextSiblingElement()) {
+        if (!isPackageUpdate(element))
+            addNode(&hash, element);
+    }
+    return hash.result().toHex();
+}
+
+/*!
+    Returns the checksum of \a packageUpdate.
+*/
+QByteArray UpdatesIndex::hashPackageUpdate(const QDomElement &packageUpdate)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    addNode(&hash, packageUpdate);
+    return hash.result().toHex();
+}
+
+/*!
+    Returns the content of the Name element of \a packageUpdate.
+*/
+QString UpdatesIndex::packageName(const QDomElement &packageUpdate)
+{
+    return packageUpdate.firstChildElement(QLatin1String("Name")).text();
+}
+
+/*!
+    Returns whether the index was read successfully or has a generation set.
+*/
+bool UpdatesIndex::isValid() const
+{
+    return m_generation > 0;
+}
+
+/*!
+    Returns the generation of the index. The repository generator increments it whenever the
+    content of Updates.xml changes.
+*/
+quint64 UpdatesIndex::generation() const
+{
+    return m_generation;
+}
+
+/*!
+    Sets the generation of the index to \a generation.
+*/
+void UpdatesIndex::setGeneration(quint64 generation)
+{
+    m_generation = generation;
+}
+
+/*!
+    Returns the checksum of the repository wide elements of Updates.xml.
+*/
+QByteArray UpdatesIndex::headerSha1() const
+{
+    return m_headerSha1;
+}
+
+/*!
+    Returns the packages in the order of their PackageUpdate elements in Updates.xml.
+*/
+QVector<UpdatesIndex::Package> UpdatesIndex::packages() const
+{
+    return m_packages;
+}
+
+/*!
+    Reads the index from \a fileName. Returns \c false and sets \a errorString if the file cannot
+    be read or is not a valid index.
+*/
+bool UpdatesIndex::read(const QString &fileName, QString *errorString)
+{
+    *this = UpdatesIndex();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorString) {
+            *errorString = QString::fromLatin1("Cannot open file \"%1\" for reading: %2")
+                .arg(QDir::toNativeSeparators(fileName), file.errorString());
+        }
+        return false;
+    }
+
+    UpdatesIndex index;
+    QXmlStreamReader reader(&file);
+    if (reader.readNextStartElement()) {
+        const QXmlStreamAttributes attributes = reader.attributes();
+        if (reader.name() != QLatin1String("UpdatesIndex")
+            || attributes.value(QLatin1String("version")) != QLatin1String(IndexVersion)) {
+            reader.raiseError(QLatin1String("Unsupported index format."));
+        }
+        index.m_generation = attributes.value(QLatin1String("generation")).toULongLong();
+        index.m_headerSha1 = attributes.value(QLatin1String("header")).toLatin1();
+    }
+    while (!reader.hasError() && reader.readNextStartElement()) {
+        if (reader.name() != QLatin1String("Package")) {
+            reader.skipCurrentElement();
+            continue;
+        }
+        Package package;
+        package.name = reader.attributes().value(QLatin1String("name")).toString();
+        package.sha1 = reader.attributes().value(QLatin1String("sha1")).toLatin1();
+        index.m_packages.append(package);
+        reader.skipCurrentElement();
+    }
+
+    if (reader.hasError() || !index.isValid() || index.m_headerSha1.isEmpty()) {
+        if (errorString) {
+            *errorString = QString::fromLatin1("Invalid index \"%1\": %2")
+                .arg(QDir::toNativeSeparators(fileName), reader.hasError() ? reader.errorString()
+                    : QLatin1String("Missing generation or header checksum."));
+        }
+        return false;
+    }
+    *this = index;
+    return true;
+}
+
+/*!
+    Writes the index to \a fileName. Returns \c false and sets \a errorString if the file cannot
+    be written.
+*/
+bool UpdatesIndex::write(const QString &fileName, QString *errorString) const
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (errorString) {
+            *errorString = QString::fromLatin1("Cannot open file \"%1\" for writing: %2")
+                .arg(QDir::toNativeSeparators(fileName), file.errorString());
+        }
+        return false;
+    }
+
+    QXmlStreamWriter writer(&file);
+    writer.setAutoFormatting(true);
+    writer.writeStartDocument();
+    writer.writeStartElement(QLatin1String("UpdatesIndex"));
+    writer.writeAttribute(QLatin1String("version"), QLatin1String(IndexVersion));
+    writer.writeAttribute(QLatin1String("generation"), QString::number(m_generation));
+    writer.writeAttribute(QLatin1String("header"), QString::fromLatin1(m_headerSha1));
+    foreach (const Package &package, m_packages) {
+        writer.writeEmptyElement(QLatin1String("Package"));
+        writer.writeAttribute(QLatin1String("name"), package.name);
+        writer.writeAttribute(QLatin1String("sha1"), QString::fromLatin1(package.sha1));
+    }
+    writer.writeEndDocument();
+
+    if (writer.hasError() || !file.commit()) {
+        if (errorString) {
+            *errorString = QString::fromLatin1("Cannot write file \"%1\": %2")
+                .arg(QDir::toNativeSeparators(fileName), file.errorString());
+        }
+        return false;
+    }
+    return true;
+}
+
+/*!
+    Returns whether \a other describes the same Updates.xml content, regardless of the
+    generation.
+*/
+bool UpdatesIndex::hasSameContent(const UpdatesIndex &other) const
+{
+    return m_headerSha1 == other.m_headerSha1 && m_packages == other.m_packages;
+}
+
+/*!
+    Returns whether the index describes the content of \a updates.
+*/
+bool UpdatesIndex::describes(const QDomDocument &updates) const
+{
+    return hasSameContent(fromUpdates(updates));
+}
+
+/*!
+    Returns the names of the packages whose PackageUpdate element in \a updates is missing or
+    differs from the index.
+*/
+QStringList UpdatesIndex::changedPackages(const QDomDocument &updates) const
+{
+    QHash<QString, QByteArray> current;
+    foreach (const Package &package, fromUpdates(updates).m_packages)
+        current.insert(package.name, package.sha1);
+
+    QStringList changed;
+    foreach (const Package &package, m_packages) {
+        if (current.value(package.name) != package.sha1)
+            changed.append(package.name);
+    }
+    return changed;
+}
+
+/*!
+    Brings \a updates up to date with the index. The PackageUpdate elements of the packages in
+    \a packageUpdates replace the ones in \a updates, elements of packages no longer listed are
+    removed, and the remaining ones are put in the order of the index.
+
+    Returns \c false and sets \a errorString if the repository wide elements of \a updates do not
+    match the index, or if a PackageUpdate element is missing or does not match its checksum. In
+    that case \a updates is left partially modified and should be discarded.
+*/
+bool UpdatesIndex::apply(QDomDocument *updates, const QHash<QString, QDomElement> &packageUpdates,
+    QString *errorString) const
+{
+    QDomElement root = updates->documentElement();
+    if (root.tagName() != QLatin1String("Updates") || hashHeader(*updates) != m_headerSha1) {
+        if (errorString)
+            *errorString = QString::fromLatin1("The repository wide elements do not match the index.");
+        return false;
+    }
+
+    QHash<QString, QDomElement> existing;
+    QList<QDomElement> elements;
+    for (QDomElement element = root.firstChildElement(); !element.isNull();
+        element = element.nextSiblingElement()) {
+        if (isPackageUpdate(element))
+            elements.append(element);
+    }
+    foreach (const QDomElement &element, elements) {
+        existing.insert(packageName(element), element);
+        root.removeChild(element);
+    }
+
+    foreach (const Package &package, m_packages) {
+        const QDomElement element = packageUpdates.contains(package.name)
+            ? updates->importNode(packageUpdates.value(package.name), true).toElement()
+            : existing.value(package.name);
+        if (element.isNull() || !isPackageUpdate(element) || packageName(element) != package.name
+            || hashPackageUpdate(element) != package.sha1) {
+            if (errorString) {
+                *errorString = QString::fromLatin1("The PackageUpdate element of \"%1\" does not "
+                    "match the index.").arg(package.name);
+            }
+            return false;
+        }
+        root.appendChild(element);
+    }
+    return true;
+}
+
+} // namespace QInstaller
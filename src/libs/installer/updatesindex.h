@@ -0,0 +1,92 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#ifndef UPDATESINDEX_H
+#define UPDATESINDEX_H
+
+#include "installer_global.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QDomDocument;
+class QDomElement;
+QT_END_NAMESPACE
+
+namespace QInstaller {
+
+class INSTALLER_EXPORT UpdatesIndex
+{
+public:
+    struct Package {
+        QString name;
+        QByteArray sha1;
+
+        bool operator==(const Package &other) const {
+            return name == other.name && sha1 == other.sha1;
+        }
+    };
+
+    UpdatesIndex();
+
+    static QString fileName();
+    static QString packageUpdateFileName(const QString &package);
+
+    static UpdatesIndex fromUpdates(const QDomDocument &updates);
+    static QByteArray hashHeader(const QDomDocument &updates);
+    static QByteArray hashPackageUpdate(const QDomElement &packageUpdate);
+    static QString packageName(const QDomElement &packageUpdate);
+
+    bool isValid() const;
+    quint64 generation() const;
+    void setGeneration(quint64 generation);
+    QByteArray headerSha1() const;
+    QVector<Package> packages() const;
+
+    bool read(const QString &fileName, QString *errorString = nullptr);
+    bool write(const QString &fileName, QString *errorString = nullptr) const;
+
+    bool hasSameContent(const UpdatesIndex &other) const;
+    bool describes(const QDomDocument &updates) const;
+    QStringList changedPackages(const QDomDocument &updates) const;
+    bool apply(QDomDocument *updates, const QHash<QString, QDomElement> &packageUpdates,
+        QString *errorString = nullptr) const;
+
+private:
+    quint64 m_generation;
+    QByteArray m_headerSha1;
+    QVector<Package> m_packages;
+};
+
+} // namespace QInstaller
+
+#endif // UPDATESINDEX_H
@@ -1156,7 +1156,7 @@ struct KDUpdater::HttpDownloader::Private
     {}
 
     HttpDownloader *const q;
-    QNetworkAccessManager manager;
+    QScopedPointer<QNetworkAccessManager> manager; // if no request function is set
     QNetworkReply *http;
     QUrl sourceUrl;
     QFile *destination;
@@ -1165,6 +1165,34 @@ struct KDUpdater::HttpDownloader::Private
     bool aborted;
     int m_authenticationCount;
 
+    QNetworkReply *get(const QNetworkRequest &request)
+    {
+        const FileDownloaderFactory::RequestFunction requestFunction
+            = FileDownloaderFactory::requestFunction();
+        if (requestFunction)
+            return requestFunction(request, q->proxyFactory());
+
+        if (!manager)
+            manager.reset(new QNetworkAccessManager);
+        manager->setProxyFactory(q->proxyFactory());
+        return manager->get(request);
+    }
+
+    // The request function might pick the network access manager by proxies, so connect to the
+    // one of each request. The connections are kept for the following requests through the same
+    // manager.
+    void connectManager(QNetworkAccessManager *manager)
+    {
+#ifndef QT_NO_SSL
+        QObject::connect(manager, &QNetworkAccessManager::sslErrors,
+            q, &HttpDownloader::onSslErrors, Qt::UniqueConnection);
+#endif
+        QObject::connect(manager, &QNetworkAccessManager::authenticationRequired,
+            q, &HttpDownloader::onAuthenticationRequired, Qt::UniqueConnection);
+        QObject::connect(manager, &QNetworkAccessManager::networkAccessibleChanged,
+            q, &HttpDownloader::onNetworkAccessibleChanged, Qt::UniqueConnection);
+    }
+
     void shutDown(bool closeDestination = true)
     {
         if (http) {
@@ -1193,15 +1221,6 @@ KDUpdater::HttpDownloader::HttpDownloader(QObject *parent)
     : KDUpdater::FileDownloader(QLatin1String("http"), parent)
     , d(new Private(this))
 {
-#ifndef QT_NO_SSL
-    connect(&d->manager, &QNetworkAccessManager::sslErrors,
-            this, &HttpDownloader::onSslErrors);
-#endif
-    connect(&d->manager, &QNetworkAccessManager::authenticationRequired,
-            this, &HttpDownloader::onAuthenticationRequired);
-    connect(&d->manager, &QNetworkAccessManager::networkAccessibleChanged,
-            this, &HttpDownloader::onNetworkAccessibleChanged);
-
 }
 
 /*!
@@ -1212,6 +1231,12 @@ KDUpdater::HttpDownloader::HttpDownloader(QObject *parent)
 */
 KDUpdater::HttpDownloader::~HttpDownloader()
 {
+    // The network access manager might be shared, abort the request instead of leaving it running.
+    if (d->http) {
+        d->http->disconnect(this);
+        d->http->abort();
+        d->http->deleteLater();
+    }
     if (this->isAutoRemoveDownloadedFile() && !d->destFileName.isEmpty())
         QFile::remove(d->destFileName);
     delete d;
@@ -1450,9 +1475,9 @@ void KDUpdater::HttpDownloader::startDownload(const QUrl &url)
 {
     d->sourceUrl = url;
     d->m_authenticationCount = 0;
-    d->manager.setProxyFactory(proxyFactory());
     clearBytesDownloadedBeforeResume();
-    d->http = d->manager.get(QNetworkRequest(url));
+    d->http = d->get(QNetworkRequest(url));
+    d->connectManager(d->http->manager());
     connect(d->http, &QIODevice::readyRead, this, &HttpDownloader::httpReadyRead);
     connect(d->http, &QNetworkReply::downloadProgress,
             this, &HttpDownloader::httpReadProgress);
@@ -1489,7 +1514,8 @@ void KDUpdater::HttpDownloader::resumeDownload()
                          .arg(bytesDownloadedBeforeResume())
                          .toLatin1());
     setDownloadResumed(true);
-    d->http = d->manager.get(request);
+    d->http = d->get(request);
+    d->connectManager(d->http->manager());
     connect(d->http, &QIODevice::readyRead, this, &HttpDownloader::httpReadyRead);
     connect(d->http, &QNetworkReply::downloadProgress,
             this, &HttpDownloader::httpReadProgress);
@@ -1502,7 +1528,8 @@ void KDUpdater::HttpDownloader::resumeDownload()
 
 void KDUpdater::HttpDownloader::onAuthenticationRequired(QNetworkReply *reply, QAuthenticator *authenticator)
 {
-    Q_UNUSED(reply)
+    if (reply != d->http)
+        return; // request of another downloader sharing the network access manager
     // first try with the information we have already
     if (d->m_authenticationCount == 0) {
         d->m_authenticationCount++;
@@ -1558,7 +1585,8 @@ void KDUpdater::HttpDownloader::onNetworkAccessibleChanged(QNetworkAccessManager
 
 void KDUpdater::HttpDownloader::onSslErrors(QNetworkReply* reply, const QList<QSslError> &errors)
 {
-    Q_UNUSED(reply)
+    if (reply != d->http)
+        return; // request of another downloader sharing the network access manager
     QString errorString;
     foreach (const QSslError &error, errors) {
         if (!errorString.isEmpty())
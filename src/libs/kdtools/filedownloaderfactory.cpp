@@ -115,6 +115,25 @@ void FileDownloaderFactory::setIgnoreSslErrors(bool ignore)
     FileDownloaderFactory::instance().d->m_ignoreSslErrors = ignore;
 }
 
+/*!
+    Returns the function HTTP downloaders send their requests with, if one is set.
+*/
+FileDownloaderFactory::RequestFunction FileDownloaderFactory::requestFunction()
+{
+    return FileDownloaderFactory::instance().d->m_requestFunction;
+}
+
+/*!
+    Sets \a function to send the GET requests of HTTP downloaders, for example to share network
+    connections with other parts of the application. The function gets the request and the proxy
+    factory to use, which it takes ownership of, and returns the reply. Without a function, each
+    downloader sends its requests with a network access manager of its own.
+*/
+void FileDownloaderFactory::setRequestFunction(const RequestFunction &function)
+{
+    FileDownloaderFactory::instance().d->m_requestFunction = function;
+}
+
 /*!
     Destroys the file downloader factory.
 */
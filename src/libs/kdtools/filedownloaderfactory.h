@@ -37,7 +37,11 @@
 
 #include <QtNetwork/QNetworkProxyFactory>
 
+#include <functional>
+
 QT_BEGIN_NAMESPACE
+class QNetworkReply;
+class QNetworkRequest;
 class QObject;
 QT_END_NAMESPACE
 
@@ -56,6 +60,12 @@ class KDTOOLS_EXPORT FileDownloaderFactory : public GenericFactory<FileDownloade
                                                                      QObject*>
 {
     Q_DISABLE_COPY(FileDownloaderFactory)
+
+public:
+    typedef std::function<QNetworkReply *(const QNetworkRequest &, QNetworkProxyFactory *)>
+        RequestFunction;
+
+private:
     struct FileDownloaderFactoryData {
         FileDownloaderFactoryData() : m_factory(0) {}
         ~FileDownloaderFactoryData() { delete m_factory; }
@@ -64,6 +74,7 @@ class KDTOOLS_EXPORT FileDownloaderFactory : public GenericFactory<FileDownloade
         bool m_ignoreSslErrors;
         QStringList m_supportedSchemes;
         FileDownloaderProxyFactory *m_factory;
+        RequestFunction m_requestFunction;
     };
 
 public:
@@ -86,6 +97,9 @@ public:
     static bool ignoreSslErrors();
     static void setIgnoreSslErrors(bool ignore);
 
+    static RequestFunction requestFunction();
+    static void setRequestFunction(const RequestFunction &function);
+
     static QStringList supportedSchemes();
     static bool isSupportedScheme(const QString &scheme);
 
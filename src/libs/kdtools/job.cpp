@@ -48,6 +48,7 @@ public:
         , totalAmount(100)
         , processedAmount(0)
         , m_timeout(-1)
+        , finished(false)
     {
         connect(&m_timer, &QTimer::timeout, q, &Job::cancel);
     }
@@ -59,6 +60,7 @@ public:
 
     void delayedStart()
     {
+        finished = false;
         q->doStart();
         emit q->started(q);
     }
@@ -84,6 +86,7 @@ public:
     quint64 processedAmount;
     int m_timeout;
     QTimer m_timer;
+    bool finished;
 };
 
 
@@ -123,6 +126,7 @@ QString Job::errorString() const
 
 void Job::emitFinished()
 {
+    d->finished = true;
     emit finished(this);
 }
 
@@ -153,6 +157,15 @@ void Job::waitForFinished()
     d->waitForSignal(SIGNAL(finished(Job*)));
 }
 
+/*!
+    Returns \c true if the job has finished, either successfully, with an error or by being
+    canceled.
+*/
+bool Job::isFinished() const
+{
+    return d->finished;
+}
+
 Job::Capabilities Job::capabilities() const
 {
     return d->caps;
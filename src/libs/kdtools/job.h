@@ -69,6 +69,7 @@ public:
 
     void waitForStarted();
     void waitForFinished();
+    bool isFinished() const;
 
     quint64 totalAmount() const;
     quint64 processedAmount() const;
@@ -34,6 +34,16 @@
 #include <QDomDocument>
 #include <QDomElement>
 #include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QXmlStreamReader>
+
+#ifdef Q_OS_WIN
+#include <qt_windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 using namespace KDUpdater;
 using namespace QInstaller;
@@ -52,6 +62,12 @@ using namespace QInstaller;
         \li Get information about the number of packages installed and their meta-data via the
             packageInfoCount() and packageInfo() methods.
     \endlist
+
+    Rewriting the whole file after every single change gets expensive with many packages. Instead,
+    changes can be appended to a journal file next to the installation information file with
+    writeJournal(), and the complete file gets written at checkpoints only with writeToDisk().
+    The file is replaced atomically, and the journal is removed afterwards. If the application
+    terminates before a checkpoint, refresh() replays the journal on top of the last written file.
 */
 
 /*!
@@ -84,8 +100,14 @@ struct LocalPackageHub::PackagesInfoData
 
     QMap<QString, LocalPackage> m_packageInfoMap;
 
+    // changes not yet written to the journal, a null name stands for clearing all packages
+    QList<QPair<QString, bool> > m_journalChanges;
+    LocalPackageHub::SyncFunction m_syncJournal;
+
     void addPackageFrom(const QDomElement &packageE);
     void setInvalidContentError(const QString &detail);
+    void readElement(const QDomElement &element);
+    bool replayJournal();
 };
 
 void LocalPackageHub::PackagesInfoData::setInvalidContentError(const QString &detail)
@@ -240,12 +262,18 @@ void LocalPackageHub::refresh()
     d->m_packageInfoMap.clear();
     d->modified = false;
 
+    d->m_journalChanges.clear();
+
     QFile file(d->fileName);
 
     // if the file does not exist then we just skip the reading
     if (!file.exists()) {
         d->error = NotYetReadError;
         d->errorMessage = tr("The file %1 does not exist.").arg(d->fileName);
+        if (d->replayJournal()) {
+            d->error = NoError;
+            d->errorMessage.clear();
+        }
         return;
     }
 
@@ -281,24 +309,81 @@ void LocalPackageHub::refresh()
     }
 
     QDomNodeList childNodes = rootE.childNodes();
-    for (int i = 0; i < childNodes.count(); i++) {
-        QDomNode childNode = childNodes.item(i);
-        QDomElement childNodeE = childNode.toElement();
-        if (childNodeE.isNull())
-            continue;
-
-        if (childNodeE.tagName() == QLatin1String("ApplicationName"))
-            d->applicationName = childNodeE.text();
-        else if (childNodeE.tagName() == QLatin1String("ApplicationVersion"))
-            d->applicationVersion = childNodeE.text();
-        else if (childNodeE.tagName() == QLatin1String("Package"))
-            d->addPackageFrom(childNodeE);
-    }
+    for (int i = 0; i < childNodes.count(); i++)
+        d->readElement(childNodes.item(i).toElement());
 
+    d->replayJournal();
     d->error = NoError;
     d->errorMessage.clear();
 }
 
+void LocalPackageHub::PackagesInfoData::readElement(const QDomElement &element)
+{
+    if (element.isNull())
+        return;
+
+    if (element.tagName() == QLatin1String("ApplicationName"))
+        applicationName = element.text();
+    else if (element.tagName() == QLatin1String("ApplicationVersion"))
+        applicationVersion = element.text();
+    else if (element.tagName() == QLatin1String("Package"))
+        addPackageFrom(element);
+    else if (element.tagName() == QLatin1String("RemovePackage"))
+        m_packageInfoMap.remove(element.text());
+    else if (element.tagName() == QLatin1String("ClearPackages"))
+        m_packageInfoMap.clear();
+}
+
+/*!
+    \internal
+
+    Applies the records of an existing journal file on top of the packages read so far. A record
+    that has only been written partially, because the application terminated while writing it, is
+    ignored and cut off the file, so that records appended later are not hidden behind it. Returns
+    \c true if a journal was found.
+*/
+bool LocalPackageHub::PackagesInfoData::replayJournal()
+{
+    QFile file(fileName + QLatin1String(".journal"));
+    if (!file.open(QFile::ReadOnly))
+        return false;
+
+    const QLatin1String prefix("<Journal>");
+    const QString content = prefix + QString::fromUtf8(file.readAll());
+
+    // find the end of the last complete record
+    qint64 validSize = 0;
+    QXmlStreamReader reader(content);
+    if (reader.readNextStartElement()) {
+        while (reader.readNextStartElement()) {
+            reader.skipCurrentElement();
+            if (reader.hasError())
+                break;
+            validSize = reader.characterOffset();
+        }
+    }
+
+    // the partial record would end the replay at the next start, drop it from the file
+    if (!content.mid(validSize).trimmed().isEmpty()) {
+        const qint64 validBytes = content.mid(prefix.size(), qMax<qint64>(validSize - prefix.size(), 0))
+            .toUtf8().size();
+        file.close();
+        QFile::resize(file.fileName(), validBytes);
+    }
+
+    QDomDocument doc;
+    if (!doc.setContent(content.left(validSize) + QLatin1String("</Journal>")))
+        return true;
+
+    QDomNodeList childNodes = doc.documentElement().childNodes();
+    for (int i = 0; i < childNodes.count(); i++)
+        readElement(childNodes.item(i).toElement());
+
+    // the file on disk is outdated until the next checkpoint
+    modified = true;
+    return true;
+}
+
 /*!
     Marks the package specified by \a name as installed. Sets the values of
     \a version,
@@ -347,6 +432,7 @@ void LocalPackageHub::addPackage(const QString &name,
         info.expandedByDefault = expandedByDefault;
         d->m_packageInfoMap.insert(name, info);
     }
+    d->m_journalChanges.append(qMakePair(name, true));
     d->modified = true;
 }
 
@@ -358,6 +444,7 @@ bool LocalPackageHub::removePackage(const QString &name)
     if (d->m_packageInfoMap.remove(name) <= 0)
         return false;
 
+    d->m_journalChanges.append(qMakePair(name, false));
     d->modified = true;
     return true;
 }
@@ -377,12 +464,54 @@ static void addTextChildHelper(QDomNode *node,
     node->appendChild(domElement);
 }
 
+static void addPackageHelper(QDomNode *node, const LocalPackage &info)
+{
+    QDomElement package = node->ownerDocument().createElement(QLatin1String("Package"));
+
+    addTextChildHelper(&package, QLatin1String("Name"), info.name);
+    addTextChildHelper(&package, QLatin1String("Title"), info.title);
+    addTextChildHelper(&package, QLatin1String("Description"), info.description);
+    if (info.inheritVersionFrom.isEmpty())
+        addTextChildHelper(&package, QLatin1String("Version"), info.version);
+    else
+        addTextChildHelper(&package, QLatin1String("Version"), info.version,
+                           QLatin1String("inheritVersionFrom"), info.inheritVersionFrom);
+    addTextChildHelper(&package, QLatin1String("LastUpdateDate"), info.lastUpdateDate
+        .toString(Qt::ISODate));
+    addTextChildHelper(&package, QLatin1String("InstallDate"), info.installDate
+        .toString(Qt::ISODate));
+    addTextChildHelper(&package, QLatin1String("Size"),
+        QString::number(info.uncompressedSize));
+
+    if (info.dependencies.count())
+        addTextChildHelper(&package, scDependencies, info.dependencies.join(QLatin1String(",")));
+    if (info.autoDependencies.count())
+        addTextChildHelper(&package, scAutoDependOn, info.autoDependencies.join(QLatin1String(",")));
+    if (info.forcedInstallation)
+        addTextChildHelper(&package, QLatin1String("ForcedInstallation"), QLatin1String("true"));
+    if (info.virtualComp)
+        addTextChildHelper(&package, QLatin1String("Virtual"), QLatin1String("true"));
+    if (info.checkable)
+        addTextChildHelper(&package, QLatin1String("Checkable"), QLatin1String("true"));
+    if (info.expandedByDefault)
+        addTextChildHelper(&package, QLatin1String("ExpandedByDefault"), QLatin1String("true"));
+
+    node->appendChild(package);
+}
+
 /*!
-    Writes the installation information file to disk.
+    Writes the installation information file to disk. The file is replaced atomically and the
+    journal written by writeJournal() is removed afterwards.
 */
 void LocalPackageHub::writeToDisk()
 {
-    if (d->modified && (!d->m_packageInfoMap.isEmpty() || QFile::exists(d->fileName))) {
+    if (d->fileName.isEmpty())
+        return;
+
+    if (d->modified && d->m_packageInfoMap.isEmpty() && !QFile::exists(d->fileName))
+        d->modified = false; // nothing to store
+
+    if (d->modified) {
         QDomDocument doc;
         QDomElement root = doc.createElement(QLatin1String("Packages")) ;
         doc.appendChild(root);
@@ -390,49 +519,106 @@ void LocalPackageHub::writeToDisk()
         addTextChildHelper(&root, QLatin1String("ApplicationName"), d->applicationName);
         addTextChildHelper(&root, QLatin1String("ApplicationVersion"), d->applicationVersion);
 
-        Q_FOREACH (const LocalPackage &info, d->m_packageInfoMap) {
-            QDomElement package = doc.createElement(QLatin1String("Package"));
-
-            addTextChildHelper(&package, QLatin1String("Name"), info.name);
-            addTextChildHelper(&package, QLatin1String("Title"), info.title);
-            addTextChildHelper(&package, QLatin1String("Description"), info.description);
-            if (info.inheritVersionFrom.isEmpty())
-                addTextChildHelper(&package, QLatin1String("Version"), info.version);
-            else
-                addTextChildHelper(&package, QLatin1String("Version"), info.version,
-                                   QLatin1String("inheritVersionFrom"), info.inheritVersionFrom);
-            addTextChildHelper(&package, QLatin1String("LastUpdateDate"), info.lastUpdateDate
-                .toString(Qt::ISODate));
-            addTextChildHelper(&package, QLatin1String("InstallDate"), info.installDate
-                .toString(Qt::ISODate));
-            addTextChildHelper(&package, QLatin1String("Size"),
-                QString::number(info.uncompressedSize));
-
-            if (info.dependencies.count())
-                addTextChildHelper(&package, scDependencies, info.dependencies.join(QLatin1String(",")));
-            if (info.autoDependencies.count())
-                addTextChildHelper(&package, scAutoDependOn, info.autoDependencies.join(QLatin1String(",")));
-            if (info.forcedInstallation)
-                addTextChildHelper(&package, QLatin1String("ForcedInstallation"), QLatin1String("true"));
-            if (info.virtualComp)
-                addTextChildHelper(&package, QLatin1String("Virtual"), QLatin1String("true"));
-            if (info.checkable)
-                addTextChildHelper(&package, QLatin1String("Checkable"), QLatin1String("true"));
-            if (info.expandedByDefault)
-                addTextChildHelper(&package, QLatin1String("ExpandedByDefault"), QLatin1String("true"));
-
-            root.appendChild(package);
-        }
+        Q_FOREACH (const LocalPackage &info, d->m_packageInfoMap)
+            addPackageHelper(&root, info);
 
-        // Open Packages.xml
-        QFile file(d->fileName);
+        // Open Packages.xml, fall back to writing in place if no temporary file can be created
+        // next to it, e.g. because the directory is only writable through elevated file access
+        QSaveFile file(d->fileName);
+        file.setDirectWriteFallback(true);
         if (!file.open(QFile::WriteOnly))
             return;
 
         file.write(doc.toByteArray(4));
-        file.close();
+        if (!file.commit())
+            return;
         d->modified = false;
     }
+
+    if (!d->modified) {
+        d->m_journalChanges.clear();
+        QFile::remove(journalFileName());
+    }
+}
+
+/*!
+    Appends the changes made since the last call to the journal file, instead of rewriting the
+    complete installation information file. The journal is flushed to disk before the function
+    returns, so that the changes survive if the application or the system terminates before the
+    next writeToDisk(). The journal is synchronized with the function set with
+    setJournalSyncFunction(), or with syncToDisk() if none is set.
+*/
+void LocalPackageHub::writeJournal()
+{
+    if (d->m_journalChanges.isEmpty() || d->fileName.isEmpty())
+        return;
+
+    QDomDocument doc;
+    QDomElement records = doc.createElement(QLatin1String("Journal"));
+    doc.appendChild(records);
+
+    addTextChildHelper(&records, QLatin1String("ApplicationName"), d->applicationName);
+    addTextChildHelper(&records, QLatin1String("ApplicationVersion"), d->applicationVersion);
+
+    typedef QPair<QString, bool> Change;
+    foreach (const Change &change, d->m_journalChanges) {
+        if (change.first.isNull()) {
+            records.appendChild(doc.createElement(QLatin1String("ClearPackages")));
+        } else if (!change.second) {
+            addTextChildHelper(&records, QLatin1String("RemovePackage"), change.first);
+        } else if (d->m_packageInfoMap.contains(change.first)) {
+            addPackageHelper(&records, d->m_packageInfoMap.value(change.first));
+        }
+    }
+
+    QByteArray data;
+    QTextStream stream(&data);
+    stream.setCodec("UTF-8");
+    QDomNodeList childNodes = records.childNodes();
+    for (int i = 0; i < childNodes.count(); i++)
+        childNodes.item(i).save(stream, 4);
+    stream.flush();
+
+    QFile file(journalFileName());
+    if (!file.open(QFile::WriteOnly | QFile::Append))
+        return;
+    if (file.write(data) != data.size() || !file.flush())
+        return;
+    if (!(d->m_syncJournal ? d->m_syncJournal(&file) : syncToDisk(&file)))
+        return;
+    d->m_journalChanges.clear();
+}
+
+/*!
+    Sets the function writeJournal() calls with the written journal file to \a sync, to make sure
+    the file reached the storage device. The function returns \c false if that failed. Set it if
+    the file handle does not belong to this process, for example because the file is written by
+    another process on behalf of this one. Pass an empty function to use syncToDisk() again.
+*/
+void LocalPackageHub::setJournalSyncFunction(const SyncFunction &sync)
+{
+    d->m_syncJournal = sync;
+}
+
+/*!
+    Flushes the operating system buffers of the open \a file to the storage device. Returns
+    \c true on success.
+*/
+bool LocalPackageHub::syncToDisk(QFileDevice *file)
+{
+#ifdef Q_OS_WIN
+    return FlushFileBuffers(HANDLE(_get_osfhandle(file->handle())));
+#else
+    return ::fsync(file->handle()) == 0;
+#endif
+}
+
+/*!
+    Returns the name of the journal file written by writeJournal().
+*/
+QString LocalPackageHub::journalFileName() const
+{
+    return d->fileName + QLatin1String(".journal");
 }
 
 void LocalPackageHub::PackagesInfoData::addPackageFrom(const QDomElement &packageE)
@@ -495,6 +681,8 @@ void LocalPackageHub::PackagesInfoData::addPackageFrom(const QDomElement &packag
 void LocalPackageHub::clearPackageInfos()
 {
     d->m_packageInfoMap.clear();
+    d->m_journalChanges.clear();
+    d->m_journalChanges.append(qMakePair(QString(), false));
     d->modified = true;
 }
 
@@ -36,6 +36,12 @@
 #include <QDate>
 #include <QStringList>
 
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+class QFileDevice;
+QT_END_NAMESPACE
+
 namespace KDUpdater {
 
 struct KDTOOLS_EXPORT LocalPackage
@@ -111,6 +117,13 @@ public:
 
     void refresh();
     void writeToDisk();
+    void writeJournal();
+
+    QString journalFileName() const;
+
+    typedef std::function<bool(QFileDevice *)> SyncFunction;
+    void setJournalSyncFunction(const SyncFunction &sync);
+    static bool syncToDisk(QFileDevice *file);
 
 private:
     struct PackagesInfoData;
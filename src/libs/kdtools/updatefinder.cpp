@@ -38,8 +38,11 @@
 #include "globals.h"
 
 #include <QCoreApplication>
+#include <QDir>
+#include <QEventLoop>
 #include <QFileInfo>
 #include <QRegExp>
+#include <QtConcurrentMap>
 
 using namespace KDUpdater;
 using namespace QInstaller;
@@ -69,8 +72,11 @@ public:
 
     Private(UpdateFinder *qq)
         : q(qq)
+        , cancel(false)
         , downloadCompleteCount(0)
         , m_downloadsToComplete(0)
+        , m_activeDownloads(0)
+        , m_eventLoop(nullptr)
     {}
 
     ~Private()
@@ -94,20 +100,27 @@ public:
     bool cancel;
     int downloadCompleteCount;
     int m_downloadsToComplete;
+    int m_activeDownloads;
+    QList<FileDownloader *> m_pendingDownloads;
+    QEventLoop *m_eventLoop;
     QHash<UpdatesInfo *, Data> m_updatesInfoList;
 
     void clear();
     void computeUpdates();
     void cancelComputeUpdates();
     bool downloadUpdateXMLFiles();
+    void startPendingDownloads();
     bool computeApplicableUpdates();
 
     QList<UpdateInfo> applicableUpdates(UpdatesInfo *updatesInfo);
-    void createUpdateObjects(const PackageSource &source, const QList<UpdateInfo> &updateInfoList);
-    Resolution checkPriorityAndVersion(const PackageSource &source, const QVariantHash &data) const;
+    void createUpdateObject(const PackageSource &source, const UpdateInfo &info,
+        QHash<QString, Update *> *updates) const;
+    Resolution checkPriorityAndVersion(const PackageSource &source, const QVariantHash &data,
+        const QHash<QString, Update *> &updates) const;
     void slotDownloadDone();
 
     QSet<PackageSource> packageSources;
+    QHash<QString, UpdatesInfo> parsedUpdatesInfo;
     std::weak_ptr<LocalPackageHub> m_localPackageHub;
 };
 
@@ -122,6 +135,9 @@ static int computePercent(int done, int total)
     return total ? done * Q_INT64_C(100) / total : 0 ;
 }
 
+// Updates.xml files fetched at the same time, the others wait for one of them to finish.
+static const int MaxConcurrentDownloads = 6;
+
 /*!
    \internal
 
@@ -141,6 +157,8 @@ void UpdateFinder::Private::clear()
 
     downloadCompleteCount = 0;
     m_downloadsToComplete = 0;
+    m_activeDownloads = 0;
+    m_pendingDownloads.clear();
 }
 
 /*!
@@ -220,26 +238,38 @@ void UpdateFinder::Private::computeUpdates()
 void UpdateFinder::Private::cancelComputeUpdates()
 {
     cancel = true;
+    const QList<FileDownloader *> pending = m_pendingDownloads;
+    m_pendingDownloads.clear();
+    foreach (const Data &data, m_updatesInfoList) {
+        FileDownloader *downloader = data.downloader;
+        if (downloader && !downloader->isDownloaded() && !pending.contains(downloader))
+            downloader->cancelDownload();
+    }
+    if (m_eventLoop)
+        m_eventLoop->quit();
 }
 
 /*!
    \internal
 
    This function downloads Updates.xml from all the update sources except local files.
-   A single application can potentially have several update sources, hence we need to be
-   asynchronous in downloading updates from different sources.
 
    The function basically does this for each update source:
    a) Create a KDUpdater::FileDownloader and KDUpdater::UpdatesInfo for each update
-   b) Triggers the download of Updates.xml from each file downloader.
+   b) Triggers the download of Updates.xml from each file downloader, at most
+   MaxConcurrentDownloads at a time.
    c) The downloadCompleted(), downloadCanceled() and downloadAborted() signals are connected
-   in each of the downloaders. Once all the downloads are complete and/or aborted, the next stage
-   would be done.
+   in each of the downloaders. Each of them starts the next pending download. Once all the
+   downloads are complete and/or aborted, the next stage would be done.
+   d) Parses the downloaded and the local Updates.xml files in parallel.
 
-   The function gets into an event loop until all the downloads are complete.
+   The function waits in an event loop until all the downloads are complete. The loop sleeps
+   until one of the downloaders reports back, instead of polling.
 */
 bool UpdateFinder::Private::downloadUpdateXMLFiles()
 {
+    QList<QPair<UpdatesInfo *, QString> > files;
+
     // create UpdatesInfo for each update source
     foreach (const PackageSource &info, packageSources) {
         const QUrl url = QString::fromLatin1("%1/Updates.xml").arg(info.url.toString());
@@ -255,35 +285,39 @@ bool UpdateFinder::Private::downloadUpdateXMLFiles()
             connect(downloader, SIGNAL(downloadCompleted()), q, SLOT(slotDownloadDone()));
             connect(downloader, SIGNAL(downloadAborted(QString)), q, SLOT(slotDownloadDone()));
             m_updatesInfoList.insert(new UpdatesInfo, Data(info, downloader));
+            m_pendingDownloads.append(downloader);
         } else {
-            UpdatesInfo *updatesInfo = new UpdatesInfo;
-            updatesInfo->setFileName(QInstaller::pathFromUrl(url));
-            m_updatesInfoList.insert(updatesInfo, Data(info));
+            // the file might have been parsed by the caller already
+            const QString fileName = QDir::cleanPath(QInstaller::pathFromUrl(url));
+            const auto parsed = parsedUpdatesInfo.constFind(fileName);
+            if (parsed != parsedUpdatesInfo.constEnd()) {
+                m_updatesInfoList.insert(new UpdatesInfo(parsed.value()), Data(info));
+            } else {
+                UpdatesInfo *updatesInfo = new UpdatesInfo;
+                m_updatesInfoList.insert(updatesInfo, Data(info));
+                files.append(qMakePair(updatesInfo, fileName));
+            }
         }
     }
 
     // Trigger download of Updates.xml file
     downloadCompleteCount = 0;
-    m_downloadsToComplete = 0;
-    foreach (const Data &data, m_updatesInfoList) {
-        if (data.downloader) {
-            m_downloadsToComplete++;
-            data.downloader->download();
-        }
+    m_activeDownloads = 0;
+    m_downloadsToComplete = m_pendingDownloads.count();
+    if (m_downloadsToComplete > 0) {
+        q->reportProgress(0, tr("Downloading Updates.xml from update sources."));
+        startPendingDownloads();
     }
 
     // Wait until all downloaders have completed their downloads.
-    while (true) {
-        QCoreApplication::processEvents();
-        if (cancel)
-            return false;
-
-        if (downloadCompleteCount == m_downloadsToComplete)
-            break;
-
-        q->reportProgress(computePercent(downloadCompleteCount, m_downloadsToComplete),
-            tr("Downloading Updates.xml from update sources."));
+    if (!cancel && downloadCompleteCount < m_downloadsToComplete) {
+        QEventLoop loop;
+        m_eventLoop = &loop;
+        loop.exec();
+        m_eventLoop = nullptr;
     }
+    if (cancel)
+        return false;
 
     // Setup the update info objects with the files from download.
     foreach (UpdatesInfo *updatesInfo, m_updatesInfoList.keys()) {
@@ -293,11 +327,16 @@ bool UpdateFinder::Private::downloadUpdateXMLFiles()
                 q->reportError(tr("Cannot download package source %1 from \"%2\".").arg(data
                     .downloader->url().fileName(), data.info.url.toString()));
             } else {
-                updatesInfo->setFileName(data.downloader->downloadedFileName());
+                files.append(qMakePair(updatesInfo, data.downloader->downloadedFileName()));
             }
         }
     }
 
+    // Every source not parsed by the caller already is parsed on its own.
+    QtConcurrent::blockingMap(files, [](const QPair<UpdatesInfo *, QString> &file) {
+        file.first->setFileName(file.second);
+    });
+
     // Remove all invalid update info objects.
     QMutableHashIterator<UpdatesInfo *, Data> it(m_updatesInfoList);
     while (it.hasNext()) {
@@ -317,6 +356,19 @@ bool UpdateFinder::Private::downloadUpdateXMLFiles()
     return true;
 }
 
+/*!
+   \internal
+
+   Starts pending downloads until MaxConcurrentDownloads are running.
+*/
+void UpdateFinder::Private::startPendingDownloads()
+{
+    while (!cancel && m_activeDownloads < MaxConcurrentDownloads && !m_pendingDownloads.isEmpty()) {
+        ++m_activeDownloads;
+        m_pendingDownloads.takeFirst()->download();
+    }
+}
+
 /*!
    \internal
 
@@ -324,30 +376,24 @@ bool UpdateFinder::Private::downloadUpdateXMLFiles()
    the downloadUpdateXMLFiles() method and compares it with the data contained in
    KDUpdater::PackagesInfo. Thereby figures out whether an update is applicable for
    this application or not.
+
+   The applicable updates are looked up for all sources in parallel, the update objects are
+   then created walking the sources in order.
 */
 bool UpdateFinder::Private::computeApplicableUpdates()
 {
-    int i = 0;
-    foreach (UpdatesInfo *updatesInfo, m_updatesInfoList.keys()) {
-        // Fetch updates applicable to this application.
-        QList<UpdateInfo> updates = applicableUpdates(updatesInfo);
-        if (!updates.count())
-            continue;
-
-        if (cancel)
-            return false;
-        const PackageSource updateSource = m_updatesInfoList.value(updatesInfo).info;
-
-        // Create Update objects for updates that have a valid
-        // UpdateFile
-        createUpdateObjects(updateSource, updates);
-        if (cancel)
-            return false;
+    // Fetch updates applicable to this application.
+    const QList<UpdatesInfo *> sources = m_updatesInfoList.keys();
+    const QList<QList<UpdateInfo> > applicable = QtConcurrent::blockingMapped<QList<QList<UpdateInfo> > >
+        (sources, [this](UpdatesInfo *updatesInfo) { return applicableUpdates(updatesInfo); });
+    if (cancel)
+        return false;
+    q->reportProgress(75, tr("Computing applicable updates."));
 
-        // Report progress
-        q->reportProgress(computeProgressPercentage(51, 100, computePercent(i,
-            m_updatesInfoList.count())), tr("Computing applicable updates."));
-        ++i;
+    for (int i = 0; i < sources.count(); ++i) {
+        const PackageSource source = m_updatesInfoList.value(sources.at(i)).info;
+        foreach (const UpdateInfo &info, applicable.at(i))
+            createUpdateObject(source, info, &updates);
     }
 
     q->reportProgress(99, tr("Application updates computed."));
@@ -383,22 +429,20 @@ QList<UpdateInfo> UpdateFinder::Private::applicableUpdates(UpdatesInfo *updatesI
     return updatesInfo->updatesInfo();
 }
 
-void UpdateFinder::Private::createUpdateObjects(const PackageSource &source,
-    const QList<UpdateInfo> &updateInfoList)
+void UpdateFinder::Private::createUpdateObject(const PackageSource &source,
+    const UpdateInfo &info, QHash<QString, Update *> *updates) const
 {
-    foreach (const UpdateInfo &info, updateInfoList) {
-        const Resolution value = checkPriorityAndVersion(source, info.data);
-        if (value == Resolution::KeepExisting)
-            continue;
+    const Resolution value = checkPriorityAndVersion(source, info.data, *updates);
+    if (value == Resolution::KeepExisting)
+        return;
 
-        const QString name = info.data.value(QLatin1String("Name")).toString();
-        if (value == Resolution::RemoveExisting)
-            delete updates.take(name);
+    const QString name = info.data.value(QLatin1String("Name")).toString();
+    if (value == Resolution::RemoveExisting)
+        delete updates->take(name);
 
-        // Create and register the update
-        if (!q->isCompressedPackage() || value == Resolution::AddPackage)
-            updates.insert(name, new Update(source, info));
-    }
+    // Create and register the update
+    if (!q->isCompressedPackage() || value == Resolution::AddPackage)
+        updates->insert(name, new Update(source, info));
 }
 
 /*
@@ -407,7 +451,8 @@ void UpdateFinder::Private::createUpdateObjects(const PackageSource &source,
     priority, use the new new package, otherwise keep the already existing package.
 */
 UpdateFinder::Private::Resolution UpdateFinder::Private::checkPriorityAndVersion(
-    const PackageSource &source, const QVariantHash &newPackage) const
+    const PackageSource &source, const QVariantHash &newPackage,
+    const QHash<QString, Update *> &updates) const
 {
     const QString name = newPackage.value(QLatin1String("Name")).toString();
     if (Update *existingPackage = updates.value(name)) {
@@ -489,6 +534,19 @@ void UpdateFinder::setPackageSources(const QSet<PackageSource> &sources)
     d->packageSources = sources;
 }
 
+/*!
+    Sets the already parsed Updates.xml files in \a updatesInfo. Local package sources whose
+    Updates.xml is among them use the parsed content instead of reading the file again.
+*/
+void UpdateFinder::setParsedUpdatesInfo(const QList<UpdatesInfo> &updatesInfo)
+{
+    d->parsedUpdatesInfo.clear();
+    foreach (const UpdatesInfo &info, updatesInfo) {
+        if (!info.fileName().isEmpty())
+            d->parsedUpdatesInfo.insert(QDir::cleanPath(info.fileName()), info);
+    }
+}
+
 /*!
    \internal
 
@@ -542,10 +600,15 @@ bool UpdateFinder::doResume()
 void UpdateFinder::Private::slotDownloadDone()
 {
     ++downloadCompleteCount;
+    --m_activeDownloads;
 
     int pc = computePercent(downloadCompleteCount, m_downloadsToComplete);
     pc = computeProgressPercentage(0, 45, pc);
     q->reportProgress( pc, tr("Downloading Updates.xml from update sources.") );
+
+    startPendingDownloads();
+    if (downloadCompleteCount == m_downloadsToComplete && m_eventLoop)
+        m_eventLoop->quit();
 }
 
 
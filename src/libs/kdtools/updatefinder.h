@@ -32,6 +32,7 @@
 
 #include "task.h"
 #include "packagesource.h"
+#include "updatesinfo_p.h"
 
 #include <memory>
 
@@ -53,6 +54,7 @@ public:
 
     void setLocalPackageHub(std::weak_ptr<LocalPackageHub> hub);
     void setPackageSources(const QSet<QInstaller::PackageSource> &sources);
+    void setParsedUpdatesInfo(const QList<UpdatesInfo> &updatesInfo);
     void addCompressedPackage(bool add) { m_compressedPackage = add; }
     bool isCompressedPackage() { return m_compressedPackage; }
 private:
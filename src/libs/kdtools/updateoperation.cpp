@@ -385,12 +385,29 @@ bool UpdateOperation::deleteFileNowOrLater(const QString &file, QString *errorSt
     Returns \c true if the operation is successful.
 */
 
+/*!
+    Returns the values set via UpdateOperation::setValue() that are saved together with the
+    operation, both by toXml() and in the binary operation log of the maintenance tool. The
+    default implementation returns all values except the \c installer object. Override this
+    method to keep values that are only needed while the operation runs out of the saved state.
+*/
+QVariantMap UpdateOperation::persistentValues() const
+{
+    QVariantMap values = m_values;
+    // the installer can't be saved, ignore
+    values.remove(QLatin1String("installer"));
+    return values;
+}
+
 /*!
     Saves operation arguments and values as an XML document and returns the
     document. You can override this method to store your
     own extra-data. Extra-data can be any data that you need to store to perform or undo the
-    operation. The default implementation is taking care of arguments and values set via
-    UpdateOperation::setValue().
+    operation. The default implementation is taking care of arguments and the values returned
+    by persistentValues().
+
+    \note The maintenance tool stores the arguments and persistentValues() of an operation in
+    a binary log, extra-data needs to be kept in values to survive there.
 */
 QDomDocument UpdateOperation::toXml() const
 {
@@ -407,16 +424,13 @@ QDomDocument UpdateOperation::toXml() const
         args.appendChild(arg);
     }
     root.appendChild(args);
-    if (m_values.isEmpty())
+    const QVariantMap persistent = persistentValues();
+    if (persistent.isEmpty())
         return doc;
 
     // append all values set with setValue
     QDomElement values = doc.createElement(QLatin1String("values"));
-    for (QVariantMap::const_iterator it = m_values.constBegin(); it != m_values.constEnd(); ++it) {
-        // the installer can't be put into XML, ignore
-        if (it.key() == QLatin1String("installer"))
-            continue;
-
+    for (QVariantMap::const_iterator it = persistent.constBegin(); it != persistent.constEnd(); ++it) {
         QDomElement value = doc.createElement(QLatin1String("value"));
         QVariant variant = it.value();
         value.setAttribute(QLatin1String("name"), it.key());
@@ -79,6 +79,8 @@ public:
     virtual bool undoOperation() = 0;
     virtual bool testOperation() = 0;
 
+    virtual QVariantMap persistentValues() const;
+
     virtual QDomDocument toXml() const;
     virtual bool fromXml(const QString &xml);
     virtual bool fromXml(const QDomDocument &doc);
@@ -45,7 +45,7 @@ public:
     bool undoOperation();
     bool testOperation();
 
-    QDomDocument toXml() const;
+    QVariantMap persistentValues() const;
 private:
     QString sourcePath();
     QString destinationPath();
@@ -76,7 +76,7 @@ public:
     bool undoOperation();
     bool testOperation();
 
-    QDomDocument toXml() const;
+    QVariantMap persistentValues() const;
 };
 
 class KDTOOLS_EXPORT MkdirOperation : public UpdateOperation
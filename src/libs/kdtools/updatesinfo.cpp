@@ -29,17 +29,18 @@
 #include "updatesinfo_p.h"
 #include "utils.h"
 
-#include <QDomDocument>
 #include <QFile>
 #include <QLocale>
 #include <QPair>
 #include <QVector>
 #include <QUrl>
+#include <QXmlStreamReader>
 
 using namespace KDUpdater;
 
 UpdatesInfoData::UpdatesInfoData()
      : error(UpdatesInfo::NotYetReadError)
+     , hasChecksum(false)
 {
 }
 
@@ -62,37 +63,32 @@ void UpdatesInfoData::parseFile(const QString &updateXmlFile)
         return;
     }
 
-    QDomDocument doc;
-    QString parseErrorMessage;
-    int parseErrorLine, parseErrorColumn;
-    if (!doc.setContent(&file, &parseErrorMessage, &parseErrorLine, &parseErrorColumn)) {
-        error = UpdatesInfo::InvalidXmlError;
-        errorMessage = tr("Parse error in %1 at %2, %3: %4").arg(updateXmlFile,
-            QString::number(parseErrorLine), QString::number(parseErrorColumn), parseErrorMessage);
-        return;
-    }
+    QXmlStreamReader reader(&file);
+    reader.setNamespaceProcessing(false);
 
-    QDomElement rootE = doc.documentElement();
-    if (rootE.tagName() != QLatin1String("Updates")) {
-        setInvalidContentError(tr("Root element %1 unexpected, should be \"Updates\".").arg(rootE.tagName()));
-        return;
+    bool validContent = false;
+    if (reader.readNextStartElement()) {
+        if (reader.qualifiedName() != QLatin1String("Updates")) {
+            setInvalidContentError(tr("Root element %1 unexpected, should be \"Updates\".")
+                .arg(reader.qualifiedName().toString()));
+        } else {
+            validContent = parseUpdatesElement(reader);
+        }
     }
+    strings.clear();
 
-    QDomNodeList childNodes = rootE.childNodes();
-    for(int i = 0; i < childNodes.count(); i++) {
-        const QDomElement childE = childNodes.at(i).toElement();
-        if (childE.isNull())
-            continue;
-
-        if (childE.tagName() == QLatin1String("ApplicationName"))
-            applicationName = childE.text();
-        else if (childE.tagName() == QLatin1String("ApplicationVersion"))
-            applicationVersion = childE.text();
-        else if (childE.tagName() == QLatin1String("PackageUpdate")) {
-            if (!parsePackageUpdateElement(childE))
-                return; //error handled in subroutine
-        }
+    // a syntax error anywhere in the file takes precedence over invalid content
+    while (!reader.atEnd())
+        reader.readNext();
+    if (reader.hasError()) {
+        error = UpdatesInfo::InvalidXmlError;
+        errorMessage = tr("Parse error in %1 at %2, %3: %4").arg(updateXmlFile,
+            QString::number(reader.lineNumber()), QString::number(reader.columnNumber()),
+            reader.errorString());
+        return;
     }
+    if (!validContent)
+        return; //error handled in subroutine
 
     if (applicationName.isEmpty()) {
         setInvalidContentError(tr("ApplicationName element is missing."));
@@ -108,56 +104,85 @@ void UpdatesInfoData::parseFile(const QString &updateXmlFile)
     error = UpdatesInfo::NoError;
 }
 
-bool UpdatesInfoData::parsePackageUpdateElement(const QDomElement &updateE)
+bool UpdatesInfoData::parseUpdatesElement(QXmlStreamReader &reader)
 {
-    if (updateE.isNull())
-        return false;
+    QStringList languages;
+    foreach (const QString &lang, QLocale().uiLanguages())
+        languages << QInstaller::localeCandidates(lang.toLower());
+
+    bool repositoryUpdateFound = false;
+    while (reader.readNextStartElement()) {
+        const QStringRef tagName = reader.qualifiedName();
+        if (tagName == QLatin1String("ApplicationName")) {
+            applicationName = elementText(reader);
+        } else if (tagName == QLatin1String("ApplicationVersion")) {
+            applicationVersion = elementText(reader);
+        } else if (tagName == QLatin1String("Checksum") && !hasChecksum) {
+            hasChecksum = true;
+            checksum = elementText(reader);
+        } else if (tagName == QLatin1String("RepositoryUpdate") && !repositoryUpdateFound) {
+            repositoryUpdateFound = true;
+            parseRepositoryUpdateElement(reader);
+        } else if (tagName == QLatin1String("PackageUpdate")) {
+            if (!parsePackageUpdateElement(reader, languages))
+                return false; //error handled in subroutine
+        } else {
+            reader.skipCurrentElement();
+        }
+    }
+    return !reader.hasError();
+}
 
+bool UpdatesInfoData::parsePackageUpdateElement(QXmlStreamReader &reader,
+    const QStringList &languages)
+{
     UpdateInfo info;
     QMap<QString, QString> localizedDescriptions;
-    for (int i = 0; i < updateE.childNodes().count(); i++) {
-        QDomElement childE = updateE.childNodes().at(i).toElement();
-        if (childE.isNull())
-            continue;
+    while (reader.readNextStartElement()) {
+        const QString tagName = intern(reader.qualifiedName().toString());
+        const QXmlStreamAttributes attributes = reader.attributes();
 
-        if (childE.tagName() == QLatin1String("ReleaseNotes")) {
-            info.data[childE.tagName()] = QUrl(childE.text());
-        } else if (childE.tagName() == QLatin1String("Licenses")) {
+        if (tagName == QLatin1String("ReleaseNotes")) {
+            info.data[tagName] = QUrl(elementText(reader));
+        } else if (tagName == QLatin1String("Licenses")) {
             QHash<QString, QVariant> licenseHash;
-            const QDomNodeList licenseNodes = childE.childNodes();
-            for (int i = 0; i < licenseNodes.count(); ++i) {
-                const QDomNode licenseNode = licenseNodes.at(i);
-                if (licenseNode.nodeName() == QLatin1String("License")) {
-                    QDomElement element = licenseNode.toElement();
-                    licenseHash.insert(element.attributeNode(QLatin1String("name")).value(),
-                        element.attributeNode(QLatin1String("file")).value());
+            while (reader.readNextStartElement()) {
+                if (reader.qualifiedName() == QLatin1String("License")) {
+                    licenseHash.insert(reader.attributes().value(QLatin1String("name")).toString(),
+                        reader.attributes().value(QLatin1String("file")).toString());
                 }
+                reader.skipCurrentElement();
             }
             if (!licenseHash.isEmpty())
                 info.data.insert(QLatin1String("Licenses"), licenseHash);
-        } else if (childE.tagName() == QLatin1String("Version")) {
-            info.data.insert(QLatin1String("inheritVersionFrom"),
-                childE.attribute(QLatin1String("inheritVersionFrom")));
-            info.data[childE.tagName()] = childE.text();
-        } else if (childE.tagName() == QLatin1String("DisplayName")) {
-            processLocalizedTag(childE, info.data);
-        } else if (childE.tagName() == QLatin1String("Description")) {
-            if (!childE.hasAttribute(QLatin1String("xml:lang")))
-                info.data[QLatin1String("Description")] = childE.text();
-            QString languageAttribute = childE.attribute(QLatin1String("xml:lang"), QLatin1String("en"));
-            localizedDescriptions.insert(languageAttribute.toLower(), childE.text());
-        } else if (childE.tagName() == QLatin1String("UpdateFile")) {
-            info.data[QLatin1String("CompressedSize")] = childE.attribute(QLatin1String("CompressedSize"));
-            info.data[QLatin1String("UncompressedSize")] = childE.attribute(QLatin1String("UncompressedSize"));
+        } else if (tagName == QLatin1String("Version")) {
+            info.data.insert(intern(QLatin1String("inheritVersionFrom")),
+                intern(attributes.value(QLatin1String("inheritVersionFrom")).toString()));
+            info.data[tagName] = intern(elementText(reader));
+        } else if (tagName == QLatin1String("DisplayName")) {
+            const QString language = attributes.value(QLatin1String("xml:lang")).toString();
+            processLocalizedTag(tagName, language.toLower(), elementText(reader), info.data);
+        } else if (tagName == QLatin1String("Description")) {
+            const QString text = elementText(reader);
+            if (!attributes.hasAttribute(QLatin1String("xml:lang")))
+                info.data[tagName] = text;
+            const QString language = attributes.hasAttribute(QLatin1String("xml:lang"))
+                ? attributes.value(QLatin1String("xml:lang")).toString() : QLatin1String("en");
+            localizedDescriptions.insert(language.toLower(), text);
+        } else if (tagName == QLatin1String("UpdateFile")) {
+            info.data[intern(QLatin1String("CompressedSize"))]
+                = intern(attributes.value(QLatin1String("CompressedSize")).toString());
+            info.data[intern(QLatin1String("UncompressedSize"))]
+                = intern(attributes.value(QLatin1String("UncompressedSize")).toString());
+            reader.skipCurrentElement();
         } else {
-            info.data[childE.tagName()] = childE.text();
+            info.data[tagName] = intern(elementText(reader));
         }
     }
+    if (reader.hasError())
+        return false;
 
-    QStringList candidates;
-    foreach (const QString &lang, QLocale().uiLanguages())
-        candidates << QInstaller::localeCandidates(lang.toLower());
-    foreach (const QString &candidate, candidates) {
+    foreach (const QString &candidate, languages) {
         if (localizedDescriptions.contains(candidate)) {
             info.data[QLatin1String("Description")] = localizedDescriptions.value(candidate);
             break;
@@ -181,15 +206,78 @@ bool UpdatesInfoData::parsePackageUpdateElement(const QDomElement &updateE)
     return true;
 }
 
-void UpdatesInfoData::processLocalizedTag(const QDomElement &childE, QHash<QString, QVariant> &info) const
+void UpdatesInfoData::parseRepositoryUpdateElement(QXmlStreamReader &reader)
+{
+    while (reader.readNextStartElement()) {
+        if (reader.qualifiedName() == QLatin1String("Repository")) {
+            RepositoryUpdateInfo update;
+            update.lineNumber = reader.lineNumber();
+            foreach (const QXmlStreamAttribute &attribute, reader.attributes()) {
+                update.attributes.insert(attribute.qualifiedName().toString(),
+                    attribute.value().toString());
+            }
+            repositoryUpdates.append(update);
+        }
+        reader.skipCurrentElement();
+    }
+}
+
+/*
+    Returns a copy of \a string that shares its data with equal strings seen before. Package
+    records repeat the same element names, and often the same short values, thousands of times.
+*/
+QString UpdatesInfoData::intern(const QString &string)
+{
+    if (string.size() > 64)
+        return string;
+    const QSet<QString>::const_iterator it = strings.constFind(string);
+    if (it != strings.constEnd())
+        return *it;
+    strings.insert(string);
+    return string;
+}
+
+/*
+    Returns the text of the current element and all its child elements, leaving the reader on its
+    end element. Like QDomDocument, text nodes made of whitespace only are dropped, all others are
+    kept as they are.
+*/
+QString UpdatesInfoData::elementText(QXmlStreamReader &reader)
+{
+    QString text;
+    QString node; // the reader may split the text of one node, for example at entity references
+    bool keepNode = false;
+    int depth = 1;
+    while (depth > 0 && !reader.atEnd()) {
+        const QXmlStreamReader::TokenType token = reader.readNext();
+        if (token == QXmlStreamReader::Characters) {
+            node += reader.text();
+            keepNode = keepNode || reader.isCDATA() || !reader.isWhitespace();
+            continue;
+        }
+
+        if (keepNode)
+            text += node;
+        node.clear();
+        keepNode = false;
+
+        if (token == QXmlStreamReader::StartElement)
+            ++depth;
+        else if (token == QXmlStreamReader::EndElement)
+            --depth;
+    }
+    return text;
+}
+
+void UpdatesInfoData::processLocalizedTag(const QString &tagName, const QString &language,
+    const QString &text, QHash<QString, QVariant> &info) const
 {
-    QString languageAttribute = childE.attribute(QLatin1String("xml:lang")).toLower();
-    if (!info.contains(childE.tagName()) && (languageAttribute.isEmpty()))
-        info[childE.tagName()] = childE.text();
+    if (!info.contains(tagName) && (language.isEmpty()))
+        info[tagName] = text;
 
     // overwrite default if we have a language specific description
-    if (QLocale().name().startsWith(languageAttribute, Qt::CaseInsensitive))
-        info[childE.tagName()] = childE.text();
+    if (QLocale().name().startsWith(language, Qt::CaseInsensitive))
+        info[tagName] = text;
 }
 
 
@@ -210,6 +298,11 @@ bool UpdatesInfo::isValid() const
     return d->error == NoError;
 }
 
+UpdatesInfo::Error UpdatesInfo::error() const
+{
+    return Error(d->error);
+}
+
 QString UpdatesInfo::errorString() const
 {
     return d->errorMessage;
@@ -222,7 +315,10 @@ void UpdatesInfo::setFileName(const QString &updateXmlFile)
 
     d->applicationName.clear();
     d->applicationVersion.clear();
+    d->hasChecksum = false;
+    d->checksum.clear();
     d->updateInfoList.clear();
+    d->repositoryUpdates.clear();
 
     d->updateXmlFile = updateXmlFile;
     d->parseFile(d->updateXmlFile);
@@ -243,6 +339,21 @@ QString UpdatesInfo::applicationVersion() const
     return d->applicationVersion;
 }
 
+bool UpdatesInfo::hasChecksum() const
+{
+    return d->hasChecksum;
+}
+
+QString UpdatesInfo::checksum() const
+{
+    return d->checksum;
+}
+
+QList<RepositoryUpdateInfo> UpdatesInfo::repositoryUpdates() const
+{
+    return d->repositoryUpdates;
+}
+
 int UpdatesInfo::updateInfoCount() const
 {
     return d->updateInfoList.count();
@@ -46,6 +46,12 @@ struct KDTOOLS_EXPORT UpdateInfo
     QHash<QString, QVariant> data;
 };
 
+struct KDTOOLS_EXPORT RepositoryUpdateInfo
+{
+    QHash<QString, QString> attributes;
+    qint64 lineNumber;
+};
+
 class KDTOOLS_EXPORT UpdatesInfo
 {
 public:
@@ -72,6 +78,10 @@ public:
     QString applicationName() const;
     QString applicationVersion() const;
 
+    bool hasChecksum() const;
+    QString checksum() const;
+    QList<RepositoryUpdateInfo> repositoryUpdates() const;
+
     int updateInfoCount() const;
     UpdateInfo updateInfo(int index) const;
     QList<UpdateInfo> updatesInfo() const;
@@ -30,13 +30,15 @@
 #define UPDATESINFODATA_P_H
 
 #include <QCoreApplication>
+#include <QSet>
 #include <QSharedData>
 
-QT_FORWARD_DECLARE_CLASS(QDomElement)
+QT_FORWARD_DECLARE_CLASS(QXmlStreamReader)
 
 namespace KDUpdater {
 
 struct UpdateInfo;
+struct RepositoryUpdateInfo;
 
 struct UpdatesInfoData : public QSharedData
 {
@@ -51,15 +53,25 @@ public:
     QString updateXmlFile;
     QString applicationName;
     QString applicationVersion;
+    bool hasChecksum;
+    QString checksum;
     QList<UpdateInfo> updateInfoList;
+    QList<RepositoryUpdateInfo> repositoryUpdates;
 
     void parseFile(const QString &updateXmlFile);
-    bool parsePackageUpdateElement(const QDomElement &updateE);
+    bool parseUpdatesElement(QXmlStreamReader &reader);
+    bool parsePackageUpdateElement(QXmlStreamReader &reader, const QStringList &languages);
+    void parseRepositoryUpdateElement(QXmlStreamReader &reader);
 
     void setInvalidContentError(const QString &detail);
 
 private:
-    void processLocalizedTag(const QDomElement &childE, QHash<QString, QVariant> &info) const;
+    QString intern(const QString &string);
+    QString elementText(QXmlStreamReader &reader);
+    void processLocalizedTag(const QString &tagName, const QString &language, const QString &text,
+        QHash<QString, QVariant> &info) const;
+
+    QSet<QString> strings; // shares equal keys and short values while parsing
 };
 
 } // namespace KDUpdater
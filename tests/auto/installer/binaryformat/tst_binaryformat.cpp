@@ -30,6 +30,7 @@
 #include <binaryformat.h>
 #include <errors.h>
 #include <fileio.h>
+#include <operationlog.h>
 #include <updateoperation.h>
 
 #include <QTest>
@@ -392,6 +393,173 @@ private slots:
         resource->close();
     }
 
+    void testMappedResource()
+    {
+        QFile file(m_binary);
+        QInstaller::openForRead(&file);
+
+        qint64 magicMarker;
+        QList<OperationBlob> operations;
+        ResourceCollectionManager manager;
+        BinaryContent::readBinaryContent(&file, &operations, &manager, &magicMarker,
+            m_layout.magicCookie);
+        file.close();
+
+        QSharedPointer<Resource> resource1 = manager.collectionByName(QByteArray("Collection 1"))
+            .resourceByName(QByteArray("Resource 1"));
+        QSharedPointer<Resource> resource2 = manager.collectionByName(QByteArray("Collection 2"))
+            .resourceByName(QByteArray("Resource 2"));
+        QCOMPARE(resource1->isMapped(), false);
+        QCOMPARE(resource1->constData(), static_cast<const char *>(nullptr));
+
+        QCOMPARE(resource1->open(), true);
+        QCOMPARE(resource2->open(), true);
+        QCOMPARE(resource1->isMapped(), true);
+        QCOMPARE(resource2->isMapped(), true);
+
+        // both resources share the mapping of the binary
+        QCOMPARE(qint64(resource2->constData() - resource1->constData()),
+            resource2->segment().start() - resource1->segment().start());
+        QCOMPARE(resource1->view(), QByteArray("Collection 1, Resource 1."));
+
+        QCOMPARE(resource2->seek(14), true);
+        QCOMPARE(resource2->read(8), QByteArray("Resource"));
+
+        QTemporaryFile target;
+        QInstaller::openForWrite(&target);
+        resource2->copyData(&target);
+        target.close();
+        QInstaller::openForRead(&target);
+        QCOMPARE(target.readAll(), QByteArray(" 2."));
+
+        resource1->close();
+        resource2->close();
+        QCOMPARE(resource1->isMapped(), false);
+    }
+
+    void testOperationLog()
+    {
+        TestOperation op1(QLatin1String("Operation 1"));
+        op1.setArguments(QStringList() << QLatin1String("arg1") << QLatin1String("arg2"));
+        op1.setValue(QLatin1String("key"), QLatin1String("arg1"));
+        op1.setValue(QLatin1String("list"), QStringList() << QLatin1String("a")
+            << QLatin1String("arg2"));
+        op1.setValue(QLatin1String("number"), 42);
+        op1.setValue(QLatin1String("variants"), QVariantList() << 1 << QLatin1String("b"));
+
+        TestOperation op2(QLatin1String("Operation 2"));
+        op2.setArguments(QStringList() << QLatin1String("arg1") << QString());
+        op2.setValue(QLatin1String("key"), QLatin1String("Operation 2 value."));
+
+        QTemporaryFile file;
+        QInstaller::openForWrite(&file);
+        OperationLog::write(&file, OperationList() << &op1 << &op2);
+        QInstaller::appendInt64(&file, 0);
+        const qint64 size = file.pos();
+        file.close();
+
+        QInstaller::openForRead(&file);
+        QSharedPointer<OperationLog> log = OperationLog::read(&file);
+        QVERIFY(!log.isNull());
+        QCOMPARE(file.pos(), size - qint64(sizeof(qint64)));
+        QCOMPARE(log->count(), 2);
+        QCOMPARE(log->name(0), op1.name());
+        QCOMPARE(log->name(1), op2.name());
+
+        TestOperation restored1(log->name(0));
+        QVERIFY(log->restore(0, &restored1));
+        QCOMPARE(restored1.arguments(), op1.arguments());
+        QCOMPARE(restored1.persistentValues(), op1.persistentValues());
+        QCOMPARE(restored1.value(QLatin1String("number")).type(), QVariant::Int);
+
+        TestOperation restored2(log->name(1));
+        QVERIFY(log->restore(1, &restored2));
+        QCOMPARE(restored2.arguments(), op2.arguments());
+        QCOMPARE(restored2.persistentValues(), op2.persistentValues());
+
+        // the XML based log starts with the operation count
+        QVERIFY(file.seek(size - qint64(sizeof(qint64))));
+        QVERIFY(OperationLog::read(&file).isNull());
+    }
+
+    void testOperationLogComponentIndex()
+    {
+        TestOperation op1(QLatin1String("Operation 1"));
+        op1.setValue(QLatin1String("component"), QLatin1String("A"));
+        TestOperation op2(QLatin1String("Operation 2"));
+        TestOperation op3(QLatin1String("Operation 3"));
+        op3.setValue(QLatin1String("component"), QLatin1String("B"));
+        TestOperation op4(QLatin1String("Operation 4"));
+        op4.setValue(QLatin1String("component"), QLatin1String("A"));
+
+        QTemporaryFile file;
+        QInstaller::openForWrite(&file);
+        OperationLog::write(&file, OperationList() << &op1 << &op2 << &op3 << &op4);
+        file.close();
+
+        QInstaller::openForRead(&file);
+        QSharedPointer<OperationLog> log = OperationLog::read(&file);
+        QVERIFY(!log.isNull());
+        QCOMPARE(log->component(0), QLatin1String("A"));
+        QCOMPARE(log->component(1), QString());
+        QCOMPARE(log->component(2), QLatin1String("B"));
+        QCOMPARE(log->component(3), QLatin1String("A"));
+    }
+
+    void testOperationLogCopy()
+    {
+        TestOperation op1(QLatin1String("Operation 1"));
+        op1.setArguments(QStringList() << QLatin1String("arg1") << QLatin1String("arg2"));
+        op1.setValue(QLatin1String("component"), QLatin1String("A"));
+        op1.setValue(QLatin1String("list"), QStringList() << QLatin1String("a")
+            << QLatin1String("arg2"));
+        op1.setValue(QLatin1String("number"), 42);
+        op1.setValue(QLatin1String("variants"), QVariantList() << 1 << QLatin1String("b"));
+        TestOperation op2(QLatin1String("Operation 2"));
+        op2.setValue(QLatin1String("component"), QLatin1String("B"));
+
+        QTemporaryFile file;
+        QInstaller::openForWrite(&file);
+        OperationLog::write(&file, OperationList() << &op1 << &op2);
+        file.close();
+
+        QInstaller::openForRead(&file);
+        QSharedPointer<OperationLog> log = OperationLog::read(&file);
+        QVERIFY(!log.isNull());
+
+        // keep the first operation of the log and put a new one in front of it
+        TestOperation op3(QLatin1String("Operation 3"));
+        op3.setArguments(QStringList() << QLatin1String("arg3"));
+
+        OperationLog::Writer writer;
+        writer.append(&op3);
+        QVERIFY(writer.append(*log, 0));
+
+        QTemporaryFile copy;
+        QInstaller::openForWrite(&copy);
+        writer.write(&copy);
+        copy.close();
+
+        QInstaller::openForRead(&copy);
+        QSharedPointer<OperationLog> copied = OperationLog::read(&copy);
+        QVERIFY(!copied.isNull());
+        QCOMPARE(copied->count(), 2);
+        QCOMPARE(copied->name(0), op3.name());
+        QCOMPARE(copied->component(0), QString());
+        QCOMPARE(copied->name(1), op1.name());
+        QCOMPARE(copied->component(1), QLatin1String("A"));
+
+        TestOperation restored3(copied->name(0));
+        QVERIFY(copied->restore(0, &restored3));
+        QCOMPARE(restored3.arguments(), op3.arguments());
+
+        TestOperation restored1(copied->name(1));
+        QVERIFY(copied->restore(1, &restored1));
+        QCOMPARE(restored1.arguments(), op1.arguments());
+        QCOMPARE(restored1.persistentValues(), op1.persistentValues());
+        QCOMPARE(restored1.value(QLatin1String("number")).type(), QVariant::Int);
+    }
+
     void cleanupTestCase()
     {
         m_manager.clear();
@@ -26,11 +26,14 @@
 **
 **************************************************************************/
 
+#include <lib7z_create.h>
+#include <lib7z_facade.h>
 #include <protocol.h>
 #include <qprocesswrapper.h>
 #include <qsettingswrapper.h>
 #include <remoteclient.h>
 #include <remotefileengine.h>
+#include <remotefileoperations.h>
 #include <remoteserver.h>
 
 #include <QBuffer>
@@ -38,6 +41,7 @@
 #include <QLocalSocket>
 #include <QTest>
 #include <QSignalSpy>
+#include <QTemporaryDir>
 #include <QTemporaryFile>
 #include <QUuid>
 #include <QLocalServer>
@@ -139,6 +143,64 @@ private slots:
         }
     }
 
+    void sendReceiveVersionedPacket()
+    {
+        QCOMPARE(Protocol::commandId(Protocol::QAbstractFileEngineWrite),
+            Protocol::CommandId::QAbstractFileEngineWrite);
+        QCOMPARE(QByteArray(Protocol::commandName(Protocol::CommandId::QSettingsValue)),
+            QByteArray(Protocol::QSettingsValue));
+        QCOMPARE(Protocol::commandId("unknown"), Protocol::CommandId::Invalid);
+
+        const QByteArray data = "hello";
+        QByteArray validPackage;
+        {
+            QBuffer device(&validPackage);
+            device.open(QBuffer::WriteOnly);
+            QInstaller::sendPacket(&device, Protocol::Version, Protocol::CommandId::Reply, 42, data);
+            // size, request id, command id and flags
+            QCOMPARE(device.buffer().size(), 12 + data.size());
+        }
+
+        QByteArray incompletePackage = validPackage;
+        incompletePackage.chop(1);
+        {
+            QBuffer device(&incompletePackage);
+            device.open(QBuffer::ReadOnly);
+            Packet packet;
+            QCOMPARE(QInstaller::receivePacket(&device, Protocol::Version, &packet), false);
+            QCOMPARE(device.pos(), 0);
+        }
+
+        {
+            QBuffer device(&validPackage);
+            device.open(QBuffer::ReadOnly);
+            Packet packet;
+            QCOMPARE(QInstaller::receivePacket(&device, Protocol::Version, &packet), true);
+            QCOMPARE(device.pos(), device.size());
+            QCOMPARE(packet.command, Protocol::CommandId::Reply);
+            QCOMPARE(packet.requestId, quint32(42));
+            QCOMPARE(packet.data, data);
+        }
+
+        // the legacy version keeps the textual framing
+        QByteArray legacyPackage;
+        {
+            QBuffer device(&legacyPackage);
+            device.open(QBuffer::WriteOnly);
+            QInstaller::sendPacket(&device, Protocol::LegacyVersion, Protocol::CommandId::Reply, 42,
+                data);
+        }
+        {
+            QBuffer device(&legacyPackage);
+            device.open(QBuffer::ReadOnly);
+            QByteArray cmd;
+            QByteArray received;
+            QCOMPARE(QInstaller::receivePacket(&device, &cmd, &received), true);
+            QCOMPARE(cmd, QByteArray(Protocol::Reply));
+            QCOMPARE(received, data);
+        }
+    }
+
     void localSocket()
     {
         //
@@ -515,6 +577,225 @@ private slots:
         QCOMPARE(file.atEnd(), true);
     }
 
+    void testRemoteFileEngineDeferredWrites()
+    {
+        RemoteServer server;
+        QString socketName = QUuid::createUuid().toString();
+        server.init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Production);
+        server.start();
+
+        RemoteClient::instance().init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Debug,
+                                      Protocol::StartAs::User);
+
+        QString filename;
+        {
+            QTemporaryFile file;
+            file.setAutoRemove(false);
+            QCOMPARE(file.open(), true);
+            filename = file.fileName();
+        }
+
+        RemoteFileEngineHandler handler;
+
+        // enough unbuffered writes to fill several batches
+        QByteArray expected;
+        QFile file(filename);
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Unbuffered));
+        for (int i = 0; i < 1000; ++i) {
+            const QByteArray chunk = QByteArray::number(i).repeated(64);
+            QCOMPARE(file.write(chunk), qint64(chunk.size()));
+            expected.append(chunk);
+        }
+        file.close();
+        QCOMPARE(file.error(), QFile::NoError);
+
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), expected);
+        file.close();
+        QFile::remove(filename);
+    }
+
+    void testRemoteFileEngineDeferredWriteFails()
+    {
+#ifdef Q_OS_LINUX
+        RemoteServer server;
+        QString socketName = QUuid::createUuid().toString();
+        server.init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Production);
+        server.start();
+
+        RemoteClient::instance().init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Debug,
+                                      Protocol::StartAs::User);
+
+        RemoteFileEngineHandler handler;
+
+        // every write to /dev/full fails, but the client only learns about it on close
+        QFile file(QLatin1String("/dev/full"));
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Unbuffered));
+        const QByteArray chunk(64, 'x');
+        QCOMPARE(file.write(chunk), qint64(chunk.size()));
+        file.close();
+        QVERIFY(file.error() != QFile::NoError);
+        QVERIFY(!file.errorString().isEmpty());
+#else
+        QSKIP("Needs a device that fails all writes.");
+#endif
+    }
+
+    void testRemoteFileEngineSharedMemory()
+    {
+        RemoteServer server;
+        QString socketName = QUuid::createUuid().toString();
+        server.init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Production);
+        server.start();
+
+        RemoteClient::instance().init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Debug,
+                                      Protocol::StartAs::User);
+        RemoteClient::instance().setSharedMemoryThreshold(1024);
+
+        QString filename;
+        {
+            QTemporaryFile file;
+            file.setAutoRemove(false);
+            QCOMPARE(file.open(), true);
+            filename = file.fileName();
+        }
+
+        RemoteFileEngineHandler handler;
+
+        // more data than fits into the segment, so it has to be reused
+        QByteArray expected;
+        QFile file(filename);
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Unbuffered));
+        for (int i = 0; i < 20; ++i) {
+            const QByteArray chunk(1024 * 1024 + i, char('a' + i));
+            QCOMPARE(file.write(chunk), qint64(chunk.size()));
+            expected.append(chunk);
+        }
+        QCOMPARE(file.write("small"), qint64(5));
+        expected.append("small");
+        file.close();
+        QCOMPARE(file.error(), QFile::NoError);
+
+        QVERIFY(file.open(QIODevice::ReadOnly | QIODevice::Unbuffered));
+        QByteArray content;
+        while (!file.atEnd()) {
+            const QByteArray chunk = file.read(4 * 1024 * 1024);
+            QVERIFY(!chunk.isEmpty());
+            content.append(chunk);
+        }
+        QCOMPARE(content, expected);
+        file.close();
+        QFile::remove(filename);
+
+        RemoteClient::instance().setSharedMemoryThreshold(Protocol::DefaultSharedMemoryThreshold);
+    }
+
+    void testRemoteFileOperations()
+    {
+        RemoteServer server;
+        QString socketName = QUuid::createUuid().toString();
+        server.init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Production);
+        server.start();
+
+        RemoteClient::instance().init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Debug,
+                                      Protocol::StartAs::User);
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString source = dir.path() + QLatin1String("/source");
+        const QString target = dir.path() + QLatin1String("/target");
+        QVERIFY(QDir().mkpath(source + QLatin1String("/sub")));
+        {
+            QFile file(source + QLatin1String("/sub/file.txt"));
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write("content");
+        }
+
+        RemoteFileOperations operations;
+        QVERIFY(operations.isAvailable());
+
+        QVERIFY2(operations.copyTree(source, target), qPrintable(operations.errorString()));
+        const QString copied = target + QLatin1String("/sub/file.txt");
+        QVERIFY(QFileInfo(copied).isFile());
+
+        const QFileDevice::Permissions permissions = QFileDevice::ReadOwner | QFileDevice::WriteOwner;
+        QVERIFY(operations.setPermissions(QList<QPair<QString, QFileDevice::Permissions> >()
+            << qMakePair(copied, permissions)));
+        QCOMPARE(QFile::permissions(copied) & (QFileDevice::ReadOwner | QFileDevice::WriteOwner
+            | QFileDevice::ExeOwner), permissions);
+        QVERIFY(!operations.setPermissions(QList<QPair<QString, QFileDevice::Permissions> >()
+            << qMakePair(dir.path() + QLatin1String("/missing"), permissions)));
+        QVERIFY(!operations.errorString().isEmpty());
+
+        QVERIFY2(operations.removeTree(target), qPrintable(operations.errorString()));
+        QVERIFY(!QFileInfo::exists(target));
+    }
+
+    void testRemoteFileOperationsExtractArchive()
+    {
+        RemoteServer server;
+        QString socketName = QUuid::createUuid().toString();
+        server.init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Production);
+        server.start();
+
+        RemoteClient::instance().init(socketName, QLatin1String("SomeKey"), Protocol::Mode::Debug,
+                                      Protocol::StartAs::User);
+        Lib7z::initSevenZ();
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString source = dir.path() + QLatin1String("/file.txt");
+        const QByteArray content = QByteArray("content").repeated(1024 * 1024);
+        {
+            QFile file(source);
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write(content);
+        }
+        const QString archive = dir.path() + QLatin1String("/archive.7z");
+        try {
+            Lib7z::createArchive(archive, QStringList() << source, Lib7z::QTmpFile::No);
+        } catch (const Lib7z::SevenZipException &e) {
+            QFAIL(qPrintable(e.message()));
+        }
+
+        // an existing file gets renamed before it is overwritten
+        const QString target = dir.path() + QLatin1String("/target");
+        const QString extracted = target + QLatin1String("/file.txt");
+        QVERIFY(QDir().mkpath(target));
+        {
+            QFile file(extracted);
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write("old");
+        }
+
+        RemoteFileOperations operations;
+        QVERIFY(operations.isAvailable());
+
+        QList<QPair<quint64, quint64> > progress;
+        QVERIFY2(operations.extractArchive(archive, target, [&progress](quint64 completed,
+            quint64 total) { progress.append(qMakePair(completed, total)); }),
+            qPrintable(operations.errorString()));
+
+        QVERIFY(!progress.isEmpty());
+        for (int i = 1; i < progress.count(); ++i)
+            QVERIFY(progress.at(i - 1).first <= progress.at(i).first);
+        QVERIFY(progress.last().second > 0);
+        QVERIFY(progress.last().first <= progress.last().second);
+
+        QVERIFY(operations.extractedFiles().contains(extracted));
+        QCOMPARE(operations.backupFiles().count(), 1);
+        QCOMPARE(operations.backupFiles().first().first, extracted);
+        QFile backup(operations.backupFiles().first().second);
+        QVERIFY(backup.open(QIODevice::ReadOnly));
+        QCOMPARE(backup.readAll(), QByteArray("old"));
+        QFile file(extracted);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), content);
+
+        QVERIFY(!operations.extractArchive(dir.path() + QLatin1String("/missing.7z"), target));
+        QVERIFY(!operations.errorString().isEmpty());
+    }
+
     void cleanupTestCase()
     {
         RemoteClient::instance().setActive(false);
@@ -61,6 +61,7 @@ private slots:
     void testPackageManagerCoreSetterGetter();
 
     void testComponentDependencies();
+    void testComponentIndexUpdates();
 };
 
 void tst_ComponentIdentifier::testPackageManagerCoreSetterGetter_data()
@@ -247,6 +248,34 @@ void tst_ComponentIdentifier::testComponentDependencies()
     delete core;
 }
 
+void tst_ComponentIdentifier::testComponentIndexUpdates()
+{
+    PackageManagerCore *core = new PackageManagerCore();
+    core->setPackageManager();
+
+    Component *componentA = new NamedComponent(core, "A");
+    core->appendRootComponent(componentA);
+    QCOMPARE(core->componentByName("A"), componentA);
+    QCOMPARE(core->componentByName("A.B"), static_cast<Component *>(0));
+
+    // children appended after a lookup must be found
+    Component *componentB = new NamedComponent(core, "A.B", "2.0.0");
+    componentA->appendComponent(componentB);
+    QCOMPARE(core->componentByName("A.B"), componentB);
+    QCOMPARE(core->componentByName("A.B:>=2.0.0"), componentB);
+    QCOMPARE(core->componentByName("A.B:<2.0.0"), static_cast<Component *>(0));
+
+    componentA->removeComponent(componentB);
+    QCOMPARE(core->componentByName("A.B"), static_cast<Component *>(0));
+    delete componentB;
+
+    componentA->setValue(scName, "C");
+    QCOMPARE(core->componentByName("A"), static_cast<Component *>(0));
+    QCOMPARE(core->componentByName("C"), componentA);
+
+    delete core;
+}
+
 QTEST_MAIN(tst_ComponentIdentifier)
 
 #include "tst_componentidentifier.moc"
@@ -21,7 +21,13 @@ SUBDIRS += \
     settingsoperation \
     task \
     clientserver \
-    factory
+    factory \
+    localpackagehub \
+    metadatacache \
+    updatesindex \
+    updatesinfo \
+    networksession \
+    updatefinder
 
 win32 {
     SUBDIRS += registerfiletypeoperation
@@ -32,6 +32,7 @@
 #include <lib7z_list.h>
 
 #include <QDir>
+#include <QFileInfo>
 #include <QObject>
 #include <QTemporaryFile>
 #include <QTest>
@@ -153,6 +154,26 @@ private slots:
         }
     }
 
+    void testExtractArchiveKeepsPosition()
+    {
+        QFile source(":///data/valid.7z");
+        QVERIFY(source.open(QIODevice::ReadOnly));
+        QVERIFY(source.seek(source.size() / 2));
+
+        try {
+            const QString target = QDir::tempPath() + QString("/segment");
+            Lib7z::extractArchive(&source, target, nullptr, 4);
+            QCOMPARE(QFileInfo(target + QString("/valid")).size(),
+                qint64(m_file.uncompressedSize));
+            QCOMPARE(source.pos(), source.size() / 2);
+            QDir(target).removeRecursively();
+        } catch (const Lib7z::SevenZipException& e) {
+            QFAIL(e.message().toUtf8());
+        } catch (...) {
+            QFAIL("Unexpected error during extract archive.");
+        }
+    }
+
 private:
     QString tempSourceFile(const QByteArray &data, const QString &templateName = QString())
     {
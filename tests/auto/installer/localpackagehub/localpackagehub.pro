@@ -0,0 +1,6 @@
+include(../../qttest.pri)
+
+QT -= gui
+QT += xml
+
+SOURCES += tst_localpackagehub.cpp
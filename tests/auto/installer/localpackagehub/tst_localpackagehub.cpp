@@ -0,0 +1,149 @@
+/**************************************************************************
+**
+** Copyright (C) 2018 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include <localpackagehub.h>
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace KDUpdater;
+
+class tst_LocalPackageHub : public QObject
+{
+    Q_OBJECT
+
+private:
+    static void addPackage(LocalPackageHub *hub, const QString &name)
+    {
+        hub->addPackage(name, QLatin1String("1.0.0"), name, QLatin1String("Description"),
+            QStringList(), QStringList(), false, false, 42, QString(), true, false);
+    }
+
+private slots:
+    void init()
+    {
+        QVERIFY(m_tempDir.isValid());
+        m_fileName = m_tempDir.path() + QLatin1String("/components.xml");
+        QFile::remove(m_fileName);
+        QFile::remove(m_fileName + QLatin1String(".journal"));
+    }
+
+    void testJournalIsReplayed()
+    {
+        {
+            LocalPackageHub hub;
+            hub.setFileName(m_fileName);
+            hub.setApplicationName(QLatin1String("Application"));
+            addPackage(&hub, QLatin1String("A"));
+            addPackage(&hub, QLatin1String("B"));
+            hub.writeJournal();
+            addPackage(&hub, QLatin1String("C"));
+            hub.removePackage(QLatin1String("A"));
+            hub.writeJournal();
+
+            QVERIFY(!QFile::exists(m_fileName));
+            QVERIFY(QFile::exists(hub.journalFileName()));
+
+            // simulate a crash before the next checkpoint
+            LocalPackageHub recovered;
+            recovered.setFileName(m_fileName);
+            QCOMPARE(recovered.error(), LocalPackageHub::NoError);
+            QCOMPARE(recovered.applicationName(), QLatin1String("Application"));
+            QCOMPARE(recovered.packageNames(), QStringList() << QLatin1String("B")
+                << QLatin1String("C"));
+            QCOMPARE(recovered.packageInfo(QLatin1String("B")).uncompressedSize, quint64(42));
+            QCOMPARE(recovered.packageInfo(QLatin1String("C")).checkable, true);
+
+            hub.writeToDisk();
+            QVERIFY(QFile::exists(m_fileName));
+            QVERIFY(!QFile::exists(hub.journalFileName()));
+        }
+
+        LocalPackageHub hub;
+        hub.setFileName(m_fileName);
+        QCOMPARE(hub.packageNames(), QStringList() << QLatin1String("B") << QLatin1String("C"));
+    }
+
+    void testJournalOnTopOfFile()
+    {
+        LocalPackageHub hub;
+        hub.setFileName(m_fileName);
+        addPackage(&hub, QLatin1String("A"));
+        hub.writeToDisk();
+
+        hub.clearPackageInfos();
+        addPackage(&hub, QLatin1String("B"));
+        hub.writeJournal();
+
+        LocalPackageHub recovered;
+        recovered.setFileName(m_fileName);
+        QCOMPARE(recovered.packageNames(), QStringList() << QLatin1String("B"));
+    }
+
+    void testTruncatedJournalRecord()
+    {
+        LocalPackageHub hub;
+        hub.setFileName(m_fileName);
+        addPackage(&hub, QLatin1String("A"));
+        hub.writeJournal();
+
+        QFile journal(hub.journalFileName());
+        QVERIFY(journal.open(QIODevice::WriteOnly | QIODevice::Append));
+        journal.write("<Package>\n    <Name>B</Name>\n    <Ti");
+        journal.close();
+
+        LocalPackageHub recovered;
+        recovered.setFileName(m_fileName);
+        QCOMPARE(recovered.error(), LocalPackageHub::NoError);
+        QCOMPARE(recovered.packageNames(), QStringList() << QLatin1String("A"));
+
+        // records appended after the recovery must not be hidden by the partial record
+        addPackage(&recovered, QLatin1String("C"));
+        recovered.writeJournal();
+
+        LocalPackageHub reopened;
+        reopened.setFileName(m_fileName);
+        QCOMPARE(reopened.error(), LocalPackageHub::NoError);
+        QCOMPARE(reopened.packageNames(), QStringList() << QLatin1String("A") << QLatin1String("C"));
+    }
+
+    void cleanup()
+    {
+        QFile::remove(m_fileName);
+        QFile::remove(m_fileName + QLatin1String(".journal"));
+    }
+
+private:
+    QTemporaryDir m_tempDir;
+    QString m_fileName;
+};
+
+QTEST_MAIN(tst_LocalPackageHub)
+
+#include "tst_localpackagehub.moc"
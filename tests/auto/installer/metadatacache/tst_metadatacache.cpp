@@ -0,0 +1,211 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include <metadatacache.h>
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace QInstaller;
+
+class tst_MetadataCache : public QObject
+{
+    Q_OBJECT
+
+private:
+    static void addPackageDirectory(const MetadataCache &cache, const QString &name)
+    {
+        QVERIFY(QDir().mkpath(cache.directory() + QLatin1Char('/') + name));
+    }
+
+private slots:
+    void testDirectoryIsLocked()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QUrl url(QLatin1String("http://example.com/repository"));
+
+        MetadataCache cache(dir.path(), url);
+        QVERIFY(cache.open());
+        QVERIFY(cache.directory().startsWith(dir.path()));
+
+        MetadataCache second(dir.path(), url);
+        QVERIFY(!second.open());
+        QVERIFY(!second.errorString().isEmpty());
+
+        MetadataCache other(dir.path(), QUrl(QLatin1String("http://example.com/other")));
+        QVERIFY(other.open());
+        QVERIFY(other.directory() != cache.directory());
+    }
+
+    void testIndexIsPersistent()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QUrl url(QLatin1String("http://example.com/repository"));
+        {
+            MetadataCache cache(dir.path(), url);
+            QVERIFY(cache.open());
+            QFile updatesXml(cache.updatesXml());
+            QVERIFY(updatesXml.open(QIODevice::WriteOnly));
+            updatesXml.close();
+            cache.setValidators("\"etag\"", "Mon, 01 Jun 2020 00:00:00 GMT");
+
+            cache.beginUpdate(QLatin1String("A"), QLatin1String("1.0"), "aaaa");
+            cache.beginUpdate(QLatin1String("B"), QLatin1String("1.0"), "bbbb");
+            cache.cancelUpdate(QLatin1String("B"));
+            addPackageDirectory(cache, QLatin1String("A"));
+            QVERIFY(!cache.contains(QLatin1String("A"), QLatin1String("1.0"), "aaaa"));
+            QVERIFY(cache.commitUpdates());
+        }
+
+        MetadataCache cache(dir.path(), url);
+        QVERIFY(cache.open());
+        QCOMPARE(cache.eTag(), QByteArray("\"etag\""));
+        QCOMPARE(cache.lastModified(), QByteArray("Mon, 01 Jun 2020 00:00:00 GMT"));
+        QVERIFY(cache.contains(QLatin1String("A"), QLatin1String("1.0"), "aaaa"));
+        QVERIFY(!cache.contains(QLatin1String("A"), QLatin1String("1.1"), "aaaa"));
+        QVERIFY(!cache.contains(QLatin1String("A"), QLatin1String("1.0"), "abab"));
+        QVERIFY(!cache.contains(QLatin1String("B"), QLatin1String("1.0"), "bbbb"));
+        QCOMPARE(cache.packages(), QStringList() << QLatin1String("A"));
+    }
+
+    void testChangedPackagesAreRemoved()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        MetadataCache cache(dir.path(), QUrl(QLatin1String("http://example.com/repository")));
+        QVERIFY(cache.open());
+        cache.beginUpdate(QLatin1String("A"), QLatin1String("1.0"), "aaaa");
+        cache.beginUpdate(QLatin1String("B"), QLatin1String("1.0"), "bbbb");
+        addPackageDirectory(cache, QLatin1String("A"));
+        addPackageDirectory(cache, QLatin1String("B"));
+        QVERIFY(cache.commitUpdates());
+
+        // a new version removes the unpacked metadata until it got fetched again
+        cache.beginUpdate(QLatin1String("A"), QLatin1String("2.0"), "aaaa");
+        QVERIFY(!QFileInfo::exists(cache.directory() + QLatin1String("/A")));
+        QVERIFY(!cache.contains(QLatin1String("A"), QLatin1String("1.0"), "aaaa"));
+
+        cache.retain(QSet<QString>() << QLatin1String("A"));
+        QVERIFY(!QFileInfo::exists(cache.directory() + QLatin1String("/B")));
+        QVERIFY(cache.packages().isEmpty());
+
+        // packages without checksum are never taken from the cache
+        cache.beginUpdate(QLatin1String("C"), QLatin1String("1.0"), QByteArray());
+        addPackageDirectory(cache, QLatin1String("C"));
+        QVERIFY(cache.commitUpdates());
+        QVERIFY(!cache.contains(QLatin1String("C"), QLatin1String("1.0"), QByteArray()));
+    }
+
+    void testInvalidNamesAreNotDeleted()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+
+        MetadataCache cache(dir.path(), QUrl(QLatin1String("http://example.com/repository")));
+        QVERIFY(cache.open());
+        const QString outside = dir.path() + QLatin1String("/outside");
+        QVERIFY(QDir().mkpath(outside));
+
+        cache.remove(QLatin1String("../outside"));
+        cache.remove(QLatin1String(".."));
+        cache.beginUpdate(QLatin1String("A/../../outside"), QLatin1String("1.0"), "aaaa");
+        cache.remove(QLatin1String("A\\..\\..\\outside"));
+        QVERIFY(QFileInfo(outside).isDir());
+        QVERIFY(QFileInfo(cache.directory()).isDir());
+    }
+
+    void testValidatorsNeedUpdatesXml()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QUrl url(QLatin1String("http://example.com/repository"));
+        {
+            MetadataCache cache(dir.path(), url);
+            QVERIFY(cache.open());
+            cache.setValidators("\"etag\"", QByteArray());
+            QVERIFY(cache.save());
+        }
+
+        MetadataCache cache(dir.path(), url);
+        QVERIFY(cache.open());
+        QVERIFY(cache.eTag().isEmpty());
+    }
+
+    void testMissingUpdatesIndexIsPersistent()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QUrl url(QLatin1String("http://example.com/repository"));
+        {
+            MetadataCache cache(dir.path(), url);
+            QVERIFY(cache.open());
+            QCOMPARE(cache.isUpdatesIndexMissing(), false);
+            cache.setUpdatesIndexMissing(true);
+            QVERIFY(cache.save());
+        }
+        {
+            MetadataCache cache(dir.path(), url);
+            QVERIFY(cache.open());
+            QCOMPARE(cache.isUpdatesIndexMissing(), true);
+            cache.setUpdatesIndexMissing(false);
+            QVERIFY(cache.save());
+        }
+
+        MetadataCache cache(dir.path(), url);
+        QVERIFY(cache.open());
+        QCOMPARE(cache.isUpdatesIndexMissing(), false);
+    }
+
+    void testBrokenIndexIsIgnored()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QUrl url(QLatin1String("http://example.com/repository"));
+        {
+            MetadataCache cache(dir.path(), url);
+            QVERIFY(cache.open());
+            QFile index(cache.directory() + QLatin1String("/index"));
+            QVERIFY(index.open(QIODevice::WriteOnly));
+            index.write("garbage");
+        }
+
+        MetadataCache cache(dir.path(), url);
+        QVERIFY(cache.open());
+        QVERIFY(cache.packages().isEmpty());
+        QVERIFY(cache.eTag().isEmpty());
+    }
+};
+
+QTEST_MAIN(tst_MetadataCache)
+
+#include "tst_metadatacache.moc"
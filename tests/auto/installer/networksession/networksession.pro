@@ -0,0 +1,6 @@
+include(../../qttest.pri)
+
+QT += network
+QT -= gui
+
+SOURCES += tst_networksession.cpp
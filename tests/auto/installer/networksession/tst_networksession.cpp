@@ -0,0 +1,177 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include <networksession.h>
+
+#include <QNetworkAccessManager>
+#include <QNetworkProxyFactory>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QSignalSpy>
+#include <QTest>
+#include <QThread>
+#include <QUrl>
+
+using namespace QInstaller;
+
+class ManagerThread : public QThread
+{
+public:
+    QPointer<QNetworkAccessManager> manager;
+    QNetworkAccessManager *managerAddress = nullptr;
+    bool sameManager = false;
+
+protected:
+    void run()
+    {
+        manager = NetworkSession::instance().networkAccessManager();
+        managerAddress = manager.data();
+        sameManager = NetworkSession::instance().networkAccessManager() == manager;
+    }
+};
+
+class ProxyFactory : public QNetworkProxyFactory
+{
+public:
+    explicit ProxyFactory(const QString &hostName)
+        : m_hostName(hostName)
+    {}
+
+    QList<QNetworkProxy> queryProxy(const QNetworkProxyQuery &query) Q_DECL_OVERRIDE
+    {
+        Q_UNUSED(query)
+        return QList<QNetworkProxy>() << QNetworkProxy(QNetworkProxy::HttpProxy, m_hostName, 3128);
+    }
+
+private:
+    const QString m_hostName;
+};
+
+class tst_NetworkSession : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testRequestsPerHost()
+    {
+        NetworkSession &session = NetworkSession::instance();
+        const int maxRequests = session.maxRequestsPerHost();
+        session.setMaxRequestsPerHost(2);
+
+        const QUrl first(QLatin1String("https://example.com/repository/A/meta.7z"));
+        const QUrl second(QLatin1String("https://EXAMPLE.com/repository/B/meta.7z"));
+        QVERIFY(session.tryAcquireRequest(first));
+        QVERIFY(session.tryAcquireRequest(second));
+        QVERIFY(!session.tryAcquireRequest(first));
+
+        // other hosts, ports and schemes are limited on their own
+        QVERIFY(session.tryAcquireRequest(QUrl(QLatin1String("https://example.org/meta.7z"))));
+        QVERIFY(session.tryAcquireRequest(QUrl(QLatin1String("https://example.com:8443/meta.7z"))));
+        QVERIFY(session.tryAcquireRequest(QUrl(QLatin1String("http://example.com/meta.7z"))));
+
+        QSignalSpy spy(&session, &NetworkSession::requestReleased);
+        session.releaseRequest(first);
+        QCOMPARE(spy.count(), 1);
+        QVERIFY(session.tryAcquireRequest(second));
+        QVERIFY(!session.tryAcquireRequest(second));
+
+        session.releaseRequest(first);
+        session.releaseRequest(second);
+        session.releaseRequest(QUrl(QLatin1String("https://example.org/meta.7z")));
+        session.releaseRequest(QUrl(QLatin1String("https://example.com:8443/meta.7z")));
+        session.releaseRequest(QUrl(QLatin1String("http://example.com/meta.7z")));
+        session.setMaxRequestsPerHost(maxRequests);
+        QCOMPARE(session.maxRequestsPerHost(), maxRequests);
+    }
+
+    void testManagerPerThread()
+    {
+        QNetworkAccessManager *manager = NetworkSession::instance().networkAccessManager();
+        QVERIFY(manager);
+        QCOMPARE(NetworkSession::instance().networkAccessManager(), manager);
+
+        ManagerThread thread;
+        thread.start();
+        QVERIFY(thread.wait());
+        QVERIFY(thread.managerAddress);
+        QVERIFY(thread.managerAddress != manager);
+        QVERIFY(thread.sameManager);
+        QTRY_VERIFY(thread.manager.isNull()); // deleted once the thread finished
+    }
+
+    void testManagerPerProxy()
+    {
+        NetworkSession &session = NetworkSession::instance();
+        const QNetworkRequest request(QUrl(QLatin1String("file:///nonexistent/Updates.xml")));
+
+        QScopedPointer<QNetworkReply> direct(session.get(request));
+        QCOMPARE(direct->manager(), session.networkAccessManager());
+
+        QScopedPointer<QNetworkReply> first(session.get(request,
+            new ProxyFactory(QLatin1String("first.example.com"))));
+        QVERIFY(first->manager() != session.networkAccessManager());
+
+        // the same proxies reuse the manager, other ones do not touch it
+        QScopedPointer<QNetworkReply> same(session.get(request,
+            new ProxyFactory(QLatin1String("first.example.com"))));
+        QCOMPARE(same->manager(), first->manager());
+        QScopedPointer<QNetworkReply> second(session.get(request,
+            new ProxyFactory(QLatin1String("second.example.com"))));
+        QVERIFY(second->manager() != first->manager());
+        QVERIFY(second->manager() != session.networkAccessManager());
+
+        const QList<QNetworkProxy> proxies = first->manager()->proxyFactory()
+            ->queryProxy(QNetworkProxyQuery(request.url()));
+        QCOMPARE(proxies.count(), 1);
+        QCOMPARE(proxies.first().hostName(), QLatin1String("first.example.com"));
+    }
+
+    void testPrepareRequest()
+    {
+        QNetworkRequest secure(QUrl(QLatin1String("https://example.com/Updates.xml")));
+        NetworkSession::instance().prepareRequest(&secure);
+#if QT_VERSION >= 0x050800
+        QCOMPARE(secure.attribute(QNetworkRequest::HTTP2AllowedAttribute).toBool(), true);
+#endif
+#ifndef QT_NO_SSL
+        QCOMPARE(secure.sslConfiguration().testSslOption(QSsl::SslOptionDisableSessionPersistence),
+            false);
+#endif
+
+        QNetworkRequest plain(QUrl(QLatin1String("http://example.com/Updates.xml")));
+        NetworkSession::instance().prepareRequest(&plain);
+#if QT_VERSION >= 0x050800
+        QVERIFY(!plain.attribute(QNetworkRequest::HTTP2AllowedAttribute).isValid());
+#endif
+    }
+};
+
+QTEST_MAIN(tst_NetworkSession)
+
+#include "tst_networksession.moc"
@@ -32,10 +32,14 @@
 #include <fileutils.h>
 #include <packagemanagercore.h>
 #include <progresscoordinator.h>
+#include <settings.h>
 
 #include <QDir>
+#include <QMessageBox>
+#include <QMutex>
 #include <QTemporaryFile>
 #include <QTest>
+#include <QThread>
 
 using namespace QInstaller;
 
@@ -77,6 +81,111 @@ public:
 
 };
 
+class OperationRecorder
+{
+public:
+    void record(const QString &entry)
+    {
+        QMutexLocker _(&m_mutex);
+        m_entries.append(entry);
+    }
+
+    QStringList entries() const
+    {
+        QMutexLocker _(&m_mutex);
+        return m_entries;
+    }
+
+private:
+    mutable QMutex m_mutex;
+    QStringList m_entries;
+};
+
+class RecordingOperation : public Operation
+{
+public:
+    RecordingOperation(PackageManagerCore *core, OperationRecorder *recorder,
+            const QString &component, bool fail, const QString &name = QLatin1String("Recording"),
+            const QString &action = QLatin1String("perform"))
+        : Operation(core)
+        , m_recorder(recorder)
+        , m_fail(fail)
+        , m_action(action)
+    {
+        setName(name);
+        setValue(QLatin1String("component"), component);
+    }
+
+    void backup() {}
+
+    bool performOperation()
+    {
+        QThread::msleep(20); // give independent components the chance to overlap
+        m_recorder->record(m_action + QLatin1Char(' ')
+            + value(QLatin1String("component")).toString());
+        if (m_fail) {
+            setError(UserDefinedError, QLatin1String("Force fail to test rollback."));
+            return false;
+        }
+        return true;
+    }
+
+    bool undoOperation()
+    {
+        m_recorder->record(QLatin1String("undo ") + value(QLatin1String("component")).toString());
+        return true;
+    }
+
+    bool testOperation()
+    {
+        return true;
+    }
+
+private:
+    OperationRecorder *m_recorder;
+    bool m_fail;
+    QString m_action;
+};
+
+class RecordingComponent : public NamedComponent
+{
+public:
+    RecordingComponent(PackageManagerCore *core, OperationRecorder *recorder, const QString &name,
+            const QString &dependencies = QString(), bool fail = false)
+        : NamedComponent(core, name)
+    {
+        setValue(scDependencies, dependencies);
+        setAutoCreateOperations(false);
+        setCheckState(Qt::Checked);
+        addOperation(new RecordingOperation(core, recorder, name, fail));
+    }
+
+    void beginInstallation()
+    {
+    }
+};
+
+class UnpackingComponent : public NamedComponent
+{
+public:
+    UnpackingComponent(PackageManagerCore *core, OperationRecorder *recorder, const QString &name,
+            const QString &dependencies = QString())
+        : NamedComponent(core, name)
+    {
+        setValue(scDependencies, dependencies);
+        setAutoCreateOperations(false);
+        setCheckState(Qt::Checked);
+        // unpacking runs on a worker thread, the recording operation after it on the main thread
+        addOperation(new RecordingOperation(core, recorder, name, false, QLatin1String("Extract"),
+            QLatin1String("unpack")));
+        addOperation(new RecordingOperation(core, recorder, name, false));
+    }
+
+    void beginInstallation()
+    {
+    }
+};
+
 class tst_PackageManagerCore : public QObject
 {
     Q_OBJECT
@@ -152,6 +261,146 @@ private slots:
         ProgressCoordinator::instance()->reset();
     }
 
+    void testConcurrentInstallationRollBack()
+    {
+        const QString testDirectory = QInstaller::generateTemporaryFileName();
+        QVERIFY(QDir().mkpath(testDirectory));
+
+        PackageManagerCore core(QInstaller::BinaryContent::MagicInstallerMarker,
+            QList<QInstaller::OperationBlob>());
+        core.setMessageBoxAutomaticAnswer(QLatin1String("installationErrorWithRetry"),
+            QMessageBox::Cancel);
+        core.autoRejectMessageBoxes();
+        core.settings().setMaxConcurrentInstallations(4);
+        core.setValue(QLatin1String("TargetDir"), testDirectory);
+        core.setValue(QLatin1String("RemoveTargetDir"), QLatin1String("true"));
+
+        // A and B are independent, C needs both of them and D fails after C got installed
+        OperationRecorder recorder;
+        core.appendRootComponent(new RecordingComponent(&core, &recorder, QLatin1String("A")));
+        core.appendRootComponent(new RecordingComponent(&core, &recorder, QLatin1String("B")));
+        core.appendRootComponent(new RecordingComponent(&core, &recorder, QLatin1String("C"),
+            QLatin1String("A, B")));
+        core.appendRootComponent(new RecordingComponent(&core, &recorder, QLatin1String("D"),
+            QLatin1String("C"), true));
+
+        QVERIFY(core.calculateComponentsToInstall());
+        QVERIFY(!core.runInstaller());
+
+        const QStringList entries = recorder.entries();
+        QCOMPARE(entries.count(), 8);
+        QVERIFY(entries.indexOf(QLatin1String("perform A")) < entries.indexOf(QLatin1String("perform C")));
+        QVERIFY(entries.indexOf(QLatin1String("perform B")) < entries.indexOf(QLatin1String("perform C")));
+        QVERIFY(entries.indexOf(QLatin1String("perform C")) < entries.indexOf(QLatin1String("perform D")));
+
+        // the failed operation of D is undone as well, and everything in reverse order
+        QCOMPARE(entries.at(4), QLatin1String("undo D"));
+        QCOMPARE(entries.at(5), QLatin1String("undo C"));
+        QVERIFY(entries.contains(QLatin1String("undo A")));
+        QVERIFY(entries.contains(QLatin1String("undo B")));
+
+        QVERIFY(!QDir(testDirectory).exists());
+        ProgressCoordinator::instance()->reset();
+    }
+
+    void testConcurrentInstallationOverlappingDependencies()
+    {
+        const QString testDirectory = QInstaller::generateTemporaryFileName();
+        QVERIFY(QDir().mkpath(testDirectory));
+
+        PackageManagerCore core(QInstaller::BinaryContent::MagicInstallerMarker,
+            QList<QInstaller::OperationBlob>());
+        core.setMessageBoxAutomaticAnswer(QLatin1String("installationErrorWithRetry"),
+            QMessageBox::Cancel);
+        core.autoRejectMessageBoxes();
+        core.settings().setMaxConcurrentInstallations(4);
+        core.setValue(QLatin1String("TargetDir"), testDirectory);
+        core.setValue(QLatin1String("RemoveTargetDir"), QLatin1String("true"));
+
+        // the chains A -> C -> E and B -> D -> E overlap in B -> C and E, F fails at the end
+        QHash<QString, QStringList> dependencies;
+        dependencies.insert(QLatin1String("C"), QStringList() << QLatin1String("A")
+            << QLatin1String("B"));
+        dependencies.insert(QLatin1String("D"), QStringList() << QLatin1String("B"));
+        dependencies.insert(QLatin1String("E"), QStringList() << QLatin1String("C")
+            << QLatin1String("D"));
+
+        OperationRecorder recorder;
+        const QStringList names = QStringList() << QLatin1String("A") << QLatin1String("B")
+            << QLatin1String("C") << QLatin1String("D") << QLatin1String("E");
+        foreach (const QString &name, names) {
+            core.appendRootComponent(new UnpackingComponent(&core, &recorder, name,
+                dependencies.value(name).join(QLatin1String(", "))));
+        }
+        core.appendRootComponent(new RecordingComponent(&core, &recorder, QLatin1String("F"),
+            QLatin1String("E"), true));
+
+        QVERIFY(core.calculateComponentsToInstall());
+        QVERIFY(!core.runInstaller());
+
+        const QStringList entries = recorder.entries();
+        QCOMPARE(entries.count(), 2 * (2 * names.count() + 1));
+        foreach (const QString &name, names) {
+            const int unpacked = entries.indexOf(QLatin1String("unpack ") + name);
+            const int performed = entries.indexOf(QLatin1String("perform ") + name);
+            QVERIFY(unpacked >= 0);
+            QVERIFY(unpacked < performed);
+
+            // a component is only unpacked once its dependencies have been installed completely
+            foreach (const QString &dependency, dependencies.value(name))
+                QVERIFY(entries.indexOf(QLatin1String("perform ") + dependency) < unpacked);
+        }
+        QVERIFY(entries.indexOf(QLatin1String("perform E")) < entries.indexOf(QLatin1String("perform F")));
+
+        // everything is undone, the components in reverse dependency order
+        QCOMPARE(entries.count(QLatin1String("undo E")), 2);
+        QCOMPARE(entries.at(2 * names.count() + 1), QLatin1String("undo F"));
+        QCOMPARE(entries.at(2 * names.count() + 2), QLatin1String("undo E"));
+        QCOMPARE(entries.at(2 * names.count() + 3), QLatin1String("undo E"));
+        foreach (const QString &name, names) {
+            foreach (const QString &dependency, dependencies.value(name)) {
+                QVERIFY(entries.lastIndexOf(QLatin1String("undo ") + name)
+                    < entries.indexOf(QLatin1String("undo ") + dependency));
+            }
+        }
+
+        QVERIFY(!QDir(testDirectory).exists());
+        ProgressCoordinator::instance()->reset();
+    }
+
+    void testCalculatorFollowsComponentsAndRunMode()
+    {
+        QTest::ignoreMessage(QtDebugMsg, "Operations sanity check succeeded.");
+        PackageManagerCore core(QInstaller::BinaryContent::MagicInstallerMarker,
+            QList<QInstaller::OperationBlob>());
+        core.setPackageManager();
+
+        Component *a = new NamedComponent(&core, QLatin1String("A"));
+        a->setCheckState(Qt::Checked);
+        core.appendRootComponent(a);
+        core.componentsToInstallNeedsRecalculation();
+        QCOMPARE(core.orderedComponentsToInstall(), QList<Component *>() << a);
+
+        // a component added after the calculation is known to the next one
+        Component *b = new NamedComponent(&core, QLatin1String("B"));
+        b->setValue(scAutoDependOn, QLatin1String("A"));
+        core.appendRootComponent(b);
+        core.componentsToInstallNeedsRecalculation();
+        QCOMPARE(core.orderedComponentsToInstall(), QList<Component *>() << a << b);
+
+        // in updater mode only the updater components are available, A cannot be resolved
+        Component *update = new NamedComponent(&core, QLatin1String("U"));
+        update->setValue(scDependencies, QLatin1String("A"));
+        update->setCheckState(Qt::Checked);
+        core.appendUpdaterComponent(update);
+        core.setUpdater();
+        QVERIFY(!core.calculateComponentsToInstall());
+
+        core.setPackageManager();
+        QVERIFY(core.calculateComponentsToInstall());
+        QCOMPARE(core.orderedComponentsToInstall(), QList<Component *>() << a << b);
+    }
+
     void testComponentSetterGetter()
     {
         {
@@ -92,11 +92,19 @@ void tst_Settings::loadTutorialConfig()
     QCOMPARE(settings.controlScript(), QString());
 
     QCOMPARE(settings.supportsModify(), true);
+    QCOMPARE(settings.maxConcurrentDownloads(), 4);
+    QCOMPARE(settings.maxConcurrentDownloadsPerHost(), 4);
+    QCOMPARE(settings.pipelinedInstallation(), false);
+    QCOMPARE(settings.maxConcurrentInstallations(), 1);
 }
 
 void tst_Settings::loadFullConfig()
 {
     Settings settings = Settings::fromFileAndPrefix(":///data/full_config.xml", ":///data");
+    QCOMPARE(settings.maxConcurrentDownloads(), 8);
+    QCOMPARE(settings.maxConcurrentDownloadsPerHost(), 2);
+    QCOMPARE(settings.pipelinedInstallation(), true);
+    QCOMPARE(settings.maxConcurrentInstallations(), 4);
 }
 
 void tst_Settings::loadEmptyConfig()
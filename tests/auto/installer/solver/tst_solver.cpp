@@ -141,6 +141,53 @@ private slots:
             qPrintable(cycle.first.data()));
     }
 
+    void sortGraphLevels()
+    {
+        Graph<QString> graph;
+        graph.addEdges("C", QStringList() << "A" << "B");
+        graph.addEdge("D", "C");
+        graph.addEdge("E", "A");
+        graph.addNode("F");
+
+        QList<QList<QString> > levels = graph.levels();
+        QVERIFY(!graph.hasCycle());
+        QCOMPARE(levels.count(), 3);
+        QCOMPARE(levels.at(0), QList<QString>() << "A" << "B" << "F");
+        QCOMPARE(levels.at(1), QList<QString>() << "C" << "E");
+        QCOMPARE(levels.at(2), QList<QString>() << "D");
+
+        QCOMPARE(graph.sort(), QList<QString>() << "A" << "B" << "F" << "C" << "E" << "D");
+    }
+
+    void sortGraphCyclePath()
+    {
+        Graph<QString> graph;
+        graph.addEdge("A", "B");
+        graph.addEdge("B", "C");
+        graph.addEdge("C", "D");
+        graph.addEdge("D", "B");
+        graph.addNode("E");
+
+        QCOMPARE(graph.sort(), QList<QString>() << "E");
+        QVERIFY(graph.hasCycle());
+        QCOMPARE(graph.cyclePath(), QList<QString>() << "B" << "C" << "D");
+        QCOMPARE(graph.cycle(), qMakePair(QString("D"), QString("B")));
+    }
+
+    void sortGraphDeepChain()
+    {
+        const int count = 200000;
+        Graph<int> graph;
+        for (int i = 1; i < count; ++i)
+            graph.addEdge(i, i - 1);
+
+        const QList<int> resolved = graph.sort();
+        QVERIFY(!graph.hasCycle());
+        QCOMPARE(resolved.count(), count);
+        QCOMPARE(resolved.first(), 0);
+        QCOMPARE(resolved.last(), count - 1);
+    }
+
     void resolveInstaller_data()
     {
         QTest::addColumn<PackageManagerCore *>("core");
@@ -174,6 +221,30 @@ private slots:
                         << InstallerCalculator::Dependent
                         << InstallerCalculator::Resolved
                         << InstallerCalculator::Automatic);
+
+        core = new PackageManagerCore();
+        core->setPackageManager();
+        NamedComponent *componentC = new NamedComponent(core, QLatin1String("C"));
+        NamedComponent *componentC_Auto = new NamedComponent(core, QLatin1String("C_auto"));
+        NamedComponent *componentC_AutoAuto = new NamedComponent(core, QLatin1String("C_auto_auto"));
+        NamedComponent *componentC_Unresolved = new NamedComponent(core, QLatin1String("C_unresolved"));
+        componentC_AutoAuto->addAutoDependOn(QLatin1String("C"));
+        componentC_AutoAuto->addAutoDependOn(QLatin1String("C_auto"));
+        componentC_Auto->addAutoDependOn(QLatin1String("C"));
+        componentC_Unresolved->addAutoDependOn(QLatin1String("C"));
+        componentC_Unresolved->addAutoDependOn(QLatin1String("D"));
+        core->appendRootComponent(componentC_AutoAuto);
+        core->appendRootComponent(componentC_Unresolved);
+        core->appendRootComponent(componentC_Auto);
+        core->appendRootComponent(componentC);
+
+        QTest::newRow("Chained auto dependencies") << core
+                    << (QList<Component *>() << componentC)
+                    << (QList<Component *>() << componentC << componentC_Auto << componentC_AutoAuto)
+                    << (QList<int>()
+                        << InstallerCalculator::Selected
+                        << InstallerCalculator::Automatic
+                        << InstallerCalculator::Automatic);
     }
 
     void resolveInstaller()
@@ -195,6 +266,84 @@ private slots:
         delete core;
     }
 
+    void updateInstaller()
+    {
+        PackageManagerCore core;
+        core.setPackageManager();
+        NamedComponent *componentA = new NamedComponent(&core, QLatin1String("A"));
+        NamedComponent *componentB = new NamedComponent(&core, QLatin1String("B"));
+        NamedComponent *componentC = new NamedComponent(&core, QLatin1String("C"));
+        NamedComponent *componentD = new NamedComponent(&core, QLatin1String("D"));
+        NamedComponent *componentE = new NamedComponent(&core, QLatin1String("E"));
+        componentB->addDependency(QLatin1String("A"));
+        componentD->addAutoDependOn(QLatin1String("C"));
+        core.appendRootComponent(componentA);
+        core.appendRootComponent(componentB);
+        core.appendRootComponent(componentC);
+        core.appendRootComponent(componentD);
+        core.appendRootComponent(componentE);
+
+        InstallerCalculator calc(core.components(PackageManagerCore::ComponentType::AllNoReplacements));
+        QVERIFY(calc.appendComponentsToInstall(QList<Component *>() << componentC));
+        QCOMPARE(calc.orderedComponentsToInstall(), QList<Component *>() << componentC << componentD);
+
+        QVERIFY(calc.updateComponentsToInstall(QList<Component *>() << componentB << componentE,
+            QList<Component *>()));
+        QCOMPARE(calc.orderedComponentsToInstall(), QList<Component *>() << componentC << componentD
+            << componentE << componentA << componentB);
+        QCOMPARE(calc.installReasonType(componentA), InstallerCalculator::Dependent);
+
+        QVERIFY(calc.updateComponentsToInstall(QList<Component *>(), QList<Component *>() << componentE));
+        QCOMPARE(calc.orderedComponentsToInstall(), QList<Component *>() << componentC << componentD
+            << componentA << componentB);
+
+        // dropping these would need dropping their dependencies as well
+        QVERIFY(!calc.updateComponentsToInstall(QList<Component *>(), QList<Component *>() << componentB));
+        InstallerCalculator calc2(core.components(PackageManagerCore::ComponentType::AllNoReplacements));
+        QVERIFY(calc2.appendComponentsToInstall(QList<Component *>() << componentC));
+        QVERIFY(!calc2.updateComponentsToInstall(QList<Component *>(), QList<Component *>() << componentC));
+    }
+
+    void resolveAutoDependOnBenchmark_data()
+    {
+        QTest::addColumn<int>("componentCount");
+
+        QTest::newRow("5k components") << 5000;
+        QTest::newRow("50k components") << 50000;
+    }
+
+    void resolveAutoDependOnBenchmark()
+    {
+        QFETCH(int, componentCount);
+
+        // half of the components get selected, every other component auto depends on two of them
+        PackageManagerCore core;
+        core.setPackageManager();
+        QList<Component *> selectedComponents;
+        const int half = componentCount / 2;
+        for (int i = 0; i < half; ++i) {
+            NamedComponent *component = new NamedComponent(&core, QString::fromLatin1("base.%1").arg(i));
+            core.appendRootComponent(component);
+            selectedComponents.append(component);
+        }
+        for (int i = 0; i < half; ++i) {
+            NamedComponent *component = new NamedComponent(&core, QString::fromLatin1("addon.%1").arg(i));
+            component->addAutoDependOn(QString::fromLatin1("base.%1").arg(i));
+            component->addAutoDependOn(QString::fromLatin1("base.%1").arg((i + 1) % half));
+            core.appendRootComponent(component);
+        }
+        const QList<Component *> allComponents
+            = core.components(PackageManagerCore::ComponentType::AllNoReplacements);
+
+        int resultCount = 0;
+        QBENCHMARK {
+            InstallerCalculator calc(allComponents);
+            QVERIFY(calc.appendComponentsToInstall(selectedComponents));
+            resultCount = calc.orderedComponentsToInstall().count();
+        }
+        QCOMPARE(resultCount, componentCount);
+    }
+
     void unresolvedDependencyVersion_data()
     {
         QTest::addColumn<PackageManagerCore *>("core");
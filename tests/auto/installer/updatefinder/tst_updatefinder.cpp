@@ -0,0 +1,179 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include <localpackagehub.h>
+#include <update.h>
+#include <updatefinder.h>
+#include <updater.h>
+
+#include <QDir>
+#include <QFile>
+#include <QTcpServer>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTimer>
+
+using namespace KDUpdater;
+using namespace QInstaller;
+
+class tst_UpdateFinder : public QObject
+{
+    Q_OBJECT
+
+private:
+    struct Package {
+        QString name;
+        QString version;
+        int priority;
+    };
+
+    QString writeSource(const QString &name, const QList<Package> &packages)
+    {
+        const QString directory = m_dir.path() + QLatin1Char('/') + name;
+        if (!QDir().mkpath(directory))
+            return QString();
+
+        QFile file(directory + QLatin1String("/Updates.xml"));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return QString();
+        file.write("<Updates>\n"
+            "  <ApplicationName>{AnyApplication}</ApplicationName>\n"
+            "  <ApplicationVersion>1.0.0</ApplicationVersion>\n");
+        foreach (const Package &package, packages) {
+            file.write(QString::fromLatin1("  <PackageUpdate>\n"
+                "    <Name>%1</Name>\n"
+                "    <Version>%2</Version>\n"
+                "    <ReleaseDate>2020-01-01</ReleaseDate>\n"
+                "  </PackageUpdate>\n").arg(package.name, package.version).toUtf8());
+        }
+        file.write("</Updates>\n");
+        return directory;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(m_dir.isValid());
+        m_hub = std::make_shared<LocalPackageHub>();
+        m_hub->setFileName(m_dir.path() + QLatin1String("/components.xml"));
+        QVERIFY(m_hub->isValid());
+    }
+
+    void testResolutionMatchesSequentialOrder()
+    {
+        // the same packages in several sources, with different versions and priorities
+        QList<QList<Package> > sources;
+        for (int source = 0; source < 3; ++source) {
+            QList<Package> packages;
+            for (int i = 0; i < 60; ++i) {
+                if ((source == 1 && i % 2 != 0) || (source == 2 && i % 5 != 0))
+                    continue;
+                const Package package = { QString::fromLatin1("package%1").arg(i),
+                    QString::fromLatin1("1.%1").arg((i + source) % 3), source };
+                packages.append(package);
+            }
+            sources.append(packages);
+        }
+
+        // resolve one source after the other: the higher version wins, then the higher priority
+        QHash<QString, Package> expected;
+        QSet<PackageSource> packageSources;
+        for (int source = 0; source < sources.count(); ++source) {
+            const QString directory = writeSource(QString::fromLatin1("source%1").arg(source),
+                sources.at(source));
+            QVERIFY(!directory.isEmpty());
+            packageSources.insert(PackageSource(QUrl::fromLocalFile(directory), source));
+
+            foreach (const Package &package, sources.at(source)) {
+                if (!expected.contains(package.name)) {
+                    expected.insert(package.name, package);
+                    continue;
+                }
+                const Package existing = expected.value(package.name);
+                const int match = compareVersion(package.version, existing.version);
+                if (match > 0 || (match == 0 && package.priority > existing.priority))
+                    expected.insert(package.name, package);
+            }
+        }
+
+        UpdateFinder finder;
+        finder.setLocalPackageHub(m_hub);
+        finder.setPackageSources(packageSources);
+        finder.run();
+        QVERIFY(finder.isFinished());
+
+        const QList<Update *> updates = finder.updates();
+        QCOMPARE(updates.count(), expected.count());
+        foreach (const Update *update, updates) {
+            const QString name = update->data(QLatin1String("Name")).toString();
+            QVERIFY2(expected.contains(name), qPrintable(name));
+            QCOMPARE(update->data(QLatin1String("Version")).toString(),
+                expected.value(name).version);
+            QCOMPARE(update->packageSource().priority, expected.value(name).priority);
+        }
+    }
+
+    void testCancelWithQueuedDownloads()
+    {
+        // accepts connections but never answers, so the downloads only end when canceled
+        QTcpServer server;
+        QVERIFY(server.listen(QHostAddress::LocalHost));
+        int connections = 0;
+        connect(&server, &QTcpServer::newConnection, [&]() {
+            while (server.hasPendingConnections()) {
+                server.nextPendingConnection();
+                ++connections;
+            }
+        });
+
+        // more sources than downloads run at the same time
+        QSet<PackageSource> packageSources;
+        for (int i = 0; i < 10; ++i) {
+            packageSources.insert(PackageSource(QUrl(QString::fromLatin1("http://127.0.0.1:%1/%2")
+                .arg(server.serverPort()).arg(i)), 0));
+        }
+
+        UpdateFinder finder;
+        finder.setLocalPackageHub(m_hub);
+        finder.setPackageSources(packageSources);
+        QTimer::singleShot(500, &finder, &UpdateFinder::stop);
+        finder.run(); // returns only once the event loop waiting for the downloads quit
+
+        QVERIFY(finder.isStopped());
+        QVERIFY(finder.updates().isEmpty());
+        QVERIFY(connections <= 6);
+    }
+
+private:
+    QTemporaryDir m_dir;
+    std::shared_ptr<LocalPackageHub> m_hub;
+};
+
+QTEST_MAIN(tst_UpdateFinder)
+
+#include "tst_updatefinder.moc"
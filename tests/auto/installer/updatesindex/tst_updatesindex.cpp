@@ -0,0 +1,155 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include <updatesindex.h>
+
+#include <QDomDocument>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace QInstaller;
+
+class tst_UpdatesIndex : public QObject
+{
+    Q_OBJECT
+
+private:
+    static QDomDocument document(const QString &content)
+    {
+        QDomDocument doc;
+        doc.setContent(content);
+        return doc;
+    }
+
+    static QString packageUpdate(const QString &name, const QString &version)
+    {
+        return QString::fromLatin1("<PackageUpdate><Name>%1</Name><Version>%2</Version>"
+            "<UpdateFile OS=\"Any\" CompressedSize=\"10\" UncompressedSize=\"20\"/>"
+            "</PackageUpdate>").arg(name, version);
+    }
+
+    static QString updates(const QString &packages)
+    {
+        return QLatin1String("<Updates><ApplicationName>{AnyApplication}</ApplicationName>"
+            "<ApplicationVersion>1.0.0</ApplicationVersion><Checksum>true</Checksum>")
+            + packages + QLatin1String("</Updates>");
+    }
+
+private slots:
+    void testChecksumIgnoresFormatting()
+    {
+        const QDomDocument first = document(QLatin1String("<PackageUpdate><Name>A</Name>"
+            "<UpdateFile OS=\"Any\" CompressedSize=\"10\"/></PackageUpdate>"));
+        const QDomDocument second = document(QLatin1String("<PackageUpdate>\n  <Name>A</Name>\n"
+            "  <UpdateFile CompressedSize=\"10\" OS=\"Any\" />\n</PackageUpdate>"));
+        const QDomDocument third = document(QLatin1String("<PackageUpdate><Name>A</Name>"
+            "<UpdateFile OS=\"Any\" CompressedSize=\"11\"/></PackageUpdate>"));
+
+        QCOMPARE(UpdatesIndex::hashPackageUpdate(first.documentElement()),
+            UpdatesIndex::hashPackageUpdate(second.documentElement()));
+        QVERIFY(UpdatesIndex::hashPackageUpdate(first.documentElement())
+            != UpdatesIndex::hashPackageUpdate(third.documentElement()));
+    }
+
+    void testWriteAndRead()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QString fileName = dir.path() + QLatin1Char('/') + UpdatesIndex::fileName();
+
+        UpdatesIndex index = UpdatesIndex::fromUpdates(document(updates(packageUpdate(
+            QLatin1String("A"), QLatin1String("1.0")) + packageUpdate(QLatin1String("B"),
+            QLatin1String("2.0")))));
+        QVERIFY(!index.isValid());
+        index.setGeneration(7);
+        QVERIFY(index.write(fileName));
+
+        UpdatesIndex read;
+        QVERIFY(read.read(fileName));
+        QCOMPARE(read.generation(), quint64(7));
+        QCOMPARE(read.headerSha1(), index.headerSha1());
+        QCOMPARE(read.packages().count(), 2);
+        QCOMPARE(read.packages().at(0).name, QLatin1String("A"));
+        QCOMPARE(read.packages().at(1).name, QLatin1String("B"));
+        QVERIFY(read.hasSameContent(index));
+
+        QFile file(fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("<Updates/>");
+        file.close();
+        QString error;
+        QVERIFY(!read.read(fileName, &error));
+        QVERIFY(!error.isEmpty());
+        QVERIFY(!read.isValid());
+    }
+
+    void testApplyChangedPackages()
+    {
+        const QString a = packageUpdate(QLatin1String("A"), QLatin1String("1.0"));
+        const QString b = packageUpdate(QLatin1String("B"), QLatin1String("1.0"));
+        const QString newB = packageUpdate(QLatin1String("B"), QLatin1String("1.1"));
+        const QString c = packageUpdate(QLatin1String("C"), QLatin1String("1.0"));
+
+        QDomDocument cached = document(updates(a + b + c));
+        const QDomDocument current = document(updates(newB + a));
+        UpdatesIndex index = UpdatesIndex::fromUpdates(current);
+        index.setGeneration(2);
+
+        QCOMPARE(index.changedPackages(cached), QStringList(QLatin1String("B")));
+        QVERIFY(!index.describes(cached));
+
+        QHash<QString, QDomElement> packageUpdates;
+        QVERIFY(!index.apply(&cached, packageUpdates)); // B is outdated
+        cached = document(updates(a + b + c));
+
+        const QDomDocument fragment = document(newB);
+        packageUpdates.insert(QLatin1String("B"), fragment.documentElement());
+        QString error;
+        QVERIFY2(index.apply(&cached, packageUpdates, &error), qPrintable(error));
+        QVERIFY(index.describes(cached));
+        QVERIFY(index.changedPackages(cached).isEmpty());
+    }
+
+    void testApplyRejectsChangedHeader()
+    {
+        const QString a = packageUpdate(QLatin1String("A"), QLatin1String("1.0"));
+        QDomDocument cached = document(updates(a));
+        QDomDocument current = document(updates(a));
+        current.documentElement().firstChildElement(QLatin1String("Checksum"))
+            .firstChild().setNodeValue(QLatin1String("false"));
+
+        UpdatesIndex index = UpdatesIndex::fromUpdates(current);
+        index.setGeneration(1);
+        QVERIFY(index.headerSha1() != UpdatesIndex::hashHeader(cached));
+        QVERIFY(!index.apply(&cached, QHash<QString, QDomElement>()));
+    }
+};
+
+QTEST_MAIN(tst_UpdatesIndex)
+
+#include "tst_updatesindex.moc"
@@ -0,0 +1,149 @@
+/**************************************************************************
+**
+** Copyright (C) 2020 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the Qt Installer Framework.
+**
+** $QT_BEGIN_LICENSE:GPL-EXCEPT$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3 as published by the Free Software
+** Foundation with exceptions as appearing in the file LICENSE.GPL3-EXCEPT
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+**************************************************************************/
+
+#include "updatesinfo_p.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace KDUpdater;
+
+class tst_UpdatesInfo : public QObject
+{
+    Q_OBJECT
+
+private:
+    QString writeUpdatesXml(const QByteArray &content)
+    {
+        const QString fileName = m_dir.path() + QLatin1String("/Updates.xml");
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return QString();
+        file.write(content);
+        return fileName;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        QVERIFY(m_dir.isValid());
+    }
+
+    void testParse()
+    {
+        const QString fileName = writeUpdatesXml(
+            "<Updates>\n"
+            "  <ApplicationName>{AnyApplication}</ApplicationName>\n"
+            "  <ApplicationVersion>1.0.0</ApplicationVersion>\n"
+            "  <Checksum>true</Checksum>\n"
+            "  <RepositoryUpdate>\n"
+            "    <Repository action=\"add\" url=\"http://example.com/extra\" displayname=\"Extra\"/>\n"
+            "  </RepositoryUpdate>\n"
+            "  <PackageUpdate>\n"
+            "    <Name>A</Name>\n"
+            "    <Version inheritVersionFrom=\"B\">1.0</Version>\n"
+            "    <ReleaseDate>2020-01-01</ReleaseDate>\n"
+            "    <Description>Plain &amp; simple</Description>\n"
+            "    <UpdateFile OS=\"Any\" CompressedSize=\"10\" UncompressedSize=\"20\"/>\n"
+            "    <Licenses>\n"
+            "      <License name=\"License\" file=\"license.txt\"/>\n"
+            "    </Licenses>\n"
+            "    <UserInterfaces>\n"
+            "      <UserInterface>page.ui</UserInterface>\n"
+            "    </UserInterfaces>\n"
+            "  </PackageUpdate>\n"
+            "  <PackageUpdate>\n"
+            "    <Name>B</Name>\n"
+            "    <Version>2.0</Version>\n"
+            "    <ReleaseDate>2020-01-01</ReleaseDate>\n"
+            "    <DisplayName>  </DisplayName>\n"
+            "    <Description>one &amp; <!-- note --> two</Description>\n"
+            "  </PackageUpdate>\n"
+            "</Updates>\n");
+
+        UpdatesInfo info;
+        info.setFileName(fileName);
+        QVERIFY2(info.isValid(), qPrintable(info.errorString()));
+        QCOMPARE(info.applicationName(), QLatin1String("{AnyApplication}"));
+        QCOMPARE(info.applicationVersion(), QLatin1String("1.0.0"));
+        QVERIFY(info.hasChecksum());
+        QCOMPARE(info.checksum(), QLatin1String("true"));
+
+        QCOMPARE(info.repositoryUpdates().count(), 1);
+        const RepositoryUpdateInfo update = info.repositoryUpdates().first();
+        QCOMPARE(update.attributes.value(QLatin1String("action")), QLatin1String("add"));
+        QCOMPARE(update.attributes.value(QLatin1String("displayname")), QLatin1String("Extra"));
+        QCOMPARE(update.lineNumber, qint64(6));
+
+        QCOMPARE(info.updateInfoCount(), 2);
+        const QHash<QString, QVariant> a = info.updateInfo(0).data;
+        QCOMPARE(a.value(QLatin1String("Name")).toString(), QLatin1String("A"));
+        QCOMPARE(a.value(QLatin1String("Version")).toString(), QLatin1String("1.0"));
+        QCOMPARE(a.value(QLatin1String("inheritVersionFrom")).toString(), QLatin1String("B"));
+        QCOMPARE(a.value(QLatin1String("Description")).toString(), QLatin1String("Plain & simple"));
+        QCOMPARE(a.value(QLatin1String("CompressedSize")).toString(), QLatin1String("10"));
+        QCOMPARE(a.value(QLatin1String("UncompressedSize")).toString(), QLatin1String("20"));
+        QCOMPARE(a.value(QLatin1String("UserInterfaces")).toString(), QLatin1String("page.ui"));
+        QCOMPARE(a.value(QLatin1String("Licenses")).toHash().value(QLatin1String("License"))
+            .toString(), QLatin1String("license.txt"));
+
+        const QHash<QString, QVariant> b = info.updateInfo(1).data;
+        QCOMPARE(b.value(QLatin1String("Name")).toString(), QLatin1String("B"));
+        QVERIFY(!b.contains(QLatin1String("Licenses")));
+        // whitespace only text is dropped, whitespace around other text kept
+        QCOMPARE(b.value(QLatin1String("DisplayName")).toString(), QString());
+        QCOMPARE(b.value(QLatin1String("Description")).toString(), QLatin1String("one &  two"));
+    }
+
+    void testErrors()
+    {
+        UpdatesInfo info;
+        info.setFileName(writeUpdatesXml("<Updates><ApplicationName>A</ApplicationName>"
+            "<ApplicationVersion>1</ApplicationVersion><PackageUpdate><Name>A</Name>"
+            "</PackageUpdate></Updates>"));
+        QCOMPARE(info.error(), UpdatesInfo::InvalidContentError);
+
+        // a syntax error later in the file wins over invalid content before it
+        UpdatesInfo broken;
+        broken.setFileName(writeUpdatesXml("<Updates><PackageUpdate><Name>A</Name>"
+            "</PackageUpdate><Broken></Updates>"));
+        QCOMPARE(broken.error(), UpdatesInfo::InvalidXmlError);
+
+        UpdatesInfo missing;
+        missing.setFileName(m_dir.path() + QLatin1String("/Missing.xml"));
+        QCOMPARE(missing.error(), UpdatesInfo::CouldNotReadUpdateInfoFileError);
+    }
+
+private:
+    QTemporaryDir m_dir;
+};
+
+QTEST_MAIN(tst_UpdatesInfo)
+
+#include "tst_updatesinfo.moc"
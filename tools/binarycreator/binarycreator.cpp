@@ -785,6 +785,7 @@ int main(int argc, char **argv)
     QInstallerTools::FilterType ftype = QInstallerTools::Exclude;
     bool compileResource = false;
     QString signingIdentity;
+    int jobs = 0;
 
     const QStringList args = app.arguments().mid(1);
     for (QStringList::const_iterator it = args.begin(); it != args.end(); ++it) {
@@ -880,6 +881,13 @@ int main(int argc, char **argv)
         } else if (*it == QLatin1String("--ignore-translations")
             || *it == QLatin1String("--ignore-invalid-packages")) {
                 continue;
+        } else if (*it == QLatin1String("-j") || *it == QLatin1String("--jobs")) {
+            ++it;
+            bool ok = false;
+            if (it != args.end())
+                jobs = it->toInt(&ok);
+            if (!ok || jobs < 1)
+                return printErrorAndUsageAndExit(QString::fromLatin1("Error: Jobs parameter needs a positive number."));
         } else if (*it == QLatin1String("-rcc") || *it == QLatin1String("--compile-resource")) {
             compileResource = true;
 #ifdef Q_OS_OSX
@@ -961,7 +969,7 @@ int main(int argc, char **argv)
             // 2.2; copy the packages data and setup the packages vector with the files we copied,
             //    must happen before copying meta data because files will be compressed if
             //    needed and meta data generation relies on this
-            QInstallerTools::copyComponentData(packagesDirectories, tmpRepoDir, &preparedPackages);
+            QInstallerTools::copyComponentData(packagesDirectories, tmpRepoDir, &preparedPackages, jobs);
             // 2.3; add to common vector
             packages.append(preparedPackages);
         }
@@ -38,6 +38,7 @@
 #include <lib7z_list.h>
 #include <settings.h>
 #include <qinstallerglobal.h>
+#include <updatesindex.h>
 #include <utils.h>
 #include <scriptengine.h>
 
@@ -45,9 +46,14 @@
 
 #include <QtCore/QDirIterator>
 #include <QtCore/QRegExp>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+
+#include <QtConcurrentRun>
 
 #include <QtXml/QDomDocument>
 
+#include <exception>
 #include <iostream>
 
 using namespace QInstaller;
@@ -67,6 +73,9 @@ void QInstallerTools::printRepositoryGenOptions()
     std::cout << "  --ignore-translations     Do not use any translation" << std::endl;
     std::cout << "  --ignore-invalid-packages Ignore all invalid packages instead of aborting." << std::endl;
     std::cout << "  --ignore-invalid-repositories Ignore all invalid repositories instead of aborting." << std::endl;
+    std::cout << "  -j|--jobs n               Compress up to n packages at the same time. Defaults to" << std::endl;
+    std::cout << "                            the number of processor cores. The cores are split" << std::endl;
+    std::cout << "                            between the packages compressed at the same time." << std::endl;
 }
 
 QString QInstallerTools::makePathAbsolute(const QString &path)
@@ -625,6 +634,54 @@ QHash<QString, QString> QInstallerTools::buildPathToVersionMapping(const Package
     return map;
 }
 
+/*
+    Calls \a task for every index below \a count, running at most \a jobs of them at the same
+    time. Once all tasks are done, the exception of the failed task with the lowest index is
+    rethrown. The tasks must only touch data belonging to their index, so that the result does
+    not depend on the order they are scheduled in.
+*/
+template <typename Task>
+static void runConcurrently(int count, int jobs, const Task &task)
+{
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(jobs > 0 ? jobs : QThread::idealThreadCount());
+
+    QAtomicInt failed;
+    QVector<std::exception_ptr> errors(count);
+    std::exception_ptr *const errorOf = errors.data(); // detached once, before any task runs
+    QVector<QFuture<void> > futures;
+    for (int i = 0; i < count; ++i) {
+        futures.append(QtConcurrent::run(&threadPool, [&, i]() {
+            if (failed.load())
+                return; // do not start new work once something went wrong
+            try {
+                task(i);
+            } catch (...) {
+                errorOf[i] = std::current_exception();
+                failed.store(1);
+            }
+        }));
+    }
+
+    foreach (QFuture<void> future, futures)
+        future.waitForFinished();
+    foreach (const std::exception_ptr &error, errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
+/*
+    Returns the number of threads each archive is compressed with when \a jobs archives are
+    created at the same time, so that all of them together do not use more threads, and
+    dictionary memory, than there are processor cores.
+*/
+static int compressionThreadCount(int jobs)
+{
+    const int idealThreadCount = qMax(1, QThread::idealThreadCount());
+    return qMax(1, idealThreadCount / (jobs > 0 ? jobs : idealThreadCount));
+}
+
 static void writeSHA1ToNodeWithName(QDomDocument &doc, QDomNodeList &list, const QByteArray &sha1sum,
     const QString &nodename)
 {
@@ -656,7 +713,7 @@ static void writeSHA1ToNodeWithName(QDomDocument &doc, QDomNodeList &list, const
 }
 
 void QInstallerTools::compressMetaDirectories(const QString &repoDir, const QString &baseDir,
-    const QHash<QString, QString> &versionMapping)
+    const QHash<QString, QString> &versionMapping, int jobs)
 {
     QDomDocument doc;
     QDomElement root;
@@ -671,31 +728,41 @@ void QInstallerTools::compressMetaDirectories(const QString &repoDir, const QStr
 
     QDir dir(repoDir);
     const QStringList sub = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-    QDomNodeList elements =  doc.elementsByTagName(QLatin1String("PackageUpdate"));
-    foreach (const QString &i, sub) {
+    QVector<QByteArray> sha1Sums(sub.count());
+    QByteArray *const sha1SumOf = sha1Sums.data();
+    const int threadCount = compressionThreadCount(jobs);
+    runConcurrently(sub.count(), jobs, [&](int i) {
         QDir sd(dir);
-        sd.cd(i);
-        const QString path = QString(i).remove(baseDir);
+        sd.cd(sub.at(i));
+        const QString path = QString(sub.at(i)).remove(baseDir);
         const QString versionPrefix = versionMapping[path];
         if (path.isNull())
-            continue;
+            return;
         const QString absPath = sd.absolutePath();
         const QString fn = QLatin1String(versionPrefix.toLatin1() + "meta.7z");
-        const QString tmpTarget = repoDir + QLatin1String("/") +fn;
-        Lib7z::createArchive(tmpTarget, QStringList() << absPath, Lib7z::QTmpFile::No);
+        // packages are compressed at the same time and may share a version, name them apart
+        const QString tmpTarget = repoDir + QLatin1String("/") + sub.at(i) + QLatin1Char('-') + fn;
+        Lib7z::createArchive(tmpTarget, QStringList() << absPath, Lib7z::QTmpFile::No,
+            Lib7z::Compression::Normal, nullptr, threadCount);
 
         // remove the files that got compressed
         QInstaller::removeFiles(absPath, true);
 
         QFile tmp(tmpTarget);
         tmp.open(QFile::ReadOnly);
-        const QByteArray sha1Sum = QInstaller::calculateHash(&tmp, QCryptographicHash::Sha1);
-        writeSHA1ToNodeWithName(doc, elements, sha1Sum, path);
+        sha1SumOf[i] = QInstaller::calculateHash(&tmp, QCryptographicHash::Sha1);
         const QString finalTarget = absPath + QLatin1String("/") + fn;
         if (!tmp.rename(finalTarget)) {
             throw QInstaller::Error(QString::fromLatin1("Cannot move file \"%1\" to \"%2\".").arg(
                                         QDir::toNativeSeparators(tmpTarget), QDir::toNativeSeparators(finalTarget)));
         }
+    });
+
+    // update the document in directory order, independent of which archive finished first
+    QDomNodeList elements =  doc.elementsByTagName(QLatin1String("PackageUpdate"));
+    for (int i = 0; i < sub.count(); ++i) {
+        if (!sha1Sums.at(i).isNull())
+            writeSHA1ToNodeWithName(doc, elements, sha1Sums.at(i), QString(sub.at(i)).remove(baseDir));
     }
 
     QInstaller::openForWrite(&existingUpdatesXml);
@@ -704,10 +771,13 @@ void QInstallerTools::compressMetaDirectories(const QString &repoDir, const QStr
 }
 
 void QInstallerTools::copyComponentData(const QStringList &packageDirs, const QString &repoDir,
-    PackageInfoVector *const infos)
+    PackageInfoVector *const infos, int jobs)
 {
-    for (int i = 0; i < infos->count(); ++i) {
-        const PackageInfo info = infos->at(i);
+    // detach once up front, every task then only writes the copied files of its own package
+    PackageInfo *const packages = infos->data();
+    const int threadCount = compressionThreadCount(jobs);
+    runConcurrently(infos->count(), jobs, [&](int i) {
+        PackageInfo &info = packages[i];
         const QString name = info.name;
         qDebug() << "Copying component data for" << name;
 
@@ -742,7 +812,7 @@ void QInstallerTools::copyComponentData(const QStringList &packageDirs, const QS
                         qDebug() << "Compressing data directory" << entry;
                         QString target = QString::fromLatin1("%1/%3%2.7z").arg(namedRepoDir, entry, info.version);
                         Lib7z::createArchive(target, QStringList() << dataDir.absoluteFilePath(entry),
-                            Lib7z::QTmpFile::No);
+                            Lib7z::QTmpFile::No, Lib7z::Compression::Normal, nullptr, threadCount);
                         compressedFiles.append(target);
                     } else if (fileInfo.isSymLink()) {
                         filesToCompress.append(dataDir.absoluteFilePath(entry));
@@ -754,12 +824,13 @@ void QInstallerTools::copyComponentData(const QStringList &packageDirs, const QS
                 qDebug() << "Compressing files found in data directory:" << filesToCompress;
                 QString target = QString::fromLatin1("%1/%3%2").arg(namedRepoDir, QLatin1String("content.7z"),
                     info.version);
-                Lib7z::createArchive(target, filesToCompress, Lib7z::QTmpFile::No);
+                Lib7z::createArchive(target, filesToCompress, Lib7z::QTmpFile::No,
+                    Lib7z::Compression::Normal, nullptr, threadCount);
                 compressedFiles.append(target);
             }
 
             foreach (const QString &target, compressedFiles) {
-                (*infos)[i].copiedFiles.append(target);
+                info.copiedFiles.append(target);
 
                 QFile archiveFile(target);
                 QFile archiveHashFile(archiveFile.fileName() + QLatin1String(".sha1"));
@@ -776,7 +847,7 @@ void QInstallerTools::copyComponentData(const QStringList &packageDirs, const QS
                     QInstaller::openForWrite(&archiveHashFile);
                     archiveHashFile.write(hashOfArchiveData);
                     qDebug() << "Generated sha1 hash:" << hashOfArchiveData;
-                    (*infos)[i].copiedFiles.append(archiveHashFile.fileName());
+                    info.copiedFiles.append(archiveHashFile.fileName());
                     archiveHashFile.close();
                 } catch (const QInstaller::Error &/*e*/) {
                     archiveFile.close();
@@ -785,7 +856,7 @@ void QInstallerTools::copyComponentData(const QStringList &packageDirs, const QS
                 }
             }
         } else {
-            foreach (const QString &file, (*infos)[i].copiedFiles) {
+            foreach (const QString &file, info.copiedFiles) {
                 QFileInfo fromInfo(file);
                 QFile from(file);
                 QString target = QString::fromLatin1("%1/%2").arg(namedRepoDir, fromInfo.fileName());
@@ -796,5 +867,62 @@ void QInstallerTools::copyComponentData(const QStringList &packageDirs, const QS
                 }
             }
         }
+    });
+}
+
+void QInstallerTools::writeUpdatesIndex(const QString &repoDir)
+{
+    QFile updatesXml(repoDir + QLatin1String("/Updates.xml"));
+    QInstaller::openForRead(&updatesXml);
+    QString error;
+    QDomDocument doc;
+    if (!doc.setContent(&updatesXml, &error)) {
+        throw QInstaller::Error(QString::fromLatin1("Cannot read \"%1\": %2")
+            .arg(QDir::toNativeSeparators(updatesXml.fileName()), error));
+    }
+    updatesXml.close();
+
+    // the generation only moves on if the content changed, so unchanged clients stay idle
+    const QString indexFile = repoDir + QLatin1Char('/') + UpdatesIndex::fileName();
+    UpdatesIndex previous;
+    if (QFile::exists(indexFile) && !previous.read(indexFile, &error))
+        qDebug() << "Ignoring existing index:" << error;
+    UpdatesIndex index = UpdatesIndex::fromUpdates(doc);
+    index.setGeneration(index.hasSameContent(previous) ? previous.generation()
+        : previous.generation() + 1);
+
+    const QDomElement root = doc.documentElement();
+    for (QDomElement element = root.firstChildElement(QLatin1String("PackageUpdate"));
+        !element.isNull(); element = element.nextSiblingElement(QLatin1String("PackageUpdate"))) {
+        QDomDocument packageUpdate;
+        packageUpdate.appendChild(packageUpdate.importNode(element, true));
+
+        QFile file(repoDir + QLatin1Char('/')
+            + UpdatesIndex::packageUpdateFileName(UpdatesIndex::packageName(element)));
+        QInstaller::openForWrite(&file);
+        QInstaller::blockingWrite(&file, packageUpdate.toByteArray());
+    }
+
+    if (!index.write(indexFile, &error))
+        throw QInstaller::Error(error);
+    qDebug() << "Generated" << UpdatesIndex::fileName() << "generation" << index.generation();
+}
+
+void QInstallerTools::removeUpdatesIndex(const QString &repoDir)
+{
+    // neither the index nor the package files would describe Updates.xml any longer
+    const QDir dir(repoDir);
+    foreach (const QString &package, dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        const QString file = dir.absoluteFilePath(UpdatesIndex::packageUpdateFileName(package));
+        if (QFile::exists(file) && !QFile::remove(file)) {
+            throw QInstaller::Error(QString::fromLatin1("Cannot remove \"%1\".")
+                .arg(QDir::toNativeSeparators(file)));
+        }
+    }
+
+    const QString indexFile = dir.absoluteFilePath(UpdatesIndex::fileName());
+    if (QFile::exists(indexFile) && !QFile::remove(indexFile)) {
+        throw QInstaller::Error(QString::fromLatin1("Cannot remove \"%1\".")
+            .arg(QDir::toNativeSeparators(indexFile)));
     }
 }
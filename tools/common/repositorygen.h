@@ -67,11 +67,14 @@ PackageInfoVector createListOfRepositoryPackages(const QStringList &repositoryDi
 QHash<QString, QString> buildPathToVersionMapping(const PackageInfoVector &info);
 
 void compressMetaDirectories(const QString &repoDir, const QString &baseDir,
-    const QHash<QString, QString> &versionMapping);
+    const QHash<QString, QString> &versionMapping, int jobs = 0);
 
 void copyMetaData(const QString &outDir, const QString &dataDir, const PackageInfoVector &packages,
     const QString &appName, const QString& appVersion);
-void copyComponentData(const QStringList &packageDir, const QString &repoDir, PackageInfoVector *const infos);
+void copyComponentData(const QStringList &packageDir, const QString &repoDir, PackageInfoVector *const infos,
+    int jobs = 0);
+void writeUpdatesIndex(const QString &repoDir);
+void removeUpdatesIndex(const QString &repoDir);
 
 
 } // namespace QInstallerTools
@@ -66,6 +66,10 @@ static void printUsage()
     std::cout << "                            --include or --exclude) in the repository with all new components"
         << std::endl;
 
+    std::cout << "  --updates-index           Write an index of Updates.xml and a PackageUpdate.xml" << std::endl;
+    std::cout << "                            per package, so that clients can fetch only the" << std::endl;
+    std::cout << "                            changed packages." << std::endl;
+
     std::cout << "  -v|--verbose              Verbose output" << std::endl;
 
     std::cout << std::endl;
@@ -99,6 +103,8 @@ int main(int argc, char** argv)
         QInstallerTools::FilterType filterType = QInstallerTools::Exclude;
         bool remove = false;
         bool updateExistingRepositoryWithNewComponents = false;
+        bool updatesIndex = false;
+        int jobs = 0;
 
         //TODO: use a for loop without removing values from args like it is in binarycreator.cpp
         //for (QStringList::const_iterator it = args.begin(); it != args.end(); ++it) {
@@ -143,6 +149,9 @@ int main(int argc, char** argv)
             } else if (args.first() == QLatin1String("--update-new-components")) {
                 args.removeFirst();
                 updateExistingRepositoryWithNewComponents = true;
+            } else if (args.first() == QLatin1String("--updates-index")) {
+                args.removeFirst();
+                updatesIndex = true;
             } else if (args.first() == QLatin1String("-p") || args.first() == QLatin1String("--packages")) {
                 args.removeFirst();
                 if (args.isEmpty()) {
@@ -173,6 +182,15 @@ int main(int argc, char** argv)
             } else if (args.first() == QLatin1String("--ignore-translations")
                 || args.first() == QLatin1String("--ignore-invalid-packages")) {
                     args.removeFirst();
+            } else if (args.first() == QLatin1String("-j") || args.first() == QLatin1String("--jobs")) {
+                args.removeFirst();
+                bool ok = false;
+                jobs = args.isEmpty() ? 0 : args.first().toInt(&ok);
+                if (!ok || jobs < 1) {
+                    return printErrorAndUsageAndExit(QCoreApplication::translate("QInstaller",
+                        "Error: Jobs parameter needs a positive number."));
+                }
+                args.removeFirst();
             } else if (args.first() == QLatin1String("-r") || args.first() == QLatin1String("--remove")) {
                 remove = true;
                 args.removeFirst();
@@ -275,10 +293,10 @@ int main(int argc, char** argv)
         QStringList directories;
         directories.append(packagesDirectories);
         directories.append(repositoryDirectories);
-        QInstallerTools::copyComponentData(directories, repositoryDir, &packages);
+        QInstallerTools::copyComponentData(directories, repositoryDir, &packages, jobs);
         QInstallerTools::copyMetaData(tmpMetaDir, repositoryDir, packages, QLatin1String("{AnyApplication}"),
             QLatin1String(QUOTE(IFW_REPOSITORY_FORMAT_VERSION)));
-        QInstallerTools::compressMetaDirectories(tmpMetaDir, tmpMetaDir, pathToVersionMapping);
+        QInstallerTools::compressMetaDirectories(tmpMetaDir, tmpMetaDir, pathToVersionMapping, jobs);
 
         QDirIterator it(repositoryDir, QStringList(QLatin1String("Updates*.xml")), QDir::Files | QDir::CaseSensitive);
         while (it.hasNext()) {
@@ -286,6 +304,11 @@ int main(int argc, char** argv)
             QFile::remove(it.fileInfo().absoluteFilePath());
         }
         QInstaller::moveDirectoryContents(tmpMetaDir, repositoryDir);
+
+        if (updatesIndex)
+            QInstallerTools::writeUpdatesIndex(repositoryDir);
+        else
+            QInstallerTools::removeUpdatesIndex(repositoryDir);
         exitCode = EXIT_SUCCESS;
     } catch (const Lib7z::SevenZipException &e) {
         std::cerr << "Caught 7zip exception: " << e.message() << std::endl;